@@ -0,0 +1,263 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Live migration of allocator ranges between two simulated devices.
+//
+// The ranges of --tensors allocations are filled with a known pattern on device 0, then moved to device 1 with
+// VmmAllocator::migrate_step, --budget-mb per serving step. Between the steps the "model" keeps reading every range
+// and writing to it through device 0, as a serving loop would. The simulated driver backs its handles with host
+// memory, so the run checks that
+//
+//   - the content of every range survives the migration, the writes made between the steps included
+//   - the virtual addresses never change, and device 0 keeps access to the migrated memory
+//   - the memory of device 0 is released once the ranges moved, and nothing leaks once they are freed
+//   - a migration the target device cannot hold fails and leaves its range mapped on device 0
+//
+// and reports the driver time stalled per step against the budget.
+//
+// Build & run :
+//
+//   g++ -O2 -std=c++17 -I include/vtensor -I $CUDA_HOME/include -pthread -o migration_sim
+//       benchmarks/migration_sim.cpp benchmarks/sim_driver.cpp src/allocator/*.cpp -lrt
+//   ./migration_sim --tensors 8 --tensor-mb 64 --budget-mb 32
+//
+// or cmake -DVTENSOR_BUILD_BENCHMARKS=ON, target vtensor_migration_sim. Exits with 1 if a check fails.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "allocator/vmm_allocator.h"
+#include "sim_driver.h"
+
+using namespace nvgpu;
+
+struct Options {
+    int tensors = 8;
+    size_t tensor_bytes = 64ULL << 20;
+    size_t budget_bytes = 32ULL << 20;
+    bool verbose = false;
+};
+
+struct Range {
+    CUdeviceptr ptr = 0;
+    size_t size = 0;
+    // content the range must hold
+    std::vector<unsigned char> expected;
+};
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED : %s\n", what.c_str());
+        failures++;
+    }
+}
+
+static bool content_matches(const Range& range) {
+    std::vector<unsigned char> bytes(range.size);
+    if (cuMemcpyDtoH(bytes.data(), range.ptr, range.size) != CUDA_SUCCESS) {
+        return false;
+    }
+    return bytes == range.expected;
+}
+
+// one byte of the range changes, as a kernel of the serving loop would
+static void write_byte(Range& range, size_t offset, unsigned char value) {
+    check(cuMemcpyHtoD(range.ptr + offset, &value, 1) == CUDA_SUCCESS, "write to the range at " + std::to_string(range.ptr));
+    range.expected[offset] = value;
+}
+
+// returns the saved stdout descriptor
+static int silence_stdout() {
+    std::cout.flush();
+    std::fflush(stdout);
+    int saved_fd = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved_fd;
+}
+
+static void restore_stdout(int saved_fd) {
+    if (saved_fd < 0) {
+        return;
+    }
+    std::cout.flush();
+    std::fflush(stdout);
+    dup2(saved_fd, STDOUT_FILENO);
+    close(saved_fd);
+}
+
+static void usage(const char* name) {
+    std::fprintf(stderr, "usage : %s [--tensors N] [--tensor-mb MB] [--budget-mb MB] [--verbose]\n", name);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--tensors" && has_value) {
+            options.tensors = std::atoi(argv[++i]);
+        } else if (arg == "--tensor-mb" && has_value) {
+            options.tensor_bytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+        } else if (arg == "--budget-mb" && has_value) {
+            options.budget_bytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.tensors <= 0 || options.tensor_bytes == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    sim::DriverConfig config;
+    config.num_devices = 2;
+    config.backing = true;
+    config.device_capacity = (size_t)options.tensors * options.tensor_bytes + (256ULL << 20);
+    sim::configure(config);
+
+    int stdout_fd = options.verbose ? -1 : silence_stdout();
+    std::unique_ptr<VmmAllocator> allocator(new VmmAllocator());
+    allocator->slab_enabled = false;
+
+    // 1. the ranges live on device 0
+    std::vector<Range> ranges(options.tensors);
+    for (int i = 0; i < options.tensors; i++) {
+        Range& range = ranges[i];
+        range.size = options.tensor_bytes;
+        range.ptr = reinterpret_cast<CUdeviceptr>(allocator->alloc(range.size, 0, nullptr));
+        range.expected.resize(range.size);
+        for (size_t b = 0; b < range.size; b++) {
+            range.expected[b] = (unsigned char)(b * 31 + i * 7 + (b >> 12));
+        }
+        check(cuMemcpyHtoD(range.ptr, range.expected.data(), range.size) == CUDA_SUCCESS, "fill range " + std::to_string(i));
+    }
+    sim::DriverStats before = sim::stats();
+
+    // 2. move them to device 1, one budget per step, round robin
+    for (auto& range : ranges) {
+        allocator->migrate_begin(reinterpret_cast<void *>(range.ptr), 1);
+    }
+    std::vector<double> stalls;
+    std::vector<size_t> left(ranges.size(), options.tensor_bytes);
+    size_t next = 0;
+    while (std::any_of(left.begin(), left.end(), [](size_t bytes) { return bytes > 0; })) {
+        while (left[next] == 0) {
+            next = (next + 1) % ranges.size();
+        }
+        double start_us = sim::modeled_us();
+        left[next] = allocator->migrate_step(reinterpret_cast<void *>(ranges[next].ptr), options.budget_bytes);
+        stalls.push_back(sim::modeled_us() - start_us);
+
+        // the serving loop runs between the steps : it updates a page already moved and one still on device 0
+        Range& range = ranges[next];
+        size_t moved = range.size - left[next];
+        write_byte(range, moved > 0 ? moved - 1 : 0, (unsigned char)stalls.size());
+        write_byte(range, range.size - 1, (unsigned char)(stalls.size() * 3));
+        check(content_matches(range), "content of range " + std::to_string(next) + " after step " + std::to_string(stalls.size()));
+        next = (next + 1) % ranges.size();
+    }
+    sim::DriverStats after = sim::stats();
+    restore_stdout(stdout_fd);
+
+    // 3. same addresses, memory of device 1, still readable from device 0
+    for (size_t i = 0; i < ranges.size(); i++) {
+        const Range& range = ranges[i];
+        check(content_matches(range), "content of range " + std::to_string(i) + " once migrated");
+        for (size_t offset = 0; offset < range.size; offset += config.granularity) {
+            std::vector<int> access = sim::access_of(range.ptr + offset);
+            check(sim::device_of(range.ptr + offset) == 1, "range " + std::to_string(i) + " is on device 1");
+            check(std::count(access.begin(), access.end(), 0) == 1 && std::count(access.begin(), access.end(), 1) == 1,
+                  "devices 0 and 1 access range " + std::to_string(i));
+        }
+    }
+    check(after.used_per_device[0] == 0, "the memory of device 0 is released");
+    check(after.used_per_device[1] == before.used_per_device[0], "device 1 holds the migrated memory");
+
+    MigrationStats migration = allocator->migration_stats();
+    double max_stall = 0, total_stall = 0;
+    for (double stall : stalls) {
+        max_stall = std::max(max_stall, stall);
+        total_stall += stall;
+    }
+    std::printf("migrated %zu ranges of %.1f MiB to device 1 in %zu steps, budget %.1f MiB per step\n",
+                migration.completed, options.tensor_bytes / 1048576.0, stalls.size(), options.budget_bytes / 1048576.0);
+    std::printf("pages moved : %zu (%.1f MiB)\n", migration.pages, migration.bytes / 1048576.0);
+    std::printf("modeled stall per step (us) : mean %.1f, max %.1f, total %.1f\n",
+                total_stall / std::max<size_t>(stalls.size(), 1), max_stall, total_stall);
+    std::printf("device used (MiB) : device 0 %.1f -> %.1f, device 1 %.1f -> %.1f\n",
+                before.used_per_device[0] / 1048576.0, after.used_per_device[0] / 1048576.0,
+                before.used_per_device[1] / 1048576.0, after.used_per_device[1] / 1048576.0);
+
+    // 4. a step the target cannot hold leaves the range mapped where it was
+    stdout_fd = options.verbose ? -1 : silence_stdout();
+    Range stuck;
+    stuck.size = options.tensor_bytes;
+    stuck.ptr = reinterpret_cast<CUdeviceptr>(allocator->alloc(stuck.size, 0, nullptr));
+    stuck.expected.assign(stuck.size, 0x5a);
+    check(cuMemcpyHtoD(stuck.ptr, stuck.expected.data(), stuck.size) == CUDA_SUCCESS, "fill the range of the failed migration");
+    size_t room = config.device_capacity - sim::stats().used_per_device[1];
+    void* filler = allocator->alloc(room, 1, nullptr);
+    size_t errors = sim::stats().errors;
+    bool failed = false;
+    try {
+        allocator->migrate(reinterpret_cast<void *>(stuck.ptr), 1);
+    } catch (const OutOfMemoryError&) {
+        failed = true;
+    }
+    size_t failed_calls = sim::stats().errors - errors;
+    restore_stdout(stdout_fd);
+    check(failed, "a migration to a full device fails");
+    check(content_matches(stuck) && sim::device_of(stuck.ptr) == 0, "the range of the failed migration stays on device 0");
+
+    // 5. a range freed while it migrates leaves nothing behind
+    stdout_fd = options.verbose ? -1 : silence_stdout();
+    allocator->dealloc(reinterpret_cast<void *>(stuck.ptr), stuck.size, 0, nullptr);
+    allocator->dealloc(filler, room, 1, nullptr);
+    allocator->empty_cache();
+    void* cancelled = allocator->alloc(options.tensor_bytes, 0, nullptr);
+    allocator->migrate_begin(cancelled, 1);
+    allocator->migrate_step(cancelled, options.tensor_bytes / 2);
+    allocator->dealloc(cancelled, options.tensor_bytes, 0, nullptr);
+
+    for (auto& range : ranges) {
+        allocator->dealloc(reinterpret_cast<void *>(range.ptr), range.size, 1, nullptr);
+    }
+    allocator->empty_cache();
+    allocator.reset();
+    restore_stdout(stdout_fd);
+
+    sim::DriverStats end = sim::stats();
+    check(end.num_handles == 0 && end.num_mappings == 0 && end.num_reservations == 0, "nothing leaks once the ranges are freed");
+    check(end.errors == failed_calls, "no failed driver call but the ones of the failed migration");
+
+    std::printf("%s\n", failures == 0 ? "all checks passed" : "some checks failed");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,389 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Fragmentation benchmark of the OwnedBlockPool placement policies.
+//
+// The benchmark replays allocation sequences against the placement policies with the same placement as
+// VmmAllocator::alloc : a request is rounded up to the VMM granularity and mapped, from the first byte, to one idle
+// block at most twice its size picked by the policy. Failing that, it is scattered across up to 16 idle blocks
+// (the largest first, none more than twice the rest to cover) when they cover it, or gets a new block sized to the
+// request. A block serves a single request until it is freed. No device is needed, and blocks are never released
+// (no empty_cache).
+//
+// Workloads with lifetime hints are replayed a second time with the blocks of each lifetime kept apart, as
+// VmmAllocator::alloc does for hinted allocations : transient requests are bump allocated by address from arenas
+// of `--block-size-mb` (an arena is reused once its requests were all freed, larger requests get a block of their
+// own), persistent blocks are best fit, the others use the policy of the row.
+//
+// Build & run :
+//
+//   g++ -O2 -std=c++17 -I include/vtensor benchmarks/placement_policy_bench.cpp -o placement_policy_bench
+//   ./placement_policy_bench                      # synthetic workloads
+//   ./placement_policy_bench --trace alloc.trace  # recorded workload
+//
+// A recorded trace has one event per line, `#` starts a comment :
+//
+//   a <id> <bytes> [<lifetime>]   allocation of <bytes> identified by <id>, optionally hinted with
+//                                 transient, step or persistent
+//   f <id>                        release of allocation <id>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "allocator/lifetime.h"
+#include "allocator/placement_policy.h"
+
+#define CEIL_DIV(x, n) (((x) + (n) - 1) / (n))
+#define ROUND_UP(x, n) (CEIL_DIV(x, n) * (n))
+
+using namespace nvgpu;
+
+struct SimBlock {
+    int block_id = -1;
+    size_t block_size = 0;
+    // live requests, an arena holds several of them
+    size_t live = 0;
+    bool arena = false;
+};
+
+struct Event {
+    bool alloc;
+    long id;
+    size_t size;
+    Lifetime lifetime;
+};
+
+struct Result {
+    size_t blocks = 0;
+    // requests mapped across several idle blocks
+    size_t scattered = 0;
+    size_t peak_live = 0;
+    size_t peak_reserved = 0;
+    double frag_at_peak = 0.;
+    double avg_frag = 0.;
+    // the unused part of the blocks empty_cache cannot release (the ones with live requests), at the end
+    double frag_at_end = 0.;
+    double ns_per_op = 0.;
+};
+
+static const size_t kGranularity = 2UL << 20;
+static const size_t kMaxReuseRatio = 2;
+static const size_t kMaxScatterPieces = 16;
+
+// `segregate` : one policy per lifetime, a block only serves the lifetime it was created for
+static Result replay(PlacementPolicyType type, const std::vector<Event>& events, size_t block_size, bool segregate) {
+    std::unique_ptr<PlacementPolicy<SimBlock>> policies[(int)Lifetime::N];
+    for (int i = 0; i < (int)Lifetime::N; i++) {
+        PlacementPolicyType pool_type = type;
+        if (segregate && (i == (int)Lifetime::TRANSIENT || i == (int)Lifetime::PERSISTENT)) {
+            pool_type = PlacementPolicyType::BEST_FIT;
+        }
+        policies[i] = PlacementPolicy<SimBlock>::create(pool_type);
+    }
+    size_t arena_size = ROUND_UP(block_size, kGranularity);
+    std::vector<std::unique_ptr<SimBlock>> blocks;
+    std::vector<int> block_pools;
+    // the arenas, and the offset of the next request in each one
+    std::vector<SimBlock*> arenas;
+    std::map<SimBlock*, size_t> arena_offsets;
+    // request -> (block, bytes) of its pieces
+    std::map<long, std::vector<std::pair<SimBlock*, size_t>>> live;
+
+    Result r;
+    size_t live_bytes = 0, reserved_bytes = 0;
+    double frag_sum = 0.;
+    size_t frag_samples = 0;
+
+    auto new_block = [&](size_t size, int pool) {
+        blocks.emplace_back(new SimBlock());
+        SimBlock* block = blocks.back().get();
+        block->block_id = (int)blocks.size() - 1;
+        block->block_size = size;
+        block_pools.push_back(pool);
+        reserved_bytes += size;
+        return block;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto& e : events) {
+        if (e.alloc) {
+            size_t size = ROUND_UP(e.size, kGranularity);
+            int pool = segregate ? (int)e.lifetime : (int)Lifetime::DEFAULT;
+            PlacementPolicy<SimBlock>* policy = policies[pool].get();
+            std::vector<std::pair<SimBlock*, size_t>> pieces;
+
+            if (pool == (int)Lifetime::TRANSIENT && size <= arena_size) {
+                // bumped by address : the first arena with room, rewound once empty
+                SimBlock* arena = nullptr;
+                for (SimBlock* it : arenas) {
+                    if (arena_offsets[it] + size <= it->block_size) {
+                        arena = it;
+                        break;
+                    }
+                }
+                if (arena == nullptr) {
+                    arena = new_block(arena_size, pool);
+                    arena->arena = true;
+                    arenas.push_back(arena);
+                }
+                arena_offsets[arena] += size;
+                pieces.push_back({arena, size});
+            } else if (SimBlock* block = policy->find(size, size * kMaxReuseRatio)) {
+                pieces.push_back({block, size});
+            } else {
+                // the idle blocks, the largest first
+                std::vector<std::pair<size_t, SimBlock*>> open;
+                policy->for_each([&](SimBlock* block, size_t capacity) {
+                    open.push_back({capacity, block});
+                });
+                std::sort(open.begin(), open.end(), [](const std::pair<size_t, SimBlock*>& a, const std::pair<size_t, SimBlock*>& b) {
+                    return a.first != b.first ? a.first > b.first : a.second->block_id < b.second->block_id;
+                });
+                size_t covered = 0;
+                for (auto& it : open) {
+                    if (covered >= size || pieces.size() >= kMaxScatterPieces) {
+                        break;
+                    }
+                    if (it.first > (size - covered) * kMaxReuseRatio) {
+                        continue;
+                    }
+                    size_t piece = std::min(it.first, size - covered);
+                    pieces.push_back({it.second, piece});
+                    covered += piece;
+                }
+                if (size > kGranularity && covered >= size) {
+                    r.scattered += pieces.size() > 1 ? 1 : 0;
+                } else {
+                    pieces.clear();
+                    pieces.push_back({new_block(size, pool), size});
+                }
+            }
+
+            for (auto& piece : pieces) {
+                piece.first->live++;
+                if (!piece.first->arena) {
+                    policy->insert(piece.first, 0);
+                }
+            }
+            live[e.id] = pieces;
+            live_bytes += size;
+        } else {
+            auto it = live.find(e.id);
+            if (it == live.end()) {
+                continue;
+            }
+            for (auto& piece : it->second) {
+                SimBlock* block = piece.first;
+                live_bytes -= piece.second;
+                if (--block->live > 0) {
+                    continue;
+                }
+                if (block->arena) {
+                    arena_offsets[block] = 0;
+                } else {
+                    policies[block_pools[block->block_id]]->insert(block, block->block_size);
+                }
+            }
+            live.erase(it);
+        }
+
+        double frag = reserved_bytes == 0 ? 0. : 1. - (double)live_bytes / (double)reserved_bytes;
+        frag_sum += frag;
+        frag_samples++;
+        if (live_bytes > r.peak_live) {
+            r.peak_live = live_bytes;
+            r.frag_at_peak = frag;
+        }
+        r.peak_reserved = std::max(r.peak_reserved, reserved_bytes);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    r.blocks = blocks.size();
+    size_t held_bytes = 0;
+    for (auto& block : blocks) {
+        if (block->live > 0) {
+            held_bytes += block->block_size;
+        }
+    }
+    r.frag_at_end = held_bytes == 0 ? 0. : 1. - (double)live_bytes / (double)held_bytes;
+    r.avg_frag = frag_samples == 0 ? 0. : frag_sum / frag_samples;
+    r.ns_per_op = events.empty() ? 0. :
+        (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / events.size();
+    return r;
+}
+
+// Random sizes between 2 MiB and 64 MiB with a bounded number of live allocations
+static std::vector<Event> uniform_workload(size_t num_ops, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> size_dist(1, 32);
+    std::vector<Event> events;
+    std::vector<long> live;
+    long next_id = 0;
+    for (size_t i = 0; i < num_ops; i++) {
+        if (live.size() < 64 && (live.empty() || rng() % 2 == 0)) {
+            events.push_back({true, next_id, size_dist(rng) * kGranularity, Lifetime::DEFAULT});
+            live.push_back(next_id++);
+        } else {
+            size_t idx = rng() % live.size();
+            events.push_back({false, live[idx], 0, Lifetime::DEFAULT});
+            live[idx] = live.back();
+            live.pop_back();
+        }
+    }
+    return events;
+}
+
+// LLM serving like : long lived KV pages which grow per sequence, plus short lived activations freed every step.
+// The events carry these lifetimes as hints.
+static std::vector<Event> serving_workload(size_t num_steps, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> act_dist(1, 16);
+    std::uniform_int_distribution<size_t> seq_len_dist(4, 64);
+    std::vector<Event> events;
+    long next_id = 0;
+
+    struct Seq { std::vector<long> pages; size_t target; };
+    std::vector<Seq> seqs;
+    for (size_t step = 0; step < num_steps; step++) {
+        if (seqs.size() < 32 && rng() % 3 == 0) {
+            seqs.push_back({{}, seq_len_dist(rng)});
+        }
+
+        std::vector<long> acts;
+        for (int i = 0; i < 8; i++) {
+            events.push_back({true, next_id, act_dist(rng) * kGranularity, Lifetime::TRANSIENT});
+            acts.push_back(next_id++);
+        }
+
+        for (size_t s = 0; s < seqs.size();) {
+            events.push_back({true, next_id, kGranularity, Lifetime::PERSISTENT});
+            seqs[s].pages.push_back(next_id++);
+            if (seqs[s].pages.size() >= seqs[s].target) {
+                for (long id : seqs[s].pages) {
+                    events.push_back({false, id, 0, Lifetime::DEFAULT});
+                }
+                seqs[s] = seqs.back();
+                seqs.pop_back();
+            } else {
+                s++;
+            }
+        }
+
+        for (long id : acts) {
+            events.push_back({false, id, 0, Lifetime::DEFAULT});
+        }
+    }
+    return events;
+}
+
+static bool load_trace(const std::string& path, std::vector<Event>* events) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream ss(line);
+        std::string op;
+        Event e{false, 0, 0, Lifetime::DEFAULT};
+        ss >> op >> e.id;
+        if (op == "a") {
+            e.alloc = true;
+            ss >> e.size;
+            std::string lifetime;
+            if (ss >> lifetime && !parse_lifetime(lifetime, &e.lifetime)) {
+                continue;
+            }
+        } else if (op != "f") {
+            continue;
+        }
+        events->push_back(e);
+    }
+    return true;
+}
+
+static void report(const std::string& workload, const std::vector<Event>& events, size_t block_size) {
+    bool hinted = false;
+    for (auto& e : events) {
+        hinted = hinted || e.lifetime != Lifetime::DEFAULT;
+    }
+
+    for (int segregate = 0; segregate < (hinted ? 2 : 1); segregate++) {
+        std::printf("\n== %s : %zu events%s\n", workload.c_str(), events.size(),
+                    segregate ? ", pools segregated by lifetime (transient arenas, persistent : best_fit)" : "");
+        if (segregate) {
+            std::printf("transient arenas of %zu MiB\n", block_size >> 20);
+        }
+        std::printf("%-16s %8s %10s %14s %16s %14s %10s %12s %10s\n",
+                    "policy", "blocks", "scattered", "peak_live_MiB", "peak_reserved_MiB", "frag_at_peak", "avg_frag", "frag_at_end", "ns/op");
+        for (int i = 0; i < (int)PlacementPolicyType::N; i++) {
+            PlacementPolicyType type = (PlacementPolicyType)i;
+            Result r = replay(type, events, block_size, segregate);
+            std::printf("%-16s %8zu %10zu %14zu %16zu %14.3f %10.3f %12.3f %10.1f\n",
+                        placement_policy_name(type), r.blocks, r.scattered, r.peak_live >> 20, r.peak_reserved >> 20,
+                        r.frag_at_peak, r.avg_frag, r.frag_at_end, r.ns_per_op);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string trace;
+    size_t block_size = 64UL << 20;
+    size_t num_ops = 200000;
+    uint64_t seed = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--trace") && i + 1 < argc) {
+            trace = argv[++i];
+        } else if (!std::strcmp(argv[i], "--block-size-mb") && i + 1 < argc) {
+            block_size = std::strtoull(argv[++i], nullptr, 10) << 20;
+        } else if (!std::strcmp(argv[i], "--ops") && i + 1 < argc) {
+            num_ops = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--trace FILE] [--block-size-mb N] [--ops N] [--seed N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!trace.empty()) {
+        std::vector<Event> events;
+        if (!load_trace(trace, &events)) {
+            std::cerr << "cannot read trace " << trace << std::endl;
+            return 1;
+        }
+        report("trace " + trace, events, block_size);
+        return 0;
+    }
+
+    report("uniform", uniform_workload(num_ops, seed), block_size);
+    report("serving", serving_workload(num_ops / 64, seed), block_size);
+    return 0;
+}
@@ -0,0 +1,538 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Synthetic LLM serving workload for the VMM allocator.
+//
+// The simulator drives the real VmmAllocator (owned pool, slab, step pre-warming, out of memory pipeline) through
+// a serving loop, on a CPU : the CUDA driver is replaced by the host side bookkeeping of sim_driver.cpp, which
+// enforces the device capacity and models the latency of every driver call.
+//
+// Every step :
+//
+//   - requests arrive following a Poisson process, with log-normal prompt and output lengths
+//   - waiting requests are admitted up to --max-batch running sequences, the prefill allocates the KV cache of the
+//     prompt in blocks of --kv-block-tokens tokens (paged KV cache)
+//   - every running sequence decodes a token, and allocates a new KV block when it crosses a block boundary
+//   - the activations of the step (hidden states of the prefill and decode tokens, plus small metadata tensors
+//     served by the slab) are allocated then freed at the end of the step
+//   - finished sequences free their KV cache
+//
+// When the device is full, the allocator calls the pressure callback of the simulator, which preempts the youngest
+// running sequence (its KV cache is freed and the request goes back to the queue, to be recomputed).
+//
+// Build & run :
+//
+//   g++ -O2 -std=c++17 -I include/vtensor -I $CUDA_HOME/include -pthread -o serving_sim
+//       benchmarks/serving_sim.cpp benchmarks/sim_driver.cpp src/allocator/*.cpp
+//   ./serving_sim --steps 2000 --arrival-rate 0.25 --device-mem 24
+//
+// or cmake -DVTENSOR_BUILD_BENCHMARKS=ON, target vtensor_serving_sim. Only the CUDA headers are needed.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "allocator/vmm_allocator.h"
+#include "sim_driver.h"
+
+#define CEIL_DIV(x, n) (((x) + (n) - 1) / (n))
+
+using namespace nvgpu;
+
+struct Options {
+    int steps = 2000;
+    // mean number of arrivals per step
+    double arrival_rate = 0.25;
+    double prompt_mean = 512;
+    double output_mean = 256;
+    // fp16 K and V of 32 layers x 4096 hidden
+    size_t kv_bytes_per_token = 2 * 32 * 4096 * 2;
+    size_t kv_block_tokens = 16;
+    size_t act_bytes_per_token = 4096 * 2 * 4;
+    int max_batch = 64;
+    double device_mem_gb = 24;
+    unsigned seed = 0;
+    std::string placement = "best_fit";
+    bool slab = true;
+    bool scatter = true;
+    bool prewarm = false;
+    int samples = 20;
+    bool verbose = false;
+};
+
+struct Sequence {
+    int id = 0;
+    size_t prompt = 0;
+    size_t output = 0;
+    size_t generated = 0;
+    std::vector<void*> kv_blocks;
+    int preemptions = 0;
+};
+
+struct LatencyRecorder {
+    std::vector<double> samples_us;
+
+    double percentile(double p) {
+        if (samples_us.empty()) {
+            return 0;
+        }
+        std::sort(samples_us.begin(), samples_us.end());
+        size_t index = std::min(samples_us.size() - 1, (size_t)(p / 100.0 * samples_us.size()));
+        return samples_us[index];
+    }
+};
+
+struct FragmentationSample {
+    int step = 0;
+    size_t running = 0;
+    size_t live_bytes = 0;
+    size_t mapped_bytes = 0;
+    size_t physical_bytes = 0;
+    size_t reserved_bytes = 0;
+};
+
+struct Simulator {
+    Options options;
+    VmmAllocator::Ptr allocator;
+    std::mt19937_64 rng;
+
+    std::map<int, std::unique_ptr<Sequence>> sequences;
+    std::deque<int> waiting;
+    // in admission order, the youngest last
+    std::vector<int> running;
+    int next_id = 0;
+    // sequence allocating right now, never preempted by the pressure callback
+    int current = -1;
+    // the prefill of new requests never preempts running sequences
+    bool admitting = false;
+    bool preempted_this_step = false;
+
+    size_t kv_block_bytes = 0;
+    size_t live_bytes = 0;
+    size_t peak_live_bytes = 0;
+    size_t peak_reserved_bytes = 0;
+    size_t peak_physical_bytes = 0;
+
+    LatencyRecorder alloc_latency;
+    LatencyRecorder free_latency;
+    size_t allocations = 0;
+    size_t failed_allocations = 0;
+    size_t preemptions = 0;
+    size_t completed = 0;
+    size_t generated_tokens = 0;
+    std::vector<FragmentationSample> fragmentation;
+
+    explicit Simulator(const Options& options) : options(options), rng(options.seed) {
+        kv_block_bytes = options.kv_block_tokens * options.kv_bytes_per_token;
+        allocator = std::make_shared<VmmAllocator>();
+        allocator->slab_enabled = options.slab;
+        allocator->scatter_enabled = options.scatter;
+        if (!allocator->set_placement_policy(options.placement)) {
+            std::fprintf(stderr, "unknown placement policy %s\n", options.placement.c_str());
+            std::exit(1);
+        }
+        if (options.prewarm) {
+            allocator->set_step_prewarm(true, 2);
+        }
+        allocator->add_pressure_callback([this](int device, size_t bytes_needed) { return preempt(bytes_needed); });
+    }
+
+    // host time of the call plus the modeled time spent in the driver
+    void* alloc(size_t size) {
+        double modeled = sim::modeled_us();
+        auto start = std::chrono::steady_clock::now();
+        void* ptr = nullptr;
+        try {
+            ptr = allocator->alloc(size, 0, nullptr);
+        } catch (const OutOfMemoryError& e) {
+            failed_allocations++;
+        }
+        auto end = std::chrono::steady_clock::now();
+        double host_us = std::chrono::duration<double, std::micro>(end - start).count();
+        alloc_latency.samples_us.push_back(host_us + sim::modeled_us() - modeled);
+        allocations++;
+        if (ptr != nullptr) {
+            live_bytes += size;
+            sample_peaks();
+        }
+        return ptr;
+    }
+
+    // the three peaks are taken at the same points, after every allocation and at the end of every step (the step
+    // pre-warming maps ranges ahead of the allocations), so that the live bytes never exceed the reserved ones
+    void sample_peaks() {
+        AllocatorStats stats = allocator->stats();
+        peak_live_bytes = std::max(peak_live_bytes, live_bytes);
+        peak_reserved_bytes = std::max(peak_reserved_bytes, stats.reserved_bytes);
+        peak_physical_bytes = std::max(peak_physical_bytes, stats.physical_bytes + stats.slab_mapped_bytes);
+    }
+
+    void free(void* ptr, size_t size) {
+        double modeled = sim::modeled_us();
+        auto start = std::chrono::steady_clock::now();
+        allocator->dealloc(ptr, size, 0, nullptr);
+        auto end = std::chrono::steady_clock::now();
+        double host_us = std::chrono::duration<double, std::micro>(end - start).count();
+        free_latency.samples_us.push_back(host_us + sim::modeled_us() - modeled);
+        live_bytes -= size;
+    }
+
+    size_t sample_length(double mean) {
+        // log-normal with sigma 1, the mean is exp(mu + sigma^2 / 2)
+        std::lognormal_distribution<double> dist(std::log(mean) - 0.5, 1.0);
+        return std::max<size_t>(1, std::min<size_t>((size_t)dist(rng), (size_t)(mean * 8)));
+    }
+
+    void release_kv(Sequence* seq) {
+        for (void* block : seq->kv_blocks) {
+            free(block, kv_block_bytes);
+        }
+        seq->kv_blocks.clear();
+    }
+
+    // pressure callback : preempt the youngest running sequences until `bytes_needed` is freed
+    size_t preempt(size_t bytes_needed) {
+        size_t freed = 0;
+        if (admitting) {
+            return freed;
+        }
+        preempted_this_step = true;
+        for (int i = (int)running.size() - 1; i >= 0 && freed < bytes_needed; i--) {
+            int id = running[i];
+            if (id == current) {
+                continue;
+            }
+            Sequence* seq = sequences[id].get();
+            freed += seq->kv_blocks.size() * kv_block_bytes;
+            release_kv(seq);
+            // recomputed from the prompt once admitted again
+            seq->generated = 0;
+            seq->preemptions++;
+            preemptions++;
+            running.erase(running.begin() + i);
+            waiting.push_front(id);
+        }
+        return freed;
+    }
+
+    // grows the KV cache of `seq` to `tokens` tokens, false when the device is full
+    bool grow_kv(Sequence* seq, size_t tokens) {
+        current = seq->id;
+        size_t blocks = CEIL_DIV(tokens, options.kv_block_tokens);
+        bool ok = true;
+        while (seq->kv_blocks.size() < blocks) {
+            void* block = alloc(kv_block_bytes);
+            if (block == nullptr) {
+                ok = false;
+                break;
+            }
+            seq->kv_blocks.push_back(block);
+        }
+        current = -1;
+        return ok;
+    }
+
+    bool is_running(int id) {
+        return std::find(running.begin(), running.end(), id) != running.end();
+    }
+
+    void step(int step_id) {
+        if (options.prewarm) {
+            allocator->begin_step();
+        }
+
+        std::poisson_distribution<int> arrivals(options.arrival_rate);
+        for (int n = arrivals(rng); n > 0; n--) {
+            std::unique_ptr<Sequence> seq(new Sequence());
+            seq->id = next_id++;
+            seq->prompt = sample_length(options.prompt_mean);
+            seq->output = sample_length(options.output_mean);
+            waiting.push_back(seq->id);
+            sequences[seq->id] = std::move(seq);
+        }
+
+        // admission and prefill, paused for one step after a preemption so that sequences do not evict each other
+        size_t prefill_tokens = 0;
+        admitting = true;
+        while (!preempted_this_step && !waiting.empty() && (int)running.size() < options.max_batch) {
+            Sequence* seq = sequences[waiting.front()].get();
+            waiting.pop_front();
+            running.push_back(seq->id);
+            if (!grow_kv(seq, seq->prompt)) {
+                // not even the prompt fits : back to the queue, retried next step
+                release_kv(seq);
+                running.pop_back();
+                waiting.push_front(seq->id);
+                break;
+            }
+            prefill_tokens += seq->prompt;
+        }
+        admitting = false;
+        preempted_this_step = false;
+
+        // decode, the pressure callback may preempt sequences of the batch
+        std::vector<int> batch = running;
+        for (int id : batch) {
+            if (!is_running(id)) {
+                continue;
+            }
+            Sequence* seq = sequences[id].get();
+            if (!grow_kv(seq, seq->prompt + seq->generated + 1)) {
+                preempt_self(seq);
+                continue;
+            }
+            seq->generated++;
+            generated_tokens++;
+        }
+
+        // activations of the step
+        std::vector<std::pair<void*, size_t>> activations;
+        size_t tokens = prefill_tokens + running.size();
+        if (tokens > 0) {
+            size_t sizes[] = {
+                tokens * options.act_bytes_per_token,      // hidden states
+                tokens * options.act_bytes_per_token * 4,  // MLP intermediate
+                running.size() * 4,                        // positions
+                running.size() * 4,                        // sampled tokens
+                running.size() * 4 * CEIL_DIV((size_t)(options.prompt_mean + options.output_mean), options.kv_block_tokens),  // block tables
+            };
+            for (size_t size : sizes) {
+                void* ptr = alloc(size);
+                if (ptr != nullptr) {
+                    activations.emplace_back(ptr, size);
+                }
+            }
+        }
+        for (auto& it : activations) {
+            free(it.first, it.second);
+        }
+
+        // completion
+        for (size_t i = 0; i < running.size();) {
+            Sequence* seq = sequences[running[i]].get();
+            if (seq->generated >= seq->output) {
+                release_kv(seq);
+                sequences.erase(seq->id);
+                running.erase(running.begin() + i);
+                completed++;
+            } else {
+                i++;
+            }
+        }
+
+        if (options.prewarm) {
+            allocator->end_step();
+        }
+
+        sample_peaks();
+
+        int every = std::max(1, options.steps / std::max(1, options.samples));
+        if (step_id % every == 0 || step_id == options.steps - 1) {
+            AllocatorStats stats = allocator->stats();
+            FragmentationSample sample;
+            sample.step = step_id;
+            sample.running = running.size();
+            sample.live_bytes = live_bytes;
+            sample.mapped_bytes = stats.mapped_bytes;
+            sample.physical_bytes = stats.physical_bytes + stats.slab_mapped_bytes;
+            sample.reserved_bytes = stats.reserved_bytes;
+            fragmentation.push_back(sample);
+        }
+    }
+
+    // the device is full even after preempting the other sequences
+    void preempt_self(Sequence* seq) {
+        preempted_this_step = true;
+        release_kv(seq);
+        seq->generated = 0;
+        seq->preemptions++;
+        preemptions++;
+        running.erase(std::find(running.begin(), running.end(), seq->id));
+        waiting.push_front(seq->id);
+    }
+
+    void run() {
+        for (int i = 0; i < options.steps; i++) {
+            step(i);
+        }
+    }
+
+    void drain() {
+        for (auto& it : sequences) {
+            release_kv(it.second.get());
+        }
+        sequences.clear();
+        running.clear();
+        waiting.clear();
+    }
+};
+
+static double gib(size_t bytes) {
+    return (double)bytes / (1ULL << 30);
+}
+
+static void report(Simulator& simulator) {
+    const Options& options = simulator.options;
+    std::printf("workload : %d steps, %.3f arrivals / step, prompt %.0f / output %.0f tokens (mean), max batch %d\n",
+                options.steps, options.arrival_rate, options.prompt_mean, options.output_mean, options.max_batch);
+    std::printf("allocator : %s, slab %s, scatter %s, prewarm %s, device %.1f GiB, KV block %zu bytes\n\n",
+                options.placement.c_str(), options.slab ? "on" : "off", options.scatter ? "on" : "off",
+                options.prewarm ? "on" : "off", options.device_mem_gb, simulator.kv_block_bytes);
+
+    std::printf("requests : %zu completed, %zu running, %zu waiting, %zu preemptions, %zu tokens generated\n",
+                simulator.completed, simulator.running.size(), simulator.waiting.size(), simulator.preemptions,
+                simulator.generated_tokens);
+    std::printf("allocations : %zu, %zu failed\n\n", simulator.allocations, simulator.failed_allocations);
+
+    std::printf("%-8s %12s %12s %12s\n", "latency", "p50 (us)", "p99 (us)", "max (us)");
+    std::printf("%-8s %12.2f %12.2f %12.2f\n", "alloc", simulator.alloc_latency.percentile(50),
+                simulator.alloc_latency.percentile(99), simulator.alloc_latency.percentile(100));
+    std::printf("%-8s %12.2f %12.2f %12.2f\n\n", "free", simulator.free_latency.percentile(50),
+                simulator.free_latency.percentile(99), simulator.free_latency.percentile(100));
+
+    sim::DriverStats driver = sim::stats();
+    // live <= reserved at every sample, the physical bytes also count the idle blocks, which have no reservation
+    std::printf("peak memory (GiB) : live %.2f, physical %.2f, reserved %.2f, device used %.2f\n",
+                gib(simulator.peak_live_bytes), gib(simulator.peak_physical_bytes), gib(simulator.peak_reserved_bytes),
+                gib(driver.peak_device_used));
+    std::printf("scatter : %.2f GiB served across several idle blocks\n\n",
+                gib(simulator.allocator->scatter_stats().reused_bytes));
+
+    std::printf("%-8s %8s %12s %12s %12s %12s %14s\n", "step", "running", "live GiB", "mapped GiB", "physical GiB",
+                "reserved GiB", "fragmentation");
+    for (auto& sample : simulator.fragmentation) {
+        // physical memory not backing live bytes
+        double fragmentation = sample.physical_bytes > 0 ? 1.0 - (double)sample.live_bytes / sample.physical_bytes : 0.0;
+        std::printf("%-8d %8zu %12.2f %12.2f %12.2f %12.2f %13.1f%%\n", sample.step, sample.running,
+                    gib(sample.live_bytes), gib(sample.mapped_bytes), gib(sample.physical_bytes),
+                    gib(sample.reserved_bytes), fragmentation * 100);
+    }
+
+    std::printf("\n%-22s %10s\n", "driver call", "count");
+    for (auto& it : driver.calls) {
+        std::printf("%-22s %10zu\n", it.first.c_str(), it.second);
+    }
+    std::printf("%-22s %10.1f\n", "modeled time (ms)", driver.modeled_us / 1000);
+    std::printf("%-22s %10zu\n", "failed calls", driver.errors);
+}
+
+// returns the saved stdout descriptor
+static int silence_stdout() {
+    std::cout.flush();
+    std::fflush(stdout);
+    int saved_fd = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved_fd;
+}
+
+static void restore_stdout(int saved_fd) {
+    if (saved_fd < 0) {
+        return;
+    }
+    std::cout.flush();
+    std::fflush(stdout);
+    dup2(saved_fd, STDOUT_FILENO);
+    close(saved_fd);
+}
+
+static void usage(const char* name) {
+    std::fprintf(stderr,
+                 "usage : %s [--steps N] [--arrival-rate R] [--prompt-mean T] [--output-mean T]\n"
+                 "          [--kv-bytes-per-token B] [--kv-block-tokens T] [--act-bytes-per-token B] [--max-batch N]\n"
+                 "          [--device-mem GiB] [--seed S] [--placement POLICY] [--no-slab] [--no-scatter]\n"
+                 "          [--prewarm] [--samples N] [--verbose]\n",
+                 name);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--steps" && has_value) {
+            options.steps = std::atoi(argv[++i]);
+        } else if (arg == "--arrival-rate" && has_value) {
+            options.arrival_rate = std::atof(argv[++i]);
+        } else if (arg == "--prompt-mean" && has_value) {
+            options.prompt_mean = std::atof(argv[++i]);
+        } else if (arg == "--output-mean" && has_value) {
+            options.output_mean = std::atof(argv[++i]);
+        } else if (arg == "--kv-bytes-per-token" && has_value) {
+            options.kv_bytes_per_token = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--kv-block-tokens" && has_value) {
+            options.kv_block_tokens = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--act-bytes-per-token" && has_value) {
+            options.act_bytes_per_token = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--max-batch" && has_value) {
+            options.max_batch = std::atoi(argv[++i]);
+        } else if (arg == "--device-mem" && has_value) {
+            options.device_mem_gb = std::atof(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            options.seed = (unsigned)std::atoi(argv[++i]);
+        } else if (arg == "--placement" && has_value) {
+            options.placement = argv[++i];
+        } else if (arg == "--samples" && has_value) {
+            options.samples = std::atoi(argv[++i]);
+        } else if (arg == "--no-slab") {
+            options.slab = false;
+        } else if (arg == "--no-scatter") {
+            options.scatter = false;
+        } else if (arg == "--prewarm") {
+            options.prewarm = true;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.steps <= 0 || options.kv_block_tokens == 0 || options.max_batch <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    sim::DriverConfig config;
+    config.device_capacity = (size_t)(options.device_mem_gb * (1ULL << 30));
+    sim::configure(config);
+
+    // the allocator logs every mapping to stdout : the report is printed once the run is over
+    int stdout_fd = options.verbose ? -1 : silence_stdout();
+    std::unique_ptr<Simulator> simulator(new Simulator(options));
+    simulator->run();
+    restore_stdout(stdout_fd);
+
+    report(*simulator);
+
+    stdout_fd = options.verbose ? -1 : silence_stdout();
+    simulator->drain();
+    simulator.reset();
+    restore_stdout(stdout_fd);
+    return 0;
+}
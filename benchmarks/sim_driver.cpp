@@ -0,0 +1,494 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cuda.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "sim_driver.h"
+
+#define CEIL_DIV(x, n) (((x) + (n) - 1) / (n))
+#define ROUND_UP(x, n) (CEIL_DIV(x, n) * (n))
+
+namespace sim {
+
+    static constexpr int kMaxDevices = 16;
+
+    struct Handle {
+        size_t size = 0;
+        int device = 0;
+        bool on_device = true;
+        bool released = false;
+        size_t mappings = 0;
+        // config.backing only
+        std::vector<unsigned char> bytes;
+    };
+
+    struct Mapping {
+        size_t size = 0;
+        CUmemGenericAllocationHandle handle = 0;
+        // devices granted access by cuMemSetAccess, and the ones granted write access
+        std::set<int> access;
+        std::set<int> writable;
+    };
+
+    struct Driver {
+        DriverConfig config;
+        DriverStats stats;
+
+        std::map<CUmemGenericAllocationHandle, Handle> handles;
+        CUmemGenericAllocationHandle next_handle = 1;
+
+        // base -> size
+        std::map<CUdeviceptr, size_t> reservations;
+        CUdeviceptr next_address = 0x7f0000000000ULL;
+
+        std::map<CUdeviceptr, Mapping> mappings;
+
+        // primary context of device i : contexts + i
+        int contexts[kMaxDevices] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+
+        std::mutex mtx;
+
+        CUresult call(const char* name, CUresult result = CUDA_SUCCESS) {
+            stats.calls[name]++;
+            auto it = config.latency_us.find(name);
+            if (it != config.latency_us.end()) {
+                stats.modeled_us += it->second;
+            }
+            if (result != CUDA_SUCCESS) {
+                stats.errors++;
+            }
+            return result;
+        }
+
+        // a handle is freed once it is released and no longer mapped, like the real driver
+        void collect(CUmemGenericAllocationHandle h) {
+            auto it = handles.find(h);
+            if (it == handles.end() || !it->second.released || it->second.mappings > 0) {
+                return;
+            }
+            if (it->second.on_device) {
+                stats.device_used -= it->second.size;
+                stats.used_per_device[it->second.device] -= it->second.size;
+            } else {
+                stats.host_used -= it->second.size;
+            }
+            handles.erase(it);
+        }
+
+        Mapping* mapping_at(CUdeviceptr ptr) {
+            auto it = mappings.upper_bound(ptr);
+            if (it == mappings.begin()) {
+                return nullptr;
+            }
+            --it;
+            return ptr < it->first + it->second.size ? &it->second : nullptr;
+        }
+
+        // calls fn(bytes, length) over the memory mapped at [ptr, ptr + size), false if a part is not mapped or not
+        // accessible (writable when `write`) by `device`
+        template <typename Fn>
+        bool visit(CUdeviceptr ptr, size_t size, int device, bool write, Fn fn) {
+            while (size > 0) {
+                auto it = mappings.upper_bound(ptr);
+                if (it == mappings.begin()) {
+                    return false;
+                }
+                --it;
+                Mapping& m = it->second;
+                if (ptr >= it->first + m.size || !(write ? m.writable : m.access).count(device)) {
+                    return false;
+                }
+                size_t in = ptr - it->first;
+                size_t length = std::min(size, m.size - in);
+                fn(handles[m.handle].bytes.data() + in, length);
+                ptr += length;
+                size -= length;
+            }
+            return true;
+        }
+
+        // copies between mappings, or only counts them without backing
+        CUresult copy(const char* name, CUdeviceptr dst, int dst_device, CUdeviceptr src, int src_device, size_t size) {
+            if (!config.backing) {
+                return call(name);
+            }
+            std::vector<unsigned char> buffer;
+            bool ok = visit(src, size, src_device, false, [&](unsigned char* bytes, size_t length) {
+                buffer.insert(buffer.end(), bytes, bytes + length);
+            });
+            size_t done = 0;
+            ok = ok && visit(dst, size, dst_device, true, [&](unsigned char* bytes, size_t length) {
+                std::memcpy(bytes, buffer.data() + done, length);
+                done += length;
+            });
+            return call(name, ok ? CUDA_SUCCESS : CUDA_ERROR_INVALID_VALUE);
+        }
+
+        // first reservation overlapping [ptr, ptr + size), reservations.end() if none
+        std::map<CUdeviceptr, size_t>::iterator overlapping(CUdeviceptr ptr, size_t size) {
+            auto it = reservations.upper_bound(ptr);
+            if (it != reservations.begin() && std::prev(it)->first + std::prev(it)->second > ptr) {
+                return std::prev(it);
+            }
+            return it != reservations.end() && it->first < ptr + size ? it : reservations.end();
+        }
+
+        bool reserved(CUdeviceptr ptr, size_t size) {
+            auto it = reservations.upper_bound(ptr);
+            if (it == reservations.begin()) {
+                return false;
+            }
+            --it;
+            return ptr + size <= it->first + it->second;
+        }
+    };
+
+    static Driver& driver() {
+        static Driver instance;
+        return instance;
+    }
+
+    void configure(const DriverConfig& config) {
+        std::lock_guard<std::mutex> lock(driver().mtx);
+        driver().config = config;
+        if (driver().reservations.empty()) {
+            driver().next_address = config.address_base;
+        }
+    }
+
+    const DriverConfig& config() {
+        return driver().config;
+    }
+
+    DriverStats stats() {
+        Driver& d = driver();
+        std::lock_guard<std::mutex> lock(d.mtx);
+        DriverStats stats = d.stats;
+        stats.num_handles = d.handles.size();
+        stats.num_mappings = d.mappings.size();
+        stats.num_reservations = d.reservations.size();
+        return stats;
+    }
+
+    double modeled_us() {
+        Driver& d = driver();
+        std::lock_guard<std::mutex> lock(d.mtx);
+        return d.stats.modeled_us;
+    }
+
+    int device_of(uint64_t ptr) {
+        Driver& d = driver();
+        std::lock_guard<std::mutex> lock(d.mtx);
+        Mapping* m = d.mapping_at(ptr);
+        return m != nullptr ? d.handles[m->handle].device : -1;
+    }
+
+    std::vector<int> access_of(uint64_t ptr) {
+        Driver& d = driver();
+        std::lock_guard<std::mutex> lock(d.mtx);
+        Mapping* m = d.mapping_at(ptr);
+        return m != nullptr ? std::vector<int>(m->access.begin(), m->access.end()) : std::vector<int>();
+    }
+
+    // device of the context current in this thread
+    static thread_local int current_device = 0;
+
+    void reset_counters() {
+        Driver& d = driver();
+        std::lock_guard<std::mutex> lock(d.mtx);
+        d.stats.calls.clear();
+        d.stats.modeled_us = 0;
+        d.stats.errors = 0;
+        d.stats.peak_device_used = d.stats.device_used;
+    }
+
+} // namespace sim
+
+using sim::driver;
+using sim::current_device;
+
+extern "C" {
+
+CUresult CUDAAPI cuGetErrorString(CUresult error, const char** pStr) {
+    switch (error) {
+        case CUDA_SUCCESS: *pStr = "no error"; break;
+        case CUDA_ERROR_INVALID_VALUE: *pStr = "invalid argument"; break;
+        case CUDA_ERROR_OUT_OF_MEMORY: *pStr = "out of memory"; break;
+        default: *pStr = "simulated driver error"; break;
+    }
+    return CUDA_SUCCESS;
+}
+
+CUresult CUDAAPI cuCtxGetCurrent(CUcontext* pctx) {
+    *pctx = reinterpret_cast<CUcontext>(&driver().contexts[current_device]);
+    return CUDA_SUCCESS;
+}
+
+CUresult CUDAAPI cuCtxSetCurrent(CUcontext ctx) {
+    if (ctx != nullptr) {
+        current_device = *reinterpret_cast<int *>(ctx);
+    }
+    return CUDA_SUCCESS;
+}
+
+CUresult CUDAAPI cuDevicePrimaryCtxRetain(CUcontext* pctx, CUdevice dev) {
+    if (dev < 0 || dev >= driver().config.num_devices) {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+    *pctx = reinterpret_cast<CUcontext>(&driver().contexts[dev]);
+    return CUDA_SUCCESS;
+}
+
+CUresult CUDAAPI cuDevicePrimaryCtxRelease(CUdevice dev) {
+    return CUDA_SUCCESS;
+}
+
+CUresult CUDAAPI cuDeviceCanAccessPeer(int* canAccessPeer, CUdevice dev, CUdevice peerDev) {
+    const sim::DriverConfig& config = driver().config;
+    *canAccessPeer = config.peer_access && dev != peerDev && dev < config.num_devices && peerDev < config.num_devices;
+    return CUDA_SUCCESS;
+}
+
+CUresult CUDAAPI cuCtxSynchronize(void) {
+    return CUDA_SUCCESS;
+}
+
+CUresult CUDAAPI cuStreamIsCapturing(CUstream hStream, CUstreamCaptureStatus* captureStatus) {
+    *captureStatus = CU_STREAM_CAPTURE_STATUS_NONE;
+    return CUDA_SUCCESS;
+}
+
+CUresult CUDAAPI cuMemGetAllocationGranularity(size_t* granularity, const CUmemAllocationProp* prop, CUmemAllocationGranularity_flags option) {
+    *granularity = driver().config.granularity;
+    return CUDA_SUCCESS;
+}
+
+CUresult CUDAAPI cuMemGetInfo(size_t* free, size_t* total) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    *total = d.config.device_capacity;
+    *free = d.config.device_capacity - d.stats.used_per_device[current_device];
+    return d.call("cuMemGetInfo");
+}
+
+CUresult CUDAAPI cuMemCreate(CUmemGenericAllocationHandle* handle, size_t size, const CUmemAllocationProp* prop, unsigned long long flags) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    if (size == 0 || size % d.config.granularity != 0) {
+        return d.call("cuMemCreate", CUDA_ERROR_INVALID_VALUE);
+    }
+    bool on_device = prop->location.type == CU_MEM_LOCATION_TYPE_DEVICE;
+    int device = prop->location.id;
+    if (on_device && (device < 0 || device >= d.config.num_devices)) {
+        return d.call("cuMemCreate", CUDA_ERROR_INVALID_VALUE);
+    }
+    if (on_device && d.stats.used_per_device[device] + size > d.config.device_capacity) {
+        return d.call("cuMemCreate", CUDA_ERROR_OUT_OF_MEMORY);
+    }
+
+    *handle = d.next_handle++;
+    sim::Handle& h = d.handles[*handle];
+    h.size = size;
+    h.device = on_device ? device : -1;
+    h.on_device = on_device;
+    if (d.config.backing) {
+        h.bytes.resize(size);
+    }
+    if (on_device) {
+        d.stats.device_used += size;
+        d.stats.used_per_device[device] += size;
+        d.stats.peak_device_used = std::max(d.stats.peak_device_used, d.stats.device_used);
+    } else {
+        d.stats.host_used += size;
+    }
+    return d.call("cuMemCreate");
+}
+
+CUresult CUDAAPI cuMemRelease(CUmemGenericAllocationHandle handle) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    auto it = d.handles.find(handle);
+    if (it == d.handles.end() || it->second.released) {
+        return d.call("cuMemRelease", CUDA_ERROR_INVALID_VALUE);
+    }
+    it->second.released = true;
+    d.collect(handle);
+    return d.call("cuMemRelease");
+}
+
+CUresult CUDAAPI cuMemAddressReserve(CUdeviceptr* ptr, size_t size, size_t alignment, CUdeviceptr addr, unsigned long long flags) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    if (size == 0 || size % d.config.granularity != 0) {
+        return d.call("cuMemAddressReserve", CUDA_ERROR_INVALID_VALUE);
+    }
+    // the hint is honoured when the range is free, like the real driver usually does. The other reservations go
+    // to the cursor, past the hinted ones
+    size_t align = std::max(alignment, d.config.granularity);
+    CUdeviceptr base = ROUND_UP(addr, align);
+    if (addr == 0 || d.overlapping(base, size) != d.reservations.end()) {
+        base = ROUND_UP(d.next_address, align);
+        for (auto it = d.overlapping(base, size); it != d.reservations.end(); it = d.overlapping(base, size)) {
+            base = ROUND_UP(it->first + it->second + d.config.granularity, align);
+        }
+        d.next_address = base + size + d.config.granularity;
+    }
+    d.reservations[base] = size;
+    *ptr = base;
+    return d.call("cuMemAddressReserve");
+}
+
+CUresult CUDAAPI cuMemAddressFree(CUdeviceptr ptr, size_t size) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    auto it = d.reservations.find(ptr);
+    if (it == d.reservations.end() || it->second != size) {
+        return d.call("cuMemAddressFree", CUDA_ERROR_INVALID_VALUE);
+    }
+    auto mapped = d.mappings.lower_bound(ptr);
+    if (mapped != d.mappings.end() && mapped->first < ptr + size) {
+        // still mapped
+        return d.call("cuMemAddressFree", CUDA_ERROR_INVALID_VALUE);
+    }
+    d.reservations.erase(it);
+    return d.call("cuMemAddressFree");
+}
+
+CUresult CUDAAPI cuMemMap(CUdeviceptr ptr, size_t size, size_t offset, CUmemGenericAllocationHandle handle, unsigned long long flags) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    auto h = d.handles.find(handle);
+    if (h == d.handles.end() || h->second.released || offset != 0 || size > h->second.size || !d.reserved(ptr, size)) {
+        return d.call("cuMemMap", CUDA_ERROR_INVALID_VALUE);
+    }
+    auto next = d.mappings.lower_bound(ptr);
+    if (next != d.mappings.end() && next->first < ptr + size) {
+        return d.call("cuMemMap", CUDA_ERROR_INVALID_VALUE);
+    }
+    if (next != d.mappings.begin() && std::prev(next)->first + std::prev(next)->second.size > ptr) {
+        return d.call("cuMemMap", CUDA_ERROR_INVALID_VALUE);
+    }
+    d.mappings[ptr] = sim::Mapping{size, handle};
+    h->second.mappings++;
+    return d.call("cuMemMap");
+}
+
+CUresult CUDAAPI cuMemUnmap(CUdeviceptr ptr, size_t size) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    auto it = d.mappings.find(ptr);
+    if (it == d.mappings.end() || it->second.size != size) {
+        // the whole mapping must be unmapped at once
+        return d.call("cuMemUnmap", CUDA_ERROR_INVALID_VALUE);
+    }
+    CUmemGenericAllocationHandle handle = it->second.handle;
+    d.mappings.erase(it);
+    d.handles[handle].mappings--;
+    d.collect(handle);
+    return d.call("cuMemUnmap");
+}
+
+CUresult CUDAAPI cuMemSetAccess(CUdeviceptr ptr, size_t size, const CUmemAccessDesc* desc, size_t count) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    if (count == 0 || !d.reserved(ptr, size)) {
+        return d.call("cuMemSetAccess", CUDA_ERROR_INVALID_VALUE);
+    }
+    for (auto it = d.mappings.lower_bound(ptr); it != d.mappings.end() && it->first < ptr + size; ++it) {
+        for (size_t i = 0; i < count; i++) {
+            if (desc[i].flags != CU_MEM_ACCESS_FLAGS_PROT_NONE) {
+                it->second.access.insert(desc[i].location.id);
+            }
+            if (desc[i].flags == CU_MEM_ACCESS_FLAGS_PROT_READWRITE) {
+                it->second.writable.insert(desc[i].location.id);
+            }
+        }
+    }
+    return d.call("cuMemSetAccess");
+}
+
+// without backing there is no memory behind the simulated addresses : copies are only counted
+
+CUresult CUDAAPI cuMemcpyDtoD(CUdeviceptr dst, CUdeviceptr src, size_t size) {
+    std::lock_guard<std::mutex> lock(driver().mtx);
+    return driver().copy("cuMemcpyDtoD", dst, current_device, src, current_device, size);
+}
+
+CUresult CUDAAPI cuMemcpyPeer(CUdeviceptr dstDevice, CUcontext dstContext, CUdeviceptr srcDevice, CUcontext srcContext, size_t ByteCount) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    d.stats.modeled_us += ByteCount / (d.config.peer_gbps * 1e3);
+    return d.copy("cuMemcpyPeer", dstDevice, *reinterpret_cast<int *>(dstContext), srcDevice, *reinterpret_cast<int *>(srcContext), ByteCount);
+}
+
+CUresult CUDAAPI cuMemcpyDtoH(void* dst, CUdeviceptr src, size_t size) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    if (!d.config.backing) {
+        return d.call("cuMemcpyDtoH");
+    }
+    unsigned char* out = static_cast<unsigned char *>(dst);
+    bool ok = d.visit(src, size, current_device, false, [&](unsigned char* bytes, size_t length) {
+        std::memcpy(out, bytes, length);
+        out += length;
+    });
+    return d.call("cuMemcpyDtoH", ok ? CUDA_SUCCESS : CUDA_ERROR_INVALID_VALUE);
+}
+
+CUresult CUDAAPI cuMemcpyHtoD(CUdeviceptr dst, const void* src, size_t size) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    if (!d.config.backing) {
+        return d.call("cuMemcpyHtoD");
+    }
+    const unsigned char* in = static_cast<const unsigned char *>(src);
+    bool ok = d.visit(dst, size, current_device, true, [&](unsigned char* bytes, size_t length) {
+        std::memcpy(bytes, in, length);
+        in += length;
+    });
+    return d.call("cuMemcpyHtoD", ok ? CUDA_SUCCESS : CUDA_ERROR_INVALID_VALUE);
+}
+
+CUresult CUDAAPI cuMemsetD8(CUdeviceptr dst, unsigned char value, size_t size) {
+    sim::Driver& d = driver();
+    std::lock_guard<std::mutex> lock(d.mtx);
+    if (!d.config.backing) {
+        return d.call("cuMemsetD8");
+    }
+    bool ok = d.visit(dst, size, current_device, true, [&](unsigned char* bytes, size_t length) {
+        std::memset(bytes, value, length);
+    });
+    return d.call("cuMemsetD8", ok ? CUDA_SUCCESS : CUDA_ERROR_INVALID_VALUE);
+}
+
+CUresult CUDAAPI cuMemHostAlloc(void** pp, size_t size, unsigned int flags) {
+    *pp = std::malloc(size);
+    return *pp ? CUDA_SUCCESS : CUDA_ERROR_OUT_OF_MEMORY;
+}
+
+CUresult CUDAAPI cuMemFreeHost(void* p) {
+    std::free(p);
+    return CUDA_SUCCESS;
+}
+
+} // extern "C"
@@ -0,0 +1,99 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Simulated CUDA driver : sim_driver.cpp defines the cu* entry points used by the allocator core with host side
+// bookkeeping only, so that the real VmmAllocator runs on a CPU. Virtual addresses are never dereferenced.
+//
+// The driver checks what the real one rejects (mapping outside a reservation or from a nonzero handle offset, unmapping
+// a partial mapping, going over the device capacity) and models the cost of every call with a fixed latency, in the
+// order of magnitude measured on recent datacenter GPUs.
+//
+// With `backing`, the handles hold host memory : copies move real bytes through the mappings and fail when the
+// copying device has no access to them, or only read access to the destination, so that tests can check the content
+// of the ranges the allocator remaps.
+
+namespace sim {
+
+struct DriverConfig {
+    // capacity of each device
+    size_t device_capacity = 80ULL << 30;
+    size_t granularity = 2ULL << 20;
+    int num_devices = 1;
+    bool backing = false;
+    // devices reach the memory of each other (NVLink, PCIe P2P)
+    bool peer_access = true;
+    // modeled bandwidth of cuMemcpyPeer
+    double peer_gbps = 50.0;
+    // first address of the reservations without a hint, processes simulating ranks change it to get different
+    // address space layouts
+    uint64_t address_base = 0x7f0000000000ULL;
+
+    // modeled latency of the calls, in microseconds
+    std::map<std::string, double> latency_us = {
+        {"cuMemCreate", 40.0},
+        {"cuMemRelease", 30.0},
+        {"cuMemMap", 5.0},
+        {"cuMemUnmap", 15.0},
+        {"cuMemSetAccess", 20.0},
+        {"cuMemAddressReserve", 3.0},
+        {"cuMemAddressFree", 2.0},
+        {"cuMemGetInfo", 1.0},
+    };
+};
+
+struct DriverStats {
+    std::map<std::string, size_t> calls;
+    // sum of the modeled latencies
+    double modeled_us = 0;
+    // all devices
+    size_t device_used = 0;
+    size_t peak_device_used = 0;
+    std::map<int, size_t> used_per_device;
+    // handles located on the host (CU_MEM_LOCATION_TYPE_HOST*), they do not take device capacity
+    size_t host_used = 0;
+    size_t num_handles = 0;
+    size_t num_mappings = 0;
+    size_t num_reservations = 0;
+    size_t errors = 0;
+};
+
+void configure(const DriverConfig& config);
+
+const DriverConfig& config();
+
+// snapshot of the counters
+DriverStats stats();
+
+// modeled latency spent in the driver so far, for latency measurements around a call
+double modeled_us();
+
+// device of the memory mapped at `ptr`, -1 if nothing is mapped there or the memory is on the host
+int device_of(uint64_t ptr);
+
+// devices granted access to the mapping at `ptr`
+std::vector<int> access_of(uint64_t ptr);
+
+void reset_counters();
+
+} // namespace sim
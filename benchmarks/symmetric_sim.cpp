@@ -0,0 +1,268 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Symmetric heap across local ranks, one process per rank.
+//
+// Every rank runs the real VmmAllocator over its own simulated driver, with a different address space layout (the
+// first address of the driver and the allocations made before the heap differ per rank). The ranks agree on a heap
+// base through a shared file, then make the same sequence of symmetric allocations and frees, interleaved with
+// private allocations which differ per rank. The run checks that
+//
+//   - every symmetric buffer is at the same address on every rank, also after frees reuse the holes of the heap
+//   - the buffers are backed : a pattern written to each one reads back
+//   - nothing leaks once the buffers are freed and the heap is finalized
+//
+// With --conflict, rank 0 holds a reservation where the other ranks first propose the heap, so that the agreement
+// takes several rounds.
+//
+// Build & run :
+//
+//   g++ -O2 -std=c++17 -I include/vtensor -I $CUDA_HOME/include -pthread -o symmetric_sim
+//       benchmarks/symmetric_sim.cpp benchmarks/sim_driver.cpp src/allocator/*.cpp -lrt
+//   ./symmetric_sim --ranks 4 --heap-mb 256 --conflict
+//
+// or cmake -DVTENSOR_BUILD_BENCHMARKS=ON, target vtensor_symmetric_sim. Exits with 1 if a check fails.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "allocator/vmm_allocator.h"
+#include "sim_driver.h"
+
+using namespace nvgpu;
+
+struct Options {
+    int ranks = 4;
+    size_t heap_bytes = 256ULL << 20;
+    bool conflict = false;
+    bool verbose = false;
+};
+
+// distance between the first addresses of the ranks
+static const uint64_t kRankStride = 64ULL << 30;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED : %s\n", what.c_str());
+        failures++;
+    }
+}
+
+static void usage(const char* name) {
+    std::fprintf(stderr, "usage : %s [--ranks N] [--heap-mb MB] [--conflict] [--verbose]\n", name);
+}
+
+// runs in the process of `rank`, writes "<rounds> <base> <address>..." to `report_fd`
+static int run_rank(const Options& options, const std::string& path, int rank, int report_fd) {
+    sim::DriverConfig config;
+    config.backing = true;
+    config.device_capacity = 4ULL << 30;
+    config.address_base = sim::DriverConfig().address_base + rank * kRankStride;
+    sim::configure(config);
+
+    if (!options.verbose) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+    std::unique_ptr<VmmAllocator> allocator(new VmmAllocator());
+
+    // private allocations before the heap, a different number per rank
+    std::vector<std::pair<void*, size_t>> private_buffers;
+    for (int i = 0; i <= rank; i++) {
+        size_t size = (size_t)(i + 1) * (3ULL << 20);
+        private_buffers.push_back({allocator->alloc(size, 0, nullptr), size});
+    }
+    // where the last rank proposes the heap
+    CUdeviceptr blocker = 0;
+    size_t blocker_size = 2 * options.heap_bytes;
+    if (options.conflict && rank == 0 && options.ranks > 1) {
+        CUdeviceptr hint = config.address_base + (options.ranks - 1) * kRankStride;
+        check(cuMemAddressReserve(&blocker, blocker_size, 0, hint, 0) == CUDA_SUCCESS && blocker == hint, "reserve the blocker");
+    }
+
+    allocator->symmetric_init(path, rank, options.ranks, options.heap_bytes, 0, 30000);
+    SymmetricHeap* heap = allocator->symmetric_heap.get();
+
+    // the same symmetric sequence on every rank, the private allocations in between differ
+    std::vector<std::pair<void*, size_t>> buffers;
+    std::vector<std::string> addresses;
+    auto alloc_symmetric = [&](size_t size) {
+        void* ptr = allocator->alloc_symmetric(size, 0);
+        buffers.push_back({ptr, size});
+        addresses.push_back(std::to_string(reinterpret_cast<uintptr_t>(ptr)));
+
+        std::vector<unsigned char> pattern(size);
+        for (size_t b = 0; b < size; b++) {
+            pattern[b] = (unsigned char)(b * 13 + rank * 7 + buffers.size());
+        }
+        std::vector<unsigned char> read(size);
+        CUdeviceptr dptr = reinterpret_cast<CUdeviceptr>(ptr);
+        check(cuMemcpyHtoD(dptr, pattern.data(), size) == CUDA_SUCCESS && cuMemcpyDtoH(read.data(), dptr, size) == CUDA_SUCCESS &&
+              read == pattern, "content of symmetric buffer " + std::to_string(buffers.size()) + " on rank " + std::to_string(rank));
+    };
+    for (size_t mb : {8, 1, 20, 4}) {
+        alloc_symmetric(mb << 20);
+        if (rank % 2 == 1) {
+            private_buffers.push_back({allocator->alloc(5ULL << 20, 0, nullptr), 5ULL << 20});
+        }
+    }
+    // the hole of the second buffer is reused first fit
+    allocator->dealloc(buffers[1].first, buffers[1].second, 0, nullptr);
+    alloc_symmetric(512 << 10);
+    allocator->dealloc(buffers[0].first, buffers[0].second, 0, nullptr);
+    alloc_symmetric(6ULL << 20);
+
+    std::ostringstream report;
+    report << heap->rounds() << " " << reinterpret_cast<uintptr_t>(heap->base());
+    for (auto& address : addresses) {
+        report << " " << address;
+    }
+    report << "\n";
+    std::string line = report.str();
+    check(write(report_fd, line.data(), line.size()) == (ssize_t)line.size(), "report of rank " + std::to_string(rank));
+    close(report_fd);
+
+    for (size_t i = 2; i < buffers.size(); i++) {
+        allocator->dealloc(buffers[i].first, buffers[i].second, 0, nullptr);
+    }
+    check(heap->reserved_bytes() == 0, "the heap of rank " + std::to_string(rank) + " is empty");
+    allocator->symmetric_finalize();
+    for (auto& buffer : private_buffers) {
+        allocator->dealloc(buffer.first, buffer.second, 0, nullptr);
+    }
+    if (blocker != 0) {
+        cuMemAddressFree(blocker, blocker_size);
+    }
+    allocator->empty_cache();
+    allocator.reset();
+
+    sim::DriverStats end = sim::stats();
+    check(end.num_handles == 0 && end.num_mappings == 0 && end.num_reservations == 0, "nothing leaks on rank " + std::to_string(rank));
+    check(end.errors == 0, "no failed driver call on rank " + std::to_string(rank));
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--ranks" && has_value) {
+            options.ranks = std::atoi(argv[++i]);
+        } else if (arg == "--heap-mb" && has_value) {
+            options.heap_bytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+        } else if (arg == "--conflict") {
+            options.conflict = true;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.ranks <= 0 || options.ranks > SymmetricHeap::kMaxRanks || options.heap_bytes < (64ULL << 20)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string path = "/tmp/vtensor_symmetric_sim." + std::to_string(getpid());
+    unlink(path.c_str());
+
+    std::vector<pid_t> pids;
+    std::vector<int> report_fds;
+    for (int rank = 0; rank < options.ranks; rank++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            std::perror("pipe");
+            return 1;
+        }
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            int status = 1;
+            try {
+                status = run_rank(options, path, rank, fds[1]);
+            } catch (std::exception& e) {
+                std::fprintf(stderr, "FAILED : rank %d : %s\n", rank, e.what());
+            }
+            std::fflush(stderr);
+            _exit(status);
+        }
+        close(fds[1]);
+        pids.push_back(pid);
+        report_fds.push_back(fds[0]);
+    }
+
+    std::vector<std::string> reports;
+    for (int fd : report_fds) {
+        std::string report;
+        char buffer[4096];
+        ssize_t n;
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+            report.append(buffer, n);
+        }
+        close(fd);
+        reports.push_back(report);
+    }
+    for (size_t rank = 0; rank < pids.size(); rank++) {
+        int status = 0;
+        waitpid(pids[rank], &status, 0);
+        check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "rank " + std::to_string(rank) + " passed its checks");
+    }
+
+    // "<rounds> <base> <addresses>" : everything but the rounds must match
+    std::vector<std::string> layouts;
+    int rounds = 0;
+    for (auto& report : reports) {
+        std::istringstream is(report);
+        int rank_rounds = 0;
+        is >> rank_rounds;
+        rounds = std::max(rounds, rank_rounds);
+        std::string layout;
+        std::getline(is, layout);
+        layouts.push_back(layout);
+    }
+    for (size_t rank = 1; rank < layouts.size(); rank++) {
+        check(!layouts[rank].empty() && layouts[rank] == layouts[0], "rank " + std::to_string(rank) + " has the layout of rank 0");
+    }
+    check(access(path.c_str(), F_OK) != 0, "the agreement file is removed");
+
+    std::istringstream first(layouts.empty() ? "" : layouts[0]);
+    uintptr_t base = 0, address = 0;
+    first >> base;
+    std::printf("%d ranks agreed on heap base 0x%lx (%.1f MiB) after %d rounds%s\n", options.ranks, (unsigned long)base,
+                options.heap_bytes / 1048576.0, rounds, options.conflict ? ", rank 0 blocking the first proposal" : "");
+    std::printf("symmetric buffers at the same heap offsets on every rank (MiB) :");
+    while (first >> address) {
+        std::printf(" %.1f", (address - base) / 1048576.0);
+    }
+    std::printf("\n");
+    std::printf("%s\n", failures == 0 ? "all checks passed" : "some checks failed");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nvgpu {
+
+struct VmmAllocator;
+
+// Checkpoint of the allocator layout and of selected buffers (weights, KV cache), so that a restarted replica
+// rebuilds its memory with a sequential file read instead of re-initializing the blocks and reloading the model.
+//
+// File layout (native endianness, the file is only read back on the same kind of host) :
+//
+//   CheckpointHeader
+//   num_segments x CheckpointSegmentRecord
+//   num_regions  x (CheckpointRegionRecord, name, meta)
+//   layout_size bytes of allocator snapshot JSON
+//   chunks : CheckpointChunkRecord + `length` bytes of region `region` at `offset`, ended by kEndOfChunks
+//
+// A segment is the allocation (VA reservation) that owns one or more regions. Restore allocates one buffer per
+// segment and places every region at its original offset, so buffers sharing a reservation stay together.
+
+static const char kCheckpointMagic[8] = {'V', 'T', 'C', 'K', 'P', 'T', '\0', '\1'};
+static const uint32_t kCheckpointVersion = 1;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_segments;
+    uint32_t num_regions;
+    uint32_t reserved;
+    uint64_t chunk_size;
+    uint64_t layout_size;
+};
+
+struct CheckpointSegmentRecord {
+    int32_t device;
+    uint32_t reserved;
+    uint64_t size;
+    // address at checkpoint time, informative only
+    uint64_t original_base;
+};
+
+struct CheckpointRegionRecord {
+    uint32_t segment;
+    uint32_t name_size;
+    uint32_t meta_size;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct CheckpointChunkRecord {
+    static const uint32_t kEndOfChunks = 0xffffffffu;
+
+    uint32_t region;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Memory the checkpoint reads from and restores to. The VMM implementation copies through pinned staging
+// buffers, the host implementation stands in for a device with plain host memory so the whole save / restore
+// path runs without a GPU.
+struct CheckpointBackend {
+    virtual ~CheckpointBackend() = default;
+
+    virtual void* alloc(size_t size, int device) = 0;
+
+    virtual void free(void* ptr, size_t size, int device) = 0;
+
+    virtual void* alloc_staging(size_t size) = 0;
+
+    virtual void free_staging(void* ptr, size_t size) = 0;
+
+    virtual void copy_to_host(void* dst, const void* src, size_t size, int device) = 0;
+
+    virtual void copy_to_device(void* dst, const void* src, size_t size, int device) = 0;
+
+    // allocation owning `ptr`, false when the backend does not track allocations
+    virtual bool find_segment(const void* ptr, uintptr_t* base, size_t* size) { return false; }
+};
+
+struct HostCheckpointBackend : public CheckpointBackend {
+    void* alloc(size_t size, int device) override;
+    void free(void* ptr, size_t size, int device) override;
+    void* alloc_staging(size_t size) override;
+    void free_staging(void* ptr, size_t size) override;
+    void copy_to_host(void* dst, const void* src, size_t size, int device) override;
+    void copy_to_device(void* dst, const void* src, size_t size, int device) override;
+};
+
+struct VmmCheckpointBackend : public CheckpointBackend {
+    explicit VmmCheckpointBackend(std::shared_ptr<VmmAllocator> allocator) : allocator(allocator) {}
+
+    void* alloc(size_t size, int device) override;
+    void free(void* ptr, size_t size, int device) override;
+    void* alloc_staging(size_t size) override;
+    void free_staging(void* ptr, size_t size) override;
+    void copy_to_host(void* dst, const void* src, size_t size, int device) override;
+    void copy_to_device(void* dst, const void* src, size_t size, int device) override;
+    bool find_segment(const void* ptr, uintptr_t* base, size_t* size) override;
+
+    std::shared_ptr<VmmAllocator> allocator;
+};
+
+struct CheckpointRegion {
+    std::string name;
+    // opaque to the core, e.g. dtype / shape / stride of a tensor
+    std::string meta;
+    void* ptr = nullptr;
+    size_t size = 0;
+    int device = 0;
+};
+
+struct CheckpointSegment {
+    void* ptr = nullptr;
+    size_t size = 0;
+    int device = 0;
+};
+
+struct CheckpointOptions {
+    // bytes per chunk record, also the size of a staging buffer
+    size_t chunk_size = 8 << 20;
+    // staging buffers in flight between the copy thread and the file thread
+    int num_buffers = 4;
+};
+
+// Staging buffers handed over between the thread copying to / from the device and the thread doing the file
+// I/O, so that the device copy of chunk i+1 overlaps the file access of chunk i. Also used by the safetensors
+// loader.
+struct StagingQueue {
+    struct Item {
+        int buffer;
+        CheckpointChunkRecord record;
+    };
+
+    StagingQueue(CheckpointBackend* backend, size_t buffer_size, int num_buffers)
+        : backend(backend), buffer_size(buffer_size) {
+        for (int i = 0; i < std::max(num_buffers, 2); i++) {
+            buffers.push_back(backend->alloc_staging(buffer_size));
+            free_buffers.push_back(i);
+        }
+    }
+
+    ~StagingQueue() {
+        for (void* buffer : buffers) {
+            backend->free_staging(buffer, buffer_size);
+        }
+    }
+
+    // -1 once the queue is closed
+    int acquire() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] { return closed || !free_buffers.empty(); });
+        if (closed) {
+            return -1;
+        }
+        int buffer = free_buffers.front();
+        free_buffers.pop_front();
+        return buffer;
+    }
+
+    void release(int buffer) {
+        std::lock_guard<std::mutex> lock(mtx);
+        free_buffers.push_back(buffer);
+        cv.notify_all();
+    }
+
+    void push(const Item& item) {
+        std::lock_guard<std::mutex> lock(mtx);
+        full.push_back(item);
+        cv.notify_all();
+    }
+
+    // false once the queue is closed and drained
+    bool pop(Item* item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] { return closed || !full.empty(); });
+        if (full.empty()) {
+            return false;
+        }
+        *item = full.front();
+        full.pop_front();
+        return true;
+    }
+
+    void close(const std::string& why = std::string()) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (error.empty()) {
+            error = why;
+        }
+        closed = true;
+        cv.notify_all();
+    }
+
+    void* data(int buffer) { return buffers[buffer]; }
+
+    CheckpointBackend* backend;
+    size_t buffer_size;
+    std::vector<void*> buffers;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<int> free_buffers;
+    std::deque<Item> full;
+    bool closed = false;
+    std::string error;
+};
+
+// returns the number of bytes written
+size_t save_checkpoint(const std::string& path, const std::vector<CheckpointRegion>& regions, CheckpointBackend* backend,
+                       const std::string& layout_json, const CheckpointOptions& options = CheckpointOptions());
+
+struct RestoredCheckpoint {
+    // allocated with the backend, owned by the caller
+    std::vector<CheckpointSegment> segments;
+    // region pointers point into the segments
+    std::vector<CheckpointRegion> regions;
+    // segment of every region
+    std::vector<size_t> region_segments;
+    std::string layout_json;
+    size_t bytes_read = 0;
+};
+
+// throws std::runtime_error on a malformed file, the segments allocated so far are freed
+RestoredCheckpoint restore_checkpoint(const std::string& path, CheckpointBackend* backend,
+                                      const CheckpointOptions& options = CheckpointOptions());
+
+} // namespace nvgpu
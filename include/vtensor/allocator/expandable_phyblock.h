@@ -24,6 +24,10 @@ limitations under the License.
 #include <set>
 #include <vector>
 
+#include "lifetime.h"
+#include "memory_tier.h"
+#include "placement_policy.h"
+
 namespace nvgpu {
 
 struct VmmAllocator;
@@ -37,12 +41,25 @@ struct BlockPool;
 // With VMM API, we can request a tensor with actual size, and expand it in runtime (pad an activation tensor) without copy the whole tensor.
 class ExpandablePhyBlock {
 public:
-  ExpandablePhyBlock(int device_id, size_t block_size);
+  // a block of the host tier holds pinned host memory, of `numa_node` when >= 0, mapped for `device_id`
+  ExpandablePhyBlock(int device_id, size_t block_size, MemoryTier tier = MemoryTier::DEVICE_MEMORY, int numa_node = -1);
   ~ExpandablePhyBlock();
 
   bool map_virtual_address(CUdeviceptr v_offset_addr, size_t size);
 
-  bool unmap_virtual_address(CUdeviceptr v_offset_addr, size_t size);
+  // `release_address` frees the virtual range too, when the mapping is the whole reservation
+  bool unmap_virtual_address(CUdeviceptr v_offset_addr, size_t size, bool release_address = true);
+
+  // maps the block again at `v_offset_addr` without taking capacity, the caller owns the virtual range
+  bool map_alias(CUdeviceptr v_offset_addr, size_t size, CUmemAccess_flags access = CU_MEM_ACCESS_FLAGS_PROT_READWRITE);
+
+  bool unmap_alias(CUdeviceptr v_offset_addr);
+
+  // allocation granularity of the memory of `tier`, 0 if the driver cannot tell
+  static size_t granularity_of(int device_id, MemoryTier tier, int numa_node = -1);
+
+  // neither mapped nor aliased : every mapping starts at offset 0 of the block, so only an idle block takes a new one
+  bool idle() const { return mapped_addresses.empty() && alias_addresses.empty(); }
 
   static std::atomic<int> thread_safe_counter;
 
@@ -54,9 +71,19 @@ public:
 
   int device_id = 0;
 
+  // the owned pool only offers the block to allocations of the same lifetime
+  Lifetime lifetime = Lifetime::DEFAULT;
+
+  MemoryTier tier = MemoryTier::DEVICE_MEMORY;
+
+  int numa_node = -1;
+
   using Address = uintptr_t;
   std::map<Address, size_t> mapped_addresses;
 
+  // views aliasing the block (see VmmAllocator::gather), the block is not offered for new mappings meanwhile
+  std::map<Address, size_t> alias_addresses;
+
   VmmAllocator* allocator = nullptr;
 
   BlockPool<ExpandablePhyBlock>* owned_pool = nullptr;
@@ -97,19 +124,61 @@ struct OwnedBlockPool<ExpandablePhyBlock> {
 
     using BlockId = int;
     std::map<BlockId, std::shared_ptr<ExpandablePhyBlock>> blocks;
-    std::map<size_t, std::vector<ExpandablePhyBlock*>> open_blocks;
+
+    // an idle block is mapped whole by one request, so it only serves the requests of at least 1 / kMaxReuseRatio of
+    // its size : a small tensor would pin a large block, the others get a block of their own (or scattered pieces)
+    static constexpr size_t kMaxReuseRatio = 2;
+
+    // idle blocks, indexed by the placement policy with their size
+    std::unique_ptr<PlacementPolicy<ExpandablePhyBlock>> open_blocks;
+
+    // open blocks of the hinted lifetimes, apart from the default ones : transient blocks (the arenas, and the
+    // requests larger than an arena) and persistent blocks best fit, step blocks follow the policy of the pool
+    std::unique_ptr<PlacementPolicy<ExpandablePhyBlock>> lifetime_blocks[(int)Lifetime::N];
+
+    // open blocks of the host tier, whatever their lifetime, best fit : device allocations never land in them
+    std::unique_ptr<PlacementPolicy<ExpandablePhyBlock>> host_blocks;
 
     VmmAllocator* allocator = nullptr;
 
-    OwnedBlockPool() {}
+    OwnedBlockPool() : open_blocks(PlacementPolicy<ExpandablePhyBlock>::create(PlacementPolicyType::BEST_FIT)),
+                       host_blocks(PlacementPolicy<ExpandablePhyBlock>::create(PlacementPolicyType::BEST_FIT)) {
+        lifetime_blocks[(int)Lifetime::TRANSIENT] = PlacementPolicy<ExpandablePhyBlock>::create(PlacementPolicyType::BEST_FIT);
+        lifetime_blocks[(int)Lifetime::STEP] = PlacementPolicy<ExpandablePhyBlock>::create(PlacementPolicyType::BEST_FIT);
+        lifetime_blocks[(int)Lifetime::PERSISTENT] = PlacementPolicy<ExpandablePhyBlock>::create(PlacementPolicyType::BEST_FIT);
+    }
+
+    PlacementPolicyType policy() const { return open_blocks->type(); }
+
+    PlacementPolicy<ExpandablePhyBlock>* open_blocks_of(Lifetime lifetime, MemoryTier tier = MemoryTier::DEVICE_MEMORY) const {
+        if (tier == MemoryTier::HOST_MEMORY) {
+            return host_blocks.get();
+        }
+        return lifetime == Lifetime::DEFAULT ? open_blocks.get() : lifetime_blocks[(int)lifetime].get();
+    }
+
+    // re-index the open blocks of the default and step lifetimes with another strategy, can be called at any time
+    void set_policy(PlacementPolicyType type);
 
     bool add(std::shared_ptr<ExpandablePhyBlock> block);
 
     bool remove(ExpandablePhyBlock* block);
 
-    ExpandablePhyBlock* find_available(size_t size);
+    // idle block of at least `size` and at most kMaxReuseRatio * `size` bytes, picked by the placement policy
+    ExpandablePhyBlock* find_available(size_t size, Lifetime lifetime = Lifetime::DEFAULT, MemoryTier tier = MemoryTier::DEVICE_MEMORY);
+
+    // pieces (block, size) of the open blocks covering up to `size` bytes, the largest first, every piece a multiple
+    // of `granularity` and at least 1 / kMaxReuseRatio of its block. Like find_available, the blocks are closed right
+    // away.
+    std::vector<std::pair<ExpandablePhyBlock*, size_t>> take_pieces(size_t size, size_t granularity, size_t max_pieces, Lifetime lifetime = Lifetime::DEFAULT);
+
+    // open blocks of every lifetime and tier
+    void for_each_open(const std::function<void(ExpandablePhyBlock*, size_t)>& fn) const;
 
     void update(ExpandablePhyBlock* block, size_t previous_remaining_size);
+
+    // re-index the block, open once it is idle again
+    void refresh(ExpandablePhyBlock* block);
 };
 
 } // namespace nvgpu
@@ -0,0 +1,71 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <string>
+
+namespace nvgpu {
+
+// Expected lifetime of an allocation. The owned pool keeps the blocks of each lifetime apart, so that a long lived
+// allocation never pins a block the short lived ones would otherwise release :
+//
+//   TRANSIENT   activations, workspaces : freed within the step, bump allocated from arena blocks which are reused
+//               once all their allocations were freed (bulk reset)
+//   STEP        buffers kept for one iteration, placed by the policy of the pool (see set_placement_policy)
+//   PERSISTENT  weights, KV cache : best fit into exactly sized blocks
+//
+// DEFAULT is the shared pool of unhinted allocations.
+enum class Lifetime {
+    DEFAULT = 0,
+    TRANSIENT,
+    STEP,
+    PERSISTENT,
+    N
+};
+
+inline const char* lifetime_name(Lifetime lifetime) {
+    switch (lifetime) {
+        case Lifetime::DEFAULT: return "default";
+        case Lifetime::TRANSIENT: return "transient";
+        case Lifetime::STEP: return "step";
+        case Lifetime::PERSISTENT: return "persistent";
+        default: return "unknown";
+    }
+}
+
+inline bool parse_lifetime(const std::string& name, Lifetime* lifetime) {
+    for (int i = 0; i < (int)Lifetime::N; i++) {
+        if (name == lifetime_name((Lifetime)i)) {
+            *lifetime = (Lifetime)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// lifetime of the allocations made by the calling thread without an explicit hint (torch tensors, vmm_alloc)
+Lifetime current_lifetime();
+
+void set_current_lifetime(Lifetime lifetime);
+
+struct ScopedLifetime {
+    explicit ScopedLifetime(Lifetime lifetime) : previous(current_lifetime()) { set_current_lifetime(lifetime); }
+    ~ScopedLifetime() { set_current_lifetime(previous); }
+
+    Lifetime previous;
+};
+
+} // namespace nvgpu
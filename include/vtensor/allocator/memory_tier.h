@@ -0,0 +1,52 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <string>
+
+namespace nvgpu {
+
+// Where the physical memory of a block lives. Every tier is mapped into the virtual address space of the device
+// and read by kernels through the same pointers :
+//
+//   DEVICE_MEMORY  memory of the GPU
+//   HOST_MEMORY    pinned host memory (of one NUMA node when the allocator has one), reached over the
+//                  interconnect : zero-copy, for cold or spilled ranges which do not fit on the device
+enum class MemoryTier {
+    DEVICE_MEMORY = 0,
+    HOST_MEMORY,
+    N
+};
+
+inline const char* memory_tier_name(MemoryTier tier) {
+    switch (tier) {
+        case MemoryTier::DEVICE_MEMORY: return "device";
+        case MemoryTier::HOST_MEMORY: return "host";
+        default: return "unknown";
+    }
+}
+
+inline bool parse_memory_tier(const std::string& name, MemoryTier* tier) {
+    for (int i = 0; i < (int)MemoryTier::N; i++) {
+        if (name == memory_tier_name((MemoryTier)i)) {
+            *tier = (MemoryTier)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace nvgpu
@@ -0,0 +1,372 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace nvgpu {
+
+// Strategies used by OwnedBlockPool to pick the physical block serving a request.
+//
+// All strategies index a block by the number of bytes it can still serve, and a block indexed with zero capacity is
+// dropped, so no empty bucket is left behind. The owned pool indexes its idle blocks only, with their whole size :
+// a mapping starts at the first byte of its block, so a block serves one request at a time and its tail stays
+// unused. A request is therefore only served by a block at most `max_size` bytes large (twice the request in the
+// owned pool), the strategies pick among those. Lookups are O(log n) in the number of open blocks, apart from
+// first fit, which may visit the slots of the blocks larger than `max_size`.
+enum class PlacementPolicyType {
+    BEST_FIT = 0,   // smallest block that fits, ties broken by block id
+    FIRST_FIT,      // lowest pool slot that fits, slots are recycled lowest first (address-ordered first fit)
+    WORST_FIT,      // largest block, keeps the remaining tails large
+    SEGREGATED_FIT, // power-of-two size classes, good fit in O(1) class lookup (TLSF-like)
+    N
+};
+
+inline const char* placement_policy_name(PlacementPolicyType type) {
+    switch (type) {
+        case PlacementPolicyType::BEST_FIT: return "best_fit";
+        case PlacementPolicyType::FIRST_FIT: return "first_fit";
+        case PlacementPolicyType::WORST_FIT: return "worst_fit";
+        case PlacementPolicyType::SEGREGATED_FIT: return "segregated_fit";
+        default: return "unknown";
+    }
+}
+
+inline bool parse_placement_policy(const std::string& name, PlacementPolicyType* type) {
+    for (int i = 0; i < (int)PlacementPolicyType::N; i++) {
+        if (name == placement_policy_name((PlacementPolicyType)i)) {
+            *type = (PlacementPolicyType)i;
+            return true;
+        }
+    }
+    // aliases
+    if (name == "address_ordered") {
+        *type = PlacementPolicyType::FIRST_FIT;
+        return true;
+    }
+    if (name == "segregated") {
+        *type = PlacementPolicyType::SEGREGATED_FIT;
+        return true;
+    }
+    return false;
+}
+
+// Block only needs a `block_id` member, so that the policies can be driven by the allocator (ExpandablePhyBlock) and
+// by host-only simulations (see benchmarks/placement_policy_bench.cpp) alike.
+template<class Block>
+struct PlacementPolicy {
+
+    virtual ~PlacementPolicy() {}
+
+    virtual PlacementPolicyType type() const = 0;
+
+    // (re-)index `block` as able to serve up to `remaining` bytes, `remaining == 0` removes the block.
+    virtual void insert(Block* block, size_t remaining) = 0;
+
+    virtual bool erase(Block* block) = 0;
+
+    // returns a block able to serve `size` bytes, of at most `max_size` bytes, without removing it, or nullptr.
+    virtual Block* find(size_t size, size_t max_size) const = 0;
+
+    virtual size_t size() const = 0;
+
+    virtual void for_each(const std::function<void(Block*, size_t)>& fn) const = 0;
+
+    static std::unique_ptr<PlacementPolicy<Block>> create(PlacementPolicyType type);
+};
+
+// Ordered by (remaining, block_id) : both best fit and worst fit are a single tree lookup.
+template<class Block>
+struct SizeOrderedPolicy : public PlacementPolicy<Block> {
+
+    using Key = std::tuple<size_t, int, Block*>;
+
+    explicit SizeOrderedPolicy(bool best) : best(best) {}
+
+    PlacementPolicyType type() const override {
+        return best ? PlacementPolicyType::BEST_FIT : PlacementPolicyType::WORST_FIT;
+    }
+
+    void insert(Block* block, size_t remaining) override {
+        erase(block);
+        if (remaining == 0) {
+            return;
+        }
+        keys.insert({block, remaining});
+        open.insert(Key{remaining, block->block_id, block});
+    }
+
+    bool erase(Block* block) override {
+        auto it = keys.find(block);
+        if (it == keys.end()) {
+            return false;
+        }
+        open.erase(Key{it->second, block->block_id, block});
+        keys.erase(it);
+        return true;
+    }
+
+    Block* find(size_t size, size_t max_size) const override {
+        if (open.empty() || max_size < size) {
+            return nullptr;
+        }
+        if (best) {
+            auto it = open.lower_bound(Key{size, INT_MIN, nullptr});
+            return it == open.end() || std::get<0>(*it) > max_size ? nullptr : std::get<2>(*it);
+        }
+        // the largest block within the bound
+        auto it = open.upper_bound(Key{max_size, INT_MAX, nullptr});
+        if (it == open.begin()) {
+            return nullptr;
+        }
+        --it;
+        return std::get<0>(*it) >= size ? std::get<2>(*it) : nullptr;
+    }
+
+    size_t size() const override { return keys.size(); }
+
+    void for_each(const std::function<void(Block*, size_t)>& fn) const override {
+        for (auto& key : open) {
+            fn(std::get<2>(key), std::get<0>(key));
+        }
+    }
+
+    bool best;
+    std::set<Key> open;
+    std::unordered_map<Block*, size_t> keys;
+};
+
+// Max segment tree over pool slots : the first slot whose capacity fits is found by a single descent.
+template<class Block>
+struct FirstFitPolicy : public PlacementPolicy<Block> {
+
+    PlacementPolicyType type() const override { return PlacementPolicyType::FIRST_FIT; }
+
+    void insert(Block* block, size_t remaining) override {
+        if (remaining == 0) {
+            erase(block);
+            return;
+        }
+        size_t slot;
+        auto it = slots.find(block);
+        if (it != slots.end()) {
+            slot = it->second;
+        } else {
+            slot = acquire_slot();
+            slots.insert({block, slot});
+            leaves[slot] = block;
+        }
+        assign(slot, remaining);
+    }
+
+    bool erase(Block* block) override {
+        auto it = slots.find(block);
+        if (it == slots.end()) {
+            return false;
+        }
+        size_t slot = it->second;
+        assign(slot, 0);
+        leaves[slot] = nullptr;
+        free_slots.insert(slot);
+        slots.erase(it);
+        return true;
+    }
+
+    Block* find(size_t size, size_t max_size) const override {
+        if (capacity == 0 || max_size < size) {
+            return nullptr;
+        }
+        // leftmost leaf within [size, max_size] : the subtrees without a block of `size` bytes are skipped
+        std::vector<size_t> stack = {1};
+        while (!stack.empty()) {
+            size_t node = stack.back();
+            stack.pop_back();
+            if (tree[node] < size) {
+                continue;
+            }
+            if (node >= capacity) {
+                if (tree[node] <= max_size) {
+                    return leaves[node - capacity];
+                }
+                continue;
+            }
+            stack.push_back(2 * node + 1);
+            stack.push_back(2 * node);
+        }
+        return nullptr;
+    }
+
+    size_t size() const override { return slots.size(); }
+
+    void for_each(const std::function<void(Block*, size_t)>& fn) const override {
+        for (size_t slot = 0; slot < leaves.size(); slot++) {
+            if (leaves[slot] != nullptr) {
+                fn(leaves[slot], tree[capacity + slot]);
+            }
+        }
+    }
+
+    size_t acquire_slot() {
+        if (!free_slots.empty()) {
+            size_t slot = *free_slots.begin();
+            free_slots.erase(free_slots.begin());
+            return slot;
+        }
+        if (next_slot == capacity) {
+            grow();
+        }
+        return next_slot++;
+    }
+
+    void grow() {
+        size_t new_capacity = capacity == 0 ? 64 : capacity * 2;
+        std::vector<size_t> new_tree(2 * new_capacity, 0);
+        for (size_t slot = 0; slot < capacity; slot++) {
+            new_tree[new_capacity + slot] = tree[capacity + slot];
+        }
+        for (size_t node = new_capacity - 1; node > 0; node--) {
+            new_tree[node] = std::max(new_tree[2 * node], new_tree[2 * node + 1]);
+        }
+        tree.swap(new_tree);
+        leaves.resize(new_capacity, nullptr);
+        capacity = new_capacity;
+    }
+
+    void assign(size_t slot, size_t remaining) {
+        size_t node = capacity + slot;
+        tree[node] = remaining;
+        for (node /= 2; node > 0; node /= 2) {
+            tree[node] = std::max(tree[2 * node], tree[2 * node + 1]);
+        }
+    }
+
+    size_t capacity = 0;
+    size_t next_slot = 0;
+    std::vector<size_t> tree;
+    std::vector<Block*> leaves;
+    std::set<size_t> free_slots;
+    std::unordered_map<Block*, size_t> slots;
+};
+
+// Blocks are binned by floor(log2(remaining)). A request is served from its own class when some block there fits,
+// otherwise from the smallest block of the next non-empty class, found with a bitmap scan.
+template<class Block>
+struct SegregatedFitPolicy : public PlacementPolicy<Block> {
+
+    using Key = std::tuple<size_t, int, Block*>;
+
+    static constexpr int kNumClasses = 64;
+
+    PlacementPolicyType type() const override { return PlacementPolicyType::SEGREGATED_FIT; }
+
+    static int size_class(size_t size) {
+        return size == 0 ? 0 : 63 - __builtin_clzll((unsigned long long)size);
+    }
+
+    void insert(Block* block, size_t remaining) override {
+        erase(block);
+        if (remaining == 0) {
+            return;
+        }
+        int cls = size_class(remaining);
+        keys.insert({block, remaining});
+        classes[cls].insert(Key{remaining, block->block_id, block});
+        non_empty |= (1ULL << cls);
+    }
+
+    bool erase(Block* block) override {
+        auto it = keys.find(block);
+        if (it == keys.end()) {
+            return false;
+        }
+        int cls = size_class(it->second);
+        classes[cls].erase(Key{it->second, block->block_id, block});
+        if (classes[cls].empty()) {
+            non_empty &= ~(1ULL << cls);
+        }
+        keys.erase(it);
+        return true;
+    }
+
+    Block* find(size_t size, size_t max_size) const override {
+        if (size == 0) {
+            size = 1;
+        }
+        if (max_size < size) {
+            return nullptr;
+        }
+        int cls = size_class(size);
+        if (non_empty & (1ULL << cls)) {
+            auto it = classes[cls].lower_bound(Key{size, INT_MIN, nullptr});
+            if (it != classes[cls].end()) {
+                return std::get<0>(*it) <= max_size ? std::get<2>(*it) : nullptr;
+            }
+        }
+        if (cls == kNumClasses - 1) {
+            return nullptr;
+        }
+        uint64_t larger = non_empty & (~0ULL << (cls + 1));
+        if (larger == 0) {
+            return nullptr;
+        }
+        // the smallest block of the next class, the other ones are larger
+        int next = __builtin_ctzll(larger);
+        auto it = classes[next].begin();
+        return std::get<0>(*it) <= max_size ? std::get<2>(*it) : nullptr;
+    }
+
+    size_t size() const override { return keys.size(); }
+
+    void for_each(const std::function<void(Block*, size_t)>& fn) const override {
+        for (int cls = 0; cls < kNumClasses; cls++) {
+            for (auto& key : classes[cls]) {
+                fn(std::get<2>(key), std::get<0>(key));
+            }
+        }
+    }
+
+    uint64_t non_empty = 0;
+    std::set<Key> classes[kNumClasses];
+    std::unordered_map<Block*, size_t> keys;
+};
+
+template<class Block>
+std::unique_ptr<PlacementPolicy<Block>> PlacementPolicy<Block>::create(PlacementPolicyType type) {
+    switch (type) {
+        case PlacementPolicyType::FIRST_FIT:
+            return std::unique_ptr<PlacementPolicy<Block>>(new FirstFitPolicy<Block>());
+        case PlacementPolicyType::WORST_FIT:
+            return std::unique_ptr<PlacementPolicy<Block>>(new SizeOrderedPolicy<Block>(false));
+        case PlacementPolicyType::SEGREGATED_FIT:
+            return std::unique_ptr<PlacementPolicy<Block>>(new SegregatedFitPolicy<Block>());
+        case PlacementPolicyType::BEST_FIT:
+        default:
+            return std::unique_ptr<PlacementPolicy<Block>>(new SizeOrderedPolicy<Block>(true));
+    }
+}
+
+} // namespace nvgpu
@@ -0,0 +1,96 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cuda.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+
+#include "expandable_phyblock.h"
+
+namespace nvgpu {
+
+struct VmmAllocator;
+
+// Circular buffer without wrap around : one physical block of `capacity` bytes is mapped twice, back to back, in a
+// reservation of 2 * capacity bytes. The bytes at base + i and base + capacity + i are the same memory, so any
+// window of up to `capacity` bytes starting at base + (offset % capacity) is virtually contiguous, and kernels
+// reading or writing it never handle the wrap around (token output buffers, sliding window KV, staging buffers).
+//
+// Positions are byte offsets in the stream, they only grow. The producer writes the window at head() then commits
+// it, the consumer reads the window at tail() then consumes it. With one producer and one consumer thread the
+// cursors need no lock.
+struct RingBuffer {
+
+    // `capacity` is rounded up to the allocation granularity of `device`, throws OutOfMemoryError
+    RingBuffer(VmmAllocator* allocator, size_t capacity, int device);
+
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    size_t capacity() const { return capacity_; }
+
+    int device() const { return device_; }
+
+    // first of the two mappings
+    void* base() const { return reinterpret_cast<void *>(base_); }
+
+    uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+    uint64_t tail() const { return tail_.load(std::memory_order_acquire); }
+
+    // bytes committed and not consumed yet
+    size_t size() const { return head() - tail(); }
+
+    // bytes the producer can write
+    size_t space() const { return capacity_ - size(); }
+
+    // address of the stream bytes [offset, offset + size), throws std::invalid_argument if size > capacity
+    void* window(uint64_t offset, size_t size) const;
+
+    // window of `size` bytes at head, nullptr if less space is left
+    void* write_window(size_t size) const;
+
+    // publishes `size` bytes written at head, throws std::invalid_argument if more than space()
+    void commit(size_t size);
+
+    // window of `size` bytes at tail, nullptr if fewer bytes were committed
+    void* read_window(size_t size) const;
+
+    // releases `size` bytes read at tail, throws std::invalid_argument if more than size()
+    void consume(size_t size);
+
+    // drops the content, both cursors go back to 0
+    void reset();
+
+private:
+    VmmAllocator* allocator = nullptr;
+    int device_ = 0;
+    size_t capacity_ = 0;
+    CUdeviceptr base_ = 0;
+    std::shared_ptr<ExpandablePhyBlock> block;
+
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+};
+
+} // namespace nvgpu
@@ -0,0 +1,89 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+#include "checkpoint.h"
+
+namespace nvgpu {
+
+// Streaming loader of safetensors files (https://github.com/huggingface/safetensors) :
+//
+//   8 bytes little endian header size N
+//   N bytes of JSON : {"<name>": {"dtype": "F16", "shape": [4096, 4096], "data_offsets": [begin, end]}, ...,
+//                      "__metadata__": {"<key>": "<value>", ...}}
+//   the tensor bytes, offsets relative to the end of the header
+//
+// The file is memory mapped and read in order, chunk by chunk, into a few pinned staging buffers by a file thread
+// while the calling thread copies the filled buffers to the device : disk reads overlap the host to device copies,
+// and the host memory held is the staging buffers plus the pages being read (consumed pages are dropped from the
+// mapping). All the tensors of the file are placed in one allocation of the backend, the VMM allocator for
+// vTensor-backed tensors.
+
+struct SafetensorsTensor {
+    std::string name;
+    // safetensors dtype, e.g. F32, BF16, I64, F8_E4M3
+    std::string dtype;
+    std::vector<int64_t> shape;
+    // byte range in the data section of the file
+    size_t file_offset = 0;
+    size_t size = 0;
+    // inside the segment once loaded
+    void* ptr = nullptr;
+};
+
+struct SafetensorsHeader {
+    std::vector<SafetensorsTensor> tensors;
+    // "__metadata__" entries, in file order
+    std::vector<std::pair<std::string, std::string>> metadata;
+    // offset of the data section in the file
+    size_t data_offset = 0;
+};
+
+struct SafetensorsOptions {
+    // bytes per read, also the size of a staging buffer
+    size_t chunk_size = 8 << 20;
+    int num_buffers = 4;
+    // of every tensor in the segment
+    size_t alignment = 256;
+};
+
+struct LoadedSafetensors {
+    // allocated with the backend, owned by the caller
+    CheckpointSegment segment;
+    // in file order, pointers into the segment
+    std::vector<SafetensorsTensor> tensors;
+    std::vector<std::pair<std::string, std::string>> metadata;
+    size_t bytes_read = 0;
+};
+
+// size in bytes of one element of a safetensors dtype, 0 if unknown
+size_t safetensors_dtype_size(const std::string& dtype);
+
+// throws std::runtime_error on a malformed header
+SafetensorsHeader read_safetensors_header(const std::string& path);
+
+// loads every tensor of `path` to `device` (-1 : host memory of the backend). Throws std::runtime_error on a
+// malformed file, nothing stays allocated then.
+LoadedSafetensors load_safetensors(const std::string& path, CheckpointBackend* backend, int device,
+                                   const SafetensorsOptions& options = SafetensorsOptions());
+
+} // namespace nvgpu
@@ -0,0 +1,179 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "trace.h"
+
+namespace nvgpu {
+
+// Counters of the allocator published to a POSIX shared memory segment, so that a monitoring process reads them
+// without calling into the serving process (see tools/vtensor_stats.cpp).
+//
+// The layout is fixed and versioned : fields are only appended (in the reserved words first), a reader checks the
+// magic and the version, and uses `size` to skip what it does not know. Every counter is a 64 bits atomic updated
+// with relaxed operations, the segment has no lock : a reader sees each counter consistent, not a snapshot of all.
+//
+// The segment is process wide, every allocator of the process adds to it. Gauges are in bytes, counters only grow.
+
+static const char kShmStatsMagic[8] = {'V', 'T', 'S', 'T', 'A', 'T', 'S', '\0'};
+static const uint32_t kShmStatsVersion = 1;
+static const int kShmStatsMaxDevices = 16;
+static const int kShmStatsMaxDriverCalls = 16;
+
+// driver calls timed in the segment
+enum class DriverCall : int {
+    MEM_CREATE = 0,
+    MEM_RELEASE,
+    MEM_MAP,
+    MEM_UNMAP,
+    MEM_SET_ACCESS,
+    ADDRESS_RESERVE,
+    ADDRESS_FREE,
+    N
+};
+
+inline const char* driver_call_name(DriverCall call) {
+    switch (call) {
+        case DriverCall::MEM_CREATE: return "cuMemCreate";
+        case DriverCall::MEM_RELEASE: return "cuMemRelease";
+        case DriverCall::MEM_MAP: return "cuMemMap";
+        case DriverCall::MEM_UNMAP: return "cuMemUnmap";
+        case DriverCall::MEM_SET_ACCESS: return "cuMemSetAccess";
+        case DriverCall::ADDRESS_RESERVE: return "cuMemAddressReserve";
+        case DriverCall::ADDRESS_FREE: return "cuMemAddressFree";
+        default: return "unknown";
+    }
+}
+
+struct ShmDeviceStats {
+    // gauges, as AllocatorStats
+    std::atomic<uint64_t> reserved_bytes;
+    std::atomic<uint64_t> mapped_bytes;
+    std::atomic<uint64_t> physical_bytes;
+    // physical memory without mapping
+    std::atomic<uint64_t> free_block_bytes;
+    // freed ranges kept mapped by the graph pools and the step warm cache
+    std::atomic<uint64_t> cached_bytes;
+
+    // counters
+    std::atomic<uint64_t> num_allocs;
+    std::atomic<uint64_t> num_frees;
+    std::atomic<uint64_t> allocated_bytes;
+    std::atomic<uint64_t> freed_bytes;
+    std::atomic<uint64_t> num_ooms;
+
+    uint64_t reserved[6];
+};
+
+struct ShmDriverStats {
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> errors;
+    std::atomic<uint64_t> total_ns;
+    std::atomic<uint64_t> max_ns;
+};
+
+struct ShmStatsSegment {
+    char magic[8];
+    uint32_t version;
+    // sizeof(ShmStatsSegment) of the writer
+    uint32_t size;
+    uint32_t max_devices;
+    uint32_t num_driver_calls;
+    int64_t pid;
+    // CLOCK_REALTIME at creation
+    uint64_t start_time_ns;
+    uint64_t reserved[4];
+
+    ShmDeviceStats devices[kShmStatsMaxDevices];
+    ShmDriverStats driver[kShmStatsMaxDriverCalls];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the shared counters need lock free 64 bits atomics");
+static_assert(sizeof(ShmDeviceStats) == 128, "ShmDeviceStats is part of the shared layout");
+static_assert(sizeof(ShmDriverStats) == 32, "ShmDriverStats is part of the shared layout");
+
+// segment name used by VTENSOR_SHM_STATS=1 : /vtensor_stats.<pid>
+inline std::string default_shm_stats_name(int64_t pid) {
+    return "/vtensor_stats." + std::to_string(pid);
+}
+
+// creates the segment `name` (empty : the default name of this process) and publishes the counters to it from now
+// on, the segment is unlinked at exit. Returns false when shared memory is unavailable or another segment is
+// already published. Gauges start at zero : VmmAllocator::publish_stats seeds them with the current state.
+bool open_shm_stats(const std::string& name);
+
+namespace shm_detail {
+extern std::atomic<ShmStatsSegment*> segment;
+} // namespace shm_detail
+
+// nullptr until open_shm_stats succeeded, the only cost of the counters on the hot path when disabled
+inline ShmStatsSegment* shm_stats_segment() {
+    return shm_detail::segment.load(std::memory_order_acquire);
+}
+
+// `delta` may be negative for the gauges
+inline void shm_add(int device, std::atomic<uint64_t> ShmDeviceStats::*field, int64_t delta) {
+    ShmStatsSegment* segment = shm_stats_segment();
+    if (segment == nullptr || device < 0 || device >= kShmStatsMaxDevices || delta == 0) {
+        return;
+    }
+    (segment->devices[device].*field).fetch_add((uint64_t)delta, std::memory_order_relaxed);
+}
+
+inline void shm_record_driver_call(ShmStatsSegment* segment, DriverCall call, uint64_t ns, bool failed) {
+    ShmDriverStats& stats = segment->driver[(int)call];
+    stats.calls.fetch_add(1, std::memory_order_relaxed);
+    stats.total_ns.fetch_add(ns, std::memory_order_relaxed);
+    if (failed) {
+        stats.errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    uint64_t max_ns = stats.max_ns.load(std::memory_order_relaxed);
+    while (ns > max_ns && !stats.max_ns.compare_exchange_weak(max_ns, ns, std::memory_order_relaxed)) {
+    }
+}
+
+// runs `fn` (a driver call returning a CUresult) and records its latency when the segment is published, and the
+// call in the trace when tracing
+template<typename F>
+inline auto timed_driver_call(DriverCall call, uint64_t bytes, F&& fn) -> decltype(fn()) {
+    ShmStatsSegment* segment = shm_stats_segment();
+    bool tracing = trace_enabled();
+    if (segment == nullptr && !tracing) {
+        return fn();
+    }
+    uint64_t start_ns = trace_now_ns();
+    auto result = fn();
+    uint64_t end_ns = trace_now_ns();
+    if (segment != nullptr) {
+        shm_record_driver_call(segment, call, end_ns - start_ns, (int)result != 0);
+    }
+    if (tracing) {
+        trace_detail::record(driver_call_name(call), "driver", start_ns, end_ns, bytes);
+    }
+    return result;
+}
+
+} // namespace nvgpu
+
+// e.g. DRV_TRY(DRV_TIMED(MEM_MAP, size, cuMemMap(...)))
+#define DRV_TIMED(id, bytes, call) nvgpu::timed_driver_call(nvgpu::DriverCall::id, (bytes), [&]() { return (call); })
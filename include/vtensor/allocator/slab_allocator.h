@@ -0,0 +1,132 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cuda.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common.h"
+#include "expandable_phyblock.h"
+
+namespace nvgpu {
+
+struct VmmAllocator;
+
+// Every VMM mapping is rounded up to the allocation granularity (usually 2 MiB), so a bias vector or a scalar
+// would cost a full physical page and a reserve/create/map/set-access sequence.
+//
+// SlabAllocator serves requests of at most granularity / 2 bytes from power-of-two size classes. A chunk is one
+// granularity sized mapping shared by the slots of a single class, and a per chunk bitmap tracks the free slots.
+struct SlabAllocator {
+
+    static constexpr size_t kMinSlotSize = 512;
+
+    struct Chunk {
+        uintptr_t base = 0;
+        size_t chunk_size = 0;
+        size_t slot_size = 0;
+        int device_id = 0;
+        int size_class = 0;
+
+        size_t num_slots = 0;
+        size_t num_free = 0;
+        // bit set : slot is free
+        std::vector<uint64_t> free_bitmap;
+        // next word to scan
+        size_t hint = 0;
+
+        // index in SizeClass::partial, -1 when the chunk is full
+        long partial_index = -1;
+
+        std::shared_ptr<ExpandablePhyBlock> block;
+    };
+
+    struct SizeClass {
+        size_t slot_size = 0;
+        // chunks with at least one free slot
+        std::vector<Chunk*> partial;
+    };
+
+    struct Stats {
+        size_t chunks = 0;
+        size_t mapped_bytes = 0;
+        size_t allocated_bytes = 0;
+        size_t requested_bytes = 0;
+        size_t num_allocs = 0;
+    };
+
+    explicit SlabAllocator(VmmAllocator* allocator) : allocator(allocator) {}
+
+    // largest request served by the slab layer on `device`, 0 when the granularity cannot be queried
+    size_t max_size(int device);
+
+    // nullptr if `size` is too large for a size class
+    void* alloc(size_t size, int device);
+
+    // false if `ptr` does not belong to a slab chunk
+    bool dealloc(void* ptr);
+
+    // releases every chunk without live slots, returns the number of bytes unmapped
+    size_t release_empty_chunks();
+
+    bool owns(void* ptr);
+
+    // size of the slot at `ptr`, 0 if `ptr` does not belong to a slab chunk
+    size_t slot_size(void* ptr);
+
+    Stats stats();
+
+    VmmAllocator* allocator = nullptr;
+
+    std::mutex mtx;
+
+private:
+    size_t granularity(int device);
+
+    int size_class(size_t size) const;
+
+    Chunk* new_chunk(int device, int cls);
+
+    void release_chunk(Chunk* chunk);
+
+    void* take_slot(Chunk* chunk);
+
+    void add_partial(Chunk* chunk);
+
+    void remove_partial(Chunk* chunk);
+
+    std::map<int, size_t> granularities;
+
+    // per device size classes
+    std::map<int, std::vector<SizeClass>> classes;
+
+    // chunk base address -> chunk
+    std::map<uintptr_t, std::unique_ptr<Chunk>> chunks;
+
+    // slot address -> requested size, to report the internal fragmentation
+    std::map<uintptr_t, size_t> requested;
+
+    Stats counters;
+};
+
+} // namespace nvgpu
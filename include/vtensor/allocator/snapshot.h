@@ -0,0 +1,81 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+namespace nvgpu {
+
+// Point-in-time copy of the allocator state. It is taken under VmmAllocator::mtx and serialized afterwards,
+// so a snapshot can be requested from a live server.
+
+struct MappingSnapshot {
+    uintptr_t address = 0;
+    size_t size = 0;
+    int block_id = -1;
+    int device_id = 0;
+    // symbolized allocation stack, empty unless stack recording is enabled
+    std::vector<std::string> frames;
+};
+
+struct PhyBlockSnapshot {
+    int block_id = -1;
+    int device_id = 0;
+    size_t block_size = 0;
+    size_t remaining_size = 0;
+    // "owned", "shared", "exclusive" or "none"
+    std::string pool;
+    // whether the owned pool placement policy can still pick this block
+    bool open = false;
+    // lifetime of the allocations the owned pool places in the block, see Lifetime
+    std::string lifetime;
+    // where the memory of the block lives, see MemoryTier
+    std::string tier;
+    std::vector<MappingSnapshot> mappings;
+};
+
+struct ReservationSnapshot {
+    uintptr_t address = 0;
+    size_t size = 0;
+    int device_id = 0;
+};
+
+struct AllocatorSnapshot {
+    std::string placement_policy;
+
+    std::vector<PhyBlockSnapshot> blocks;
+
+    std::vector<ReservationSnapshot> reservations;
+
+    // content of VmmAllocator::allocated_blocks
+    std::vector<MappingSnapshot> mappings;
+
+    // JSON laid out as torch.cuda.memory._snapshot() : every VA reservation is a segment and every mapping inside
+    // it an active block, so that the dump can be loaded by https://pytorch.org/memory_viz. The physical view
+    // (blocks, pools, remaining sizes) is stored under the extra "vtensor" key, which the visualizer ignores.
+    std::string to_json() const;
+};
+
+// captures the caller stack, frames are symbolized lazily when a snapshot is taken
+std::vector<void*> capture_stack(int skip = 1);
+
+std::vector<std::string> symbolize_stack(const std::vector<void*>& stack);
+
+} // namespace nvgpu
@@ -0,0 +1,101 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cuda.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "expandable_phyblock.h"
+
+namespace nvgpu {
+
+struct VmmAllocator;
+
+// Block-sparse virtual range : the whole range is reserved, split in blocks of `block_size` bytes, and only the
+// populated blocks hold physical memory of their own. Every page of an empty block maps the zero page of the device,
+// one read-only page shared by all the sparse ranges, so that kernels read the range as one dense tensor (zeros
+// where nothing is populated) while the memory held scales with the number of populated blocks (block-sparse
+// weights, MoE expert tables).
+//
+// Writing to an empty block faults : materialize it first. A block must not be accessed while it is materialized
+// or released, the other blocks can.
+struct SparseRange {
+
+    // `block_size` is rounded up to the allocation granularity of `device`, `size` to whole blocks. All the blocks
+    // start empty. Throws OutOfMemoryError
+    SparseRange(VmmAllocator* allocator, size_t size, size_t block_size, int device);
+
+    ~SparseRange();
+
+    SparseRange(const SparseRange&) = delete;
+    SparseRange& operator=(const SparseRange&) = delete;
+
+    size_t size() const { return num_blocks_ * block_size_; }
+
+    size_t block_size() const { return block_size_; }
+
+    size_t num_blocks() const { return num_blocks_; }
+
+    int device() const { return device_; }
+
+    void* base() const { return reinterpret_cast<void *>(base_); }
+
+    bool populated(size_t index) const;
+
+    size_t num_populated() const;
+
+    // memory of the populated blocks, the shared zero page excluded
+    size_t physical_bytes() const { return num_populated() * block_size_; }
+
+    // backs block `index` with memory of its own, zero filled when `zero` (the content is undefined otherwise).
+    // Nothing happens if the block is populated. Throws std::out_of_range, OutOfMemoryError
+    void materialize(size_t index, bool zero = true);
+
+    // gives the memory of block `index` back, the block reads zeros again. Throws std::out_of_range
+    void release(size_t index);
+
+private:
+    CUdeviceptr block_address(size_t index) const { return base_ + index * block_size_; }
+
+    void check_index(size_t index) const;
+
+    bool map_zero_page(size_t index);
+
+    void unmap_zero_page(size_t index);
+
+    VmmAllocator* allocator = nullptr;
+    int device_ = 0;
+    size_t page = 0;
+    size_t block_size_ = 0;
+    size_t num_blocks_ = 0;
+    CUdeviceptr base_ = 0;
+
+    std::shared_ptr<ExpandablePhyBlock> zero_page;
+
+    // memory of the populated blocks, nullptr for the empty ones
+    std::vector<std::shared_ptr<ExpandablePhyBlock>> blocks;
+    size_t num_populated_ = 0;
+
+    mutable std::mutex mtx;
+};
+
+} // namespace nvgpu
@@ -0,0 +1,98 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cuda.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace nvgpu {
+
+// Virtual range reserved at the same address by every local rank. The ranks agree on the base through a shared
+// file : each one reserves `size` bytes and publishes the address, all of them then reserve at the highest address
+// with an address hint, and a round that some rank cannot honour restarts above it. The allocations carved from
+// the heap are placed first fit by offset, so ranks making the same sequence of allocations and frees get the same
+// addresses : a buffer of a peer is at the local address of the buffer, and peer pointers are plain offsets from
+// base() (custom all-reduce, MoE dispatch).
+//
+// The file must be private to the job (e.g. named after the master port) and must not exist yet, it is removed
+// once all the ranks agreed. The heap only reserves addresses, the allocator maps memory into it.
+struct SymmetricHeap {
+
+    // blocks until the `world_size` ranks agreed on a base, throws std::runtime_error when they cannot within
+    // `timeout_ms`, std::invalid_argument when the ranks disagree on the size
+    SymmetricHeap(const std::string& path, int rank, int world_size, size_t size, int device, int timeout_ms = 60000);
+
+    ~SymmetricHeap();
+
+    SymmetricHeap(const SymmetricHeap&) = delete;
+    SymmetricHeap& operator=(const SymmetricHeap&) = delete;
+
+    int rank() const { return rank_; }
+
+    int world_size() const { return world_size_; }
+
+    int device() const { return device_; }
+
+    size_t size() const { return size_; }
+
+    // the same on every rank
+    void* base() const { return reinterpret_cast<void *>(base_); }
+
+    // agreement rounds it took
+    int rounds() const { return rounds_; }
+
+    bool contains(const void* ptr) const {
+        CUdeviceptr addr = reinterpret_cast<CUdeviceptr>(ptr);
+        return addr >= base_ && addr < base_ + size_;
+    }
+
+    size_t offset_of(const void* ptr) const { return reinterpret_cast<CUdeviceptr>(ptr) - base_; }
+
+    // `size` rounded up to the granularity, first fit. nullptr when the heap is full
+    void* reserve(size_t size, size_t* reserved_size);
+
+    // gives a range returned by reserve back, returns its size (0 for other addresses)
+    size_t release(void* ptr);
+
+    // size of the range returned by reserve at `ptr`, 0 for other addresses
+    size_t range_size(const void* ptr) const;
+
+    size_t reserved_bytes() const;
+
+    static const int kMaxRanks = 64;
+
+private:
+    int rank_ = 0;
+    int world_size_ = 1;
+    int device_ = 0;
+    size_t size_ = 0;
+    size_t page = 0;
+    CUdeviceptr base_ = 0;
+    int rounds_ = 0;
+
+    mutable std::mutex mtx;
+    // offset -> size
+    std::map<size_t, size_t> free_ranges;
+    std::map<size_t, size_t> used_ranges;
+};
+
+} // namespace nvgpu
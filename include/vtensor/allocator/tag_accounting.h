@@ -0,0 +1,103 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace nvgpu {
+
+// Memory attribution of colocated models : every allocation is charged to the tag of the calling thread
+// ("weights", "kv", "activations", a tenant id, ...), and admission is checked against the quotas of the tag.
+
+static const char* const kDefaultMemoryTag = "default";
+
+struct TagStats {
+    // bytes requested by the live allocations
+    size_t live_bytes = 0;
+    // bytes mapped for the live allocations (rounded up to the granularity or slot size)
+    size_t reserved_bytes = 0;
+    size_t peak_live_bytes = 0;
+    size_t num_allocs = 0;
+
+    // 0 : unlimited. Going over the soft limit calls the eviction callback, going over the hard limit fails
+    // the allocation unless the callback brings the tag back under it.
+    size_t soft_limit = 0;
+    size_t hard_limit = 0;
+
+    size_t num_rejected = 0;
+    size_t num_evictions = 0;
+};
+
+// Asked to free at least `bytes_needed` bytes of `tag`, returns the number of bytes actually freed.
+using EvictionCallback = std::function<size_t(const std::string& tag, size_t bytes_needed)>;
+
+struct TagAccountant {
+
+    using Address = uintptr_t;
+
+    void set_quota(const std::string& tag, size_t hard_limit, size_t soft_limit);
+
+    void set_eviction_callback(EvictionCallback callback);
+
+    // false when `size` more bytes would exceed the hard limit of `tag`, even after eviction
+    bool admit(const std::string& tag, size_t size);
+
+    // calls the eviction callback on behalf of `tag`, returns the number of bytes freed
+    size_t evict(const std::string& tag, size_t bytes_needed);
+
+    void charge(const std::string& tag, Address addr, size_t live_size, size_t reserved_size);
+
+    // false if `addr` was not charged
+    bool release(Address addr);
+
+    TagStats stats(const std::string& tag);
+
+    std::map<std::string, TagStats> all_stats();
+
+    std::mutex mtx;
+
+    std::unordered_map<std::string, TagStats> tags;
+
+    struct Charge {
+        std::string tag;
+        size_t live_size;
+        size_t reserved_size;
+    };
+    std::unordered_map<Address, Charge> charges;
+
+    EvictionCallback eviction_callback;
+};
+
+// tag of the allocations made by the calling thread
+const std::string& current_memory_tag();
+
+void set_current_memory_tag(const std::string& tag);
+
+struct ScopedMemoryTag {
+    explicit ScopedMemoryTag(const std::string& tag) : previous(current_memory_tag()) { set_current_memory_tag(tag); }
+    ~ScopedMemoryTag() { set_current_memory_tag(previous); }
+
+    std::string previous;
+};
+
+} // namespace nvgpu
@@ -0,0 +1,139 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace nvgpu {
+
+// Opt-in timeline of the allocator : every allocator operation, pool search, driver call and contended wait on
+// VmmAllocator::mtx is recorded as a complete event (begin, duration, thread, bytes) into a buffer of the calling
+// thread, and exported as a Chrome / Perfetto JSON trace.
+//
+// Timestamps are exported in microseconds of the wall clock (CLOCK_REALTIME), with the process id and the kernel
+// thread ids, as the PyTorch profiler does : both traces line up once merged (see vTensor.merge_traces).
+//
+// Enabled with VTENSOR_TRACE=<path> (exported at exit) or start_trace / export_trace. Disabled, an instrumented
+// scope costs one relaxed atomic load.
+
+struct TraceEvent {
+    // string literals
+    const char* name;
+    const char* category;
+    // steady clock
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint64_t bytes;
+};
+
+namespace trace_detail {
+extern std::atomic<bool> enabled;
+
+void record(const char* name, const char* category, uint64_t start_ns, uint64_t end_ns, uint64_t bytes);
+} // namespace trace_detail
+
+inline bool trace_enabled() {
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+inline uint64_t trace_now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// starts recording, dropping the events of a previous trace. A thread keeps at most `max_events_per_thread` events,
+// the next ones are counted as dropped.
+void start_trace(size_t max_events_per_thread = 1 << 20);
+
+void stop_trace();
+
+// writes the events recorded so far to `path`, returns false if the file cannot be written
+bool export_trace(const std::string& path);
+
+struct TraceStats {
+    size_t threads = 0;
+    size_t events = 0;
+    size_t dropped = 0;
+};
+
+TraceStats trace_stats();
+
+// records the enclosing scope, e.g. TraceScope scope("VmmAllocator::alloc", "allocator", size);
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* category, uint64_t bytes = 0)
+        : name(name), category(category), bytes(bytes), start_ns(trace_enabled() ? trace_now_ns() : 0) {}
+
+    ~TraceScope() {
+        if (start_ns != 0) {
+            trace_detail::record(name, category, start_ns, trace_now_ns(), bytes);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    uint64_t bytes;
+    uint64_t start_ns;
+};
+
+// std::mutex recording the waits of the threads that find it locked, the uncontended path is a try_lock
+class TracedMutex {
+public:
+    explicit TracedMutex(const char* wait_name) : wait_name(wait_name) {}
+
+    void lock() {
+        if (!trace_enabled()) {
+            m.lock();
+            return;
+        }
+        if (m.try_lock()) {
+            return;
+        }
+        uint64_t start_ns = trace_now_ns();
+        m.lock();
+        trace_detail::record(wait_name, "lock", start_ns, trace_now_ns(), 0);
+    }
+
+    bool try_lock() {
+        return m.try_lock();
+    }
+
+    void unlock() {
+        m.unlock();
+    }
+
+private:
+    std::mutex m;
+    const char* wait_name;
+};
+
+} // namespace nvgpu
+
+#define VT_TRACE_CONCAT_(a, b) a##b
+#define VT_TRACE_CONCAT(a, b) VT_TRACE_CONCAT_(a, b)
+
+// e.g. VT_TRACE_SCOPE("VmmAllocator::alloc", size);
+#define VT_TRACE_SCOPE(name, bytes) nvgpu::TraceScope VT_TRACE_CONCAT(vt_trace_scope_, __LINE__)(name, "allocator", bytes)
@@ -15,17 +15,139 @@ limitations under the License.
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <stdexcept>
+#include <string>
 
 #include <vector>
 
 #include "allocator.h"
 #include "expandable_phyblock.h"
+#include "slab_allocator.h"
+#include "snapshot.h"
+#include "symmetric_heap.h"
+#include "tag_accounting.h"
+#include "trace.h"
 
 namespace nvgpu {
 
+struct AllocatorStats {
+    // VA ranges handed out by reserve_virtual_addr
+    size_t reserved_bytes = 0;
+    size_t num_reservations = 0;
+    // bytes mapped to physical memory, slab chunks included
+    size_t mapped_bytes = 0;
+    size_t num_mappings = 0;
+    // physical memory of the owned pool and its unused capacity
+    size_t physical_bytes = 0;
+    size_t free_block_bytes = 0;
+    size_t num_blocks = 0;
+    // the unused part of the mapped blocks : a block is mapped by one request, its tail serves nothing else
+    size_t stranded_bytes = 0;
+    // freed ranges kept mapped by the private (CUDA graph) pools and the step warm cache
+    size_t cached_bytes = 0;
+    size_t slab_mapped_bytes = 0;
+    size_t slab_allocated_bytes = 0;
+};
+
+// Raised once the out of memory pipeline (empty_cache, pressure callbacks, retry) could not serve a request.
+// The python binding translates it to torch.OutOfMemoryError with the allocator state attached.
+struct OutOfMemoryError : public std::runtime_error {
+    OutOfMemoryError(const std::string& what, int device, size_t requested_size, size_t free_bytes, size_t total_bytes,
+                     const AllocatorStats& state)
+        : std::runtime_error(what), device(device), requested_size(requested_size), free_bytes(free_bytes),
+          total_bytes(total_bytes), state(state) {}
+
+    int device;
+    size_t requested_size;
+    size_t free_bytes;
+    size_t total_bytes;
+    AllocatorStats state;
+};
+
+struct StepStats {
+    // completed steps since the step profiler was enabled
+    size_t steps = 0;
+    // the profile is learned once `warmup_steps` steps completed
+    bool learned = false;
+    // peak of the live step allocations : the largest peak of the warmup steps, and the peak of the last step
+    size_t predicted_peak_bytes = 0;
+    size_t actual_peak_bytes = 0;
+    // ranges kept mapped for the next steps
+    size_t warm_bytes = 0;
+    // allocations served by the warm cache, and the ones which had to map memory
+    size_t hits = 0;
+    size_t misses = 0;
+    // ranges mapped by begin_step ahead of the allocations
+    size_t prewarmed = 0;
+};
+
+struct DedupStats {
+    // distinct pages kept, and page mappings pointing to them
+    size_t unique_pages = 0;
+    size_t mapped_pages = 0;
+    size_t page_size = 0;
+    // (mapped_pages - unique_pages) pages of physical memory
+    size_t bytes_saved = 0;
+    size_t deduped_ranges = 0;
+    // pages whose key matched a page of different content, kept apart
+    size_t collisions = 0;
+};
+
+struct ScatterStats {
+    // live reservations mapped with pieces of several blocks, and their mappings
+    size_t ranges = 0;
+    size_t pieces = 0;
+    // bytes served by idle blocks smaller than the request instead of new blocks, since the start
+    size_t reused_bytes = 0;
+};
+
+struct MigrationStats {
+    // ranges being migrated, and ranges moved since the start
+    size_t active = 0;
+    size_t completed = 0;
+    // pages copied and remapped since the start
+    size_t pages = 0;
+    size_t bytes = 0;
+};
+
+struct LifetimeStats {
+    // blocks of the owned pool serving the lifetime, their memory and its unused part
+    size_t blocks = 0;
+    size_t physical_bytes = 0;
+    size_t free_block_bytes = 0;
+    // the unused part of the mapped blocks, see AllocatorStats
+    size_t stranded_bytes = 0;
+    // blocks without mappings, released by empty_cache
+    size_t idle_blocks = 0;
+    size_t num_allocs = 0;
+};
+
+struct TierStats {
+    // blocks of the owned pool in the tier, their memory and its unused part
+    size_t blocks = 0;
+    size_t physical_bytes = 0;
+    size_t free_block_bytes = 0;
+    // allocations mapped in the tier since the start, and the device allocations which spilled to it
+    size_t num_allocs = 0;
+    size_t spilled_allocs = 0;
+    // ranges moved into the tier by move_to_tier or migrate since the start, and their bytes
+    size_t moved_in = 0;
+    size_t moved_in_bytes = 0;
+};
+
+// Asked to free memory of `device` (e.g. preempt requests), returns the number of bytes freed.
+using PressureCallback = std::function<size_t(int device, size_t bytes_needed)>;
+
+// Compares `num_pages` pages of `page_size` bytes at `a` and `b`, `equal` receives one flag per page.
+using PageCompare = std::function<CUresult(CUdeviceptr a, CUdeviceptr b, size_t num_pages, size_t page_size, std::vector<char>* equal)>;
+
 struct VmmAllocator : public DeviceAllocatorBase {
 
     using PhyBlock = ExpandablePhyBlock;
@@ -35,18 +157,255 @@ struct VmmAllocator : public DeviceAllocatorBase {
 
     BlockPool<PhyBlock> exclusive_pool;
 
+    // guarded by `mtx`, the driver calls on a block taken out of it run outside of the lock
     OwnedBlockPool<ExpandablePhyBlock> owned_pool;
 
+    // requests smaller than half of the granularity share mapped chunks
+    SlabAllocator slab;
+
+    bool slab_enabled = true;
+
+    // requests no single idle block can serve are mapped across up to `max_scatter_pieces` idle blocks
+    // when they cover it, instead of creating a new block
+    bool scatter_enabled = true;
+    size_t max_scatter_pieces = 16;
+
+    // size of the arenas transient allocations are bump allocated from, larger requests get a block of their own.
+    // The blocks of the other lifetimes are sized to the request.
+    size_t transient_block_size = 64ULL << 20;
+
+    // allocations per lifetime since the start
+    size_t lifetime_allocs[(int)Lifetime::N] = {};
+
+    // Memory tiers. The allocations of a tag in `tag_tiers` are placed in its tier, the others on the device. With
+    // `host_spill`, a device allocation the out of memory pipeline could not serve is placed in the host tier
+    // instead of failing. Host blocks are created on `host_numa_node` (the node of the GPU), any node when < 0.
+    std::map<std::string, MemoryTier> tag_tiers;
+    bool host_spill = false;
+    int host_numa_node = -1;
+
+    // indexed by MemoryTier, see TierStats
+    size_t tier_allocs[(int)MemoryTier::N] = {};
+    size_t tier_spills = 0;
+    size_t tier_moves[(int)MemoryTier::N] = {};
+    size_t tier_moved_bytes[(int)MemoryTier::N] = {};
+
     // TODO (yiakwy) : add mutex shards to enable fine control of concurrent accesses
-    std::mutex mtx;
+    // contended waits show in the allocator trace
+    TracedMutex mtx{"VmmAllocator::mtx wait"};
 
     // TODO (yiakwy) : add binary tree to retrieve blocks, use flat_map later
     using Address = uintptr_t;
     std::map<Address, PhyBlock*> allocated_blocks;
 
-    HOST VmmAllocator() : DeviceAllocatorBase() {
+    // VA ranges handed out by reserve_virtual_addr : address -> <reserved size, device>
+    std::map<Address, std::pair<size_t, int>> reserved_addresses;
+
+    // reservations mapped by map_scattered : base address -> addresses of the pieces, in order
+    std::map<Address, std::vector<Address>> scattered_ranges;
+    size_t scatter_reused_bytes = 0;
+
+    // per tag accounting and quotas, allocations are charged to current_memory_tag()
+    TagAccountant tags;
+
+    // when > 0, an allocation leaving less than `device_headroom` free bytes on the device calls the eviction
+    // callback first, and fails if the device is still short
+    size_t device_headroom = 0;
+
+    // out of memory handling, see alloc_mapped
+    std::map<int, PressureCallback> pressure_callbacks;
+    int next_callback_id = 0;
+    std::string last_oom;
+
+    // CUDA graph private pools. While a thread allocates to a pool, allocations on a capturing stream are served by
+    // the pool. Freed ranges stay mapped and are only reused by the same pool, so captured graphs keep valid and
+    // stable addresses across replays. Graphs captured with the same id share the pool.
+    using PoolId = uint64_t;
+
+    struct PrivatePool {
+        // graphs captured into the pool
+        int use_count = 0;
+        // device of the ranges
+        int device = 0;
+        // address -> reserved size
+        std::map<Address, size_t> live;
+        // reserved size -> address of freed ranges, still mapped
+        std::multimap<size_t, Address> cached;
+    };
+
+    std::mutex pool_mtx;
+    std::map<PoolId, PrivatePool> private_pools;
+    // address -> pool of every live private allocation
+    std::map<Address, PoolId> private_allocations;
+    std::atomic<PoolId> next_pool_id{1};
+
+    // Iteration aware pre-warming. Between begin_step and end_step, the mapped allocations are profiled by
+    // (device, reserved size). After `warmup_steps` steps the profile, i.e. the largest number of ranges of each
+    // size live at once, is learned : begin_step maps the missing ranges ahead of the step, allocations take them
+    // from the warm cache and frees put them back, so steady state steps make no driver calls. end_step unmaps the
+    // ranges the profile does not need in bulk.
+    using WarmKey = std::pair<int, size_t>;
+
+    struct StepProfiler {
+        bool enabled = false;
+        bool in_step = false;
+        int warmup_steps = 3;
+
+        // (device, reserved size) -> count of live ranges, largest count of the current step, learned count
+        std::map<WarmKey, size_t> live;
+        std::map<WarmKey, size_t> step_max;
+        std::map<WarmKey, size_t> learned;
+
+        // mapped ranges not in use
+        std::multimap<WarmKey, Address> warm;
+        // address -> key of the live ranges handed out by the profiler
+        std::map<Address, WarmKey> allocations;
+
+        size_t live_bytes = 0;
+        size_t step_peak_bytes = 0;
+
+        StepStats stats;
+    };
+
+    std::mutex step_mtx;
+    StepProfiler step_profiler;
+
+    // Transient arenas. An arena is a block of `transient_block_size` bytes mapped once at its own reservation,
+    // transient allocations are bump allocated sub-ranges of it : each one has bytes of its own, and no driver call
+    // is made. The arena is rewound once its last allocation is freed, and unmapped by empty_cache.
+    struct TransientArena {
+        int device = 0;
+        size_t size = 0;
+        // next free byte
+        size_t offset = 0;
+        // allocations not freed yet
+        size_t live = 0;
+        PhyBlock* block = nullptr;
+    };
+
+    std::mutex transient_mtx;
+    // arena base address -> arena
+    std::map<Address, TransientArena> transient_arenas;
+    // address -> bump allocated size of every live transient allocation
+    std::map<Address, size_t> transient_allocations;
+
+    // device -> allocation granularity
+    std::map<int, size_t> granularities;
+
+    // views made by gather : view address -> the blocks mapped into it, kept alive until release_view
+    struct AliasView {
+        size_t size = 0;
+        int device = 0;
+        std::vector<std::pair<Address, std::shared_ptr<PhyBlock>>> pieces;
+    };
+    std::map<Address, AliasView> views;
+
+    // Deduplicated read-only ranges. Each page of such a range is mapped, read only, to a granularity sized block
+    // shared by all the identical pages : the content hash picks the candidate page of the store, the bytes of both
+    // pages decide. The ranges hold the blocks, the store only refers to them, so a block is released with its last
+    // page mapping.
+    using PageKey = std::pair<uint64_t, uint64_t>;
+
+    struct DedupRange {
+        size_t size = 0;
+        int device = 0;
+        std::vector<std::shared_ptr<PhyBlock>> pages;
+    };
+
+    std::mutex dedup_mtx;
+    std::map<std::pair<int, PageKey>, std::weak_ptr<PhyBlock>> unique_pages;
+    std::map<Address, DedupRange> deduped;
+    size_t dedup_collisions = 0;
+
+    // Live migrations between devices. A mapping is only ever made from the first byte of a block, so the range
+    // moves by pieces, each one a whole mapping of a block of its own : a range mapped by a single block is first
+    // split into up to `max_scatter_pieces` chunks (a scattered range keeps its pieces). Every step copies the next
+    // pieces to new blocks of the target, through a staging range, and maps them in place of the sources.
+    struct Migration {
+        size_t size = 0;
+        size_t page = 0;
+        int source_device = 0;
+        int target_device = 0;
+        MemoryTier source_tier = MemoryTier::DEVICE_MEMORY;
+        MemoryTier target_tier = MemoryTier::DEVICE_MEMORY;
+        // addresses of the pieces, back to back
+        std::vector<Address> pieces;
+        CUdeviceptr staging = 0;
+        size_t staging_size = 0;
+        // the source device keeps access to the range
+        bool peer_access = false;
+        // pieces [0, moved) are mapped to blocks of the target
+        size_t moved = 0;
+        // a piece is being copied, without migrate_mtx : the migration belongs to the thread copying it
+        bool in_flight = false;
+        // asked by cancel_migration / revert_migration, the copying thread stops after its piece
+        bool cancelled = false;
+    };
+
+    std::mutex migrate_mtx;
+    // notified when a piece lands
+    std::condition_variable migrate_cv;
+    std::map<Address, Migration> migrations;
+    // size of `migrations`, every dealloc reads it before taking migrate_mtx
+    std::atomic<size_t> num_migrations{0};
+    MigrationStats migration_counters;
+
+    // zero filled pages, one per device, aliased read-only by the empty blocks of the sparse ranges. The ranges hold
+    // the page, it is released with the last range of its device.
+    std::mutex zero_mtx;
+    std::map<int, std::weak_ptr<PhyBlock>> zero_pages;
+
+    // Symmetric allocations : ranges of the heap the local ranks reserved at the same base, backed by the owned pool
+    // of this process. VmmTensor buffers of the heap device are placed in it while it exists.
+    std::mutex symmetric_mtx;
+    std::shared_ptr<SymmetricHeap> symmetric_heap;
+
+    // allocation stacks of the mappings, only recorded after set_record_stacks(true)
+    bool record_stacks = false;
+    std::map<Address, std::vector<void*>> alloc_stacks;
+
+    HOST VmmAllocator() : DeviceAllocatorBase(), slab(this) {
         shared_pool.allocator = this;
         exclusive_pool.allocator = this;
+
+        // e.g. VTENSOR_PLACEMENT_POLICY=segregated_fit, so that the torch pluggable allocator can be tuned without code changes
+        const char* policy_name = std::getenv("VTENSOR_PLACEMENT_POLICY");
+        if (policy_name != nullptr) {
+            set_placement_policy(policy_name);
+        }
+
+        const char* slab = std::getenv("VTENSOR_SLAB");
+        if (slab != nullptr && std::string(slab) == "0") {
+            slab_enabled = false;
+        }
+
+        const char* scatter = std::getenv("VTENSOR_SCATTER");
+        if (scatter != nullptr && std::string(scatter) == "0") {
+            scatter_enabled = false;
+        }
+
+        // VTENSOR_HOST_SPILL=1 spills to any host node, VTENSOR_HOST_SPILL=numa:<node> to that node
+        const char* host_spill_env = std::getenv("VTENSOR_HOST_SPILL");
+        if (host_spill_env != nullptr) {
+            std::string value = host_spill_env;
+            if (value.rfind("numa:", 0) == 0) {
+                host_spill = true;
+                host_numa_node = std::atoi(value.c_str() + 5);
+            } else {
+                host_spill = value != "0" && value != "";
+            }
+        }
+
+        // VTENSOR_TRACE=<path> records the allocator timeline from now on, exported to <path> at exit
+        if (std::getenv("VTENSOR_TRACE") != nullptr && !trace_enabled()) {
+            start_trace();
+        }
+
+        // VTENSOR_SHM_STATS=1 publishes to /vtensor_stats.<pid>, any other value is the segment name
+        const char* shm_stats = std::getenv("VTENSOR_SHM_STATS");
+        if (shm_stats != nullptr && std::string(shm_stats) != "0" && std::string(shm_stats) != "") {
+            publish_stats(std::string(shm_stats) == "1" ? "" : shm_stats);
+        }
     }
 
     HOST virtual ~VmmAllocator() {}
@@ -60,21 +419,256 @@ struct VmmAllocator : public DeviceAllocatorBase {
 
     virtual HOST_INLINE void* alloc(size_t size, int device, CUstream stream) override ;
 
+    // alloc placed in the blocks of `lifetime`, the overload above uses current_lifetime()
+    HOST_INLINE void* alloc(size_t size, int device, CUstream stream, Lifetime lifetime);
+
     virtual HOST_INLINE void dealloc(void* ptr, size_t size, int device, CUstream stream) override ;
 
+    // reserve, back and map a single range for a group of buffers, `offsets` receives the offset of each buffer
+    // aligned to `alignment` (a power of two). The range is released with dealloc(ptr).
+    HOST_INLINE void* alloc_group(const std::vector<size_t>& sizes, size_t alignment, int device, CUstream stream, std::vector<size_t>* offsets);
+
     // VMM reserve virtual addresses API
 
     HOST_INLINE CUresult reserve_virtual_addr(void** ptr/*dest*/, size_t request_size, size_t* reserved_size, int device, CUstream stream);
 
     // VMM mapping/unmapping virtual addresses block-level API
 
-    HOST_INLINE void map_virtual_address(PhyBlock* block, void* v_offset_addr, size_t size);
+    HOST_INLINE bool map_virtual_address(PhyBlock* block, void* v_offset_addr, size_t size);
 
     // HOST_INLINE void unmap_virtual_address(int device, size_t size, CUdeviceptr dptr);
 
     HOST_INLINE void unmap_virtual_address(PhyBlock* block, void *v_offset_addr, size_t size);
+    // placement policy of the owned pool : best_fit (default), first_fit, worst_fit, segregated_fit. The policy picks
+    // the idle block a request maps, among the ones at most twice its size (see OwnedBlockPool::kMaxReuseRatio)
+
+    HOST_INLINE bool set_placement_policy(const std::string& name);
+
+    HOST_INLINE std::string placement_policy();
+
+    // CUDA graph private pool API
+
+    HOST_INLINE PoolId graph_pool_handle();
+
+    HOST_INLINE void begin_allocate_to_pool(PoolId pool_id);
+
+    HOST_INLINE void end_allocate_to_pool(PoolId pool_id);
+
+    // called once per graph captured into the pool, unmaps the pool when the last graph is gone
+    HOST_INLINE void release_pool(PoolId pool_id);
+
+    HOST_INLINE size_t pool_cached_size(PoolId pool_id);
+
+    // zero-copy views API
+
+    // Maps the physical memory behind `ranges` (address, size) back to back into a new virtual range, without
+    // copying. Every range starts at the base of a mapping of the owned pool, the driver only maps a block from its
+    // first byte, and may span several consecutive mappings. All the ranges but the last one are multiples of the
+    // granularity. Throws std::invalid_argument for ranges which cannot be aliased.
+    HOST_INLINE void* gather(const std::vector<std::pair<void*, size_t>>& ranges, int device, size_t* view_size);
+
+    HOST_INLINE void release_view(void* ptr);
+
+    // page deduplication API
+
+    // Remaps the pages of read-only ranges with identical content to a single physical copy. `ranges` are whole
+    // mappings of the owned pool (address, size), `keys` holds the content hash of every page of every range in
+    // order. A page is only remapped to a page of the same key once `compare` found their bytes equal, pages are
+    // copied to the host and compared there without it. Writing to a deduplicated range faults. Returns the number
+    // of bytes saved by this pass.
+    HOST_INLINE size_t dedup(const std::vector<std::pair<void*, size_t>>& ranges, const std::vector<PageKey>& keys, int device,
+                             const PageCompare& compare = nullptr);
+
+    HOST_INLINE DedupStats dedup_stats();
+
+    // live migration API
+
+    // Starts moving the physical memory behind the allocation at `ptr` (a whole reservation mapped by the owned pool)
+    // to `device`, keeping its virtual address : the tensors over the range keep working, the old device reaches the
+    // new memory through peer access. The range must not be accessed while begin or a step runs, it can between the
+    // steps. A failure leaves the range mapped where it was.
+    HOST_INLINE void migrate_begin(void* ptr, int device);
+
+    // copies and remaps the next pieces of the range, up to `budget_bytes` (at least one piece). Returns the number
+    // of bytes left to move, 0 once the range lives on the target device. A failed step leaves its pieces in place.
+    HOST_INLINE size_t migrate_step(void* ptr, size_t budget_bytes);
+
+    // the whole migration at once, returns the number of bytes moved. On failure the pieces moved already go back and
+    // the error is rethrown, the range is left where it was
+    HOST_INLINE size_t migrate(void* ptr, int device);
+
+    HOST_INLINE MigrationStats migration_stats();
+
+    // migrate_begin / migrate to the memory of `tier` on `device`, e.g. the host tier of the same device
+    HOST_INLINE void migrate_begin(void* ptr, int device, MemoryTier tier);
+
+    HOST_INLINE size_t migrate(void* ptr, int device, MemoryTier tier);
+
+    // memory tiers API
+
+    // places the allocations of `tag` in `tier` from now on, the live ones stay where they are
+    HOST_INLINE void set_tag_tier(const std::string& tag, MemoryTier tier);
+
+    HOST_INLINE MemoryTier tag_tier(const std::string& tag);
+
+    // tier of the memory mapped at `ptr`. Throws std::invalid_argument if the allocator maps nothing there
+    HOST_INLINE MemoryTier tier_of(void* ptr);
+
+    // Moves the memory of the allocation at `ptr` to `tier` of the same device, keeping its virtual address : a
+    // cold range (KV cache of idle sequences, optimizer state) goes to host memory and comes back when it gets hot.
+    // Same constraints as migrate, the range moves by pieces and keeps them. The device memory is released with the
+    // last mapping of its block, so a pressure callback can demote ranges. Returns the number of bytes moved, 0 if
+    // the range is in `tier` already. Throws OutOfMemoryError if `tier` cannot hold it, the range stays in place.
+    HOST_INLINE size_t move_to_tier(void* ptr, MemoryTier tier);
+
+    // indexed by MemoryTier
+    HOST_INLINE std::vector<TierStats> tier_stats();
+
+    // sparse ranges API
+
+    // the zero page of `device`, see SparseRange. Throws OutOfMemoryError
+    HOST_INLINE std::shared_ptr<PhyBlock> zero_page(int device);
+
+    // symmetric allocations API
+
+    // joins the `world_size` local ranks agreeing on a heap of `size` bytes through the file `path`, see
+    // SymmetricHeap. Blocks until all the ranks joined, throws std::runtime_error on failure
+    HOST_INLINE void symmetric_init(const std::string& path, int rank, int world_size, size_t size, int device, int timeout_ms = 60000);
+
+    // releases the heap, its allocations must be freed
+    HOST_INLINE void symmetric_finalize();
+
+    // a range of the heap, at the same address on the ranks making the same calls in the same order. CUDA_ERROR_NOT_INITIALIZED
+    // without a heap on `device`, CUDA_ERROR_OUT_OF_MEMORY when it is full
+    HOST_INLINE CUresult reserve_symmetric(void** ptr, size_t request_size, size_t* reserved_size, int device);
+
+    // reserve_symmetric backed by the owned pool, released with dealloc. Throws OutOfMemoryError
+    HOST_INLINE void* alloc_symmetric(size_t size, int device);
+
+    // iteration aware pre-warming API
+
+    // enabling (re)starts the learning, disabling unmaps the warm cache
+    HOST_INLINE void set_step_prewarm(bool enabled, int warmup_steps);
+
+    HOST_INLINE void begin_step();
+
+    HOST_INLINE void end_step();
+
+    HOST_INLINE StepStats step_stats();
+
+    // out of memory API
+
+    // releases the physical blocks without mappings and the empty slab chunks, returns the number of bytes released
+    HOST_INLINE size_t empty_cache();
+
+    HOST_INLINE int add_pressure_callback(PressureCallback callback);
+
+    HOST_INLINE void remove_pressure_callback(int id);
+
+    // message of the last OutOfMemoryError, empty if none was raised
+    HOST_INLINE std::string last_oom_report();
+
+    HOST_INLINE ScatterStats scatter_stats();
+
+    // indexed by Lifetime
+    HOST_INLINE std::vector<LifetimeStats> lifetime_stats();
+
+    // counters of the allocator, see AllocatorStats
+
+    HOST_INLINE AllocatorStats stats();
+
+    // publishes the counters to the shared memory segment `name` (empty : /vtensor_stats.<pid>) for
+    // tools/vtensor_stats, the gauges are seeded with the current state of this allocator
+    HOST_INLINE bool publish_stats(const std::string& name);
+
+    // memory snapshot API
+
+    HOST_INLINE void set_record_stacks(bool enabled);
+
+    HOST_INLINE AllocatorSnapshot snapshot();
+
     // helpers
 
+    // quota and device headroom admission of `size` more bytes for the current tag
+    HOST_INLINE bool admit(size_t size, int device);
+
+    // alloc without the slab layer
+    HOST_INLINE void* alloc_mapped(size_t size, int device, CUstream stream, Lifetime lifetime = Lifetime::DEFAULT, MemoryTier tier = MemoryTier::DEVICE_MEMORY);
+
+    // backs a range returned by reserve_virtual_addr with memory of the owned pool, from the blocks of `lifetime`
+    // in `tier`
+    HOST_INLINE CUresult map_reserved(void* ptr, size_t reserved_size, int device, Lifetime lifetime = Lifetime::DEFAULT, MemoryTier tier = MemoryTier::DEVICE_MEMORY);
+
+    // frees a range returned by reserve_virtual_addr which was not mapped
+    HOST_INLINE void release_reservation(void* ptr);
+
+    // maps a reservation across several idle blocks of the owned pool. false when the open blocks
+    // cannot cover it, `result` receives the outcome of the mapping otherwise
+    HOST_INLINE bool map_scattered(void* ptr, size_t reserved_size, int device, CUresult* result, Lifetime lifetime = Lifetime::DEFAULT);
+
+    // unmaps the pieces of a range mapped by map_scattered and frees the reservation, false for other ranges
+    HOST_INLINE bool unmap_scattered(void* ptr);
+
+    HOST_INLINE size_t run_pressure_callbacks(int device, size_t size);
+
+    [[noreturn]] HOST_INLINE void throw_out_of_memory(size_t size, int device, CUresult result);
+
+    // pool the current thread allocates to when `stream` is capturing
+    HOST_INLINE bool capturing_pool(CUstream stream, PoolId* pool_id);
+
+    HOST_INLINE void* alloc_private(PoolId pool_id, size_t size, int device, CUstream stream);
+
+    HOST_INLINE bool dealloc_private(void* ptr, int device, CUstream stream);
+
+    HOST_INLINE bool dealloc_dedup(void* ptr);
+
+    // unmaps the pieces of a symmetric range and gives it back to the heap
+    HOST_INLINE bool dealloc_symmetric(void* ptr);
+
+    // drops the migration of a freed range, its pieces are unmapped like the ones of any scattered range
+    HOST_INLINE void cancel_migration(void* ptr);
+
+    // moves the pieces a failed migrate moved back to the source and drops the migration, false if one of them
+    // cannot go back : the migration is kept, with the pieces left on the target
+    HOST_INLINE bool revert_migration(void* ptr);
+
+    // copies and remaps one piece of a migration, see migrate_step
+    HOST_INLINE void migrate_piece(Migration& m, Address piece);
+
+    // the migration of `addr` once no piece of it is in flight, the copying thread is asked to stop
+    HOST_INLINE std::map<Address, Migration>::iterator claim_migration(std::unique_lock<std::mutex>& lock, Address addr);
+
+    // maps the range at `ptr`, a whole mapping of `block`, with the `chunks` (back to back) holding a copy of its
+    // content, returns their addresses. `peer_access` gives the device of `block` access to chunks of another device.
+    HOST_INLINE std::vector<Address> split_mapping(void* ptr, PhyBlock* block, size_t size, const std::vector<std::shared_ptr<PhyBlock>>& chunks,
+                                                   bool peer_access);
+
+    HOST_INLINE bool migrating(void* ptr);
+
+    // bytes charged to the tag of the allocation at `ptr` of `size` bytes : its slab slot, its arena sub-range or
+    // its whole reservation
+    HOST_INLINE size_t charged_size(void* ptr, size_t size);
+
+    // nullptr if `size` does not fit in an arena or no arena can be mapped
+    HOST_INLINE void* alloc_transient(size_t size, int device);
+
+    HOST_INLINE bool dealloc_transient(void* ptr);
+
+    // bump allocated size of the transient allocation at `ptr`, 0 if `ptr` is not one
+    HOST_INLINE size_t transient_size(void* ptr);
+
+    // unmaps the arenas without live allocations, their blocks are idle afterwards
+    HOST_INLINE void release_transient_arenas();
+
+    HOST_INLINE void* alloc_warm(size_t size, int device, CUstream stream);
+
+    HOST_INLINE bool dealloc_warm(void* ptr);
+
+    // unmaps the warm ranges above the learned profile, or all of them, returns the number of bytes unmapped
+    HOST_INLINE size_t release_warm(bool all);
+
+    HOST_INLINE size_t granularity(int device);
+
     HOST_INLINE PhyBlock* get_allocated_block(void* ptr, bool remove = false);
 };
 
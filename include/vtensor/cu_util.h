@@ -29,3 +29,15 @@ limitations under the License.
              __FUNCTION__, __LINE__, (int)result, errMsg);                     \
     }                                                                          \
   } while(0)
+
+// Same report as DRV_CALL without the assertion, for the calls the allocator can recover from (e.g. out of memory)
+static inline CUresult drv_try(CUresult result, const char* call, const char* func, int line) {
+  if (CUDA_SUCCESS != result) {
+    const char *errMsg = nullptr;
+    cuGetErrorString(result, &errMsg);
+    LOGE("Error when exec <%s> %s:%d code:%d err:%s", call, func, line, (int)result, errMsg ? errMsg : "unknown");
+  }
+  return result;
+}
+
+#define DRV_TRY(call) drv_try((call), #call, __FUNCTION__, __LINE__)
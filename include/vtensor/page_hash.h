@@ -0,0 +1,30 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <cuda_runtime_api.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// Content hash of `num_pages` consecutive pages of `page_size` bytes (a multiple of 16) starting at `data`.
+// `out` is a device buffer receiving two independent 64-bit hashes per page, the 128-bit pair keys the page
+// deduplication of VmmAllocator::dedup.
+void launch_page_hash(const void* data, size_t num_pages, size_t page_size, uint64_t* out, cudaStream_t stream);
+
+// Compares `num_pages` pages of `page_size` bytes (a multiple of 16) at `a` and `b`, `mismatch` is a device buffer
+// receiving 0 for the identical pages and 1 for the others. A hash match only picks the candidate page, this decides.
+void launch_page_compare(const void* a, const void* b, size_t num_pages, size_t page_size, int32_t* mismatch, cudaStream_t stream);
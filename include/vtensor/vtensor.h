@@ -21,6 +21,8 @@ limitations under the License.
 // #include <torch/torch.h>
 #include <vector>
 
+#include "allocator/ring_buffer.h"
+#include "allocator/sparse_range.h"
 #include "allocator/vmm_allocator.h"
 
 using PhyBlock = nvgpu::ExpandablePhyBlock;
@@ -28,6 +30,41 @@ using Allocator = nvgpu::VmmAllocator;
 
 torch::Tensor vmm_realloc_tensor(void * address, std::vector<int64_t> shape, std::vector<int64_t> stride, torch::Dtype dtype, size_t request_size, int device, CUstream stream);
 
+// Allocates all the tensors with one reservation and one mapping per device. `dtypes` and `devices` hold either one
+// entry per shape or a single entry used for every shape. The memory is released when the last tensor is freed.
+std::vector<torch::Tensor> vmm_alloc_tensors(std::vector<std::vector<int64_t>> shapes, std::vector<torch::Dtype> dtypes, std::vector<int> devices, size_t alignment, CUstream stream);
+
+// Zero-copy view of `shape` over the memory of the ranges (address, size) mapped back to back, see
+// VmmAllocator::gather. The view keeps the physical blocks alive, also after the source tensors are freed.
+torch::Tensor vmm_gather_view(std::vector<uintptr_t> addresses, std::vector<size_t> sizes, std::vector<int64_t> shape, torch::Dtype dtype, int device);
+
+// Tensor of `shape` over the stream bytes of `ring` starting at `offset`, contiguous also across the wrap around. The
+// tensor keeps the ring alive.
+torch::Tensor vmm_ring_view(std::shared_ptr<nvgpu::RingBuffer> ring, uint64_t offset, std::vector<int64_t> shape, torch::Dtype dtype);
+
+// Dense tensor of `shape` over the whole of `range`, the empty blocks read zeros. The tensor keeps the range alive.
+torch::Tensor vmm_sparse_view(std::shared_ptr<nvgpu::SparseRange> range, std::vector<int64_t> shape, torch::Dtype dtype);
+
+// Tensor of `shape` in the symmetric heap of `device`, see VmmAllocator::alloc_symmetric : ranks allocating the same
+// tensors in the same order get the same addresses.
+torch::Tensor vmm_symmetric_tensor(std::vector<int64_t> shape, torch::Dtype dtype, int device);
+
+// Deduplicates the pages of read-only CUDA tensors (each one a whole vTensor allocation, e.g. the weights of model
+// replicas) by content hash, see VmmAllocator::dedup. Returns the number of bytes saved.
+size_t vmm_dedup(std::vector<torch::Tensor> tensors);
+
+// Writes the tensors (all on CUDA devices, or all on the CPU) and the allocator layout to `path`. Tensors sharing a
+// VMM reservation are restored inside one allocation at their original offsets.
+size_t vmm_checkpoint(const std::string& path, std::vector<std::string> names, std::vector<torch::Tensor> tensors, size_t chunk_size);
+
+// Rebuilds the tensors written by vmm_checkpoint, in the same order. Also returns the allocator layout (snapshot JSON)
+// at checkpoint time.
+std::pair<std::vector<std::pair<std::string, torch::Tensor>>, std::string> vmm_restore(const std::string& path, size_t num_buffers);
+
+// Streams the tensors of a safetensors file to `device` (-1 : CPU) through `num_buffers` pinned staging buffers of
+// `chunk_size` bytes, disk reads overlap the copies. The tensors share one vTensor allocation, in file order.
+std::vector<std::pair<std::string, torch::Tensor>> vmm_load_safetensors(const std::string& path, int device, size_t num_buffers, size_t chunk_size);
+
 void init_shared_phy_blocks(int num_blocks, size_t block_size);
 void init_unique_phy_blocks(int num_blocks, size_t block_size);
 void release_shared_phy_blocks();
@@ -53,6 +90,13 @@ private:
   size_t used_size;
   int world_size;
 
+  // memory tag charged for the whole virtual range, current_memory_tag() at construction
+  std::string tag;
+
+  // current_lifetime() at construction, carried by the exclusive block (the owned pool keeps it apart once the
+  // block migrates there)
+  nvgpu::Lifetime lifetime = nvgpu::Lifetime::DEFAULT;
+
   std::mutex mtx;
 
   torch::Tensor tensor;
@@ -0,0 +1,136 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+/*
+ * Stable C ABI of the vTensor core library (libvtensor_core.so).
+ *
+ * The core (VmmAllocator, ExpandablePhyBlock and the block pools) only depends on the CUDA driver. This header is
+ * plain C, so that inference servers and non-PyTorch runtimes can use the allocator without linking libtorch.
+ * Every function returns a vt_status_t and never throws. Streams are passed as CUstream casted to void*.
+ *
+ * Compatibility : functions and enum values are only ever added. Structs passed by pointer start with a
+ * `struct_size` field that the caller sets to sizeof(struct), fields are only appended.
+ */
+
+#ifndef VTENSOR_C_H_
+#define VTENSOR_C_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#if defined(_WIN32)
+#define VT_API __declspec(dllexport)
+#else
+#define VT_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VT_ABI_VERSION 1
+
+typedef enum {
+  VT_SUCCESS = 0,
+  VT_ERROR_INVALID_VALUE = 1,
+  VT_ERROR_OUT_OF_MEMORY = 2,
+  VT_ERROR_NOT_FOUND = 3,
+  VT_ERROR_UNKNOWN = 999
+} vt_status_t;
+
+/* expected lifetime of an allocation, allocations of different lifetimes never share a physical block */
+typedef enum {
+  VT_LIFETIME_DEFAULT = 0,
+  VT_LIFETIME_TRANSIENT = 1,  /* freed within the step, bump allocated from arena blocks */
+  VT_LIFETIME_STEP = 2,
+  VT_LIFETIME_PERSISTENT = 3  /* weights, KV cache */
+} vt_lifetime_t;
+
+/* opaque allocator handle */
+typedef struct vt_allocator vt_allocator_t;
+
+typedef struct {
+  size_t struct_size;
+  uint64_t reserved_bytes;
+  uint64_t num_reservations;
+  uint64_t mapped_bytes;
+  uint64_t num_mappings;
+  uint64_t physical_bytes;
+  uint64_t free_block_bytes;
+  uint64_t num_blocks;
+  uint64_t cached_bytes;
+  uint64_t slab_mapped_bytes;
+  uint64_t slab_allocated_bytes;
+} vt_stats_t;
+
+VT_API int vt_abi_version(void);
+
+VT_API const char* vt_status_string(vt_status_t status);
+
+/* process wide allocator of this library. The torch extension compiles the core into itself and keeps its own. Never destroy it. */
+VT_API vt_allocator_t* vt_allocator_default(void);
+
+/* independent allocator */
+VT_API vt_status_t vt_allocator_create(vt_allocator_t** allocator);
+
+VT_API void vt_allocator_destroy(vt_allocator_t* allocator);
+
+/* reserve + back + map `size` bytes on `device` */
+VT_API vt_status_t vt_alloc(vt_allocator_t* allocator, size_t size, int device, void* stream, void** ptr);
+
+/* vt_alloc placed with the allocations of `lifetime` */
+VT_API vt_status_t vt_alloc_hinted(vt_allocator_t* allocator, size_t size, int device, void* stream, vt_lifetime_t lifetime, void** ptr);
+
+VT_API vt_status_t vt_free(vt_allocator_t* allocator, void* ptr, size_t size, int device, void* stream);
+
+/* reserve a virtual range only, `reserved_size` receives the size rounded up to the granularity */
+VT_API vt_status_t vt_reserve(vt_allocator_t* allocator, size_t size, int device, void** ptr, size_t* reserved_size);
+
+/* back a range returned by vt_reserve with physical memory of the allocator */
+VT_API vt_status_t vt_map(vt_allocator_t* allocator, void* ptr, size_t reserved_size, int device);
+
+/* unmap a range mapped by vt_map or vt_alloc, the virtual range is released as well */
+VT_API vt_status_t vt_unmap(vt_allocator_t* allocator, void* ptr, size_t size, int device);
+
+VT_API vt_status_t vt_get_stats(vt_allocator_t* allocator, vt_stats_t* stats);
+
+/* release the cached physical memory, `released` (may be NULL) receives the number of bytes released */
+VT_API vt_status_t vt_empty_cache(vt_allocator_t* allocator, size_t* released);
+
+/* "best_fit", "first_fit", "worst_fit" or "segregated_fit" : the idle block a request maps, among the ones at most
+   twice its size */
+VT_API vt_status_t vt_set_placement_policy(vt_allocator_t* allocator, const char* policy);
+
+/* publish the counters to the POSIX shared memory segment `name` (NULL : /vtensor_stats.<pid>), read by the
+ * vtensor_stats tool */
+VT_API vt_status_t vt_publish_stats(vt_allocator_t* allocator, const char* name);
+
+/* tag charged by the allocations of the calling thread */
+VT_API vt_status_t vt_set_memory_tag(const char* tag);
+
+/* lifetime of the allocations of the calling thread made without a hint, vmm_alloc included */
+VT_API vt_status_t vt_set_lifetime(vt_lifetime_t lifetime);
+
+/* torch.cuda.memory.CUDAPluggableAllocator entry points */
+VT_API void* vmm_alloc(ssize_t size, int device, uintptr_t stream);
+
+VT_API void vmm_dealloc(int64_t address, size_t size, int device, uintptr_t stream);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* VTENSOR_C_H_ */
@@ -1,4 +1,7 @@
-from typing import Callable
+import contextlib
+import json
+import pickle
+from typing import Callable, Optional
 
 import torch
 import vTensor.cpp_ext
@@ -19,5 +22,253 @@ def get_pluggable_allocator() -> torch.cuda.memory.CUDAPluggableAllocator:
     return new_alloc
 
 
+def alloc_tensors(shapes, dtypes, devices=None, alignment: int = 256, stream: int = 0):
+    """Allocate many tensors with a single call : one VA reservation and one mapping per device.
+
+    `dtypes` and `devices` are either a single value or one value per shape. Every tensor starts at an offset
+    aligned to `alignment` bytes, the group memory is released when the last tensor is freed.
+    """
+    if isinstance(dtypes, torch.dtype):
+        dtypes = [dtypes]
+    if devices is None:
+        devices = [torch.cuda.current_device()]
+    elif isinstance(devices, (int, torch.device)):
+        devices = [devices]
+    devices = [d.index if isinstance(d, torch.device) else d for d in devices]
+    shapes = [list(shape) for shape in shapes]
+    return vTensor.cpp_ext.vmm_tensors(shapes, list(dtypes), devices, alignment, stream)
+
+
+def concat(tensors) -> torch.Tensor:
+    """torch.cat(tensors) along dim 0 without copying : the memory of the tensors is mapped into a new range.
+
+    The tensors are contiguous, on the same device, with the same dtype and trailing dims, and each one starts a
+    vTensor allocation (torch.empty through the pluggable allocator, alloc_tensors with one tensor per page, ...).
+    All but the last one span a multiple of vTensor.granularity() bytes. Writes through the result are visible
+    in the inputs.
+    """
+    first = tensors[0]
+    for t in tensors:
+        if t.dtype != first.dtype or t.device != first.device or t.shape[1:] != first.shape[1:]:
+            raise ValueError("concat: tensors differ in dtype, device or trailing dims")
+        if not t.is_contiguous():
+            raise ValueError("concat: tensors must be contiguous")
+    shape = [sum(t.shape[0] for t in tensors)] + list(first.shape[1:])
+    return gather_pages([(t.data_ptr(), t.numel() * t.element_size()) for t in tensors], shape, first.dtype, first.device.index)
+
+
+def gather_pages(ranges, shape, dtype: torch.dtype, device: Optional[int] = None) -> torch.Tensor:
+    """Tensor of `shape` aliasing the (address, size) ranges mapped back to back, see concat."""
+    if device is None:
+        device = torch.cuda.current_device()
+    addresses = [int(address) for address, _ in ranges]
+    sizes = [int(size) for _, size in ranges]
+    return vTensor.cpp_ext.gather_view(addresses, sizes, list(shape), dtype, device)
+
+
+@contextlib.contextmanager
+def graph_pool(pool_id: Optional[int] = None):
+    """Route the allocations made on capturing streams to a private pool.
+
+    Use it around torch.cuda.graph(...) with the vTensor pluggable allocator. Addresses handed out to the capture
+    stay mapped and are only reused by the same pool, so replays are safe. Pass the same `pool_id` to share a pool
+    between graphs, and call release_graph_pool(pool_id) once per captured graph when it is destroyed.
+    """
+    if pool_id is None:
+        pool_id = vTensor.cpp_ext.graph_pool_handle()
+    vTensor.cpp_ext.begin_allocate_to_pool(pool_id)
+    try:
+        yield pool_id
+    finally:
+        vTensor.cpp_ext.end_allocate_to_pool(pool_id)
+
+
+def release_graph_pool(pool_id: int) -> None:
+    vTensor.cpp_ext.release_pool(pool_id)
+
+
+@contextlib.contextmanager
+def memory_tag(tag: str):
+    """Charge the allocations of the current thread (torch tensors and vTensor.tensor) to `tag`."""
+    previous = vTensor.cpp_ext.memory_tag()
+    vTensor.cpp_ext.set_memory_tag(tag)
+    try:
+        yield tag
+    finally:
+        vTensor.cpp_ext.set_memory_tag(previous)
+
+
+@contextlib.contextmanager
+def lifetime(hint: str):
+    """Place the allocations of the current thread with the ones of the same expected lifetime.
+
+    `hint` is "transient" (activations, bump allocated from arena blocks reused once empty), "step", "persistent"
+    (weights, KV cache) or "default". Short lived tensors then never share a block with long lived ones, which would
+    pin it.
+    """
+    previous = vTensor.cpp_ext.lifetime()
+    vTensor.cpp_ext.set_lifetime(hint)
+    try:
+        yield hint
+    finally:
+        vTensor.cpp_ext.set_lifetime(previous)
+
+
+@contextlib.contextmanager
+def step():
+    """One iteration of a serving / training loop, see set_step_prewarm.
+
+    The first steps teach the allocator the sizes mapped per iteration, the next ones find them mapped ahead.
+    """
+    vTensor.cpp_ext.begin_step()
+    try:
+        yield
+    finally:
+        vTensor.cpp_ext.end_step()
+
+
+@contextlib.contextmanager
+def trace(path: str, max_events_per_thread: int = 1 << 20):
+    """Record the allocator timeline (operations, pool searches, driver calls, lock waits) to a Chrome trace.
+
+    Open `path` in https://ui.perfetto.dev or chrome://tracing, or merge it with a torch.profiler trace with
+    merge_traces.
+    """
+    vTensor.cpp_ext.start_trace(max_events_per_thread)
+    try:
+        yield
+    finally:
+        vTensor.cpp_ext.stop_trace()
+        vTensor.cpp_ext.export_trace(path)
+
+
+def merge_traces(vtensor_trace: str, torch_trace: str, path: str) -> None:
+    """Write the events of a vTensor trace into a torch.profiler trace (export_chrome_trace), on the same timeline.
+
+    Both use the wall clock and the kernel thread ids : the allocator events land in the rows of the threads
+    running the torch ops. Recent profilers write timestamps relative to "baseTimeNanoseconds", the vTensor ones
+    are shifted likewise.
+    """
+    with open(vtensor_trace) as f:
+        events = json.load(f)["traceEvents"]
+    with open(torch_trace) as f:
+        merged = json.load(f)
+    base_us = merged.get("baseTimeNanoseconds", 0) / 1e3
+    for event in events:
+        event["ts"] -= base_us
+    merged["traceEvents"].extend(events)
+    with open(path, "w") as f:
+        json.dump(merged, f)
+
+
+def migrate_incrementally(tensor: torch.Tensor, device: int, budget_bytes: int = 64 << 20):
+    """Move the memory of `tensor` (a whole allocation) to `device`, `budget_bytes` per iteration.
+
+    The tensor keeps its address and its torch device, the old device reads the new memory through peer access.
+    Yields the number of bytes left after each step; run work between the steps, not on the tensor's stream while a
+    step runs:
+
+        for left in vTensor.migrate_incrementally(kv_cache, 1, 32 << 20):
+            engine.step()
+    """
+    torch.cuda.synchronize(tensor.device)
+    vTensor.cpp_ext.migrate_begin(tensor, device)
+    left = tensor.untyped_storage().nbytes()
+    while left > 0:
+        torch.cuda.synchronize(tensor.device)
+        left = vTensor.cpp_ext.migrate_step(tensor, budget_bytes)
+        yield left
+
+
+def sparse_tensor(shape, dtype: torch.dtype, block_size: int, device: Optional[int] = None):
+    """Block-sparse tensor of `shape` : returns (handle, tensor), the tensor reads zeros until a block is materialized.
+
+    Only handle.materialize(i) gives block i (`block_size` bytes, rounded up to vTensor.granularity()) memory of its
+    own and makes it writable, handle.release(i) gives it back. Synchronize before materializing or releasing a block
+    kernels may still access.
+    """
+    if device is None:
+        device = torch.cuda.current_device()
+    shape = list(shape)
+    nbytes = torch.empty(shape, dtype=dtype, device="meta").nbytes
+    handle = vTensor.cpp_ext.SparseTensor(nbytes, block_size, device)
+    return handle, handle.view(shape, dtype)
+
+
+def init_symmetric_heap(path: str, rank: int, world_size: int, size: int, device: Optional[int] = None,
+                        timeout_ms: int = 60000) -> int:
+    """Reserve a heap of `size` bytes at the same virtual address on the `world_size` local ranks, returns the base.
+
+    Every rank calls it with the same `path` (a file private to the job, removed once the ranks agreed) and `size`.
+    Then vTensor.symmetric_tensor and the vTensor.tensor buffers of `device` land at the same address on every rank
+    allocating them in the same order : the buffer of a peer is at vTensor.symmetric_offset(t) from its heap base.
+    """
+    if device is None:
+        device = torch.cuda.current_device()
+    vTensor.cpp_ext.symmetric_init(path, rank, world_size, size, device, timeout_ms)
+    return vTensor.cpp_ext.symmetric_base()
+
+
+def symmetric_tensor(shape, dtype: torch.dtype, device: Optional[int] = None) -> torch.Tensor:
+    """Tensor of the symmetric heap, see init_symmetric_heap."""
+    if device is None:
+        device = torch.cuda.current_device()
+    return vTensor.cpp_ext.symmetric_empty(list(shape), dtype, device)
+
+
+def move_to_tier(tensor: torch.Tensor, tier: str) -> int:
+    """Move the memory of `tensor` (a whole allocation) to the "host" or "device" tier, returns the bytes moved.
+
+    The tensor keeps its address and its torch device : kernels read host memory over the interconnect, so cold
+    tensors (KV cache of idle sequences) can leave the device and come back when they get hot. Allocations tagged
+    with vTensor.set_tag_tier(tag, "host") start in host memory, vTensor.set_host_spill(True) places the ones the
+    device cannot hold there instead of raising an out of memory error. A move `tier` cannot hold raises that error
+    and leaves the tensor where it was.
+    """
+    torch.cuda.synchronize(tensor.device)
+    return vTensor.cpp_ext.move_to_tier(tensor, tier)
+
+
+def memory_snapshot() -> dict:
+    """Allocator state laid out as torch.cuda.memory._snapshot(), plus the physical view under the "vtensor" key."""
+    return json.loads(vTensor.cpp_ext.snapshot_json())
+
+
+def dump_snapshot(path: str) -> None:
+    """Pickle the snapshot, the file can be dropped into https://pytorch.org/memory_viz"""
+    with open(path, "wb") as f:
+        pickle.dump(memory_snapshot(), f)
+
+
+def save_checkpoint(path: str, tensors: dict, chunk_size: int = 8 << 20) -> int:
+    """Stream `tensors` (name -> contiguous tensor, all CUDA or all CPU) and the allocator layout to `path`.
+
+    Returns the number of bytes written. CPU tensors go through the host stand-in of the device backend.
+    """
+    names = list(tensors.keys())
+    return vTensor.cpp_ext.checkpoint(path, names, [tensors[name] for name in names], chunk_size)
+
+
+def load_checkpoint(path: str, num_buffers: int = 4, return_layout: bool = False):
+    """Rebuild the tensors written by save_checkpoint, file reads overlap the copies to the device."""
+    pairs, layout = vTensor.cpp_ext.restore(path, num_buffers)
+    tensors = dict(pairs)
+    if return_layout:
+        return tensors, json.loads(layout)
+    return tensors
+
+
+def load_safetensors(path: str, device: Optional[int] = None, num_buffers: int = 4, chunk_size: int = 8 << 20) -> dict:
+    """Load a safetensors file into vTensor-backed tensors (name -> tensor, in file order).
+
+    The file is memory mapped and streamed through `num_buffers` pinned buffers of `chunk_size` bytes, the disk reads
+    overlap the copies to the device and the host memory held stays bounded by the buffers. `device` defaults to the
+    current CUDA device, -1 loads to the CPU.
+    """
+    if device is None:
+        device = torch.cuda.current_device()
+    return dict(vTensor.cpp_ext.load_safetensors(path, device, num_buffers, chunk_size))
+
+
 if __name__ == "__main__":
     pass
@@ -27,8 +27,20 @@ include_dirs = [
 srcs = [
     "src/vtensor.cpp",
     "src/allocator/allocator.cpp",
+    "src/allocator/checkpoint.cpp",
     "src/allocator/expandable_phyblock.cpp",
+    "src/allocator/ring_buffer.cpp",
+    "src/allocator/safetensors.cpp",
+    "src/allocator/shm_stats.cpp",
+    "src/allocator/slab_allocator.cpp",
+    "src/allocator/snapshot.cpp",
+    "src/allocator/sparse_range.cpp",
+    "src/allocator/symmetric_heap.cpp",
+    "src/allocator/tag_accounting.cpp",
+    "src/allocator/trace.cpp",
     "src/allocator/vmm_allocator.cpp",
+    "src/vtensor_c.cc",
+    "src/kernels/page_hash.cu",
     "src/vtensor_api.cc",
 ]
 
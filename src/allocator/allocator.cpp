@@ -1,12 +1,21 @@
 #include "allocator/allocator.h"
 
+#include <stdexcept>
+#include <string>
+
 // Adpated from https://github.com/vllm-project/vllm/pull/11743
 void ensure_context(unsigned long long device) {
   CUcontext pctx;
-  DRV_CALL(cuCtxGetCurrent(&pctx));
-  if (!pctx) {
+  // throws rather than asserts, the C ABI turns it into a status
+  CUresult result = DRV_TRY(cuCtxGetCurrent(&pctx));
+  if (result == CUDA_SUCCESS && !pctx) {
     // Ensure device context.
-    DRV_CALL(cuDevicePrimaryCtxRetain(&pctx, device));
-    DRV_CALL(cuCtxSetCurrent(pctx));
+    result = DRV_TRY(cuDevicePrimaryCtxRetain(&pctx, device));
+    if (result == CUDA_SUCCESS) {
+      result = DRV_TRY(cuCtxSetCurrent(pctx));
+    }
+  }
+  if (result != CUDA_SUCCESS) {
+    throw std::runtime_error("ensure_context: no context on device " + std::to_string(device) + ", error " + std::to_string((int)result));
   }
 }
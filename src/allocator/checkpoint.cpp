@@ -0,0 +1,390 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "cu_util.h"
+
+#include "allocator/checkpoint.h"
+#include "allocator/vmm_allocator.h"
+
+namespace nvgpu {
+
+    // host backend
+
+    void* HostCheckpointBackend::alloc(size_t size, int device) {
+        void* ptr = nullptr;
+        if (posix_memalign(&ptr, 4096, std::max<size_t>(size, 1)) != 0) {
+            throw std::runtime_error("HostCheckpointBackend: failed to allocate " + std::to_string(size) + " bytes");
+        }
+        return ptr;
+    }
+
+    void HostCheckpointBackend::free(void* ptr, size_t size, int device) {
+        std::free(ptr);
+    }
+
+    void* HostCheckpointBackend::alloc_staging(size_t size) {
+        return alloc(size, -1);
+    }
+
+    void HostCheckpointBackend::free_staging(void* ptr, size_t size) {
+        std::free(ptr);
+    }
+
+    void HostCheckpointBackend::copy_to_host(void* dst, const void* src, size_t size, int device) {
+        std::memcpy(dst, src, size);
+    }
+
+    void HostCheckpointBackend::copy_to_device(void* dst, const void* src, size_t size, int device) {
+        std::memcpy(dst, src, size);
+    }
+
+    // VMM backend
+
+    void* VmmCheckpointBackend::alloc(size_t size, int device) {
+        return allocator->alloc(size, device, 0/*stream*/);
+    }
+
+    void VmmCheckpointBackend::free(void* ptr, size_t size, int device) {
+        allocator->dealloc(ptr, size, device, 0/*stream*/);
+    }
+
+    void* VmmCheckpointBackend::alloc_staging(size_t size) {
+        // pinned, so that the copies are DMA transfers
+        void* ptr = nullptr;
+        CUresult result = DRV_TRY(cuMemHostAlloc(&ptr, size, 0));
+        if (result != CUDA_SUCCESS) {
+            throw std::runtime_error("VmmCheckpointBackend: failed to allocate " + std::to_string(size) + " bytes of pinned memory");
+        }
+        return ptr;
+    }
+
+    void VmmCheckpointBackend::free_staging(void* ptr, size_t size) {
+        DRV_TRY(cuMemFreeHost(ptr));
+    }
+
+    void VmmCheckpointBackend::copy_to_host(void* dst, const void* src, size_t size, int device) {
+        ensure_context(device);
+        CUresult result = DRV_TRY(cuMemcpyDtoH(dst, reinterpret_cast<CUdeviceptr>(src), size));
+        if (result != CUDA_SUCCESS) {
+            throw std::runtime_error("VmmCheckpointBackend: failed to copy " + std::to_string(size) + " bytes from device " + std::to_string(device) + ", error " + std::to_string((int)result));
+        }
+    }
+
+    void VmmCheckpointBackend::copy_to_device(void* dst, const void* src, size_t size, int device) {
+        ensure_context(device);
+        CUresult result = DRV_TRY(cuMemcpyHtoD(reinterpret_cast<CUdeviceptr>(dst), src, size));
+        if (result != CUDA_SUCCESS) {
+            throw std::runtime_error("VmmCheckpointBackend: failed to copy " + std::to_string(size) + " bytes to device " + std::to_string(device) + ", error " + std::to_string((int)result));
+        }
+    }
+
+    bool VmmCheckpointBackend::find_segment(const void* ptr, uintptr_t* base, size_t* size) {
+        std::lock_guard<TracedMutex> lock(allocator->mtx);
+        uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+        auto it = allocator->reserved_addresses.upper_bound(addr);
+        if (it == allocator->reserved_addresses.begin()) {
+            return false;
+        }
+        --it;
+        if (addr >= it->first + it->second.first) {
+            return false;
+        }
+        *base = it->first;
+        *size = it->second.first;
+        return true;
+    }
+
+    struct FileCloser {
+        void operator()(FILE* f) const { if (f) fclose(f); }
+    };
+    using File = std::unique_ptr<FILE, FileCloser>;
+
+    static void write_all(FILE* f, const void* data, size_t size) {
+        if (size > 0 && fwrite(data, 1, size, f) != size) {
+            throw std::runtime_error("checkpoint: write failed");
+        }
+    }
+
+    static void read_all(FILE* f, void* data, size_t size) {
+        if (size > 0 && fread(data, 1, size, f) != size) {
+            throw std::runtime_error("checkpoint: unexpected end of file");
+        }
+    }
+
+    // bytes left after the current position, the counts of the file are checked against it before any allocation
+    static uint64_t remaining_bytes(FILE* f) {
+        off_t position = ftello(f);
+        if (position < 0 || fseeko(f, 0, SEEK_END) != 0) {
+            throw std::runtime_error("checkpoint: cannot seek");
+        }
+        off_t end = ftello(f);
+        if (end < position || fseeko(f, position, SEEK_SET) != 0) {
+            throw std::runtime_error("checkpoint: cannot seek");
+        }
+        return (uint64_t)(end - position);
+    }
+
+    size_t save_checkpoint(const std::string& path, const std::vector<CheckpointRegion>& regions, CheckpointBackend* backend,
+                           const std::string& layout_json, const CheckpointOptions& options) {
+        if (options.chunk_size == 0) {
+            throw std::runtime_error("save_checkpoint: chunk_size must be positive");
+        }
+
+        // group the regions by the allocation which owns them
+        std::vector<CheckpointSegmentRecord> segments;
+        std::map<std::pair<int, uintptr_t>, uint32_t> segment_index;
+        std::vector<CheckpointRegionRecord> records(regions.size());
+        for (size_t i = 0; i < regions.size(); i++) {
+            const CheckpointRegion& region = regions[i];
+            uintptr_t addr = reinterpret_cast<uintptr_t>(region.ptr);
+            uintptr_t base = addr;
+            size_t size = region.size;
+            if (!backend->find_segment(region.ptr, &base, &size) || addr + region.size > base + size) {
+                base = addr;
+                size = region.size;
+            }
+
+            auto inserted = segment_index.insert({{region.device, base}, (uint32_t)segments.size()});
+            if (inserted.second) {
+                segments.push_back(CheckpointSegmentRecord{region.device, 0, size, base});
+            }
+            uint32_t s = inserted.first->second;
+            segments[s].size = std::max<uint64_t>(segments[s].size, addr - base + region.size);
+
+            records[i] = CheckpointRegionRecord{s, (uint32_t)region.name.size(), (uint32_t)region.meta.size(), 0,
+                                                addr - base, region.size};
+        }
+
+        File f(fopen(path.c_str(), "wb"));
+        if (!f) {
+            throw std::runtime_error("save_checkpoint: cannot open " + path);
+        }
+
+        CheckpointHeader header = {};
+        std::memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+        header.version = kCheckpointVersion;
+        header.num_segments = (uint32_t)segments.size();
+        header.num_regions = (uint32_t)regions.size();
+        header.chunk_size = options.chunk_size;
+        header.layout_size = layout_json.size();
+
+        size_t written = 0;
+        write_all(f.get(), &header, sizeof(header));
+        written += sizeof(header);
+        for (auto& segment : segments) {
+            write_all(f.get(), &segment, sizeof(segment));
+            written += sizeof(segment);
+        }
+        for (size_t i = 0; i < regions.size(); i++) {
+            write_all(f.get(), &records[i], sizeof(records[i]));
+            write_all(f.get(), regions[i].name.data(), regions[i].name.size());
+            write_all(f.get(), regions[i].meta.data(), regions[i].meta.size());
+            written += sizeof(records[i]) + regions[i].name.size() + regions[i].meta.size();
+        }
+        write_all(f.get(), layout_json.data(), layout_json.size());
+        written += layout_json.size();
+
+        // the calling thread copies chunks to the staging buffers, the file thread writes them out
+        StagingQueue queue(backend, options.chunk_size, options.num_buffers);
+        size_t payload = 0;
+        std::thread file_thread([&] {
+            try {
+                StagingQueue::Item item;
+                while (queue.pop(&item)) {
+                    write_all(f.get(), &item.record, sizeof(item.record));
+                    write_all(f.get(), queue.data(item.buffer), item.record.length);
+                    payload += sizeof(item.record) + item.record.length;
+                    queue.release(item.buffer);
+                }
+            } catch (const std::exception& e) {
+                queue.close(e.what());
+            }
+        });
+
+        try {
+            for (size_t i = 0; i < regions.size(); i++) {
+                for (size_t offset = 0; offset < regions[i].size; offset += options.chunk_size) {
+                    size_t length = std::min(options.chunk_size, regions[i].size - offset);
+                    int buffer = queue.acquire();
+                    if (buffer < 0) {
+                        break;
+                    }
+                    backend->copy_to_host(queue.data(buffer), (const char *)regions[i].ptr + offset, length, regions[i].device);
+                    queue.push(StagingQueue::Item{buffer, CheckpointChunkRecord{(uint32_t)i, 0, offset, length}});
+                }
+            }
+        } catch (const std::exception& e) {
+            queue.close(e.what());
+        }
+        queue.close();
+        file_thread.join();
+        if (!queue.error.empty()) {
+            throw std::runtime_error("save_checkpoint: " + queue.error);
+        }
+
+        CheckpointChunkRecord end = {CheckpointChunkRecord::kEndOfChunks, 0, 0, 0};
+        write_all(f.get(), &end, sizeof(end));
+        written += payload + sizeof(end);
+
+        if (fflush(f.get()) != 0) {
+            throw std::runtime_error("save_checkpoint: flush failed");
+        }
+        std::cout << "[save_checkpoint] wrote " << regions.size() << " regions in " << segments.size() << " segments, " << written << " bytes to " << path << std::endl;
+        return written;
+    }
+
+    RestoredCheckpoint restore_checkpoint(const std::string& path, CheckpointBackend* backend, const CheckpointOptions& options) {
+        File f(fopen(path.c_str(), "rb"));
+        if (!f) {
+            throw std::runtime_error("restore_checkpoint: cannot open " + path);
+        }
+
+        CheckpointHeader header;
+        read_all(f.get(), &header, sizeof(header));
+        if (std::memcmp(header.magic, kCheckpointMagic, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("restore_checkpoint: " + path + " is not a vTensor checkpoint");
+        }
+        if (header.version != kCheckpointVersion) {
+            throw std::runtime_error("restore_checkpoint: unsupported checkpoint version " + std::to_string(header.version));
+        }
+
+        // the records and the layout must fit in the file : a corrupt count would allocate up to 4G records
+        uint64_t remaining = remaining_bytes(f.get());
+        uint64_t records_size = (uint64_t)header.num_segments * sizeof(CheckpointSegmentRecord) +
+                                (uint64_t)header.num_regions * sizeof(CheckpointRegionRecord);
+        if (records_size > remaining || header.layout_size > remaining - records_size) {
+            throw std::runtime_error("restore_checkpoint: " + path + " is truncated, " + std::to_string(header.num_segments) + " segments and " +
+                                     std::to_string(header.num_regions) + " regions do not fit in " + std::to_string(remaining) + " bytes");
+        }
+        remaining -= records_size + header.layout_size;
+
+        RestoredCheckpoint restored;
+        std::vector<CheckpointSegmentRecord> segments(header.num_segments);
+        for (auto& segment : segments) {
+            read_all(f.get(), &segment, sizeof(segment));
+        }
+        std::vector<CheckpointRegionRecord> records(header.num_regions);
+        for (auto& record : records) {
+            read_all(f.get(), &record, sizeof(record));
+            if (record.segment >= segments.size() || record.offset > segments[record.segment].size ||
+                record.size > segments[record.segment].size - record.offset) {
+                throw std::runtime_error("restore_checkpoint: region out of its segment");
+            }
+            if ((uint64_t)record.name_size + record.meta_size > remaining) {
+                throw std::runtime_error("restore_checkpoint: region name and meta past the end of " + path);
+            }
+            remaining -= (uint64_t)record.name_size + record.meta_size;
+            CheckpointRegion region;
+            region.name.resize(record.name_size);
+            read_all(f.get(), &region.name[0], record.name_size);
+            region.meta.resize(record.meta_size);
+            read_all(f.get(), &region.meta[0], record.meta_size);
+            region.size = record.size;
+            region.device = segments[record.segment].device;
+            restored.regions.push_back(region);
+            restored.region_segments.push_back(record.segment);
+        }
+        restored.layout_json.resize(header.layout_size);
+        read_all(f.get(), &restored.layout_json[0], header.layout_size);
+
+        auto free_segments = [&] {
+            for (auto& segment : restored.segments) {
+                backend->free(segment.ptr, segment.size, segment.device);
+            }
+            restored.segments.clear();
+        };
+
+        // rebuild the layout : one allocation per segment, regions at their original offsets
+        try {
+            for (auto& segment : segments) {
+                void* ptr = backend->alloc(segment.size, segment.device);
+                if (ptr == nullptr) {
+                    throw std::runtime_error("restore_checkpoint: failed to allocate a segment of " + std::to_string(segment.size) + " bytes");
+                }
+                restored.segments.push_back(CheckpointSegment{ptr, segment.size, segment.device});
+            }
+        } catch (...) {
+            free_segments();
+            throw;
+        }
+        for (size_t i = 0; i < records.size(); i++) {
+            restored.regions[i].ptr = (char *)restored.segments[records[i].segment].ptr + records[i].offset;
+        }
+
+        // the file thread reads chunks ahead while the calling thread copies them to the device
+        size_t chunk_size = std::max<size_t>(header.chunk_size, 1);
+        StagingQueue queue(backend, chunk_size, options.num_buffers);
+        size_t bytes_read = 0;
+        std::thread file_thread([&] {
+            try {
+                while (true) {
+                    CheckpointChunkRecord record;
+                    read_all(f.get(), &record, sizeof(record));
+                    if (record.region == CheckpointChunkRecord::kEndOfChunks) {
+                        break;
+                    }
+                    if (record.region >= records.size() || record.length > chunk_size ||
+                        record.offset > records[record.region].size || record.length > records[record.region].size - record.offset) {
+                        throw std::runtime_error("malformed chunk");
+                    }
+                    int buffer = queue.acquire();
+                    if (buffer < 0) {
+                        return;
+                    }
+                    read_all(f.get(), queue.data(buffer), record.length);
+                    bytes_read += record.length;
+                    queue.push(StagingQueue::Item{buffer, record});
+                }
+            } catch (const std::exception& e) {
+                queue.close(e.what());
+                return;
+            }
+            queue.close();
+        });
+
+        try {
+            StagingQueue::Item item;
+            while (queue.pop(&item)) {
+                const CheckpointRegion& region = restored.regions[item.record.region];
+                backend->copy_to_device((char *)region.ptr + item.record.offset, queue.data(item.buffer), item.record.length, region.device);
+                queue.release(item.buffer);
+            }
+        } catch (const std::exception& e) {
+            queue.close(e.what());
+        }
+        file_thread.join();
+        if (!queue.error.empty()) {
+            free_segments();
+            throw std::runtime_error("restore_checkpoint: " + queue.error);
+        }
+
+        restored.bytes_read = bytes_read;
+        std::cout << "[restore_checkpoint] restored " << restored.regions.size() << " regions in " << restored.segments.size() << " segments, " << bytes_read << " bytes from " << path << std::endl;
+        return restored;
+    }
+
+} // namespace nvgpu
@@ -17,6 +17,8 @@ limitations under the License.
 #include "cu_util.h"
 
 #include "allocator/expandable_phyblock.h"
+#include "allocator/shm_stats.h"
+#include "allocator/trace.h"
 
 #define CEIL_DIV(x, n) (((x) + (n) - 1) / (n))
 #define ROUND_UP(x, n) (CEIL_DIV(x, n) * (n))
@@ -25,32 +27,66 @@ namespace nvgpu {
 
     std::atomic<int> ExpandablePhyBlock::thread_safe_counter{0};
 
-    ExpandablePhyBlock::ExpandablePhyBlock(int device_id, size_t block_size) {
-        this->device_id = device_id;
-
+    static CUmemAllocationProp allocation_prop(int device_id, MemoryTier tier, int numa_node) {
         CUmemAllocationProp prop = {};
         prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
-        prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
-        prop.location.id = device_id;
+        if (tier == MemoryTier::HOST_MEMORY) {
+            prop.location.type = numa_node >= 0 ? CU_MEM_LOCATION_TYPE_HOST_NUMA : CU_MEM_LOCATION_TYPE_HOST;
+            prop.location.id = numa_node >= 0 ? numa_node : 0;
+        } else {
+            prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+            prop.location.id = device_id;
+        }
+        return prop;
+    }
+
+    size_t ExpandablePhyBlock::granularity_of(int device_id, MemoryTier tier, int numa_node) {
+        CUmemAllocationProp prop = allocation_prop(device_id, tier, numa_node);
+        size_t granularity = 0;
+        if (DRV_TRY(cuMemGetAllocationGranularity(&granularity, &prop, CU_MEM_ALLOC_GRANULARITY_MINIMUM)) != CUDA_SUCCESS) {
+            return 0;
+        }
+        return granularity;
+    }
+
+    ExpandablePhyBlock::ExpandablePhyBlock(int device_id, size_t block_size, MemoryTier tier, int numa_node) {
+        this->device_id = device_id;
+        this->tier = tier;
+        this->numa_node = tier == MemoryTier::HOST_MEMORY ? numa_node : -1;
+
+        // the memory lives in the tier, the mappings are accessed by `device_id` whatever the tier
+        CUmemAllocationProp prop = allocation_prop(device_id, tier, this->numa_node);
+
+        this->block_id = thread_safe_counter++;
 
         size_t granularity;
-        DRV_CALL(cuMemGetAllocationGranularity(&granularity, &prop,
-                                                CU_MEM_ALLOC_GRANULARITY_MINIMUM));
+        status = DRV_TRY(cuMemGetAllocationGranularity(&granularity, &prop,
+                                                       CU_MEM_ALLOC_GRANULARITY_MINIMUM));
+        if (status != CUDA_SUCCESS) {
+            return;
+        }
 
-        int aligned_block_size = ROUND_UP(block_size, granularity);
+        size_t aligned_block_size = ROUND_UP(block_size, granularity);
+
+        // callers check `status`, e.g. CUDA_ERROR_OUT_OF_MEMORY starts the allocator recovery
+        status = DRV_TIMED(MEM_CREATE, aligned_block_size, cuMemCreate(&alloc_handle, aligned_block_size, &prop, 0ULL));
+        if (status != CUDA_SUCCESS) {
+            std::cout << "[ExpandablePhyBlock::ExpandablePhyBlock] [Block#" << block_id << "] failed to create " << aligned_block_size << " bytes of " << memory_tier_name(tier) << " memory, code " << (int)status << std::endl;
+            return;
+        }
 
         this->block_size = aligned_block_size;
         this->remaining_size = aligned_block_size;
-
-        status = cuMemCreate(&alloc_handle, aligned_block_size, &prop, 0ULL);
-
-        this->block_id = thread_safe_counter++;
+        shm_add(device_id, &ShmDeviceStats::physical_bytes, aligned_block_size);
+        shm_add(device_id, &ShmDeviceStats::free_block_bytes, aligned_block_size);
     }
 
     ExpandablePhyBlock::~ExpandablePhyBlock() {
         std::cout << "[ExpandablePhyBlock::~ExpandablePhyBlock] [Block#" << block_id << "]" << " deallocating device memory ..." << std::endl;
         if (status == CUDA_SUCCESS) {
-            status = cuMemRelease(alloc_handle);
+            status = DRV_TIMED(MEM_RELEASE, block_size, cuMemRelease(alloc_handle));
+            shm_add(device_id, &ShmDeviceStats::physical_bytes, -(int64_t)block_size);
+            shm_add(device_id, &ShmDeviceStats::free_block_bytes, -(int64_t)remaining_size);
             if (status != CUDA_SUCCESS) {
                 std::cout << "[ExpandablePhyBlock::~ExpandablePhyBlock] [Block#" << block_id << "]" << " failed to deallocate device memory ..." << std::endl;
             } else {
@@ -68,16 +104,27 @@ namespace nvgpu {
                 return false;
             }
 
-            DRV_CALL(cuMemMap(v_offset_addr, size, 0ULL, alloc_handle, 0ULL));
+            CUresult result = DRV_TRY(DRV_TIMED(MEM_MAP, size, cuMemMap(v_offset_addr, size, 0ULL, alloc_handle, 0ULL)));
+            if (result != CUDA_SUCCESS) {
+                mapped_addresses.erase(addr_inserted.first);
+                return false;
+            }
 
             CUmemAccessDesc accessDesc = {};
             accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
             accessDesc.location.id = this->device_id;
             accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
 
-            DRV_CALL(cuMemSetAccess(v_offset_addr, size, &accessDesc, 1));
+            result = DRV_TRY(DRV_TIMED(MEM_SET_ACCESS, size, cuMemSetAccess(v_offset_addr, size, &accessDesc, 1)));
+            if (result != CUDA_SUCCESS) {
+                DRV_TRY(DRV_TIMED(MEM_UNMAP, size, cuMemUnmap(v_offset_addr, size)));
+                mapped_addresses.erase(addr_inserted.first);
+                return false;
+            }
 
             remaining_size -= size;
+            shm_add(device_id, &ShmDeviceStats::mapped_bytes, size);
+            shm_add(device_id, &ShmDeviceStats::free_block_bytes, -(int64_t)size);
 
             std::cout << "[ExpandablePhyBlock::map_virtual_address] [Block#" << block_id << "] mapping address " << v_offset_addr <<  " successufully, remaining size " << remaining_size << "." << std::endl;
             return true;
@@ -86,33 +133,85 @@ namespace nvgpu {
         return false;
     }
 
-    bool ExpandablePhyBlock::unmap_virtual_address(CUdeviceptr v_offset_addr, size_t size) {
+    bool ExpandablePhyBlock::unmap_virtual_address(CUdeviceptr v_offset_addr, size_t size, bool release_address) {
         auto it = mapped_addresses.find(reinterpret_cast<uintptr_t>((void*)v_offset_addr));
         if (it != mapped_addresses.end()) {
 
             // assert(it->second == size);
             size_t mapped_size = it->second;
 
-            DRV_CALL(cuMemUnmap(v_offset_addr, (ssize_t)mapped_size));
-            DRV_CALL(cuMemAddressFree(v_offset_addr, mapped_size));
+            // a failed unmap keeps the mapping recorded, the caller sees false
+            if (DRV_TRY(DRV_TIMED(MEM_UNMAP, mapped_size, cuMemUnmap(v_offset_addr, (ssize_t)mapped_size))) != CUDA_SUCCESS) {
+                return false;
+            }
+            if (release_address) {
+                // the range is unmapped either way, a leaked reservation only costs address space
+                if (DRV_TRY(DRV_TIMED(ADDRESS_FREE, mapped_size, cuMemAddressFree(v_offset_addr, mapped_size))) == CUDA_SUCCESS) {
+                    shm_add(device_id, &ShmDeviceStats::reserved_bytes, -(int64_t)mapped_size);
+                }
+            }
 
             mapped_addresses.erase(it);
 
             remaining_size += mapped_size;
+            shm_add(device_id, &ShmDeviceStats::mapped_bytes, -(int64_t)mapped_size);
+            shm_add(device_id, &ShmDeviceStats::free_block_bytes, mapped_size);
             return true;
         }
         return false;
     }
 
 
+    bool ExpandablePhyBlock::map_alias(CUdeviceptr v_offset_addr, size_t size, CUmemAccess_flags access) {
+        if (size > block_size) {
+            return false;
+        }
+        auto addr_inserted = alias_addresses.insert({reinterpret_cast<uintptr_t>((void *)v_offset_addr), size});
+        if (!addr_inserted.second) {
+            return false;
+        }
+
+        CUresult result = DRV_TRY(DRV_TIMED(MEM_MAP, size, cuMemMap(v_offset_addr, size, 0ULL, alloc_handle, 0ULL)));
+        if (result != CUDA_SUCCESS) {
+            alias_addresses.erase(addr_inserted.first);
+            return false;
+        }
+
+        CUmemAccessDesc accessDesc = {};
+        accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+        accessDesc.location.id = this->device_id;
+        accessDesc.flags = access;
+
+        result = DRV_TRY(DRV_TIMED(MEM_SET_ACCESS, size, cuMemSetAccess(v_offset_addr, size, &accessDesc, 1)));
+        if (result != CUDA_SUCCESS) {
+            DRV_TRY(DRV_TIMED(MEM_UNMAP, size, cuMemUnmap(v_offset_addr, size)));
+            alias_addresses.erase(addr_inserted.first);
+            return false;
+        }
+
+        std::cout << "[ExpandablePhyBlock::map_alias] [Block#" << block_id << "] alias " << size << " bytes at address " << v_offset_addr << "." << std::endl;
+        return true;
+    }
+
+    bool ExpandablePhyBlock::unmap_alias(CUdeviceptr v_offset_addr) {
+        auto it = alias_addresses.find(reinterpret_cast<uintptr_t>((void *)v_offset_addr));
+        if (it == alias_addresses.end()) {
+            return false;
+        }
+        DRV_TRY(DRV_TIMED(MEM_UNMAP, it->second, cuMemUnmap(v_offset_addr, it->second)));
+        alias_addresses.erase(it);
+        return true;
+    }
+
     bool BlockPool<ExpandablePhyBlock>::add(ExpandablePhyBlock* block) {
         assert(block->owned_pool == nullptr);
 
         block->owned_pool = this;
 
         if (block->allocator != nullptr && block->allocator != this->allocator) {
-            std::cout << "[BlockPool::add] Failed to add the block#" << block->block_id << " to blockPool" << std::endl;
-            exit(0);
+            std::cout << "[BlockPool::add] Failed to add the block#" << block->block_id << " to blockPool, it belongs to another allocator" << std::endl;
+            block->owned_pool = nullptr;
+            return false;
         } else {
             block->allocator = this->allocator;
         }
@@ -146,8 +245,8 @@ namespace nvgpu {
 
     bool OwnedBlockPool<ExpandablePhyBlock>::add(std::shared_ptr<ExpandablePhyBlock> block) {
         if (block->allocator != nullptr && block->allocator != this->allocator) {
-            std::cout << "[OwnedBlockPool::add] Failed to add the block#" << block->block_id << " to blockPool" << std::endl;
-            exit(0);
+            std::cout << "[OwnedBlockPool::add] Failed to add the block#" << block->block_id << " to blockPool, it belongs to another allocator" << std::endl;
+            return false;
         } else {
             block->allocator = this->allocator;
         }
@@ -156,12 +255,9 @@ namespace nvgpu {
         if (!inserted.second) {
             std::cout << "[OwnedBlockPool::add] failed to add Block#" << block->block_id << "." << std::endl;
         } else {
-            if (block->remaining_size > 0) {
-                auto open_blocks_inserted = open_blocks.insert({block->remaining_size,{block.get()}});
-                if (!open_blocks_inserted.second) {
-                    open_blocks_inserted.first->second.push_back(block.get());
-                    std::cout << "[OwnedBlockPool::add] Block#" << block->block_id << " is now available for allocating maximum " << block->remaining_size << " bytes memory." << std::endl;
-                }
+            if (block->idle()) {
+                open_blocks_of(block->lifetime, block->tier)->insert(block.get(), block->block_size);
+                std::cout << "[OwnedBlockPool::add] Block#" << block->block_id << " is now available for allocating maximum " << block->block_size << " bytes memory." << std::endl;
             }
             std::cout << "[OwnedBlockPool::add] add Block#" << block->block_id << "." << std::endl;
         }
@@ -174,18 +270,12 @@ namespace nvgpu {
         if (it != blocks.end()) {
             assert(it->second.get() == block);
 
-            auto pos = open_blocks.find(block->remaining_size);
-            if (pos != open_blocks.end()) {
-                auto & vec = pos->second;
-                if (vec.size() == 1) {
-                    vec.clear();
-                } else {
-                    vec.erase( std::find(vec.begin(), vec.end(), block) );
-                }
-            }
+            open_blocks_of(block->lifetime, block->tier)->erase(block);
 
+            // the pool may hold the last reference of the block
+            int block_id = block->block_id;
             blocks.erase(it);
-            std::cout << "[OwnedBlockPool::remove] remove Block#" << block->block_id << std::endl;
+            std::cout << "[OwnedBlockPool::remove] remove Block#" << block_id << std::endl;
             return true;
         } else {
             std::cout << "[OwnedBlockPool::remove] failed to remove Block#" << block->block_id << std::endl;
@@ -193,52 +283,100 @@ namespace nvgpu {
         }
     }
 
-    ExpandablePhyBlock* OwnedBlockPool<ExpandablePhyBlock>::find_available(size_t size) {
-        auto it = open_blocks.lower_bound(size);
-        if (it != open_blocks.end()) {
-            if (it->second.size() > 0) {
-                ExpandablePhyBlock* block = it->second.back();
-                it->second.pop_back();
+    ExpandablePhyBlock* OwnedBlockPool<ExpandablePhyBlock>::find_available(size_t size, Lifetime lifetime, MemoryTier tier) {
+        VT_TRACE_SCOPE("OwnedBlockPool::find_available", size);
+        PlacementPolicy<ExpandablePhyBlock>* index = open_blocks_of(lifetime, tier);
+        ExpandablePhyBlock* block = index->find(size, size * kMaxReuseRatio);
+        if (block == nullptr) {
+            return nullptr;
+        }
 
-                if (block->remaining_size - size > 0) {
-                    auto open_blocks_inserted = open_blocks.insert({block->remaining_size - size, {block}});
-                    if (!open_blocks_inserted.second) {
-                        open_blocks_inserted.first->second.push_back(block);
-                        std::cout << "[OwnedBlockPool::add] Block#" << block->block_id << " will be available again for allocating maximum " << block->remaining_size - size << " bytes memory." << std::endl;
-                    }
-                }
+        // the caller is going to map the block : closed right away, until the mapping is gone
+        index->insert(block, 0);
+        return block;
+    }
 
-                return block;
+    std::vector<std::pair<ExpandablePhyBlock*, size_t>> OwnedBlockPool<ExpandablePhyBlock>::take_pieces(size_t size, size_t granularity, size_t max_pieces, Lifetime lifetime) {
+        VT_TRACE_SCOPE("OwnedBlockPool::take_pieces", size);
+        PlacementPolicy<ExpandablePhyBlock>* index = open_blocks_of(lifetime);
+        std::vector<std::pair<ExpandablePhyBlock*, size_t>> open;
+        index->for_each([&](ExpandablePhyBlock* block, size_t capacity) {
+            size_t usable = capacity / granularity * granularity;
+            if (usable > 0) {
+                open.push_back({block, usable});
+            }
+        });
+        // the largest first : fewer mappings, and the small tails stay for small requests
+        std::sort(open.begin(), open.end(), [](const std::pair<ExpandablePhyBlock*, size_t>& a, const std::pair<ExpandablePhyBlock*, size_t>& b) {
+            return a.second != b.second ? a.second > b.second : a.first->block_id < b.first->block_id;
+        });
+
+        std::vector<std::pair<ExpandablePhyBlock*, size_t>> pieces;
+        size_t covered = 0;
+        for (auto& it : open) {
+            if (covered >= size || pieces.size() >= max_pieces) {
+                break;
             }
+            // a block much larger than the rest to cover would be pinned by a small piece, a smaller one may follow
+            if (it.first->block_size > (size - covered) * kMaxReuseRatio) {
+                continue;
+            }
+            size_t piece = std::min(it.second, size - covered);
+            pieces.push_back({it.first, piece});
+            index->insert(it.first, 0);
+            covered += piece;
+        }
+
+        if (!pieces.empty()) {
+            std::cout << "[OwnedBlockPool::take_pieces] " << pieces.size() << " pieces cover " << covered << " of " << size << " bytes." << std::endl;
         }
-        return nullptr;
+        return pieces;
     }
 
     void OwnedBlockPool<ExpandablePhyBlock>::update(ExpandablePhyBlock* block, size_t previous_remaining_size) {
-        auto update = [&]() {
-            if (block->remaining_size > 0) {
-                auto open_blocks_inserted = open_blocks.insert({block->remaining_size, {block}});
-                if (!open_blocks_inserted.second) {
-                    open_blocks_inserted.first->second.push_back(block);
-                    std::cout << "[OwnedBlockPool::add] Block#" << block->block_id << " is now available for allocating maximum " << block->remaining_size << " bytes memory." << std::endl;
-                }
-            }
-        };
-
         if (block->remaining_size == previous_remaining_size) {
             return;
         }
 
-        auto pos = open_blocks.find(previous_remaining_size);
-        if (pos != open_blocks.end()) {
-            auto & vec = pos->second;
-            auto it = std::find(vec.begin(), vec.end(), block);
-            if (it != vec.end() && (*it)->block_id == block->block_id) {
-                vec.erase(it);
-            }
+        refresh(block);
+    }
+
+    void OwnedBlockPool<ExpandablePhyBlock>::refresh(ExpandablePhyBlock* block) {
+        if (blocks.find(block->block_id) == blocks.end()) {
+            // not owned by this pool (exclusive or shared blocks)
+            return;
         }
 
-        update();
+        // mappings start at offset 0 of the block : a new one would overlap the memory of the mapping or the views
+        size_t capacity = block->idle() ? block->block_size : 0;
+        open_blocks_of(block->lifetime, block->tier)->insert(block, capacity);
+        if (capacity > 0) {
+            std::cout << "[OwnedBlockPool::update] Block#" << block->block_id << " is now available for allocating maximum " << capacity << " bytes memory." << std::endl;
+        }
+    }
+
+    void OwnedBlockPool<ExpandablePhyBlock>::set_policy(PlacementPolicyType type) {
+        if (type == open_blocks->type()) {
+            return;
+        }
+
+        for (auto* index : {&open_blocks, &lifetime_blocks[(int)Lifetime::STEP]}) {
+            auto policy = PlacementPolicy<ExpandablePhyBlock>::create(type);
+            (*index)->for_each([&](ExpandablePhyBlock* block, size_t remaining) {
+                policy->insert(block, remaining);
+            });
+            index->swap(policy);
+        }
+
+        std::cout << "[OwnedBlockPool::set_policy] placement policy is now " << placement_policy_name(type) << " (" << open_blocks->size() << " open blocks)." << std::endl;
+    }
+
+    void OwnedBlockPool<ExpandablePhyBlock>::for_each_open(const std::function<void(ExpandablePhyBlock*, size_t)>& fn) const {
+        open_blocks->for_each(fn);
+        for (int i = (int)Lifetime::DEFAULT + 1; i < (int)Lifetime::N; i++) {
+            lifetime_blocks[i]->for_each(fn);
+        }
+        host_blocks->for_each(fn);
     }
 
 } // namespace nvgpu
@@ -0,0 +1,120 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "cu_util.h"
+
+#include "allocator/ring_buffer.h"
+#include "allocator/trace.h"
+#include "allocator/vmm_allocator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#define CEIL_DIV(x, n) (((x) + (n) - 1) / (n))
+#define ROUND_UP(x, n) (CEIL_DIV(x, n) * (n))
+
+namespace nvgpu {
+
+    RingBuffer::RingBuffer(VmmAllocator* allocator, size_t capacity, int device) : allocator(allocator), device_(device) {
+        VT_TRACE_SCOPE("RingBuffer::RingBuffer", capacity);
+        ensure_context(device);
+
+        size_t page = allocator->granularity(device);
+        if (page == 0) {
+            throw std::invalid_argument("RingBuffer: cannot query the granularity of device " + std::to_string(device));
+        }
+        capacity_ = ROUND_UP(std::max(capacity, (size_t)1), page);
+
+        size_t reserved_size = 0;
+        CUresult result = allocator->reserve_virtual_addr((void **)&base_, 2 * capacity_, &reserved_size, device, 0/*stream*/);
+        if (result != CUDA_SUCCESS) {
+            allocator->throw_out_of_memory(2 * capacity_, device, result);
+        }
+
+        block = std::make_shared<ExpandablePhyBlock>(device, capacity_);
+        if (block->status != CUDA_SUCCESS) {
+            result = block->status;
+            block = nullptr;
+            allocator->release_reservation((void *)base_);
+            allocator->throw_out_of_memory(capacity_, device, result);
+        }
+
+        // the same physical memory at [base, base + capacity) and [base + capacity, base + 2 * capacity)
+        if (!block->map_alias(base_, capacity_)) {
+            block = nullptr;
+            allocator->release_reservation((void *)base_);
+            allocator->throw_out_of_memory(capacity_, device, CUDA_ERROR_OUT_OF_MEMORY);
+        }
+        if (!block->map_alias(base_ + capacity_, capacity_)) {
+            block->unmap_alias(base_);
+            block = nullptr;
+            allocator->release_reservation((void *)base_);
+            allocator->throw_out_of_memory(capacity_, device, CUDA_ERROR_OUT_OF_MEMORY);
+        }
+
+        std::cout << "[RingBuffer::RingBuffer] map " << capacity_ << " bytes twice at " << base_ << " on device " << device << std::endl;
+    }
+
+    RingBuffer::~RingBuffer() {
+        ensure_context(device_);
+        block->unmap_alias(base_);
+        block->unmap_alias(base_ + capacity_);
+        block = nullptr;
+        allocator->release_reservation((void *)base_);
+    }
+
+    void* RingBuffer::window(uint64_t offset, size_t size) const {
+        if (size > capacity_) {
+            throw std::invalid_argument("RingBuffer: a window of " + std::to_string(size) + " bytes is larger than the capacity " + std::to_string(capacity_));
+        }
+        return reinterpret_cast<void *>(base_ + offset % capacity_);
+    }
+
+    void* RingBuffer::write_window(size_t size) const {
+        if (size > space()) {
+            return nullptr;
+        }
+        return window(head(), size);
+    }
+
+    void RingBuffer::commit(size_t size) {
+        if (size > space()) {
+            throw std::invalid_argument("RingBuffer: commit " + std::to_string(size) + " bytes, " + std::to_string(space()) + " bytes of space left");
+        }
+        head_.fetch_add(size, std::memory_order_release);
+    }
+
+    void* RingBuffer::read_window(size_t size) const {
+        if (size > this->size()) {
+            return nullptr;
+        }
+        return window(tail(), size);
+    }
+
+    void RingBuffer::consume(size_t size) {
+        if (size > this->size()) {
+            throw std::invalid_argument("RingBuffer: consume " + std::to_string(size) + " bytes, " + std::to_string(this->size()) + " bytes committed");
+        }
+        tail_.fetch_add(size, std::memory_order_release);
+    }
+
+    void RingBuffer::reset() {
+        head_.store(0, std::memory_order_release);
+        tail_.store(0, std::memory_order_release);
+    }
+
+} // namespace nvgpu
@@ -0,0 +1,406 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "allocator/safetensors.h"
+#include "allocator/trace.h"
+
+#define CEIL_DIV(x, n) (((x) + (n) - 1) / (n))
+#define ROUND_UP(x, n) (CEIL_DIV(x, n) * (n))
+
+namespace nvgpu {
+
+    size_t safetensors_dtype_size(const std::string& dtype) {
+        if (dtype == "F64" || dtype == "I64" || dtype == "U64") {
+            return 8;
+        }
+        if (dtype == "F32" || dtype == "I32" || dtype == "U32") {
+            return 4;
+        }
+        if (dtype == "F16" || dtype == "BF16" || dtype == "I16" || dtype == "U16") {
+            return 2;
+        }
+        if (dtype == "I8" || dtype == "U8" || dtype == "BOOL" || dtype == "F8_E4M3" || dtype == "F8_E5M2") {
+            return 1;
+        }
+        return 0;
+    }
+
+    // Just enough JSON for the safetensors header : objects, arrays, strings, integers, and skipping the rest
+    struct JsonReader {
+        const std::string& text;
+        size_t pos = 0;
+
+        explicit JsonReader(const std::string& text) : text(text) {}
+
+        [[noreturn]] void fail(const std::string& what) {
+            throw std::runtime_error("safetensors: malformed header at byte " + std::to_string(pos) + ", " + what);
+        }
+
+        void skip_spaces() {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+                pos++;
+            }
+        }
+
+        char peek() {
+            skip_spaces();
+            if (pos >= text.size()) {
+                fail("unexpected end");
+            }
+            return text[pos];
+        }
+
+        void expect(char c) {
+            if (peek() != c) {
+                fail(std::string("expected '") + c + "'");
+            }
+            pos++;
+        }
+
+        // consumes `c` if it is next
+        bool accept(char c) {
+            if (peek() != c) {
+                return false;
+            }
+            pos++;
+            return true;
+        }
+
+        std::string string() {
+            expect('"');
+            std::string out;
+            while (pos < text.size() && text[pos] != '"') {
+                char c = text[pos++];
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (pos >= text.size()) {
+                    fail("unterminated escape");
+                }
+                c = text[pos++];
+                switch (c) {
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u': {
+                        if (pos + 4 > text.size()) {
+                            fail("truncated \\u escape");
+                        }
+                        unsigned code = (unsigned)std::stoul(text.substr(pos, 4), nullptr, 16);
+                        pos += 4;
+                        // UTF-8 of the basic multilingual plane, surrogate pairs are kept as two code units
+                        if (code < 0x80) {
+                            out += (char)code;
+                        } else if (code < 0x800) {
+                            out += (char)(0xc0 | (code >> 6));
+                            out += (char)(0x80 | (code & 0x3f));
+                        } else {
+                            out += (char)(0xe0 | (code >> 12));
+                            out += (char)(0x80 | ((code >> 6) & 0x3f));
+                            out += (char)(0x80 | (code & 0x3f));
+                        }
+                        break;
+                    }
+                    default: out += c; break;
+                }
+            }
+            if (pos >= text.size()) {
+                fail("unterminated string");
+            }
+            pos++;
+            return out;
+        }
+
+        int64_t integer() {
+            skip_spaces();
+            size_t start = pos;
+            if (pos < text.size() && text[pos] == '-') {
+                pos++;
+            }
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+                pos++;
+            }
+            if (pos == start || (pos == start + 1 && text[start] == '-')) {
+                fail("expected an integer");
+            }
+            return std::stoll(text.substr(start, pos - start));
+        }
+
+        std::vector<int64_t> integers() {
+            std::vector<int64_t> values;
+            expect('[');
+            if (accept(']')) {
+                return values;
+            }
+            do {
+                values.push_back(integer());
+            } while (accept(','));
+            expect(']');
+            return values;
+        }
+
+        void skip_value() {
+            char c = peek();
+            if (c == '"') {
+                string();
+            } else if (c == '{' || c == '[') {
+                char close = c == '{' ? '}' : ']';
+                pos++;
+                if (accept(close)) {
+                    return;
+                }
+                do {
+                    if (close == '}') {
+                        string();
+                        expect(':');
+                    }
+                    skip_value();
+                } while (accept(','));
+                expect(close);
+            } else {
+                // number, true, false, null
+                while (pos < text.size() && std::strchr(",}] \t\r\n", text[pos]) == nullptr) {
+                    pos++;
+                }
+            }
+        }
+    };
+
+    struct MappedFile {
+        void* data = MAP_FAILED;
+        size_t size = 0;
+
+        ~MappedFile() {
+            if (data != MAP_FAILED) {
+                munmap(data, size);
+            }
+        }
+    };
+
+    static void map_file(const std::string& path, MappedFile* file) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("safetensors: cannot open " + path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < 8) {
+            close(fd);
+            throw std::runtime_error("safetensors: " + path + " is truncated");
+        }
+        file->size = (size_t)st.st_size;
+        file->data = mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (file->data == MAP_FAILED) {
+            throw std::runtime_error("safetensors: cannot map " + path);
+        }
+        // read ahead aggressively, pages are read once
+        madvise(file->data, file->size, MADV_SEQUENTIAL);
+    }
+
+    static SafetensorsHeader parse_header(const unsigned char* data, size_t file_size) {
+        uint64_t header_size = 0;
+        for (int i = 7; i >= 0; i--) {
+            header_size = (header_size << 8) | data[i];
+        }
+        if (header_size > file_size - 8) {
+            throw std::runtime_error("safetensors: header of " + std::to_string(header_size) + " bytes past the end of the file");
+        }
+
+        SafetensorsHeader header;
+        header.data_offset = 8 + header_size;
+        size_t data_size = file_size - header.data_offset;
+
+        std::string text(reinterpret_cast<const char *>(data) + 8, header_size);
+        JsonReader json(text);
+        json.expect('{');
+        if (!json.accept('}')) {
+            do {
+                std::string name = json.string();
+                json.expect(':');
+                if (name == "__metadata__") {
+                    json.expect('{');
+                    if (json.accept('}')) {
+                        continue;
+                    }
+                    do {
+                        std::string key = json.string();
+                        json.expect(':');
+                        if (json.peek() == '"') {
+                            header.metadata.push_back({key, json.string()});
+                        } else {
+                            json.skip_value();
+                        }
+                    } while (json.accept(','));
+                    json.expect('}');
+                    continue;
+                }
+
+                SafetensorsTensor tensor;
+                tensor.name = name;
+                std::vector<int64_t> offsets;
+                json.expect('{');
+                if (!json.accept('}')) {
+                    do {
+                        std::string key = json.string();
+                        json.expect(':');
+                        if (key == "dtype") {
+                            tensor.dtype = json.string();
+                        } else if (key == "shape") {
+                            tensor.shape = json.integers();
+                        } else if (key == "data_offsets") {
+                            offsets = json.integers();
+                        } else {
+                            json.skip_value();
+                        }
+                    } while (json.accept(','));
+                    json.expect('}');
+                }
+
+                size_t element_size = safetensors_dtype_size(tensor.dtype);
+                if (element_size == 0) {
+                    throw std::runtime_error("safetensors: tensor " + name + " has the unsupported dtype '" + tensor.dtype + "'");
+                }
+                if (offsets.size() != 2 || offsets[0] < 0 || offsets[1] < offsets[0] || (size_t)offsets[1] > data_size) {
+                    throw std::runtime_error("safetensors: tensor " + name + " has invalid data offsets");
+                }
+                size_t numel = 1;
+                for (int64_t dim : tensor.shape) {
+                    if (dim < 0) {
+                        throw std::runtime_error("safetensors: tensor " + name + " has a negative dimension");
+                    }
+                    numel *= (size_t)dim;
+                }
+                tensor.file_offset = (size_t)offsets[0];
+                tensor.size = (size_t)(offsets[1] - offsets[0]);
+                if (tensor.size != numel * element_size) {
+                    throw std::runtime_error("safetensors: tensor " + name + " holds " + std::to_string(tensor.size) + " bytes, its shape needs " + std::to_string(numel * element_size));
+                }
+                header.tensors.push_back(tensor);
+            } while (json.accept(','));
+            json.expect('}');
+        }
+
+        // the order of the data section, the file is read sequentially
+        std::stable_sort(header.tensors.begin(), header.tensors.end(), [](const SafetensorsTensor& a, const SafetensorsTensor& b) {
+            return a.file_offset < b.file_offset;
+        });
+        return header;
+    }
+
+    SafetensorsHeader read_safetensors_header(const std::string& path) {
+        MappedFile file;
+        map_file(path, &file);
+        return parse_header(static_cast<const unsigned char *>(file.data), file.size);
+    }
+
+    LoadedSafetensors load_safetensors(const std::string& path, CheckpointBackend* backend, int device, const SafetensorsOptions& options) {
+        VT_TRACE_SCOPE("load_safetensors", 0);
+        if (options.chunk_size == 0 || options.alignment == 0) {
+            throw std::runtime_error("load_safetensors: chunk_size and alignment must be positive");
+        }
+
+        MappedFile file;
+        map_file(path, &file);
+        const unsigned char* data = static_cast<const unsigned char *>(file.data);
+        SafetensorsHeader header = parse_header(data, file.size);
+
+        LoadedSafetensors loaded;
+        loaded.metadata = header.metadata;
+        loaded.tensors = header.tensors;
+
+        // one allocation for the whole file, every tensor aligned
+        std::vector<size_t> offsets;
+        size_t total = 0;
+        for (auto& tensor : loaded.tensors) {
+            offsets.push_back(ROUND_UP(total, options.alignment));
+            total = offsets.back() + tensor.size;
+        }
+        loaded.segment.size = std::max<size_t>(total, 1);
+        loaded.segment.device = device;
+        loaded.segment.ptr = backend->alloc(loaded.segment.size, device);
+        if (loaded.segment.ptr == nullptr) {
+            throw std::runtime_error("load_safetensors: failed to allocate " + std::to_string(loaded.segment.size) + " bytes on device " + std::to_string(device));
+        }
+        for (size_t i = 0; i < loaded.tensors.size(); i++) {
+            loaded.tensors[i].ptr = static_cast<char *>(loaded.segment.ptr) + offsets[i];
+        }
+
+        // the file thread copies the mapped chunks to the staging buffers (the page faults are the disk reads), the
+        // calling thread copies the filled buffers to the device
+        StagingQueue queue(backend, options.chunk_size, options.num_buffers);
+        size_t bytes_read = 0;
+        std::thread file_thread([&] {
+            const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            // pages before `dropped` were read and left the mapping
+            size_t dropped = 0;
+            for (size_t i = 0; i < loaded.tensors.size(); i++) {
+                const SafetensorsTensor& tensor = loaded.tensors[i];
+                for (size_t offset = 0; offset < tensor.size; offset += options.chunk_size) {
+                    size_t length = std::min(options.chunk_size, tensor.size - offset);
+                    int buffer = queue.acquire();
+                    if (buffer < 0) {
+                        return;
+                    }
+                    size_t position = header.data_offset + tensor.file_offset + offset;
+                    std::memcpy(queue.data(buffer), data + position, length);
+                    bytes_read += length;
+                    queue.push(StagingQueue::Item{buffer, CheckpointChunkRecord{(uint32_t)i, 0, offset, length}});
+
+                    size_t end = (position + length) / page * page;
+                    if (end > dropped) {
+                        madvise(const_cast<unsigned char *>(data) + dropped, end - dropped, MADV_DONTNEED);
+                        dropped = end;
+                    }
+                }
+            }
+            queue.close();
+        });
+
+        try {
+            StagingQueue::Item item;
+            while (queue.pop(&item)) {
+                const SafetensorsTensor& tensor = loaded.tensors[item.record.region];
+                backend->copy_to_device(static_cast<char *>(tensor.ptr) + item.record.offset, queue.data(item.buffer), item.record.length, device);
+                queue.release(item.buffer);
+            }
+        } catch (const std::exception& e) {
+            queue.close(e.what());
+        }
+        file_thread.join();
+        if (!queue.error.empty()) {
+            backend->free(loaded.segment.ptr, loaded.segment.size, device);
+            throw std::runtime_error("load_safetensors: " + queue.error);
+        }
+
+        loaded.bytes_read = bytes_read;
+        std::cout << "[load_safetensors] loaded " << loaded.tensors.size() << " tensors, " << bytes_read << " bytes from " << path << " to device " << device << std::endl;
+        return loaded;
+    }
+
+} // namespace nvgpu
@@ -0,0 +1,96 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "allocator/shm_stats.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+namespace nvgpu {
+
+    namespace shm_detail {
+    std::atomic<ShmStatsSegment*> segment{nullptr};
+
+    static std::mutex open_mtx;
+    static std::string segment_name;
+
+    static void unlink_segment() {
+        // the mapping stays valid until the process exits, only the name goes away
+        if (!segment_name.empty()) {
+            shm_unlink(segment_name.c_str());
+        }
+    }
+    } // namespace shm_detail
+
+    bool open_shm_stats(const std::string& name) {
+        std::string shm_name = name.empty() ? default_shm_stats_name(getpid()) : name;
+        if (shm_name[0] != '/') {
+            shm_name = "/" + shm_name;
+        }
+
+        std::lock_guard<std::mutex> lock(shm_detail::open_mtx);
+        if (shm_detail::segment.load(std::memory_order_acquire) != nullptr) {
+            return shm_detail::segment_name == shm_name;
+        }
+
+        int fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            std::cout << "[open_shm_stats] failed to open shared memory segment " << shm_name << " : " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        // a segment left by a previous process with the same pid is reset
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, sizeof(ShmStatsSegment)) != 0) {
+            std::cout << "[open_shm_stats] failed to size shared memory segment " << shm_name << " : " << std::strerror(errno) << std::endl;
+            close(fd);
+            shm_unlink(shm_name.c_str());
+            return false;
+        }
+        void* ptr = mmap(nullptr, sizeof(ShmStatsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED) {
+            std::cout << "[open_shm_stats] failed to map shared memory segment " << shm_name << " : " << std::strerror(errno) << std::endl;
+            shm_unlink(shm_name.c_str());
+            return false;
+        }
+
+        // the segment is zero filled : the counters start at 0, the magic goes last so that readers skip a
+        // segment being initialized
+        ShmStatsSegment* segment = static_cast<ShmStatsSegment*>(ptr);
+        segment->version = kShmStatsVersion;
+        segment->size = sizeof(ShmStatsSegment);
+        segment->max_devices = kShmStatsMaxDevices;
+        segment->num_driver_calls = (uint32_t)DriverCall::N;
+        segment->pid = (int64_t)getpid();
+        segment->start_time_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(segment->magic, kShmStatsMagic, sizeof(kShmStatsMagic));
+
+        shm_detail::segment_name = shm_name;
+        std::atexit(shm_detail::unlink_segment);
+        shm_detail::segment.store(segment, std::memory_order_release);
+
+        std::cout << "[open_shm_stats] publishing allocator counters to " << shm_name << std::endl;
+        return true;
+    }
+
+} // namespace nvgpu
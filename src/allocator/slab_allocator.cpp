@@ -0,0 +1,281 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <iostream>
+
+#include "cu_util.h"
+
+#include "allocator/slab_allocator.h"
+#include "allocator/trace.h"
+#include "allocator/vmm_allocator.h"
+
+namespace nvgpu {
+
+    size_t SlabAllocator::granularity(int device) {
+        auto it = granularities.find(device);
+        if (it != granularities.end()) {
+            return it->second;
+        }
+
+        CUmemAllocationProp prop = {};
+        prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+        prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+        prop.location.id = device;
+
+        size_t granularity = 0;
+        if (cuMemGetAllocationGranularity(&granularity, &prop, CU_MEM_ALLOC_GRANULARITY_MINIMUM) != CUDA_SUCCESS) {
+            granularity = 0;
+        }
+        granularities[device] = granularity;
+        return granularity;
+    }
+
+    size_t SlabAllocator::max_size(int device) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return granularity(device) / 2;
+    }
+
+    int SlabAllocator::size_class(size_t size) const {
+        int cls = 0;
+        size_t slot_size = kMinSlotSize;
+        while (slot_size < size) {
+            slot_size <<= 1;
+            cls++;
+        }
+        return cls;
+    }
+
+    bool SlabAllocator::owns(void* ptr) {
+        std::lock_guard<std::mutex> lock(mtx);
+        uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+        auto it = chunks.upper_bound(addr);
+        if (it == chunks.begin()) {
+            return false;
+        }
+        --it;
+        return addr < it->first + it->second->chunk_size;
+    }
+
+    size_t SlabAllocator::slot_size(void* ptr) {
+        std::lock_guard<std::mutex> lock(mtx);
+        uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+        auto it = chunks.upper_bound(addr);
+        if (it == chunks.begin()) {
+            return 0;
+        }
+        --it;
+        return addr < it->first + it->second->chunk_size ? it->second->slot_size : 0;
+    }
+
+    void* SlabAllocator::alloc(size_t size, int device) {
+        VT_TRACE_SCOPE("SlabAllocator::alloc", size);
+        std::lock_guard<std::mutex> lock(mtx);
+
+        size_t chunk_size = granularity(device);
+        if (chunk_size == 0 || size > chunk_size / 2) {
+            return nullptr;
+        }
+
+        int cls = size_class(size);
+        auto& device_classes = classes[device];
+        if ((int)device_classes.size() <= cls) {
+            size_t n = device_classes.size();
+            device_classes.resize(cls + 1);
+            for (size_t i = n; i < device_classes.size(); i++) {
+                device_classes[i].slot_size = kMinSlotSize << i;
+            }
+        }
+
+        SizeClass& size_class = device_classes[cls];
+        Chunk* chunk = size_class.partial.empty() ? new_chunk(device, cls) : size_class.partial.back();
+        if (chunk == nullptr) {
+            return nullptr;
+        }
+
+        void* ptr = take_slot(chunk);
+        if (chunk->num_free == 0) {
+            remove_partial(chunk);
+        }
+
+        requested[reinterpret_cast<uintptr_t>(ptr)] = size;
+        counters.allocated_bytes += chunk->slot_size;
+        counters.requested_bytes += size;
+        counters.num_allocs++;
+        return ptr;
+    }
+
+    bool SlabAllocator::dealloc(void* ptr) {
+        VT_TRACE_SCOPE("SlabAllocator::dealloc", 0);
+        std::lock_guard<std::mutex> lock(mtx);
+
+        uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+        auto it = chunks.upper_bound(addr);
+        if (it == chunks.begin()) {
+            return false;
+        }
+        --it;
+        Chunk* chunk = it->second.get();
+        if (addr >= chunk->base + chunk->chunk_size) {
+            return false;
+        }
+
+        size_t slot = (addr - chunk->base) / chunk->slot_size;
+        uint64_t bit = 1ULL << (slot % 64);
+        if (chunk->free_bitmap[slot / 64] & bit) {
+            std::cout << "[SlabAllocator::dealloc] double free of address " << addr << " in chunk " << chunk->base << std::endl;
+            return true;
+        }
+        chunk->free_bitmap[slot / 64] |= bit;
+        chunk->num_free++;
+        if (slot / 64 < chunk->hint) {
+            chunk->hint = slot / 64;
+        }
+
+        auto req = requested.find(addr);
+        if (req != requested.end()) {
+            counters.requested_bytes -= req->second;
+            requested.erase(req);
+        }
+        counters.allocated_bytes -= chunk->slot_size;
+        counters.num_allocs--;
+
+        if (chunk->partial_index < 0) {
+            add_partial(chunk);
+        }
+
+        // keep a single empty chunk per class to absorb alloc/free ping-pong, release the others
+        if (chunk->num_free == chunk->num_slots) {
+            SizeClass& size_class = classes[chunk->device_id][chunk->size_class];
+            if (size_class.partial.size() > 1) {
+                remove_partial(chunk);
+                release_chunk(chunk);
+            }
+        }
+        return true;
+    }
+
+    size_t SlabAllocator::release_empty_chunks() {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        std::vector<Chunk*> empty;
+        for (auto& it : chunks) {
+            if (it.second->num_free == it.second->num_slots) {
+                empty.push_back(it.second.get());
+            }
+        }
+
+        size_t released = 0;
+        for (Chunk* chunk : empty) {
+            released += chunk->chunk_size;
+            remove_partial(chunk);
+            release_chunk(chunk);
+        }
+        return released;
+    }
+
+    SlabAllocator::Stats SlabAllocator::stats() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return counters;
+    }
+
+    SlabAllocator::Chunk* SlabAllocator::new_chunk(int device, int cls) {
+        size_t chunk_size = granularity(device);
+
+        CUdeviceptr base;
+        size_t reserved_size = 0;
+        if (allocator->reserve_virtual_addr((void **)&base, chunk_size, &reserved_size, device, 0/*stream*/) != CUDA_SUCCESS) {
+            return nullptr;
+        }
+
+        auto block = std::make_shared<ExpandablePhyBlock>(device, reserved_size);
+        if (block->status != CUDA_SUCCESS) {
+            WARN(0, "[SlabAllocator::new_chunk] failed to create a physical block of %zu bytes", reserved_size);
+            allocator->release_reservation((void *)base);
+            return nullptr;
+        }
+        if (!allocator->map_virtual_address(block.get(), (void *)base, reserved_size)) {
+            allocator->release_reservation((void *)base);
+            return nullptr;
+        }
+
+        std::unique_ptr<Chunk> chunk(new Chunk());
+        chunk->base = base;
+        chunk->chunk_size = reserved_size;
+        chunk->slot_size = kMinSlotSize << cls;
+        chunk->device_id = device;
+        chunk->size_class = cls;
+        chunk->num_slots = reserved_size / chunk->slot_size;
+        chunk->num_free = chunk->num_slots;
+        chunk->free_bitmap.assign((chunk->num_slots + 63) / 64, ~0ULL);
+        if (chunk->num_slots % 64) {
+            chunk->free_bitmap.back() = (1ULL << (chunk->num_slots % 64)) - 1;
+        }
+        chunk->block = block;
+
+        Chunk* raw = chunk.get();
+        chunks.insert({raw->base, std::move(chunk)});
+        add_partial(raw);
+
+        counters.chunks++;
+        counters.mapped_bytes += reserved_size;
+
+        std::cout << "[SlabAllocator::new_chunk] map chunk " << raw->base << " of " << raw->num_slots << " slots of " << raw->slot_size << " bytes in block#" << block->block_id << std::endl;
+        return raw;
+    }
+
+    void SlabAllocator::release_chunk(Chunk* chunk) {
+        std::cout << "[SlabAllocator::release_chunk] unmap chunk " << chunk->base << " of " << chunk->slot_size << " bytes slots" << std::endl;
+
+        // unmapping also frees the virtual address
+        allocator->unmap_virtual_address(chunk->block.get(), (void *)chunk->base, chunk->chunk_size);
+
+        counters.chunks--;
+        counters.mapped_bytes -= chunk->chunk_size;
+        chunks.erase(chunk->base);
+    }
+
+    void* SlabAllocator::take_slot(Chunk* chunk) {
+        for (size_t w = chunk->hint; w < chunk->free_bitmap.size(); w++) {
+            uint64_t word = chunk->free_bitmap[w];
+            if (word != 0) {
+                int bit = __builtin_ctzll(word);
+                chunk->free_bitmap[w] &= ~(1ULL << bit);
+                chunk->num_free--;
+                chunk->hint = w;
+                return reinterpret_cast<void *>(chunk->base + (w * 64 + bit) * chunk->slot_size);
+            }
+        }
+        return nullptr;
+    }
+
+    void SlabAllocator::add_partial(Chunk* chunk) {
+        auto& partial = classes[chunk->device_id][chunk->size_class].partial;
+        chunk->partial_index = (long)partial.size();
+        partial.push_back(chunk);
+    }
+
+    void SlabAllocator::remove_partial(Chunk* chunk) {
+        if (chunk->partial_index < 0) {
+            return;
+        }
+        auto& partial = classes[chunk->device_id][chunk->size_class].partial;
+        Chunk* last = partial.back();
+        partial[chunk->partial_index] = last;
+        last->partial_index = chunk->partial_index;
+        partial.pop_back();
+        chunk->partial_index = -1;
+    }
+
+} // namespace nvgpu
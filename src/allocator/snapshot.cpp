@@ -0,0 +1,204 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <execinfo.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "allocator/snapshot.h"
+
+namespace nvgpu {
+
+    static const int kMaxStackDepth = 32;
+
+    std::vector<void*> capture_stack(int skip) {
+        void* frames[kMaxStackDepth];
+        int depth = backtrace(frames, kMaxStackDepth);
+        std::vector<void*> stack;
+        for (int i = skip + 1; i < depth; i++) {
+            stack.push_back(frames[i]);
+        }
+        return stack;
+    }
+
+    std::vector<std::string> symbolize_stack(const std::vector<void*>& stack) {
+        std::vector<std::string> frames;
+        if (stack.empty()) {
+            return frames;
+        }
+        char** symbols = backtrace_symbols(stack.data(), (int)stack.size());
+        if (symbols == nullptr) {
+            return frames;
+        }
+        for (size_t i = 0; i < stack.size(); i++) {
+            frames.emplace_back(symbols[i]);
+        }
+        free(symbols);
+        return frames;
+    }
+
+    static std::string escape(const std::string& s) {
+        std::string out;
+        out.reserve(s.size());
+        for (char c : s) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if ((unsigned char)c < 0x20) {
+                        char buf[8];
+                        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                        out += buf;
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        return out;
+    }
+
+    static void write_frames(std::ostringstream& os, const std::vector<std::string>& frames) {
+        os << "[";
+        for (size_t i = 0; i < frames.size(); i++) {
+            os << (i ? ", " : "") << "{\"filename\": \"??\", \"line\": 0, \"name\": \"" << escape(frames[i]) << "\"}";
+        }
+        os << "]";
+    }
+
+    static void write_block(std::ostringstream& os, uintptr_t address, size_t size, bool active,
+                            const std::vector<std::string>& frames) {
+        os << "{\"address\": " << address << ", \"size\": " << size
+           << ", \"requested_size\": " << (active ? size : 0)
+           << ", \"state\": \"" << (active ? "active_allocated" : "inactive") << "\", \"frames\": ";
+        write_frames(os, frames);
+        os << "}";
+    }
+
+    std::string AllocatorSnapshot::to_json() const {
+        std::ostringstream os;
+
+        // segments : VA reservations tiled with the mappings they contain
+        std::vector<MappingSnapshot> sorted_mappings = mappings;
+        std::sort(sorted_mappings.begin(), sorted_mappings.end(),
+                  [](const MappingSnapshot& a, const MappingSnapshot& b) { return a.address < b.address; });
+
+        std::vector<ReservationSnapshot> segments = reservations;
+        // mappings created outside of reserve_virtual_addr become their own segment
+        for (auto& m : sorted_mappings) {
+            bool covered = false;
+            for (auto& r : reservations) {
+                if (m.address >= r.address && m.address < r.address + r.size) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (!covered) {
+                segments.push_back({m.address, m.size, m.device_id});
+            }
+        }
+        std::sort(segments.begin(), segments.end(),
+                  [](const ReservationSnapshot& a, const ReservationSnapshot& b) { return a.address < b.address; });
+
+        std::set<int> devices;
+        os << "{\"segments\": [";
+        size_t m_idx = 0;
+        for (size_t s = 0; s < segments.size(); s++) {
+            const ReservationSnapshot& seg = segments[s];
+            devices.insert(seg.device_id);
+
+            while (m_idx < sorted_mappings.size() && sorted_mappings[m_idx].address < seg.address) {
+                m_idx++;
+            }
+
+            std::ostringstream blocks_os;
+            size_t allocated = 0;
+            uintptr_t cursor = seg.address;
+            bool first = true;
+            while (m_idx < sorted_mappings.size() && sorted_mappings[m_idx].address < seg.address + seg.size) {
+                const MappingSnapshot& m = sorted_mappings[m_idx++];
+                if (m.address > cursor) {
+                    blocks_os << (first ? "" : ", ");
+                    write_block(blocks_os, cursor, m.address - cursor, false, {});
+                    first = false;
+                }
+                size_t size = std::min<size_t>(m.size, seg.address + seg.size - m.address);
+                blocks_os << (first ? "" : ", ");
+                write_block(blocks_os, m.address, size, true, m.frames);
+                first = false;
+                allocated += size;
+                cursor = std::max<uintptr_t>(cursor, m.address + size);
+            }
+            if (cursor < seg.address + seg.size) {
+                blocks_os << (first ? "" : ", ");
+                write_block(blocks_os, cursor, seg.address + seg.size - cursor, false, {});
+            }
+
+            os << (s ? ", " : "")
+               << "{\"device\": " << seg.device_id << ", \"address\": " << seg.address
+               << ", \"total_size\": " << seg.size << ", \"allocated_size\": " << allocated
+               << ", \"active_size\": " << allocated << ", \"requested_size\": " << allocated
+               << ", \"stream\": 0, \"segment_type\": \"large\", \"segment_pool_id\": [0, 0]"
+               << ", \"is_expandable\": true, \"frames\": [], \"blocks\": [" << blocks_os.str() << "]}";
+        }
+        os << "], ";
+
+        int max_device = devices.empty() ? 0 : *devices.rbegin();
+        os << "\"device_traces\": [";
+        for (int d = 0; d <= max_device; d++) {
+            os << (d ? ", " : "") << "[]";
+        }
+        os << "], ";
+
+        // physical view
+        os << "\"vtensor\": {\"placement_policy\": \"" << escape(placement_policy) << "\", \"blocks\": [";
+        for (size_t b = 0; b < blocks.size(); b++) {
+            const PhyBlockSnapshot& block = blocks[b];
+            os << (b ? ", " : "")
+               << "{\"block_id\": " << block.block_id << ", \"device\": " << block.device_id
+               << ", \"block_size\": " << block.block_size << ", \"remaining_size\": " << block.remaining_size
+               << ", \"pool\": \"" << block.pool << "\", \"open\": " << (block.open ? "true" : "false")
+               << ", \"lifetime\": \"" << block.lifetime << "\", \"tier\": \"" << block.tier << "\""
+               << ", \"mappings\": [";
+            for (size_t i = 0; i < block.mappings.size(); i++) {
+                os << (i ? ", " : "") << "{\"address\": " << block.mappings[i].address
+                   << ", \"size\": " << block.mappings[i].size << "}";
+            }
+            os << "]}";
+        }
+        os << "], \"reservations\": [";
+        for (size_t r = 0; r < reservations.size(); r++) {
+            os << (r ? ", " : "") << "{\"address\": " << reservations[r].address
+               << ", \"size\": " << reservations[r].size << ", \"device\": " << reservations[r].device_id << "}";
+        }
+        os << "], \"allocated_blocks\": [";
+        for (size_t i = 0; i < mappings.size(); i++) {
+            os << (i ? ", " : "") << "{\"address\": " << mappings[i].address << ", \"size\": " << mappings[i].size
+               << ", \"block_id\": " << mappings[i].block_id << ", \"frames\": ";
+            write_frames(os, mappings[i].frames);
+            os << "}";
+        }
+        os << "]}}";
+
+        return os.str();
+    }
+
+} // namespace nvgpu
@@ -0,0 +1,176 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "cu_util.h"
+
+#include "allocator/sparse_range.h"
+#include "allocator/trace.h"
+#include "allocator/vmm_allocator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#define CEIL_DIV(x, n) (((x) + (n) - 1) / (n))
+#define ROUND_UP(x, n) (CEIL_DIV(x, n) * (n))
+
+namespace nvgpu {
+
+    SparseRange::SparseRange(VmmAllocator* allocator, size_t size, size_t block_size, int device) : allocator(allocator), device_(device) {
+        VT_TRACE_SCOPE("SparseRange::SparseRange", size);
+        ensure_context(device);
+
+        page = allocator->granularity(device);
+        if (page == 0) {
+            throw std::invalid_argument("SparseRange: cannot query the granularity of device " + std::to_string(device));
+        }
+        block_size_ = ROUND_UP(std::max(block_size, (size_t)1), page);
+        num_blocks_ = std::max(CEIL_DIV(size, block_size_), (size_t)1);
+
+        size_t reserved_size = 0;
+        CUresult result = allocator->reserve_virtual_addr((void **)&base_, this->size(), &reserved_size, device, 0/*stream*/);
+        if (result != CUDA_SUCCESS) {
+            allocator->throw_out_of_memory(this->size(), device, result);
+        }
+
+        try {
+            zero_page = allocator->zero_page(device);
+        } catch (...) {
+            allocator->release_reservation((void *)base_);
+            throw;
+        }
+
+        blocks.resize(num_blocks_);
+        for (size_t i = 0; i < num_blocks_; i++) {
+            if (!map_zero_page(i)) {
+                for (size_t j = 0; j < i; j++) {
+                    unmap_zero_page(j);
+                }
+                zero_page = nullptr;
+                allocator->release_reservation((void *)base_);
+                allocator->throw_out_of_memory(page, device, CUDA_ERROR_OUT_OF_MEMORY);
+            }
+        }
+
+        std::cout << "[SparseRange::SparseRange] reserve " << num_blocks_ << " blocks of " << block_size_ << " bytes at " << base_
+                  << " on device " << device << ", all mapped to the zero page" << std::endl;
+    }
+
+    SparseRange::~SparseRange() {
+        ensure_context(device_);
+        for (size_t i = 0; i < num_blocks_; i++) {
+            if (blocks[i] != nullptr) {
+                blocks[i]->unmap_alias(block_address(i));
+            } else {
+                unmap_zero_page(i);
+            }
+        }
+        blocks.clear();
+        zero_page = nullptr;
+        allocator->release_reservation((void *)base_);
+    }
+
+    bool SparseRange::populated(size_t index) const {
+        check_index(index);
+        std::lock_guard<std::mutex> lock(mtx);
+        return blocks[index] != nullptr;
+    }
+
+    size_t SparseRange::num_populated() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return num_populated_;
+    }
+
+    void SparseRange::materialize(size_t index, bool zero) {
+        VT_TRACE_SCOPE("SparseRange::materialize", block_size_);
+        check_index(index);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (blocks[index] != nullptr) {
+            return;
+        }
+        ensure_context(device_);
+
+        auto block = std::make_shared<ExpandablePhyBlock>(device_, block_size_);
+        if (block->status != CUDA_SUCCESS) {
+            allocator->empty_cache();
+            block = std::make_shared<ExpandablePhyBlock>(device_, block_size_);
+        }
+        if (block->status != CUDA_SUCCESS) {
+            allocator->throw_out_of_memory(block_size_, device_, block->status);
+        }
+
+        CUdeviceptr addr = block_address(index);
+        unmap_zero_page(index);
+        if (!block->map_alias(addr, block_size_)) {
+            map_zero_page(index);
+            allocator->throw_out_of_memory(block_size_, device_, CUDA_ERROR_OUT_OF_MEMORY);
+        }
+        if (zero) {
+            DRV_TRY(cuMemsetD8(addr, 0, block_size_));
+        }
+        blocks[index] = block;
+        num_populated_++;
+    }
+
+    void SparseRange::release(size_t index) {
+        VT_TRACE_SCOPE("SparseRange::release", block_size_);
+        check_index(index);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (blocks[index] == nullptr) {
+            return;
+        }
+        ensure_context(device_);
+
+        blocks[index]->unmap_alias(block_address(index));
+        blocks[index] = nullptr;
+        num_populated_--;
+        if (!map_zero_page(index)) {
+            // the block stays unmapped, reading it faults
+            std::cout << "[SparseRange::release] cannot map the zero page at " << block_address(index) << std::endl;
+            allocator->throw_out_of_memory(block_size_, device_, CUDA_ERROR_OUT_OF_MEMORY);
+        }
+    }
+
+    void SparseRange::check_index(size_t index) const {
+        if (index >= num_blocks_) {
+            throw std::out_of_range("SparseRange: block " + std::to_string(index) + " out of " + std::to_string(num_blocks_));
+        }
+    }
+
+    // one read-only alias of the zero page per page of the block
+    bool SparseRange::map_zero_page(size_t index) {
+        std::lock_guard<std::mutex> lock(allocator->zero_mtx);
+        CUdeviceptr addr = block_address(index);
+        for (size_t offset = 0; offset < block_size_; offset += page) {
+            if (!zero_page->map_alias(addr + offset, page, CU_MEM_ACCESS_FLAGS_PROT_READ)) {
+                for (size_t mapped = 0; mapped < offset; mapped += page) {
+                    zero_page->unmap_alias(addr + mapped);
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void SparseRange::unmap_zero_page(size_t index) {
+        std::lock_guard<std::mutex> lock(allocator->zero_mtx);
+        CUdeviceptr addr = block_address(index);
+        for (size_t offset = 0; offset < block_size_; offset += page) {
+            zero_page->unmap_alias(addr + offset);
+        }
+    }
+
+} // namespace nvgpu
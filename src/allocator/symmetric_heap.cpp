@@ -0,0 +1,290 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "cu_util.h"
+
+#include "allocator/allocator.h"
+#include "allocator/shm_stats.h"
+#include "allocator/symmetric_heap.h"
+#include "allocator/trace.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#define CEIL_DIV(x, n) (((x) + (n) - 1) / (n))
+#define ROUND_UP(x, n) (CEIL_DIV(x, n) * (n))
+
+namespace nvgpu {
+
+    namespace symmetric_detail {
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ranks share the control block through a file mapping");
+
+    // one slot per rank. A round r has two phases : the rank publishes its candidate address and sets `phase` to
+    // 2r + 1, then whether it reserved the agreed base and sets `phase` to 2r + 2. A rank only overwrites its slot
+    // once every rank reached the previous phase, i.e. read it.
+    struct Slot {
+        std::atomic<uint64_t> phase;
+        std::atomic<uint64_t> address;
+        std::atomic<uint64_t> size;
+        std::atomic<uint64_t> ok;
+    };
+
+    struct Control {
+        // ranks done with the file, the last one removes it
+        std::atomic<uint64_t> departed;
+        Slot slots[SymmetricHeap::kMaxRanks];
+    };
+
+    static const int kMaxRounds = 16;
+
+    // true once every rank reached `phase`
+    static bool wait_phase(Control* control, int world_size, uint64_t phase, std::chrono::steady_clock::time_point deadline) {
+        for (int r = 0; r < world_size; r++) {
+            while (control->slots[r].phase.load(std::memory_order_acquire) < phase) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        return true;
+    }
+
+    static CUresult reserve_at(CUdeviceptr* ptr, size_t size, size_t alignment, CUdeviceptr hint) {
+        return DRV_TRY(DRV_TIMED(ADDRESS_RESERVE, size, cuMemAddressReserve(ptr, size, alignment, hint, 0ULL)));
+    }
+
+    static void free_at(CUdeviceptr ptr, size_t size) {
+        DRV_TRY(DRV_TIMED(ADDRESS_FREE, size, cuMemAddressFree(ptr, size)));
+    }
+
+    } // namespace symmetric_detail
+
+    SymmetricHeap::SymmetricHeap(const std::string& path, int rank, int world_size, size_t size, int device, int timeout_ms)
+            : rank_(rank), world_size_(world_size), device_(device) {
+        using namespace symmetric_detail;
+        VT_TRACE_SCOPE("SymmetricHeap::SymmetricHeap", size);
+        if (world_size < 1 || world_size > kMaxRanks || rank < 0 || rank >= world_size) {
+            throw std::invalid_argument("SymmetricHeap: rank " + std::to_string(rank) + " of " + std::to_string(world_size) +
+                                        ", at most " + std::to_string(kMaxRanks) + " ranks");
+        }
+        ensure_context(device);
+
+        CUmemAllocationProp prop = {};
+        prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+        prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+        prop.location.id = device;
+        if (DRV_TRY(cuMemGetAllocationGranularity(&page, &prop, CU_MEM_ALLOC_GRANULARITY_MINIMUM)) != CUDA_SUCCESS || page == 0) {
+            throw std::invalid_argument("SymmetricHeap: cannot query the granularity of device " + std::to_string(device));
+        }
+        size_ = ROUND_UP(std::max(size, (size_t)1), page);
+
+        // every rank creates the file, sizing it is idempotent and leaves it zero filled
+        int fd = open(path.c_str(), O_CREAT | O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("SymmetricHeap: cannot open " + path + " : " + std::strerror(errno));
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || ((size_t)st.st_size < sizeof(Control) && ftruncate(fd, sizeof(Control)) != 0)) {
+            close(fd);
+            throw std::runtime_error("SymmetricHeap: cannot size " + path + " : " + std::strerror(errno));
+        }
+        void* mapped = mmap(nullptr, sizeof(Control), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("SymmetricHeap: cannot map " + path + " : " + std::strerror(errno));
+        }
+        Control* control = static_cast<Control*>(mapped);
+        Slot& slot = control->slots[rank];
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        std::string error;
+        bool size_mismatch = false;
+        CUdeviceptr hint = 0;
+        for (int round = 0; round < kMaxRounds && error.empty() && base_ == 0; round++) {
+            rounds_ = round + 1;
+
+            // 1. candidate : anywhere on the first round, above the address which failed afterwards
+            CUdeviceptr candidate = 0;
+            if (reserve_at(&candidate, size_, page, hint) != CUDA_SUCCESS) {
+                candidate = 0;
+            }
+            slot.address.store(candidate, std::memory_order_relaxed);
+            slot.size.store(size_, std::memory_order_relaxed);
+            slot.phase.store(2 * round + 1, std::memory_order_release);
+            if (!wait_phase(control, world_size, 2 * round + 1, deadline)) {
+                error = "timed out waiting for the candidates of round " + std::to_string(round);
+                if (candidate != 0) {
+                    free_at(candidate, size_);
+                }
+                break;
+            }
+
+            CUdeviceptr agreed = 0;
+            bool sizes_match = true;
+            for (int r = 0; r < world_size; r++) {
+                agreed = std::max<CUdeviceptr>(agreed, control->slots[r].address.load(std::memory_order_relaxed));
+                sizes_match &= control->slots[r].size.load(std::memory_order_relaxed) == size_;
+            }
+
+            // 2. everyone tries the highest candidate
+            CUdeviceptr got = candidate;
+            if (sizes_match && agreed != 0 && candidate != agreed) {
+                if (candidate != 0) {
+                    free_at(candidate, size_);
+                }
+                if (reserve_at(&got, size_, page, agreed) != CUDA_SUCCESS) {
+                    got = 0;
+                }
+            }
+            bool ok = sizes_match && agreed != 0 && got == agreed;
+            slot.ok.store(ok ? 1 : 0, std::memory_order_relaxed);
+            slot.phase.store(2 * round + 2, std::memory_order_release);
+            if (!wait_phase(control, world_size, 2 * round + 2, deadline)) {
+                error = "timed out waiting for the outcome of round " + std::to_string(round);
+                if (got != 0) {
+                    free_at(got, size_);
+                }
+                break;
+            }
+
+            bool all_ok = true;
+            for (int r = 0; r < world_size; r++) {
+                all_ok &= control->slots[r].ok.load(std::memory_order_relaxed) == 1;
+            }
+            if (all_ok) {
+                base_ = agreed;
+            } else {
+                if (got != 0) {
+                    free_at(got, size_);
+                }
+                if (!sizes_match) {
+                    size_mismatch = true;
+                    error = "the ranks reserve heaps of different sizes";
+                }
+                hint = agreed + size_;
+            }
+        }
+
+        if (control->departed.fetch_add(1, std::memory_order_acq_rel) + 1 == (uint64_t)world_size) {
+            unlink(path.c_str());
+        }
+        munmap(mapped, sizeof(Control));
+
+        if (base_ == 0) {
+            if (error.empty()) {
+                error = "no common base after " + std::to_string(rounds_) + " rounds";
+            }
+            std::cout << "[SymmetricHeap::SymmetricHeap] rank " << rank << " : " << error << std::endl;
+            if (size_mismatch) {
+                throw std::invalid_argument("SymmetricHeap: " + error);
+            }
+            throw std::runtime_error("SymmetricHeap: " + error);
+        }
+        shm_add(device, &ShmDeviceStats::reserved_bytes, size_);
+        free_ranges[0] = size_;
+
+        std::cout << "[SymmetricHeap::SymmetricHeap] rank " << rank << " of " << world_size << " reserved " << size_ << " bytes at "
+                  << base_ << " on device " << device << " after " << rounds_ << " rounds" << std::endl;
+    }
+
+    SymmetricHeap::~SymmetricHeap() {
+        if (base_ != 0) {
+            ensure_context(device_);
+            symmetric_detail::free_at(base_, size_);
+            shm_add(device_, &ShmDeviceStats::reserved_bytes, -(int64_t)size_);
+        }
+    }
+
+    void* SymmetricHeap::reserve(size_t size, size_t* reserved_size) {
+        size_t rounded = ROUND_UP(std::max(size, (size_t)1), page);
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+            if (it->second < rounded) {
+                continue;
+            }
+            size_t offset = it->first;
+            size_t left = it->second - rounded;
+            free_ranges.erase(it);
+            if (left > 0) {
+                free_ranges[offset + rounded] = left;
+            }
+            used_ranges[offset] = rounded;
+            *reserved_size = rounded;
+            return reinterpret_cast<void *>(base_ + offset);
+        }
+        return nullptr;
+    }
+
+    size_t SymmetricHeap::release(void* ptr) {
+        if (!contains(ptr)) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        auto used = used_ranges.find(offset_of(ptr));
+        if (used == used_ranges.end()) {
+            return 0;
+        }
+        size_t offset = used->first;
+        size_t size = used->second;
+        used_ranges.erase(used);
+
+        // coalesce with the free neighbours
+        auto it = free_ranges.insert({offset, size}).first;
+        auto next = std::next(it);
+        if (next != free_ranges.end() && it->first + it->second == next->first) {
+            it->second += next->second;
+            free_ranges.erase(next);
+        }
+        if (it != free_ranges.begin()) {
+            auto prev = std::prev(it);
+            if (prev->first + prev->second == it->first) {
+                prev->second += it->second;
+                free_ranges.erase(it);
+            }
+        }
+        return size;
+    }
+
+    size_t SymmetricHeap::range_size(const void* ptr) const {
+        if (!contains(ptr)) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        auto used = used_ranges.find(offset_of(ptr));
+        return used != used_ranges.end() ? used->second : 0;
+    }
+
+    size_t SymmetricHeap::reserved_bytes() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        size_t bytes = 0;
+        for (auto& it : used_ranges) {
+            bytes += it.second;
+        }
+        return bytes;
+    }
+
+} // namespace nvgpu
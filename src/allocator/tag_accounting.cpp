@@ -0,0 +1,138 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <iostream>
+
+#include "allocator/tag_accounting.h"
+
+namespace nvgpu {
+
+    static thread_local std::string thread_memory_tag = kDefaultMemoryTag;
+
+    const std::string& current_memory_tag() {
+        return thread_memory_tag;
+    }
+
+    void set_current_memory_tag(const std::string& tag) {
+        thread_memory_tag = tag;
+    }
+
+    void TagAccountant::set_quota(const std::string& tag, size_t hard_limit, size_t soft_limit) {
+        std::lock_guard<std::mutex> lock(mtx);
+        TagStats& stats = tags[tag];
+        stats.hard_limit = hard_limit;
+        stats.soft_limit = soft_limit;
+    }
+
+    void TagAccountant::set_eviction_callback(EvictionCallback callback) {
+        std::lock_guard<std::mutex> lock(mtx);
+        eviction_callback = std::move(callback);
+    }
+
+    bool TagAccountant::admit(const std::string& tag, size_t size) {
+        // the callback frees memory through the allocator, which releases charges : never call it under the lock
+        for (int attempt = 0; attempt < 2; attempt++) {
+            size_t over_soft = 0, over_hard = 0;
+            EvictionCallback callback;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                auto it = tags.find(tag);
+                if (it == tags.end()) {
+                    return true;
+                }
+                TagStats& stats = it->second;
+                size_t wanted = stats.live_bytes + size;
+                if (stats.hard_limit > 0 && wanted > stats.hard_limit) {
+                    over_hard = wanted - stats.hard_limit;
+                }
+                if (stats.soft_limit > 0 && wanted > stats.soft_limit) {
+                    over_soft = wanted - stats.soft_limit;
+                }
+                if (over_soft == 0 && over_hard == 0) {
+                    return true;
+                }
+                if (attempt == 0) {
+                    callback = eviction_callback;
+                }
+                if (!callback) {
+                    if (over_hard > 0) {
+                        stats.num_rejected++;
+                        std::cout << "[TagAccountant::admit] reject " << size << " bytes for tag " << tag << ", " << stats.live_bytes << " live bytes, hard limit " << stats.hard_limit << "." << std::endl;
+                        return false;
+                    }
+                    return true;
+                }
+                stats.num_evictions++;
+            }
+
+            size_t freed = callback(tag, std::max(over_soft, over_hard));
+            std::cout << "[TagAccountant::admit] eviction callback freed " << freed << " bytes for tag " << tag << "." << std::endl;
+        }
+        return true;
+    }
+
+    size_t TagAccountant::evict(const std::string& tag, size_t bytes_needed) {
+        EvictionCallback callback;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!eviction_callback) {
+                return 0;
+            }
+            callback = eviction_callback;
+            tags[tag].num_evictions++;
+        }
+        return callback(tag, bytes_needed);
+    }
+
+    void TagAccountant::charge(const std::string& tag, Address addr, size_t live_size, size_t reserved_size) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto inserted = charges.insert({addr, Charge{tag, live_size, reserved_size}});
+        if (!inserted.second) {
+            return;
+        }
+        TagStats& stats = tags[tag];
+        stats.live_bytes += live_size;
+        stats.reserved_bytes += reserved_size;
+        stats.peak_live_bytes = std::max(stats.peak_live_bytes, stats.live_bytes);
+        stats.num_allocs++;
+    }
+
+    bool TagAccountant::release(Address addr) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = charges.find(addr);
+        if (it == charges.end()) {
+            return false;
+        }
+        TagStats& stats = tags[it->second.tag];
+        stats.live_bytes -= it->second.live_size;
+        stats.reserved_bytes -= it->second.reserved_size;
+        stats.num_allocs--;
+        charges.erase(it);
+        return true;
+    }
+
+    TagStats TagAccountant::stats(const std::string& tag) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = tags.find(tag);
+        return it == tags.end() ? TagStats() : it->second;
+    }
+
+    std::map<std::string, TagStats> TagAccountant::all_stats() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return std::map<std::string, TagStats>(tags.begin(), tags.end());
+    }
+
+} // namespace nvgpu
@@ -0,0 +1,161 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "allocator/trace.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace nvgpu {
+
+    namespace trace_detail {
+    std::atomic<bool> enabled{false};
+
+    // events of one thread. The owner thread appends, export_trace reads : the mutex is only contended while
+    // exporting
+    struct ThreadBuffer {
+        int tid = 0;
+        std::mutex mtx;
+        std::vector<TraceEvent> events;
+        size_t dropped = 0;
+        // trace the events belong to
+        uint64_t generation = 0;
+    };
+
+    static std::mutex registry_mtx;
+    // kept after the threads exit, their events are still exported
+    static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    static std::atomic<uint64_t> generation{0};
+    static std::atomic<size_t> max_events{1 << 20};
+    // wall clock - steady clock, captured when the trace starts
+    static std::atomic<int64_t> realtime_offset_ns{0};
+
+    static ThreadBuffer* thread_buffer() {
+        thread_local std::shared_ptr<ThreadBuffer> buffer;
+        if (buffer == nullptr) {
+            buffer = std::make_shared<ThreadBuffer>();
+            buffer->tid = (int)syscall(SYS_gettid);
+            std::lock_guard<std::mutex> lock(registry_mtx);
+            buffers.push_back(buffer);
+        }
+        return buffer.get();
+    }
+
+    void record(const char* name, const char* category, uint64_t start_ns, uint64_t end_ns, uint64_t bytes) {
+        ThreadBuffer* buffer = thread_buffer();
+        std::lock_guard<std::mutex> lock(buffer->mtx);
+        uint64_t current = generation.load(std::memory_order_relaxed);
+        if (buffer->generation != current) {
+            buffer->events.clear();
+            buffer->dropped = 0;
+            buffer->generation = current;
+        }
+        if (buffer->events.size() >= max_events.load(std::memory_order_relaxed)) {
+            buffer->dropped++;
+            return;
+        }
+        buffer->events.push_back({name, category, start_ns, end_ns - start_ns, bytes});
+    }
+
+    static void export_at_exit() {
+        const char* path = std::getenv("VTENSOR_TRACE");
+        if (path != nullptr) {
+            export_trace(path);
+        }
+    }
+    } // namespace trace_detail
+
+    void start_trace(size_t max_events_per_thread) {
+        using namespace trace_detail;
+        int64_t wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        realtime_offset_ns.store(wall_ns - (int64_t)trace_now_ns());
+        max_events.store(max_events_per_thread);
+        // the buffers drop their events of the previous trace lazily
+        generation.fetch_add(1);
+        enabled.store(true);
+
+        static std::once_flag at_exit;
+        if (std::getenv("VTENSOR_TRACE") != nullptr) {
+            std::call_once(at_exit, []() { std::atexit(export_at_exit); });
+        }
+        std::cout << "[start_trace] recording allocator events, at most " << max_events_per_thread << " per thread." << std::endl;
+    }
+
+    void stop_trace() {
+        trace_detail::enabled.store(false);
+    }
+
+    TraceStats trace_stats() {
+        using namespace trace_detail;
+        TraceStats stats;
+        std::lock_guard<std::mutex> lock(registry_mtx);
+        uint64_t current = generation.load();
+        for (auto& buffer : buffers) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mtx);
+            if (buffer->generation == current && !buffer->events.empty()) {
+                stats.threads++;
+                stats.events += buffer->events.size();
+                stats.dropped += buffer->dropped;
+            }
+        }
+        return stats;
+    }
+
+    bool export_trace(const std::string& path) {
+        using namespace trace_detail;
+        FILE* file = std::fopen(path.c_str(), "w");
+        if (file == nullptr) {
+            std::cout << "[export_trace] failed to open " << path << std::endl;
+            return false;
+        }
+
+        int pid = (int)getpid();
+        int64_t offset_ns = realtime_offset_ns.load();
+        size_t written = 0, dropped = 0;
+        std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        {
+            std::lock_guard<std::mutex> lock(registry_mtx);
+            uint64_t current = generation.load();
+            for (auto& buffer : buffers) {
+                std::lock_guard<std::mutex> buffer_lock(buffer->mtx);
+                if (buffer->generation != current) {
+                    continue;
+                }
+                for (const TraceEvent& event : buffer->events) {
+                    // microseconds with nanosecond precision, as the PyTorch profiler
+                    double ts_us = ((int64_t)event.start_ns + offset_ns) / 1e3;
+                    std::fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"bytes\":%llu}}",
+                                 written > 0 ? ",\n" : "", event.name, event.category, ts_us, event.duration_ns / 1e3, pid,
+                                 buffer->tid, (unsigned long long)event.bytes);
+                    written++;
+                }
+                dropped += buffer->dropped;
+            }
+        }
+        std::fprintf(file, "\n],\"otherData\":{\"producer\":\"vTensor\",\"dropped_events\":%zu}}\n", dropped);
+        bool ok = std::fclose(file) == 0;
+
+        std::cout << "[export_trace] wrote " << written << " events to " << path << ", " << dropped << " dropped." << std::endl;
+        return ok;
+    }
+
+} // namespace nvgpu
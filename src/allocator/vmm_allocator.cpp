@@ -16,8 +16,15 @@ limitations under the License.
 #include "cu_util.h"
 
 #include "allocator/vmm_allocator.h"
+#include "allocator/shm_stats.h"
+#include "allocator/trace.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 
 // MACRO better to be in cpp files
 // #define ROUND_UP(x, n) (((x) + ((n) - 1)) / (n) * (n))
@@ -26,31 +33,475 @@ limitations under the License.
 #define ROUND_UP(x, n) (CEIL_DIV(x, n) * (n))
 
 namespace nvgpu {
+    // pools the current thread allocates to, innermost last
+    static thread_local std::vector<VmmAllocator::PoolId> active_pools;
+
+    static thread_local Lifetime thread_lifetime = Lifetime::DEFAULT;
+
+    Lifetime current_lifetime() {
+        return thread_lifetime;
+    }
+
+    void set_current_lifetime(Lifetime lifetime) {
+        thread_lifetime = lifetime;
+    }
+
     // This enables creating torch tensor device memory with VMM API
     HOST_INLINE void* VmmAllocator::alloc(size_t size, int device, CUstream stream) {
+        return alloc(size, device, stream, current_lifetime());
+    }
+
+    HOST_INLINE void* VmmAllocator::alloc(size_t size, int device, CUstream stream, Lifetime lifetime) {
+        VT_TRACE_SCOPE("VmmAllocator::alloc", size);
         ensure_context(device);
 
-        CUdeviceptr dptr;
-        size_t reserved_size;
-        DRV_CALL(reserve_virtual_addr((void**)&dptr, size, &reserved_size, device, stream));
+        if (!admit(size, device)) {
+            // torch reports an out of memory error for the pluggable allocator
+            return nullptr;
+        }
+
+        // the slab chunks and the warm ranges are device memory
+        MemoryTier tier = tag_tier(current_memory_tag());
+
+        void* ptr = nullptr;
+        PoolId pool_id;
+        if (capturing_pool(stream, &pool_id)) {
+            ptr = alloc_private(pool_id, size, device, stream);
+        } else if (slab_enabled && tier == MemoryTier::DEVICE_MEMORY) {
+            ptr = slab.alloc(size, device);
+        }
+        // transient tensors larger than a slab slot are bump allocated from the arenas
+        if (ptr == nullptr && lifetime == Lifetime::TRANSIENT && tier == MemoryTier::DEVICE_MEMORY) {
+            ptr = alloc_transient(size, device);
+        }
+        // the warm ranges are mapped with blocks of the default lifetime
+        if (ptr == nullptr && lifetime == Lifetime::DEFAULT && tier == MemoryTier::DEVICE_MEMORY) {
+            ptr = alloc_warm(size, device, stream);
+        }
+        if (ptr == nullptr) {
+            ptr = alloc_mapped(size, device, stream, lifetime, tier);
+        }
+
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            lifetime_allocs[(int)lifetime]++;
+        }
+        tags.charge(current_memory_tag(), reinterpret_cast<uintptr_t>(ptr), size, charged_size(ptr, size));
+        shm_add(device, &ShmDeviceStats::num_allocs, 1);
+        shm_add(device, &ShmDeviceStats::allocated_bytes, size);
+        return ptr;
+    }
+
+    HOST_INLINE size_t VmmAllocator::charged_size(void* ptr, size_t size) {
+        // a slab slot is charged its slot size, a transient allocation its bumped size : the one at the base of a
+        // chunk or an arena is not the whole reservation
+        size_t reserved_size = slab.slot_size(ptr);
+        if (reserved_size == 0) {
+            reserved_size = transient_size(ptr);
+        }
+        if (reserved_size == 0) {
+            std::lock_guard<TracedMutex> lock(mtx);
+            auto it = reserved_addresses.find(reinterpret_cast<uintptr_t>(ptr));
+            if (it != reserved_addresses.end()) {
+                reserved_size = it->second.first;
+            }
+        }
+        return reserved_size == 0 ? size : reserved_size;
+    }
+
+    HOST_INLINE bool VmmAllocator::admit(size_t size, int device) {
+        const std::string& tag = current_memory_tag();
+        if (!tags.admit(tag, size)) {
+            return false;
+        }
+        if (device_headroom == 0 || tag_tier(tag) != MemoryTier::DEVICE_MEMORY) {
+            return true;
+        }
+
+        for (int attempt = 0; attempt < 2; attempt++) {
+            size_t free_bytes = 0, total_bytes = 0;
+            if (cuMemGetInfo(&free_bytes, &total_bytes) != CUDA_SUCCESS || free_bytes >= size + device_headroom) {
+                return true;
+            }
+            if (attempt == 0 && tags.evict(tag, size + device_headroom - free_bytes) > 0) {
+                continue;
+            }
+            break;
+        }
+        std::cout << "[VmmAllocator::admit] reject " << size << " bytes for tag " << tag << " on device " << device << ", less than " << device_headroom << " bytes would be left." << std::endl;
+        return false;
+    }
+
+    HOST_INLINE void* VmmAllocator::alloc_mapped(size_t size, int device, CUstream stream, Lifetime lifetime, MemoryTier tier) {
+        VT_TRACE_SCOPE("VmmAllocator::alloc_mapped", size);
+        // out of memory pipeline : release the cached memory, then ask the pressure callbacks, then spill to the
+        // host tier when enabled, then give up
+        bool spilled = false;
+        for (int attempt = 0; ; attempt++) {
+            CUdeviceptr dptr;
+            size_t reserved_size;
+            CUresult result = reserve_virtual_addr((void**)&dptr, size, &reserved_size, device, stream);
+            if (result == CUDA_SUCCESS) {
+                result = map_reserved((void *)dptr, reserved_size, device, lifetime, tier);
+                if (result == CUDA_SUCCESS) {
+                    std::lock_guard<TracedMutex> lock(mtx);
+                    tier_allocs[(int)tier]++;
+                    tier_spills += spilled ? 1 : 0;
+                    return (void *)dptr;
+                }
+                release_reservation((void *)dptr);
+            }
+
+            if (attempt == 0) {
+                size_t released = empty_cache();
+                std::cout << "[VmmAllocator::alloc_mapped] failed to allocate " << size << " bytes (code " << (int)result << "), released " << released << " cached bytes, retrying." << std::endl;
+                continue;
+            }
+            if (attempt == 1) {
+                size_t freed = run_pressure_callbacks(device, size);
+                if (freed > 0) {
+                    std::cout << "[VmmAllocator::alloc_mapped] pressure callbacks freed " << freed << " bytes, retrying." << std::endl;
+                    continue;
+                }
+            }
+            if (!spilled && host_spill && tier == MemoryTier::DEVICE_MEMORY) {
+                std::cout << "[VmmAllocator::alloc_mapped] device " << device << " is full, spilling " << size << " bytes to host memory." << std::endl;
+                tier = MemoryTier::HOST_MEMORY;
+                spilled = true;
+                continue;
+            }
+            throw_out_of_memory(size, device, result);
+        }
+    }
+
+    HOST_INLINE CUresult VmmAllocator::map_reserved(void* ptr, size_t reserved_size, int device, Lifetime lifetime, MemoryTier tier) {
+        VT_TRACE_SCOPE("VmmAllocator::map_reserved", reserved_size);
+        // find the nearest memory block of the lifetime in the tier, the whole reservation is mapped
+        PhyBlock* block = nullptr;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            block = owned_pool.find_available(reserved_size, lifetime, tier);
+        }
 
-        // find the nearest memory block
-        PhyBlock* block = owned_pool.find_available(size);
+        // no idle block is large enough : map the reservation across several idle blocks before creating a new one.
+        // The transient requests larger than an arena and the host ones get a block sized to the request.
+        CUresult result;
+        if (block == nullptr && scatter_enabled && lifetime != Lifetime::TRANSIENT && tier == MemoryTier::DEVICE_MEMORY &&
+            map_scattered(ptr, reserved_size, device, &result, lifetime)) {
+            return result;
+        }
 
         std::shared_ptr<PhyBlock> _block = nullptr;
         if (block == nullptr) {
-            _block = std::make_shared<PhyBlock>(device, reserved_size);
+            _block = std::make_shared<PhyBlock>(device, reserved_size, tier, host_numa_node);
+            if (_block->status != CUDA_SUCCESS) {
+                return _block->status;
+            }
+            _block->lifetime = lifetime;
             block = _block.get();
         }
 
         // mapping virtual addr to the device memory
-        map_virtual_address(block, (void *)dptr, reserved_size);
+        if (!map_virtual_address(block, ptr, reserved_size)) {
+            if (_block == nullptr) {
+                // find_available closed the block
+                std::lock_guard<TracedMutex> lock(mtx);
+                owned_pool.refresh(block);
+            }
+            return CUDA_ERROR_OUT_OF_MEMORY;
+        }
 
         if (_block != nullptr) {
+            std::lock_guard<TracedMutex> lock(mtx);
             bool status = owned_pool.add(_block);
             assert(status);
         }
-        return (void *)dptr;
+        return CUDA_SUCCESS;
+    }
+
+    HOST_INLINE void VmmAllocator::release_reservation(void* ptr) {
+        size_t size = 0;
+        int device = 0;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            auto it = reserved_addresses.find(reinterpret_cast<uintptr_t>(ptr));
+            if (it == reserved_addresses.end()) {
+                return;
+            }
+            size = it->second.first;
+            device = it->second.second;
+            reserved_addresses.erase(it);
+        }
+        DRV_TRY(DRV_TIMED(ADDRESS_FREE, size, cuMemAddressFree(reinterpret_cast<CUdeviceptr>(ptr), size)));
+        shm_add(device, &ShmDeviceStats::reserved_bytes, -(int64_t)size);
+    }
+
+    HOST_INLINE bool VmmAllocator::map_scattered(void* ptr, size_t reserved_size, int device, CUresult* result, Lifetime lifetime) {
+        VT_TRACE_SCOPE("VmmAllocator::map_scattered", reserved_size);
+        size_t page_size = granularity(device);
+        if (page_size == 0 || reserved_size <= page_size) {
+            return false;
+        }
+
+        std::vector<std::pair<PhyBlock*, size_t>> pieces;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            pieces = owned_pool.take_pieces(reserved_size, page_size, max_scatter_pieces, lifetime);
+        }
+        size_t covered = 0;
+        for (auto& piece : pieces) {
+            covered += piece.second;
+        }
+        // a partial cover would still create a block, and take the tails the next requests fit in
+        if (covered < reserved_size) {
+            std::lock_guard<TracedMutex> lock(mtx);
+            for (auto& piece : pieces) {
+                owned_pool.refresh(piece.first);
+            }
+            return false;
+        }
+
+        // mapped back to back, every piece from the first byte of its block : the blocks are idle, nothing else maps them
+        std::vector<Address> addresses;
+        size_t offset = 0;
+        *result = CUDA_SUCCESS;
+        for (auto& piece : pieces) {
+            void* v_offset_addr = reinterpret_cast<char *>(ptr) + offset;
+            if (!map_virtual_address(piece.first, v_offset_addr, piece.second)) {
+                *result = CUDA_ERROR_OUT_OF_MEMORY;
+                break;
+            }
+            addresses.push_back(reinterpret_cast<Address>(v_offset_addr));
+            offset += piece.second;
+        }
+
+        if (*result != CUDA_SUCCESS) {
+            for (size_t i = 0; i < addresses.size(); i++) {
+                pieces[i].first->unmap_virtual_address(addresses[i], pieces[i].second, false/*release_address*/);
+                std::lock_guard<TracedMutex> lock(mtx);
+                allocated_blocks.erase(addresses[i]);
+                alloc_stacks.erase(addresses[i]);
+            }
+            std::lock_guard<TracedMutex> lock(mtx);
+            for (auto& piece : pieces) {
+                owned_pool.refresh(piece.first);
+            }
+            return true;
+        }
+
+        std::lock_guard<TracedMutex> lock(mtx);
+        scattered_ranges[reinterpret_cast<Address>(ptr)] = addresses;
+        scatter_reused_bytes += reserved_size;
+        std::cout << "[VmmAllocator::map_scattered] map " << reserved_size << " bytes at " << (uintptr_t)ptr << " with " << addresses.size() << " pieces." << std::endl;
+        return true;
+    }
+
+    HOST_INLINE bool VmmAllocator::unmap_scattered(void* ptr) {
+        Address base = reinterpret_cast<Address>(ptr);
+        std::vector<std::pair<Address, PhyBlock*>> pieces;
+        size_t reserved_size = 0;
+        int device = 0;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            auto it = scattered_ranges.find(base);
+            if (it == scattered_ranges.end()) {
+                return false;
+            }
+            for (Address addr : it->second) {
+                auto block = allocated_blocks.find(addr);
+                if (block != allocated_blocks.end()) {
+                    pieces.push_back({addr, block->second});
+                    allocated_blocks.erase(block);
+                }
+                alloc_stacks.erase(addr);
+            }
+            scattered_ranges.erase(it);
+
+            auto reserved = reserved_addresses.find(base);
+            if (reserved != reserved_addresses.end()) {
+                reserved_size = reserved->second.first;
+                device = reserved->second.second;
+                reserved_addresses.erase(reserved);
+            }
+        }
+
+        // the pieces share one reservation, freed once all of them are unmapped
+        for (auto& piece : pieces) {
+            PhyBlock* block = piece.second;
+            size_t old_capacity = block->remaining_size;
+            block->unmap_virtual_address(piece.first, 0, false/*release_address*/);
+            std::lock_guard<TracedMutex> lock(mtx);
+            owned_pool.update(block, old_capacity);
+        }
+        if (reserved_size > 0) {
+            DRV_TRY(DRV_TIMED(ADDRESS_FREE, reserved_size, cuMemAddressFree(reinterpret_cast<CUdeviceptr>(ptr), reserved_size)));
+            shm_add(device, &ShmDeviceStats::reserved_bytes, -(int64_t)reserved_size);
+        }
+        return true;
+    }
+
+    HOST_INLINE ScatterStats VmmAllocator::scatter_stats() {
+        std::lock_guard<TracedMutex> lock(mtx);
+        ScatterStats stats;
+        stats.ranges = scattered_ranges.size();
+        for (auto& it : scattered_ranges) {
+            stats.pieces += it.second.size();
+        }
+        stats.reused_bytes = scatter_reused_bytes;
+        return stats;
+    }
+
+    HOST_INLINE std::vector<LifetimeStats> VmmAllocator::lifetime_stats() {
+        std::lock_guard<TracedMutex> lock(mtx);
+        std::vector<LifetimeStats> stats((int)Lifetime::N);
+        for (auto& it : owned_pool.blocks) {
+            PhyBlock* block = it.second.get();
+            LifetimeStats& s = stats[(int)block->lifetime];
+            s.blocks++;
+            s.physical_bytes += block->block_size;
+            s.free_block_bytes += block->remaining_size;
+            if (block->idle()) {
+                s.idle_blocks++;
+            } else {
+                s.stranded_bytes += block->remaining_size;
+            }
+        }
+        for (int i = 0; i < (int)Lifetime::N; i++) {
+            stats[i].num_allocs = lifetime_allocs[i];
+        }
+        return stats;
+    }
+
+    HOST_INLINE size_t VmmAllocator::empty_cache() {
+        VT_TRACE_SCOPE("VmmAllocator::empty_cache", 0);
+        // the warm ranges first, so that their blocks become idle
+        size_t released = release_warm(true/*all*/);
+
+        // the empty arenas, their blocks are released with the other idle ones
+        release_transient_arenas();
+
+        // open physical blocks of the owned pool without any mapping : a closed one is being mapped or unmapped
+        // by another thread
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            std::vector<PhyBlock*> idle;
+            owned_pool.for_each_open([&](PhyBlock* block, size_t) {
+                if (block->idle() && owned_pool.blocks.at(block->block_id).use_count() == 1) {
+                    idle.push_back(block);
+                }
+            });
+            for (PhyBlock* block : idle) {
+                released += block->block_size;
+                owned_pool.remove(block);
+            }
+        }
+
+        released += slab.release_empty_chunks();
+        return released;
+    }
+
+    HOST_INLINE int VmmAllocator::add_pressure_callback(PressureCallback callback) {
+        std::lock_guard<TracedMutex> lock(mtx);
+        int id = next_callback_id++;
+        pressure_callbacks[id] = std::move(callback);
+        return id;
+    }
+
+    HOST_INLINE void VmmAllocator::remove_pressure_callback(int id) {
+        std::lock_guard<TracedMutex> lock(mtx);
+        pressure_callbacks.erase(id);
+    }
+
+    HOST_INLINE std::string VmmAllocator::last_oom_report() {
+        std::lock_guard<TracedMutex> lock(mtx);
+        return last_oom;
+    }
+
+    HOST_INLINE size_t VmmAllocator::run_pressure_callbacks(int device, size_t size) {
+        VT_TRACE_SCOPE("VmmAllocator::run_pressure_callbacks", size);
+        std::map<int, PressureCallback> callbacks;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            callbacks = pressure_callbacks;
+        }
+        // callbacks free memory through the allocator : call them without holding the lock
+        size_t freed = 0;
+        for (auto& it : callbacks) {
+            freed += it.second(device, size);
+        }
+        if (freed > 0) {
+            empty_cache();
+        }
+        return freed;
+    }
+
+    HOST_INLINE void VmmAllocator::throw_out_of_memory(size_t size, int device, CUresult result) {
+        size_t free_bytes = 0, total_bytes = 0;
+        DRV_TRY(cuMemGetInfo(&free_bytes, &total_bytes));
+        AllocatorStats state = stats();
+        shm_add(device, &ShmDeviceStats::num_ooms, 1);
+
+        std::ostringstream os;
+        os << "vTensor out of memory : tried to allocate " << size << " bytes on device " << device
+           << " (driver code " << (int)result << "). Device has " << free_bytes << " free of " << total_bytes
+           << " bytes. Allocator holds " << state.physical_bytes << " bytes in " << state.num_blocks
+           << " blocks (" << state.free_block_bytes << " unused, " << state.stranded_bytes << " of them in mapped blocks), " << state.mapped_bytes << " bytes mapped in "
+           << state.num_mappings << " mappings, " << state.reserved_bytes << " bytes reserved, "
+           << state.cached_bytes << " bytes cached by graph pools, " << state.slab_mapped_bytes << " bytes of slab chunks.";
+
+        OutOfMemoryError error(os.str(), device, size, free_bytes, total_bytes, state);
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            last_oom = error.what();
+        }
+        std::cout << "[VmmAllocator::throw_out_of_memory] " << error.what() << std::endl;
+        throw error;
+    }
+
+    HOST_INLINE void* VmmAllocator::alloc_group(const std::vector<size_t>& sizes, size_t alignment, int device, CUstream stream, std::vector<size_t>* offsets) {
+        VT_TRACE_SCOPE("VmmAllocator::alloc_group", 0);
+        ensure_context(device);
+
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            std::cout << "[VmmAllocator::alloc_group] alignment " << alignment << " is not a power of two." << std::endl;
+            return nullptr;
+        }
+
+        size_t total_size = 0;
+        offsets->clear();
+        for (size_t size : sizes) {
+            total_size = ROUND_UP(total_size, alignment);
+            offsets->push_back(total_size);
+            total_size += size;
+        }
+        if (total_size == 0) {
+            total_size = alignment;
+        }
+
+        if (!admit(total_size, device)) {
+            return nullptr;
+        }
+
+        // slab slots are aligned to their (power of two) slot size, which is at least kMinSlotSize
+        void* ptr = nullptr;
+        if (slab_enabled && alignment <= SlabAllocator::kMinSlotSize) {
+            ptr = slab.alloc(total_size, device);
+        }
+
+        // one reservation, one block and a single map/set-access pair for the whole group
+        if (ptr == nullptr) {
+            ptr = alloc_mapped(total_size, device, stream);
+        }
+        // the group is placed with the blocks of the default lifetime
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            lifetime_allocs[(int)Lifetime::DEFAULT]++;
+        }
+        tags.charge(current_memory_tag(), reinterpret_cast<uintptr_t>(ptr), total_size, charged_size(ptr, total_size));
+        shm_add(device, &ShmDeviceStats::num_allocs, 1);
+        shm_add(device, &ShmDeviceStats::allocated_bytes, total_size);
+        std::cout << "[VmmAllocator::alloc_group] allocate " << sizes.size() << " buffers of " << total_size << " bytes in total at " << (uintptr_t)ptr << std::endl;
+        return ptr;
     }
 
     // Adpated from vTensor original impl and [vllm](https://github.com/vllm-project/vllm/pull/11743), used for vTensor internal alloc
@@ -64,22 +515,67 @@ namespace nvgpu {
         prop.allocFlags.compressionType = CU_MEM_ALLOCATION_COMP_NONE;
 
         size_t granularity;
-        DRV_CALL(cuMemGetAllocationGranularity(&granularity, &prop,
-                                                CU_MEM_ALLOC_GRANULARITY_MINIMUM));
+        CUresult result = DRV_TRY(cuMemGetAllocationGranularity(&granularity, &prop,
+                                                                CU_MEM_ALLOC_GRANULARITY_MINIMUM));
+        if (result != CUDA_SUCCESS) {
+            return result;
+        }
 
         *reserved_size = ROUND_UP(request_size, granularity);
 
         CUdeviceptr v_ptr;
-        DRV_CALL(cuMemAddressReserve(&v_ptr, *reserved_size, 0ULL/*alignment*/, 0ULL/*extension addr offset*/, 0ULL/**/));
+        result = DRV_TRY(DRV_TIMED(ADDRESS_RESERVE, *reserved_size, cuMemAddressReserve(&v_ptr, *reserved_size, 0ULL/*alignment*/, 0ULL/*extension addr offset*/, 0ULL/**/)));
+        if (result != CUDA_SUCCESS) {
+            return result;
+        }
+        shm_add(device, &ShmDeviceStats::reserved_bytes, *reserved_size);
 
         *ptr = (void *)v_ptr;
 
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            reserved_addresses[reinterpret_cast<uintptr_t>(*ptr)] = {*reserved_size, device};
+        }
+
         return CUDA_SUCCESS;
     }
 
     HOST_INLINE void VmmAllocator::dealloc(void* ptr/*virtual_memroy_address*/, size_t size, int device, CUstream stream) {
+        VT_TRACE_SCOPE("VmmAllocator::dealloc", size);
         ensure_context(device);
 
+        tags.release(reinterpret_cast<uintptr_t>(ptr));
+        shm_add(device, &ShmDeviceStats::num_frees, 1);
+        shm_add(device, &ShmDeviceStats::freed_bytes, size);
+
+        if (dealloc_private(ptr, device, stream)) {
+            return;
+        }
+
+        if (dealloc_symmetric(ptr)) {
+            return;
+        }
+
+        if (dealloc_warm(ptr)) {
+            return;
+        }
+
+        if (dealloc_dedup(ptr)) {
+            return;
+        }
+
+        // a range freed halfway through its migration is unmapped like any other one
+        cancel_migration(ptr);
+
+        if (dealloc_transient(ptr)) {
+            return;
+        }
+
+        // small tensors live in slab chunks, also after the slab layer was disabled
+        if (slab.dealloc(ptr)) {
+            return;
+        }
+
         PhyBlock* block = get_allocated_block(ptr);
 
         if (block != nullptr) {
@@ -94,22 +590,31 @@ namespace nvgpu {
          */
     }
 
-    HOST_INLINE void VmmAllocator::map_virtual_address(VmmAllocator::PhyBlock* block, void* v_offset_addr, size_t size) {
+    HOST_INLINE bool VmmAllocator::map_virtual_address(VmmAllocator::PhyBlock* block, void* v_offset_addr, size_t size) {
         assert(block != nullptr);
 
-        block->map_virtual_address(reinterpret_cast<CUdeviceptr>(v_offset_addr), size);
+        if (!block->map_virtual_address(reinterpret_cast<CUdeviceptr>(v_offset_addr), size)) {
+            return false;
+        }
 
+        std::lock_guard<TracedMutex> lock(mtx);
         auto inserted = allocated_blocks.insert({reinterpret_cast<uintptr_t>(v_offset_addr), block});
 
+        if (record_stacks) {
+            alloc_stacks[reinterpret_cast<uintptr_t>(v_offset_addr)] = capture_stack();
+        }
+
         if (inserted.second) {
             std::cout << "[VmmAllocator::map_virtual_address] add mapping of <block#" << block->block_id << ", " << (uintptr_t)v_offset_addr << ", " << size << ">" << std::endl;
         } else {
             std::cout << "[VmmAllocator::map_virtual_address] failed to add mapping of <block#" << block->block_id << ", " << (uintptr_t)v_offset_addr << ", " << size << ">" << std::endl;
         }
+        return true;
 
     }
 
     HOST_INLINE void VmmAllocator::unmap_virtual_address(PhyBlock* block, void *v_offset_addr, size_t size) {
+        VT_TRACE_SCOPE("VmmAllocator::unmap", size);
         ensure_context(block->device_id);
         /*
         CUdeviceptr dptr = reinterpret_cast<CUdeviceptr>(ptr);
@@ -117,11 +622,22 @@ namespace nvgpu {
             unmap_virtual_address(block->device_id, size, dptr);
         }
          */
+        if (unmap_scattered(v_offset_addr)) {
+            return;
+        }
+
         CUdeviceptr dptr = reinterpret_cast<CUdeviceptr>(v_offset_addr);
 
         size_t old_capacity = block->remaining_size;
         if (block->unmap_virtual_address(dptr, size) ) {
+            std::lock_guard<TracedMutex> lock(mtx);
             owned_pool.update(block, old_capacity);
+
+            // the block released the virtual address as well
+            uintptr_t addr = reinterpret_cast<uintptr_t>(v_offset_addr);
+            allocated_blocks.erase(addr);
+            reserved_addresses.erase(addr);
+            alloc_stacks.erase(addr);
         }
     }
 
@@ -134,9 +650,1858 @@ namespace nvgpu {
     }
     */
 
+    HOST_INLINE bool VmmAllocator::set_placement_policy(const std::string& name) {
+        PlacementPolicyType type;
+        std::lock_guard<TracedMutex> lock(mtx);
+        if (!parse_placement_policy(name, &type)) {
+            std::cout << "[VmmAllocator::set_placement_policy] unknown placement policy " << name << ", keep " << placement_policy_name(owned_pool.policy()) << "." << std::endl;
+            return false;
+        }
+        owned_pool.set_policy(type);
+        return true;
+    }
+
+    HOST_INLINE std::string VmmAllocator::placement_policy() {
+        std::lock_guard<TracedMutex> lock(mtx);
+        return placement_policy_name(owned_pool.policy());
+    }
+
+    HOST_INLINE VmmAllocator::PoolId VmmAllocator::graph_pool_handle() {
+        return next_pool_id++;
+    }
+
+    HOST_INLINE void VmmAllocator::begin_allocate_to_pool(PoolId pool_id) {
+        {
+            std::lock_guard<std::mutex> lock(pool_mtx);
+            private_pools[pool_id].use_count++;
+        }
+        active_pools.push_back(pool_id);
+    }
+
+    HOST_INLINE void VmmAllocator::end_allocate_to_pool(PoolId pool_id) {
+        auto it = std::find(active_pools.rbegin(), active_pools.rend(), pool_id);
+        if (it == active_pools.rend()) {
+            std::cout << "[VmmAllocator::end_allocate_to_pool] pool#" << pool_id << " is not active in this thread." << std::endl;
+            return;
+        }
+        active_pools.erase(std::next(it).base());
+    }
+
+    HOST_INLINE void VmmAllocator::release_pool(PoolId pool_id) {
+        std::vector<std::pair<Address, size_t>> to_unmap;
+        {
+            std::lock_guard<std::mutex> lock(pool_mtx);
+            auto it = private_pools.find(pool_id);
+            if (it == private_pools.end()) {
+                return;
+            }
+            PrivatePool& pool = it->second;
+            if (--pool.use_count > 0) {
+                return;
+            }
+
+            // live ranges (e.g. graph outputs) are unmapped when they are freed
+            for (auto& cached : pool.cached) {
+                to_unmap.push_back({cached.second, cached.first});
+                private_allocations.erase(cached.second);
+                shm_add(pool.device, &ShmDeviceStats::cached_bytes, -(int64_t)cached.first);
+            }
+            pool.cached.clear();
+            if (pool.live.empty()) {
+                private_pools.erase(it);
+            }
+        }
+
+        for (auto& range : to_unmap) {
+            PhyBlock* block = get_allocated_block((void *)range.first);
+            if (block != nullptr) {
+                unmap_virtual_address(block, (void *)range.first, range.second);
+            }
+        }
+        std::cout << "[VmmAllocator::release_pool] release pool#" << pool_id << ", unmap " << to_unmap.size() << " cached ranges." << std::endl;
+    }
+
+    HOST_INLINE size_t VmmAllocator::pool_cached_size(PoolId pool_id) {
+        std::lock_guard<std::mutex> lock(pool_mtx);
+        auto it = private_pools.find(pool_id);
+        if (it == private_pools.end()) {
+            return 0;
+        }
+        size_t total = 0;
+        for (auto& cached : it->second.cached) {
+            total += cached.first;
+        }
+        return total;
+    }
+
+    HOST_INLINE bool VmmAllocator::capturing_pool(CUstream stream, PoolId* pool_id) {
+        if (active_pools.empty()) {
+            return false;
+        }
+        CUstreamCaptureStatus status = CU_STREAM_CAPTURE_STATUS_NONE;
+        if (cuStreamIsCapturing(stream, &status) != CUDA_SUCCESS || status != CU_STREAM_CAPTURE_STATUS_ACTIVE) {
+            return false;
+        }
+        *pool_id = active_pools.back();
+        return true;
+    }
+
+    HOST_INLINE void* VmmAllocator::alloc_private(PoolId pool_id, size_t size, int device, CUstream stream) {
+        {
+            std::lock_guard<std::mutex> lock(pool_mtx);
+            PrivatePool& pool = private_pools[pool_id];
+            auto it = pool.cached.lower_bound(size);
+            if (it != pool.cached.end()) {
+                Address addr = it->second;
+                pool.live.insert({addr, it->first});
+                shm_add(device, &ShmDeviceStats::cached_bytes, -(int64_t)it->first);
+                pool.cached.erase(it);
+                return (void *)addr;
+            }
+        }
+
+        // the pool maps its own ranges, the slab chunks are shared with allocations outside of the graphs
+        void* ptr = alloc_mapped(size, device, stream);
+
+        size_t reserved_size = size;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            auto it = reserved_addresses.find(reinterpret_cast<uintptr_t>(ptr));
+            if (it != reserved_addresses.end()) {
+                reserved_size = it->second.first;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(pool_mtx);
+        PrivatePool& pool = private_pools[pool_id];
+        pool.device = device;
+        pool.live.insert({reinterpret_cast<uintptr_t>(ptr), reserved_size});
+        private_allocations[reinterpret_cast<uintptr_t>(ptr)] = pool_id;
+
+        std::cout << "[VmmAllocator::alloc_private] map " << reserved_size << " bytes at " << (uintptr_t)ptr << " in pool#" << pool_id << std::endl;
+        return ptr;
+    }
+
+    HOST_INLINE bool VmmAllocator::dealloc_private(void* ptr, int device, CUstream stream) {
+        Address addr = reinterpret_cast<uintptr_t>(ptr);
+        size_t reserved_size = 0;
+        {
+            std::lock_guard<std::mutex> lock(pool_mtx);
+            auto owner = private_allocations.find(addr);
+            if (owner == private_allocations.end()) {
+                return false;
+            }
+            auto pool_it = private_pools.find(owner->second);
+            PrivatePool& pool = pool_it->second;
+            auto it = pool.live.find(addr);
+            if (it == pool.live.end()) {
+                // double free, the range is already cached
+                return true;
+            }
+            reserved_size = it->second;
+            pool.live.erase(it);
+
+            if (pool.use_count > 0) {
+                // keep the range mapped : a graph may still replay kernels reading or writing it
+                pool.cached.insert({reserved_size, addr});
+                shm_add(pool.device, &ShmDeviceStats::cached_bytes, reserved_size);
+                return true;
+            }
+
+            // the pool was released while this range was alive
+            private_allocations.erase(owner);
+            if (pool.live.empty()) {
+                private_pools.erase(pool_it);
+            }
+        }
+
+        PhyBlock* block = get_allocated_block(ptr);
+        if (block != nullptr) {
+            unmap_virtual_address(block, ptr, reserved_size);
+        }
+        return true;
+    }
+
+    HOST_INLINE void* VmmAllocator::gather(const std::vector<std::pair<void*, size_t>>& ranges, int device, size_t* view_size) {
+        VT_TRACE_SCOPE("VmmAllocator::gather", 0);
+        ensure_context(device);
+
+        size_t page = granularity(device);
+        if (page == 0 || ranges.empty()) {
+            throw std::invalid_argument("gather: no range to map");
+        }
+
+        for (auto& range : ranges) {
+            if (transient_size(range.first) > 0) {
+                throw std::invalid_argument("gather: range at " + std::to_string(reinterpret_cast<Address>(range.first)) + " is a transient allocation, it shares its arena");
+            }
+            if (migrating(range.first)) {
+                throw std::invalid_argument("gather: range at " + std::to_string(reinterpret_cast<Address>(range.first)) + " is being migrated");
+            }
+        }
+
+        // resolve the mappings behind every range
+        AliasView view;
+        view.device = device;
+        std::vector<size_t> lengths;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            for (size_t i = 0; i < ranges.size(); i++) {
+                Address addr = reinterpret_cast<Address>(ranges[i].first);
+                if (i + 1 < ranges.size() && ranges[i].second % page != 0) {
+                    throw std::invalid_argument("gather: range " + std::to_string(i) + " of " + std::to_string(ranges[i].second) + " bytes is not a multiple of the granularity " + std::to_string(page));
+                }
+
+                size_t left = ROUND_UP(ranges[i].second, page);
+                while (left > 0) {
+                    auto it = allocated_blocks.find(addr);
+                    if (it == allocated_blocks.end()) {
+                        throw std::invalid_argument("gather: address " + std::to_string(addr) + " is not the start of a mapping");
+                    }
+                    PhyBlock* block = it->second;
+                    auto owned = owned_pool.blocks.find(block->block_id);
+                    if (owned == owned_pool.blocks.end() || block->device_id != device) {
+                        throw std::invalid_argument("gather: address " + std::to_string(addr) + " is not backed by the owned pool of device " + std::to_string(device));
+                    }
+
+                    size_t mapped_size = block->mapped_addresses[addr];
+                    size_t length = std::min(left, mapped_size);
+                    view.pieces.push_back({0, owned->second});
+                    lengths.push_back(length);
+                    view.size += length;
+                    addr += mapped_size;
+                    left -= length;
+                }
+            }
+        }
+
+        CUdeviceptr v_ptr;
+        size_t reserved_size = 0;
+        CUresult result = reserve_virtual_addr((void **)&v_ptr, view.size, &reserved_size, device, 0/*stream*/);
+        if (result != CUDA_SUCCESS) {
+            throw_out_of_memory(view.size, device, result);
+        }
+
+        std::lock_guard<TracedMutex> lock(mtx);
+        size_t offset = 0;
+        for (size_t i = 0; i < view.pieces.size(); i++) {
+            CUdeviceptr piece = v_ptr + offset;
+            if (!view.pieces[i].second->map_alias(piece, lengths[i])) {
+                for (size_t j = 0; j < i; j++) {
+                    view.pieces[j].second->unmap_alias(view.pieces[j].first);
+                    owned_pool.refresh(view.pieces[j].second.get());
+                }
+                reserved_addresses.erase(v_ptr);
+                DRV_TRY(DRV_TIMED(ADDRESS_FREE, reserved_size, cuMemAddressFree(v_ptr, reserved_size)));
+                shm_add(device, &ShmDeviceStats::reserved_bytes, -(int64_t)reserved_size);
+                throw std::runtime_error("gather: failed to map piece " + std::to_string(i) + " of the view");
+            }
+            view.pieces[i].first = piece;
+            owned_pool.refresh(view.pieces[i].second.get());
+            offset += lengths[i];
+        }
+
+        std::cout << "[VmmAllocator::gather] map " << view.pieces.size() << " pieces of " << ranges.size() << " ranges into a view of " << view.size << " bytes at " << v_ptr << std::endl;
+        *view_size = view.size;
+        views[v_ptr] = std::move(view);
+        return (void *)v_ptr;
+    }
+
+    HOST_INLINE void VmmAllocator::release_view(void* ptr) {
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            auto it = views.find(reinterpret_cast<Address>(ptr));
+            if (it == views.end()) {
+                std::cout << "[VmmAllocator::release_view] no view at address " << (uintptr_t)ptr << std::endl;
+                return;
+            }
+            ensure_context(it->second.device);
+            for (auto& piece : it->second.pieces) {
+                piece.second->unmap_alias(piece.first);
+                owned_pool.refresh(piece.second.get());
+            }
+            // the blocks are released here if they left the owned pool meanwhile
+            views.erase(it);
+        }
+        release_reservation(ptr);
+    }
+
+    // PageCompare without a kernel : both pages go through the host
+    static CUresult compare_pages_on_host(CUdeviceptr a, CUdeviceptr b, size_t num_pages, size_t page_size, std::vector<char>* equal) {
+        std::vector<char> lhs(page_size), rhs(page_size);
+        equal->assign(num_pages, 0);
+        for (size_t i = 0; i < num_pages; i++) {
+            CUresult result = DRV_TRY(cuMemcpyDtoH(lhs.data(), a + i * page_size, page_size));
+            if (result == CUDA_SUCCESS) {
+                result = DRV_TRY(cuMemcpyDtoH(rhs.data(), b + i * page_size, page_size));
+            }
+            if (result != CUDA_SUCCESS) {
+                return result;
+            }
+            (*equal)[i] = std::memcmp(lhs.data(), rhs.data(), page_size) == 0;
+        }
+        return CUDA_SUCCESS;
+    }
+
+    HOST_INLINE size_t VmmAllocator::dedup(const std::vector<std::pair<void*, size_t>>& ranges, const std::vector<PageKey>& keys, int device,
+                                           const PageCompare& compare) {
+        VT_TRACE_SCOPE("VmmAllocator::dedup", 0);
+        ensure_context(device);
+
+        size_t page = granularity(device);
+        if (page == 0) {
+            throw std::invalid_argument("dedup: cannot query the granularity of device " + std::to_string(device));
+        }
+
+        // every range is a whole mapping of the owned pool, not recycled by a cache
+        std::vector<PhyBlock*> sources;
+        std::vector<size_t> mapped_sizes;
+        size_t total_pages = 0;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            for (auto& range : ranges) {
+                Address addr = reinterpret_cast<Address>(range.first);
+                auto it = allocated_blocks.find(addr);
+                if (it == allocated_blocks.end() || owned_pool.blocks.find(it->second->block_id) == owned_pool.blocks.end() ||
+                    it->second->device_id != device) {
+                    throw std::invalid_argument("dedup: address " + std::to_string(addr) + " is not a mapping of the owned pool of device " + std::to_string(device));
+                }
+                if (scattered_ranges.count(addr)) {
+                    throw std::invalid_argument("dedup: range at " + std::to_string(addr) + " is mapped with pieces of several blocks");
+                }
+                size_t mapped_size = it->second->mapped_addresses[addr];
+                if (mapped_size != ROUND_UP(range.second, page)) {
+                    throw std::invalid_argument("dedup: range at " + std::to_string(addr) + " does not cover its whole mapping");
+                }
+                sources.push_back(it->second);
+                mapped_sizes.push_back(mapped_size);
+                total_pages += mapped_size / page;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(pool_mtx);
+            for (auto& range : ranges) {
+                if (private_allocations.count(reinterpret_cast<Address>(range.first))) {
+                    throw std::invalid_argument("dedup: ranges of CUDA graph pools cannot be deduplicated");
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(step_mtx);
+            for (auto& range : ranges) {
+                if (step_profiler.allocations.count(reinterpret_cast<Address>(range.first))) {
+                    throw std::invalid_argument("dedup: ranges of the step warm cache cannot be deduplicated");
+                }
+            }
+        }
+        for (auto& range : ranges) {
+            if (transient_size(range.first) > 0) {
+                throw std::invalid_argument("dedup: range at " + std::to_string(reinterpret_cast<Address>(range.first)) + " is a transient allocation, it shares its arena");
+            }
+            if (migrating(range.first)) {
+                throw std::invalid_argument("dedup: range at " + std::to_string(reinterpret_cast<Address>(range.first)) + " is being migrated");
+            }
+        }
+        if (keys.size() != total_pages) {
+            throw std::invalid_argument("dedup: expect " + std::to_string(total_pages) + " page keys, got " + std::to_string(keys.size()));
+        }
+
+        size_t saved_before = dedup_stats().bytes_saved;
+        size_t k = 0;
+        for (size_t r = 0; r < ranges.size(); r++) {
+            Address addr = reinterpret_cast<Address>(ranges[r].first);
+            size_t n = mapped_sizes[r] / page;
+
+            DedupRange range;
+            range.size = mapped_sizes[r];
+            range.device = device;
+
+            // 1. a page whose key was seen before is a candidate only, it reuses the page of the store once their
+            //    bytes compare equal. The other pages are copied to their own block. Both are mapped to a staging
+            //    range : the candidates to be compared, the new pages to be written.
+            CUdeviceptr staging;
+            size_t staging_size = 0;
+            CUresult result = reserve_virtual_addr((void **)&staging, range.size, &staging_size, device, 0/*stream*/);
+            if (result != CUDA_SUCCESS) {
+                throw_out_of_memory(range.size, device, result);
+            }
+
+            // range.pages[i] is mapped at page i of the staging range when set
+            auto unmap_staging = [&]() {
+                for (size_t i = 0; i < range.pages.size(); i++) {
+                    if (range.pages[i] != nullptr) {
+                        range.pages[i]->unmap_alias(staging + i * page);
+                    }
+                }
+                release_reservation((void *)staging);
+            };
+            // the pages copied for the range are only referenced by it, they are released with their keys
+            auto drop_pages = [&]() {
+                range.pages.clear();
+                std::lock_guard<std::mutex> lock(dedup_mtx);
+                for (auto it = unique_pages.begin(); it != unique_pages.end();) {
+                    it = it->second.expired() ? unique_pages.erase(it) : std::next(it);
+                }
+            };
+
+            // in rounds : the first page of every key is copied, the later pages of the key compare to it the next
+            // round. A page differing from the page of its key gets its own copy.
+            range.pages.resize(n);
+            std::vector<char> collided(n, 0);
+            size_t collisions = 0;
+            size_t resolved = 0;
+            while (resolved < n) {
+                std::vector<char> candidate(n, 0);
+                for (size_t i = 0; i < n; i++) {
+                    if (range.pages[i] != nullptr || collided[i]) {
+                        continue;
+                    }
+                    std::shared_ptr<PhyBlock> unique;
+                    {
+                        std::lock_guard<std::mutex> lock(dedup_mtx);
+                        auto it = unique_pages.find(std::make_pair(device, keys[k + i]));
+                        if (it != unique_pages.end()) {
+                            unique = it->second.lock();
+                        }
+                    }
+                    if (unique != nullptr && unique->map_alias(staging + i * page, page, CU_MEM_ACCESS_FLAGS_PROT_READ)) {
+                        range.pages[i] = unique;
+                        candidate[i] = 1;
+                    }
+                }
+
+                // compared by runs of consecutive candidates
+                for (size_t i = 0; i < n && result == CUDA_SUCCESS; ) {
+                    if (!candidate[i]) {
+                        i++;
+                        continue;
+                    }
+                    size_t run = 1;
+                    while (i + run < n && candidate[i + run]) {
+                        run++;
+                    }
+                    std::vector<char> equal;
+                    result = compare ? compare(staging + i * page, addr + i * page, run, page, &equal)
+                                     : compare_pages_on_host(staging + i * page, addr + i * page, run, page, &equal);
+                    for (size_t j = i; j < i + run && result == CUDA_SUCCESS; j++) {
+                        if (equal[j - i]) {
+                            resolved++;
+                            continue;
+                        }
+                        range.pages[j]->unmap_alias(staging + j * page);
+                        range.pages[j] = nullptr;
+                        collided[j] = 1;
+                        collisions++;
+                    }
+                    i += run;
+                }
+                if (result != CUDA_SUCCESS) {
+                    unmap_staging();
+                    drop_pages();
+                    throw std::runtime_error("dedup: failed to compare the pages of the range at " + std::to_string(addr) + ", error " + std::to_string((int)result));
+                }
+
+                std::set<PageKey> copied;
+                for (size_t i = 0; i < n && result == CUDA_SUCCESS; i++) {
+                    if (range.pages[i] != nullptr || (!collided[i] && !copied.insert(keys[k + i]).second)) {
+                        continue;
+                    }
+                    auto unique = std::make_shared<PhyBlock>(device, page);
+                    if (unique->status != CUDA_SUCCESS || !unique->map_alias(staging + i * page, page)) {
+                        CUresult status = unique->status != CUDA_SUCCESS ? unique->status : CUDA_ERROR_OUT_OF_MEMORY;
+                        unmap_staging();
+                        drop_pages();
+                        throw_out_of_memory(page, device, status);
+                    }
+                    range.pages[i] = unique;
+                    resolved++;
+                    result = DRV_TRY(cuMemcpyDtoD(staging + i * page, addr + i * page, page));
+
+                    // a live page of the key keeps its place in the store
+                    std::lock_guard<std::mutex> lock(dedup_mtx);
+                    auto inserted = unique_pages.insert({std::make_pair(device, keys[k + i]), unique});
+                    if (!inserted.second && inserted.first->second.expired()) {
+                        inserted.first->second = unique;
+                    }
+                }
+                // device to device copies do not synchronize with the host, the next round compares to them
+                if (result == CUDA_SUCCESS) {
+                    result = DRV_TRY(cuCtxSynchronize());
+                }
+                if (result != CUDA_SUCCESS) {
+                    unmap_staging();
+                    drop_pages();
+                    throw std::runtime_error("dedup: failed to copy the pages of the range at " + std::to_string(addr) + ", error " + std::to_string((int)result));
+                }
+            }
+            unmap_staging();
+            if (collisions > 0) {
+                std::cout << "[VmmAllocator::dedup] " << collisions << " pages of the range at " << addr << " differ from the page of their key." << std::endl;
+            }
+
+            // 2. swap the backing of the range, the source block is released once it has no mapping left
+            PhyBlock* block = sources[r];
+            std::shared_ptr<PhyBlock> source;
+            {
+                std::lock_guard<TracedMutex> lock(mtx);
+                // the pool may hold the last reference of the block, keep it until the range is swapped
+                source = owned_pool.blocks.at(block->block_id);
+                result = DRV_TRY(DRV_TIMED(MEM_UNMAP, range.size, cuMemUnmap(addr, range.size)));
+                if (result == CUDA_SUCCESS) {
+                    block->mapped_addresses.erase(addr);
+                    block->remaining_size += range.size;
+                    shm_add(device, &ShmDeviceStats::mapped_bytes, -(int64_t)range.size);
+                    shm_add(device, &ShmDeviceStats::free_block_bytes, range.size);
+                }
+            }
+            if (result != CUDA_SUCCESS) {
+                drop_pages();
+                throw std::runtime_error("dedup: failed to unmap the range at " + std::to_string(addr) + ", error " + std::to_string((int)result));
+            }
+
+            size_t mapped = 0;
+            while (mapped < n && range.pages[mapped]->map_alias(addr + mapped * page, page, CU_MEM_ACCESS_FLAGS_PROT_READ)) {
+                mapped++;
+            }
+            if (mapped < n) {
+                // back to the source block, the range keeps its content
+                for (size_t i = 0; i < mapped; i++) {
+                    range.pages[i]->unmap_alias(addr + i * page);
+                }
+                bool restored;
+                {
+                    std::lock_guard<TracedMutex> lock(mtx);
+                    restored = block->map_virtual_address(addr, range.size);
+                }
+                drop_pages();
+                throw std::runtime_error("dedup: failed to map the pages of the range at " + std::to_string(addr) +
+                                         (restored ? ", the range is mapped to its block again" : ", the range is left unmapped"));
+            }
+
+            {
+                std::lock_guard<TracedMutex> lock(mtx);
+                allocated_blocks.erase(addr);
+                alloc_stacks.erase(addr);
+                owned_pool.update(block, block->remaining_size - range.size);
+                if (block->mapped_addresses.empty() && block->alias_addresses.empty()) {
+                    owned_pool.remove(block);
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(dedup_mtx);
+                deduped[addr] = std::move(range);
+                dedup_collisions += collisions;
+            }
+            k += n;
+        }
+
+        size_t saved = dedup_stats().bytes_saved;
+        std::cout << "[VmmAllocator::dedup] " << ranges.size() << " ranges of " << total_pages << " pages deduplicated, " << saved << " bytes saved in total." << std::endl;
+        return saved > saved_before ? saved - saved_before : 0;
+    }
+
+    HOST_INLINE bool VmmAllocator::dealloc_dedup(void* ptr) {
+        DedupRange range;
+        {
+            std::lock_guard<std::mutex> lock(dedup_mtx);
+            auto it = deduped.find(reinterpret_cast<Address>(ptr));
+            if (it == deduped.end()) {
+                return false;
+            }
+            range = std::move(it->second);
+            deduped.erase(it);
+        }
+
+        size_t page = range.size / range.pages.size();
+        for (size_t i = 0; i < range.pages.size(); i++) {
+            range.pages[i]->unmap_alias(reinterpret_cast<CUdeviceptr>(ptr) + i * page);
+        }
+        release_reservation(ptr);
+
+        // the pages only referenced by this range are released here
+        range.pages.clear();
+        std::lock_guard<std::mutex> lock(dedup_mtx);
+        for (auto it = unique_pages.begin(); it != unique_pages.end();) {
+            it = it->second.expired() ? unique_pages.erase(it) : std::next(it);
+        }
+        return true;
+    }
+
+    HOST_INLINE DedupStats VmmAllocator::dedup_stats() {
+        std::lock_guard<std::mutex> lock(dedup_mtx);
+        DedupStats stats;
+        for (auto& it : unique_pages) {
+            std::shared_ptr<PhyBlock> page = it.second.lock();
+            if (page == nullptr) {
+                continue;
+            }
+            // minus the reference taken above
+            size_t refs = page.use_count() - 1;
+            stats.unique_pages++;
+            stats.mapped_pages += refs;
+            stats.page_size = page->block_size;
+            stats.bytes_saved += (refs > 0 ? refs - 1 : 0) * page->block_size;
+        }
+        stats.deduped_ranges = deduped.size();
+        stats.collisions = dedup_collisions;
+        return stats;
+    }
+
+    // access of `owner` and `peer` to the memory of `owner` mapped at [ptr, ptr + size)
+    static CUresult set_peer_access(CUdeviceptr ptr, size_t size, int owner, int peer) {
+        CUmemAccessDesc desc[2] = {};
+        desc[0].location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+        desc[0].location.id = owner;
+        desc[0].flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+        desc[1] = desc[0];
+        desc[1].location.id = peer;
+        return DRV_TRY(DRV_TIMED(MEM_SET_ACCESS, size, cuMemSetAccess(ptr, size, desc, 2)));
+    }
+
+    HOST_INLINE void VmmAllocator::migrate_begin(void* ptr, int device) {
+        migrate_begin(ptr, device, MemoryTier::DEVICE_MEMORY);
+    }
+
+    // copies `size` bytes between the primary contexts of the devices and waits for the copy
+    static CUresult copy_peer(CUdeviceptr dst, int dst_device, CUdeviceptr src, int src_device, size_t size) {
+        CUcontext src_ctx, dst_ctx;
+        CUresult result = DRV_TRY(cuDevicePrimaryCtxRetain(&src_ctx, src_device));
+        if (result != CUDA_SUCCESS) {
+            return result;
+        }
+        result = DRV_TRY(cuDevicePrimaryCtxRetain(&dst_ctx, dst_device));
+        if (result == CUDA_SUCCESS) {
+            result = DRV_TRY(cuMemcpyPeer(dst, dst_ctx, src, src_ctx, size));
+            if (result == CUDA_SUCCESS) {
+                result = DRV_TRY(cuCtxSynchronize());
+            }
+            DRV_TRY(cuDevicePrimaryCtxRelease(dst_device));
+        }
+        DRV_TRY(cuDevicePrimaryCtxRelease(src_device));
+        return result;
+    }
+
+    HOST_INLINE void VmmAllocator::migrate_begin(void* ptr, int device, MemoryTier tier) {
+        VT_TRACE_SCOPE("VmmAllocator::migrate_begin", 0);
+        Address addr = reinterpret_cast<Address>(ptr);
+
+        // a whole reservation, mapped by a block of the owned pool or scattered across several
+        Migration migration;
+        PhyBlock* whole = nullptr;
+        int source_numa_node = -1;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            auto reserved = reserved_addresses.find(addr);
+            auto scattered = scattered_ranges.find(addr);
+            migration.pieces = scattered != scattered_ranges.end() ? scattered->second : std::vector<Address>{addr};
+            for (Address piece : migration.pieces) {
+                auto it = allocated_blocks.find(piece);
+                if (reserved == reserved_addresses.end() || it == allocated_blocks.end()) {
+                    throw std::invalid_argument("migrate: address " + std::to_string(addr) + " is not the start of an allocation");
+                }
+                PhyBlock* block = it->second;
+                auto owned = owned_pool.blocks.find(block->block_id);
+                if (owned == owned_pool.blocks.end() || owned->second.get() != block) {
+                    throw std::invalid_argument("migrate: the range at " + std::to_string(addr) + " is not mapped by the owned pool");
+                }
+                if (!block->alias_addresses.empty()) {
+                    throw std::invalid_argument("migrate: range at " + std::to_string(addr) + " is aliased by a view");
+                }
+                migration.source_device = block->device_id;
+                migration.source_tier = block->tier;
+                source_numa_node = block->numa_node;
+                migration.size += block->mapped_addresses[piece];
+                whole = block;
+            }
+            if (migration.size != reserved->second.first) {
+                throw std::invalid_argument("migrate: the mappings at " + std::to_string(addr) + " do not cover the whole allocation");
+            }
+            if (migration.pieces.size() > 1) {
+                whole = nullptr;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(pool_mtx);
+            if (private_allocations.count(addr)) {
+                throw std::invalid_argument("migrate: ranges of CUDA graph pools cannot be migrated");
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(step_mtx);
+            if (step_profiler.allocations.count(addr)) {
+                throw std::invalid_argument("migrate: ranges of the step warm cache cannot be migrated");
+            }
+        }
+        if (transient_size(ptr) > 0) {
+            throw std::invalid_argument("migrate: range at " + std::to_string(addr) + " is a transient allocation, it shares its arena");
+        }
+        if (migrating(ptr)) {
+            throw std::invalid_argument("migrate: range at " + std::to_string(addr) + " is already being migrated");
+        }
+        if (migration.source_device == device && migration.source_tier == tier) {
+            throw std::invalid_argument("migrate: range at " + std::to_string(addr) + " is already in " + memory_tier_name(tier) + " memory of device " + std::to_string(device));
+        }
+
+        // every piece gets a block of its size in the target : a multiple of the granularity of both memories
+        auto page_of = [&](int d, MemoryTier t, int numa_node) {
+            return t == MemoryTier::DEVICE_MEMORY ? granularity(d) : PhyBlock::granularity_of(d, t, numa_node);
+        };
+        size_t source_page = page_of(migration.source_device, migration.source_tier, source_numa_node);
+        size_t target_page = page_of(device, tier, host_numa_node);
+        migration.page = std::max(source_page, target_page);
+        bool aligned = source_page > 0 && target_page > 0 && migration.page % std::min(source_page, target_page) == 0;
+        for (size_t i = 0; aligned && i < migration.pieces.size(); i++) {
+            Address next = i + 1 < migration.pieces.size() ? migration.pieces[i + 1] : addr + migration.size;
+            aligned = (next - migration.pieces[i]) % migration.page == 0;
+        }
+        if (!aligned) {
+            throw std::invalid_argument("migrate: the pieces of the range at " + std::to_string(addr) + " are not a multiple of the granularities of " +
+                                        memory_tier_name(migration.source_tier) + " memory of device " + std::to_string(migration.source_device) +
+                                        " and " + memory_tier_name(tier) + " memory of device " + std::to_string(device));
+        }
+        migration.target_device = device;
+        migration.target_tier = tier;
+        ensure_context(migration.source_device);
+
+        // a move between the tiers of a device keeps the accessing device
+        if (migration.source_device != device) {
+            int peer_access = 0;
+            DRV_TRY(cuDeviceCanAccessPeer(&peer_access, migration.source_device, device));
+            migration.peer_access = peer_access != 0;
+            if (!migration.peer_access) {
+                std::cout << "[VmmAllocator::migrate_begin] device " << migration.source_device << " cannot access device " << device << ", the tensors over " << addr << " must be used on device " << device << " once migrated." << std::endl;
+            }
+        }
+
+        // 1. a range mapped by one block moves by chunks : it is mapped with a block per chunk first, in the source
+        // memory. Without room for a copy there (a range leaving a full device), the chunks are made in the target
+        // memory and the range moves at once.
+        size_t chunk = std::max(migration.page, ROUND_UP(CEIL_DIV(migration.size, max_scatter_pieces), migration.page));
+        if (whole != nullptr && migration.size > chunk) {
+            auto make_chunks = [&](int d, MemoryTier t, int numa_node, std::vector<std::shared_ptr<PhyBlock>>* chunks) -> CUresult {
+                for (size_t offset = 0; offset < migration.size; offset += chunk) {
+                    auto block = std::make_shared<PhyBlock>(d, std::min(chunk, migration.size - offset), t, numa_node);
+                    if (block->status != CUDA_SUCCESS) {
+                        chunks->clear();
+                        return block->status;
+                    }
+                    block->lifetime = whole->lifetime;
+                    chunks->push_back(block);
+                }
+                return CUDA_SUCCESS;
+            };
+            std::vector<std::shared_ptr<PhyBlock>> chunks;
+            bool at_once = make_chunks(migration.source_device, migration.source_tier, source_numa_node, &chunks) != CUDA_SUCCESS;
+            if (at_once) {
+                CUresult status = make_chunks(device, tier, host_numa_node, &chunks);
+                if (status != CUDA_SUCCESS) {
+                    throw_out_of_memory(chunk, device, status);
+                }
+            }
+            migration.pieces = split_mapping(ptr, whole, migration.size, chunks, at_once && migration.peer_access);
+            if (at_once) {
+                migration.moved = migration.pieces.size();
+                std::lock_guard<std::mutex> lock(migrate_mtx);
+                migration_counters.pages += migration.size / migration.page;
+                migration_counters.bytes += migration.size;
+            }
+        }
+
+        // 2. the staging range the pieces are copied to, mapped to one new block of the target at a time
+        size_t largest = 0;
+        for (size_t i = 0; i < migration.pieces.size(); i++) {
+            Address next = i + 1 < migration.pieces.size() ? migration.pieces[i + 1] : addr + migration.size;
+            largest = std::max(largest, next - migration.pieces[i]);
+        }
+        CUresult result = reserve_virtual_addr((void **)&migration.staging, largest, &migration.staging_size, device, 0/*stream*/);
+        if (result != CUDA_SUCCESS) {
+            throw_out_of_memory(largest, device, result);
+        }
+
+        std::cout << "[VmmAllocator::migrate_begin] migrate " << migration.pieces.size() << " pieces at " << addr << " from " << memory_tier_name(migration.source_tier) << " memory of device " << migration.source_device
+                  << " to " << memory_tier_name(tier) << " memory of device " << device << std::endl;
+        std::lock_guard<std::mutex> lock(migrate_mtx);
+        migrations[addr] = std::move(migration);
+        num_migrations = migrations.size();
+    }
+
+    HOST_INLINE std::vector<VmmAllocator::Address> VmmAllocator::split_mapping(void* ptr, PhyBlock* block, size_t size,
+                                                                               const std::vector<std::shared_ptr<PhyBlock>>& chunks, bool peer_access) {
+        Address addr = reinterpret_cast<Address>(ptr);
+        int device = block->device_id;
+        int chunk_device = chunks[0]->device_id;
+
+        // 1. the block mapped again at a staging range, the copy reads it there
+        CUdeviceptr staging;
+        size_t staging_size = 0;
+        CUresult result = reserve_virtual_addr((void **)&staging, size, &staging_size, device, 0/*stream*/);
+        if (result != CUDA_SUCCESS) {
+            throw_out_of_memory(size, device, result);
+        }
+        if (!block->map_alias(staging, size)) {
+            release_reservation((void *)staging);
+            throw std::runtime_error("migrate: failed to map the range at " + std::to_string(addr) + " to a staging range");
+        }
+
+        // 2. the chunks take the place of the block, which is mapped back on failure
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            result = DRV_TRY(DRV_TIMED(MEM_UNMAP, size, cuMemUnmap(addr, size)));
+            if (result == CUDA_SUCCESS) {
+                block->mapped_addresses.erase(addr);
+                block->remaining_size += size;
+                shm_add(device, &ShmDeviceStats::mapped_bytes, -(int64_t)size);
+                shm_add(device, &ShmDeviceStats::free_block_bytes, size);
+                allocated_blocks.erase(addr);
+            }
+        }
+        std::vector<Address> pieces;
+        bool restored = true;
+        if (result == CUDA_SUCCESS) {
+            Address piece = addr;
+            for (size_t i = 0; i < chunks.size() && result == CUDA_SUCCESS; i++) {
+                if (!map_virtual_address(chunks[i].get(), reinterpret_cast<void *>(piece), chunks[i]->block_size)) {
+                    result = CUDA_ERROR_OUT_OF_MEMORY;
+                    break;
+                }
+                pieces.push_back(piece);
+                if (peer_access) {
+                    result = set_peer_access(piece, chunks[i]->block_size, chunk_device, device);
+                }
+                piece += chunks[i]->block_size;
+            }
+            if (result == CUDA_SUCCESS) {
+                result = copy_peer(addr, chunk_device, staging, device, size);
+            }
+            if (result != CUDA_SUCCESS) {
+                for (size_t i = 0; i < pieces.size(); i++) {
+                    chunks[i]->unmap_virtual_address(pieces[i], chunks[i]->block_size, false/*release_address*/);
+                    std::lock_guard<TracedMutex> lock(mtx);
+                    allocated_blocks.erase(pieces[i]);
+                }
+                restored = map_virtual_address(block, ptr, size);
+            }
+        }
+        block->unmap_alias(staging);
+        release_reservation((void *)staging);
+        if (result != CUDA_SUCCESS) {
+            throw std::runtime_error("migrate: failed to split the range at " + std::to_string(addr) + ", error " + std::to_string((int)result) +
+                                     (restored ? "" : ", the range is left unmapped"));
+        }
+
+        // 3. the chunks join the owned pool, the block is released with its last mapping
+        std::lock_guard<TracedMutex> lock(mtx);
+        for (auto& piece : chunks) {
+            bool status = owned_pool.add(piece);
+            assert(status);
+        }
+        scattered_ranges[addr] = pieces;
+        owned_pool.update(block, block->remaining_size - size);
+        if (block->idle()) {
+            owned_pool.remove(block);
+        }
+        std::cout << "[VmmAllocator::split_mapping] range at " << addr << " of " << size << " bytes is now mapped with " << pieces.size() << " blocks." << std::endl;
+        return pieces;
+    }
+
+    HOST_INLINE void VmmAllocator::migrate_piece(Migration& m, Address piece) {
+        PhyBlock* source;
+        size_t size;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            source = allocated_blocks.at(piece);
+            size = source->mapped_addresses.at(piece);
+        }
+
+        // 1. copy the piece to a new block of the target, mapped at the staging range
+        auto target = std::make_shared<PhyBlock>(m.target_device, size, m.target_tier, host_numa_node);
+        if (target->status != CUDA_SUCCESS) {
+            // the cached memory is released first, as alloc_mapped does
+            empty_cache();
+            target = std::make_shared<PhyBlock>(m.target_device, size, m.target_tier, host_numa_node);
+        }
+        if (target->status != CUDA_SUCCESS) {
+            throw_out_of_memory(size, m.target_device, target->status);
+        }
+        target->lifetime = source->lifetime;
+        if (!target->map_alias(m.staging, size)) {
+            throw std::runtime_error("migrate: failed to map a block of device " + std::to_string(m.target_device) + " to the staging range");
+        }
+        CUresult result = copy_peer(m.staging, m.target_device, piece, m.source_device, size);
+        target->unmap_alias(m.staging);
+        if (result != CUDA_SUCCESS) {
+            throw std::runtime_error("migrate: failed to copy the piece at " + std::to_string(piece) + ", error " + std::to_string((int)result));
+        }
+
+        // 2. swap the blocks, the source is mapped back on failure
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            result = DRV_TRY(DRV_TIMED(MEM_UNMAP, size, cuMemUnmap(piece, size)));
+            if (result == CUDA_SUCCESS) {
+                source->mapped_addresses.erase(piece);
+                source->remaining_size += size;
+                shm_add(m.source_device, &ShmDeviceStats::mapped_bytes, -(int64_t)size);
+                shm_add(m.source_device, &ShmDeviceStats::free_block_bytes, size);
+                allocated_blocks.erase(piece);
+            }
+        }
+        if (result != CUDA_SUCCESS) {
+            throw std::runtime_error("migrate: failed to unmap the piece at " + std::to_string(piece) + ", error " + std::to_string((int)result));
+        }
+        bool mapped = map_virtual_address(target.get(), reinterpret_cast<void *>(piece), size);
+        if (mapped && m.peer_access && set_peer_access(piece, size, m.target_device, m.source_device) != CUDA_SUCCESS) {
+            target->unmap_virtual_address(piece, size, false/*release_address*/);
+            std::lock_guard<TracedMutex> lock(mtx);
+            allocated_blocks.erase(piece);
+            mapped = false;
+        }
+        if (!mapped) {
+            bool restored = map_virtual_address(source, reinterpret_cast<void *>(piece), size);
+            throw std::runtime_error("migrate: failed to map the piece at " + std::to_string(piece) + " on device " + std::to_string(m.target_device) +
+                                     (restored ? "" : ", the piece is left unmapped"));
+        }
+
+        // 3. the target joins the owned pool, the source is released with its last mapping
+        std::lock_guard<TracedMutex> lock(mtx);
+        bool status = owned_pool.add(target);
+        assert(status);
+        owned_pool.update(source, source->remaining_size - size);
+        if (source->idle()) {
+            owned_pool.remove(source);
+        }
+    }
+
+    HOST_INLINE size_t VmmAllocator::migrate_step(void* ptr, size_t budget_bytes) {
+        VT_TRACE_SCOPE("VmmAllocator::migrate_step", budget_bytes);
+        Address addr = reinterpret_cast<Address>(ptr);
+
+        std::unique_lock<std::mutex> lock(migrate_mtx);
+        auto it = migrations.find(addr);
+        if (it == migrations.end()) {
+            throw std::invalid_argument("migrate: range at " + std::to_string(addr) + " is not being migrated");
+        }
+        Migration& m = it->second;
+        if (m.in_flight) {
+            throw std::invalid_argument("migrate: range at " + std::to_string(addr) + " is being copied by another thread");
+        }
+        ensure_context(m.source_device);
+
+        // 1. the next pieces, at least one. A piece is copied without migrate_mtx, a dealloc of the range or the
+        //    other migrations wait for that piece only.
+        size_t moved_bytes = 0;
+        while (m.moved < m.pieces.size() && !m.cancelled) {
+            Address piece = m.pieces[m.moved];
+            size_t size = (m.moved + 1 < m.pieces.size() ? m.pieces[m.moved + 1] : addr + m.size) - piece;
+            if (moved_bytes > 0 && moved_bytes + size > budget_bytes) {
+                break;
+            }
+            m.in_flight = true;
+            lock.unlock();
+            try {
+                migrate_piece(m, piece);
+            } catch (...) {
+                lock.lock();
+                m.in_flight = false;
+                migrate_cv.notify_all();
+                throw;
+            }
+            lock.lock();
+            m.in_flight = false;
+            m.moved++;
+            moved_bytes += size;
+            migration_counters.pages += size / m.page;
+            migration_counters.bytes += size;
+            migrate_cv.notify_all();
+        }
+        if (m.moved < m.pieces.size()) {
+            return addr + m.size - m.pieces[m.moved];
+        }
+
+        // 2. all the pieces moved : the reservation belongs to the target device
+        release_reservation((void *)m.staging);
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            auto reserved = reserved_addresses.find(addr);
+            if (reserved != reserved_addresses.end()) {
+                reserved->second.second = m.target_device;
+                shm_add(m.source_device, &ShmDeviceStats::reserved_bytes, -(int64_t)reserved->second.first);
+                shm_add(m.target_device, &ShmDeviceStats::reserved_bytes, reserved->second.first);
+            }
+            if (m.target_tier != m.source_tier) {
+                tier_moves[(int)m.target_tier]++;
+                tier_moved_bytes[(int)m.target_tier] += m.size;
+            }
+        }
+
+        std::cout << "[VmmAllocator::migrate_step] range at " << addr << " of " << m.size << " bytes now lives in " << memory_tier_name(m.target_tier) << " memory of device " << m.target_device << std::endl;
+        migration_counters.completed++;
+        migrations.erase(it);
+        num_migrations = migrations.size();
+        return 0;
+    }
+
+    HOST_INLINE size_t VmmAllocator::migrate(void* ptr, int device) {
+        return migrate(ptr, device, MemoryTier::DEVICE_MEMORY);
+    }
+
+    HOST_INLINE size_t VmmAllocator::migrate(void* ptr, int device, MemoryTier tier) {
+        VT_TRACE_SCOPE("VmmAllocator::migrate", 0);
+        migrate_begin(ptr, device, tier);
+        size_t size;
+        {
+            std::lock_guard<std::mutex> lock(migrate_mtx);
+            size = migrations[reinterpret_cast<Address>(ptr)].size;
+        }
+        try {
+            size_t left = size;
+            while (left > 0) {
+                left = migrate_step(ptr, size);
+            }
+        } catch (...) {
+            revert_migration(ptr);
+            throw;
+        }
+        return size;
+    }
+
+    HOST_INLINE std::map<VmmAllocator::Address, VmmAllocator::Migration>::iterator VmmAllocator::claim_migration(std::unique_lock<std::mutex>& lock, Address addr) {
+        auto it = migrations.find(addr);
+        if (it != migrations.end() && it->second.in_flight) {
+            it->second.cancelled = true;
+            // the copying thread may also complete the migration meanwhile
+            migrate_cv.wait(lock, [&] {
+                it = migrations.find(addr);
+                return it == migrations.end() || !it->second.in_flight;
+            });
+        }
+        return it;
+    }
+
+    HOST_INLINE bool VmmAllocator::revert_migration(void* ptr) {
+        Address addr = reinterpret_cast<Address>(ptr);
+        std::unique_lock<std::mutex> lock(migrate_mtx);
+        auto it = claim_migration(lock, addr);
+        if (it == migrations.end()) {
+            return true;
+        }
+        Migration& m = it->second;
+
+        // the same pieces the other way, one at a time without migrate_mtx like migrate_step. The source needs no
+        // access to its own memory.
+        Migration back = m;
+        std::swap(back.source_device, back.target_device);
+        std::swap(back.source_tier, back.target_tier);
+        back.peer_access = false;
+        while (m.moved > 0) {
+            m.in_flight = true;
+            lock.unlock();
+            std::string error;
+            try {
+                migrate_piece(back, m.pieces[m.moved - 1]);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            lock.lock();
+            m.in_flight = false;
+            migrate_cv.notify_all();
+            if (!error.empty()) {
+                std::cout << "[VmmAllocator::revert_migration] " << error << ", " << m.moved << " pieces at " << addr << " stay in " << memory_tier_name(m.target_tier) << " memory of device " << m.target_device << std::endl;
+                return false;
+            }
+            m.moved--;
+            if (m.cancelled) {
+                // the range is being freed, its pieces are unmapped wherever they are
+                return false;
+            }
+        }
+        CUdeviceptr staging = m.staging;
+        migrations.erase(it);
+        num_migrations = migrations.size();
+        lock.unlock();
+        release_reservation((void *)staging);
+        std::cout << "[VmmAllocator::revert_migration] range at " << addr << " is back in its source memory" << std::endl;
+        return true;
+    }
+
+    HOST_INLINE bool VmmAllocator::migrating(void* ptr) {
+        if (num_migrations == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(migrate_mtx);
+        return migrations.count(reinterpret_cast<Address>(ptr)) > 0;
+    }
+
+    HOST_INLINE void VmmAllocator::cancel_migration(void* ptr) {
+        // every dealloc comes through here, without any migration it does not take migrate_mtx
+        if (num_migrations == 0) {
+            return;
+        }
+        CUdeviceptr staging;
+        {
+            std::unique_lock<std::mutex> lock(migrate_mtx);
+            auto it = claim_migration(lock, reinterpret_cast<Address>(ptr));
+            if (it == migrations.end()) {
+                return;
+            }
+            staging = it->second.staging;
+            migrations.erase(it);
+            num_migrations = migrations.size();
+        }
+        release_reservation((void *)staging);
+    }
+
+    HOST_INLINE MigrationStats VmmAllocator::migration_stats() {
+        std::lock_guard<std::mutex> lock(migrate_mtx);
+        MigrationStats stats = migration_counters;
+        stats.active = migrations.size();
+        return stats;
+    }
+
+    HOST_INLINE void VmmAllocator::set_tag_tier(const std::string& tag, MemoryTier tier) {
+        std::lock_guard<TracedMutex> lock(mtx);
+        if (tier == MemoryTier::DEVICE_MEMORY) {
+            tag_tiers.erase(tag);
+        } else {
+            tag_tiers[tag] = tier;
+        }
+        std::cout << "[VmmAllocator::set_tag_tier] allocations of tag " << tag << " are placed in " << memory_tier_name(tier) << " memory." << std::endl;
+    }
+
+    HOST_INLINE MemoryTier VmmAllocator::tag_tier(const std::string& tag) {
+        std::lock_guard<TracedMutex> lock(mtx);
+        auto it = tag_tiers.find(tag);
+        return it != tag_tiers.end() ? it->second : MemoryTier::DEVICE_MEMORY;
+    }
+
+    HOST_INLINE MemoryTier VmmAllocator::tier_of(void* ptr) {
+        Address addr = reinterpret_cast<Address>(ptr);
+        std::lock_guard<TracedMutex> lock(mtx);
+        // the mapping containing `ptr`, slab allocations are inside their chunk
+        auto it = allocated_blocks.upper_bound(addr);
+        if (it != allocated_blocks.begin()) {
+            --it;
+            auto mapping = it->second->mapped_addresses.find(it->first);
+            size_t size = mapping != it->second->mapped_addresses.end() ? mapping->second : 0;
+            if (addr < it->first + size) {
+                return it->second->tier;
+            }
+        }
+        throw std::invalid_argument("tier_of: nothing is mapped at address " + std::to_string(addr));
+    }
+
+    HOST_INLINE size_t VmmAllocator::move_to_tier(void* ptr, MemoryTier tier) {
+        VT_TRACE_SCOPE("VmmAllocator::move_to_tier", 0);
+        Address addr = reinterpret_cast<Address>(ptr);
+        int device = 0;
+        {
+            // a moved range is mapped by pieces : it is in `tier` when all of them are
+            std::lock_guard<TracedMutex> lock(mtx);
+            auto reserved = reserved_addresses.find(addr);
+            if (reserved == reserved_addresses.end() || allocated_blocks.find(addr) == allocated_blocks.end()) {
+                throw std::invalid_argument("move_to_tier: address " + std::to_string(addr) + " is not the start of an allocation");
+            }
+            device = reserved->second.second;
+            auto scattered = scattered_ranges.find(addr);
+            std::vector<Address> pieces = scattered != scattered_ranges.end() ? scattered->second : std::vector<Address>{addr};
+            bool moved = true;
+            for (Address piece : pieces) {
+                auto it = allocated_blocks.find(piece);
+                moved = moved && it != allocated_blocks.end() && it->second->tier == tier;
+            }
+            if (moved) {
+                return 0;
+            }
+        }
+        // piece by piece, the source is restored if a piece cannot be moved
+        return migrate(ptr, device, tier);
+    }
+
+    HOST_INLINE std::vector<TierStats> VmmAllocator::tier_stats() {
+        std::lock_guard<TracedMutex> lock(mtx);
+        std::vector<TierStats> stats((int)MemoryTier::N);
+        for (auto& it : owned_pool.blocks) {
+            PhyBlock* block = it.second.get();
+            TierStats& s = stats[(int)block->tier];
+            s.blocks++;
+            s.physical_bytes += block->block_size;
+            s.free_block_bytes += block->remaining_size;
+        }
+        for (int i = 0; i < (int)MemoryTier::N; i++) {
+            stats[i].num_allocs = tier_allocs[i];
+            stats[i].moved_in = tier_moves[i];
+            stats[i].moved_in_bytes = tier_moved_bytes[i];
+        }
+        stats[(int)MemoryTier::HOST_MEMORY].spilled_allocs = tier_spills;
+        return stats;
+    }
+
+    HOST_INLINE void VmmAllocator::symmetric_init(const std::string& path, int rank, int world_size, size_t size, int device, int timeout_ms) {
+        {
+            std::lock_guard<std::mutex> lock(symmetric_mtx);
+            if (symmetric_heap != nullptr) {
+                throw std::runtime_error("symmetric_init: the heap of rank " + std::to_string(symmetric_heap->rank()) + " exists, call symmetric_finalize first");
+            }
+        }
+        // the ranks wait for each other, not under the lock
+        auto heap = std::make_shared<SymmetricHeap>(path, rank, world_size, size, device, timeout_ms);
+
+        std::lock_guard<std::mutex> lock(symmetric_mtx);
+        symmetric_heap = heap;
+    }
+
+    HOST_INLINE void VmmAllocator::symmetric_finalize() {
+        std::lock_guard<std::mutex> lock(symmetric_mtx);
+        if (symmetric_heap == nullptr) {
+            return;
+        }
+        if (symmetric_heap->reserved_bytes() > 0) {
+            throw std::runtime_error("symmetric_finalize: " + std::to_string(symmetric_heap->reserved_bytes()) + " bytes of the heap are still allocated");
+        }
+        symmetric_heap = nullptr;
+    }
+
+    HOST_INLINE CUresult VmmAllocator::reserve_symmetric(void** ptr, size_t request_size, size_t* reserved_size, int device) {
+        std::lock_guard<std::mutex> lock(symmetric_mtx);
+        if (symmetric_heap == nullptr || symmetric_heap->device() != device) {
+            return CUDA_ERROR_NOT_INITIALIZED;
+        }
+        *ptr = symmetric_heap->reserve(request_size, reserved_size);
+        return *ptr != nullptr ? CUDA_SUCCESS : CUDA_ERROR_OUT_OF_MEMORY;
+    }
+
+    HOST_INLINE void* VmmAllocator::alloc_symmetric(size_t size, int device) {
+        VT_TRACE_SCOPE("VmmAllocator::alloc_symmetric", size);
+        ensure_context(device);
+
+        void* ptr = nullptr;
+        size_t reserved_size = 0;
+        CUresult result = reserve_symmetric(&ptr, size, &reserved_size, device);
+        if (result == CUDA_ERROR_NOT_INITIALIZED) {
+            throw std::runtime_error("alloc_symmetric: no symmetric heap on device " + std::to_string(device) + ", call symmetric_init first");
+        }
+        if (result != CUDA_SUCCESS) {
+            throw_out_of_memory(size, device, result);
+        }
+        result = map_reserved(ptr, reserved_size, device);
+        if (result != CUDA_SUCCESS) {
+            empty_cache();
+            result = map_reserved(ptr, reserved_size, device);
+        }
+        if (result != CUDA_SUCCESS) {
+            {
+                std::lock_guard<std::mutex> lock(symmetric_mtx);
+                symmetric_heap->release(ptr);
+            }
+            throw_out_of_memory(size, device, result);
+        }
+
+        std::lock_guard<std::mutex> lock(symmetric_mtx);
+        std::cout << "[VmmAllocator::alloc_symmetric] " << reserved_size << " bytes at offset " << symmetric_heap->offset_of(ptr) << " of the heap" << std::endl;
+        return ptr;
+    }
+
+    HOST_INLINE bool VmmAllocator::dealloc_symmetric(void* ptr) {
+        std::shared_ptr<SymmetricHeap> heap;
+        size_t size = 0;
+        {
+            std::lock_guard<std::mutex> lock(symmetric_mtx);
+            if (symmetric_heap == nullptr || !symmetric_heap->contains(ptr)) {
+                return false;
+            }
+            heap = symmetric_heap;
+            size = heap->range_size(ptr);
+        }
+        if (size == 0) {
+            return false;
+        }
+
+        // the range may be mapped in pieces (scattered, or one mapping per partition of a VmmTensor)
+        if (!unmap_scattered(ptr)) {
+            Address begin = reinterpret_cast<Address>(ptr);
+            std::vector<std::pair<Address, PhyBlock*>> pieces;
+            {
+                std::lock_guard<TracedMutex> lock(mtx);
+                auto it = allocated_blocks.lower_bound(begin);
+                while (it != allocated_blocks.end() && it->first < begin + size) {
+                    pieces.push_back(*it);
+                    alloc_stacks.erase(it->first);
+                    it = allocated_blocks.erase(it);
+                }
+            }
+            for (auto& piece : pieces) {
+                PhyBlock* block = piece.second;
+                size_t old_capacity = block->remaining_size;
+                block->unmap_virtual_address(piece.first, 0, false/*release_address*/);
+                std::lock_guard<TracedMutex> lock(mtx);
+                owned_pool.update(block, old_capacity);
+            }
+        }
+        heap->release(ptr);
+        return true;
+    }
+
+    HOST_INLINE std::shared_ptr<VmmAllocator::PhyBlock> VmmAllocator::zero_page(int device) {
+        std::lock_guard<std::mutex> lock(zero_mtx);
+        std::shared_ptr<PhyBlock> page = zero_pages[device].lock();
+        if (page != nullptr) {
+            return page;
+        }
+
+        size_t page_size = granularity(device);
+        if (page_size == 0) {
+            throw std::invalid_argument("zero_page: cannot query the granularity of device " + std::to_string(device));
+        }
+        page = std::make_shared<PhyBlock>(device, page_size);
+        if (page->status != CUDA_SUCCESS) {
+            empty_cache();
+            page = std::make_shared<PhyBlock>(device, page_size);
+        }
+        if (page->status != CUDA_SUCCESS) {
+            throw_out_of_memory(page_size, device, page->status);
+        }
+
+        // filled once, through a writable mapping dropped right after
+        CUdeviceptr addr = 0;
+        size_t reserved_size = 0;
+        CUresult result = reserve_virtual_addr((void **)&addr, page_size, &reserved_size, device, 0/*stream*/);
+        if (result != CUDA_SUCCESS) {
+            throw_out_of_memory(page_size, device, result);
+        }
+        result = CUDA_ERROR_OUT_OF_MEMORY;
+        if (page->map_alias(addr, page_size)) {
+            result = DRV_TRY(cuMemsetD8(addr, 0, page_size));
+            if (result == CUDA_SUCCESS) {
+                result = DRV_TRY(cuCtxSynchronize());
+            }
+            page->unmap_alias(addr);
+        }
+        release_reservation((void *)addr);
+        if (result != CUDA_SUCCESS) {
+            throw_out_of_memory(page_size, device, result);
+        }
+
+        zero_pages[device] = page;
+        std::cout << "[VmmAllocator::zero_page] zero page of device " << device << " is Block#" << page->block_id << std::endl;
+        return page;
+    }
+
+    HOST_INLINE size_t VmmAllocator::granularity(int device) {
+        std::lock_guard<TracedMutex> lock(mtx);
+        auto it = granularities.find(device);
+        if (it != granularities.end()) {
+            return it->second;
+        }
+
+        CUmemAllocationProp prop = {};
+        prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+        prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+        prop.location.id = device;
+
+        size_t granularity = 0;
+        if (DRV_TRY(cuMemGetAllocationGranularity(&granularity, &prop, CU_MEM_ALLOC_GRANULARITY_MINIMUM)) != CUDA_SUCCESS) {
+            return 0;
+        }
+        granularities[device] = granularity;
+        return granularity;
+    }
+
+    HOST_INLINE void VmmAllocator::set_step_prewarm(bool enabled, int warmup_steps) {
+        {
+            std::lock_guard<std::mutex> lock(step_mtx);
+            step_profiler.enabled = enabled;
+            step_profiler.in_step = false;
+            step_profiler.warmup_steps = std::max(warmup_steps, 1);
+            step_profiler.learned.clear();
+            step_profiler.step_max = step_profiler.live;
+            step_profiler.step_peak_bytes = step_profiler.live_bytes;
+            step_profiler.stats = StepStats();
+        }
+        if (!enabled) {
+            release_warm(true/*all*/);
+        }
+    }
+
+    HOST_INLINE void VmmAllocator::begin_step() {
+        VT_TRACE_SCOPE("VmmAllocator::begin_step", 0);
+        std::map<WarmKey, size_t> missing;
+        {
+            std::lock_guard<std::mutex> lock(step_mtx);
+            if (!step_profiler.enabled) {
+                return;
+            }
+            step_profiler.in_step = true;
+            if (!step_profiler.stats.learned) {
+                return;
+            }
+            for (auto& it : step_profiler.learned) {
+                size_t have = step_profiler.live[it.first] + step_profiler.warm.count(it.first);
+                if (have < it.second) {
+                    missing[it.first] = it.second - have;
+                }
+            }
+        }
+
+        // map ahead of the step what the profile needs and the cache lacks
+        for (auto& it : missing) {
+            for (size_t i = 0; i < it.second; i++) {
+                void* ptr = nullptr;
+                try {
+                    ptr = alloc_mapped(it.first.second, it.first.first, 0/*stream*/);
+                } catch (const OutOfMemoryError& e) {
+                    // the step allocations will report the error if they really need the memory
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(step_mtx);
+                step_profiler.warm.insert({it.first, reinterpret_cast<Address>(ptr)});
+                step_profiler.stats.prewarmed++;
+                shm_add(it.first.first, &ShmDeviceStats::cached_bytes, it.first.second);
+            }
+        }
+    }
+
+    HOST_INLINE void VmmAllocator::end_step() {
+        {
+            std::lock_guard<std::mutex> lock(step_mtx);
+            StepProfiler& profiler = step_profiler;
+            if (!profiler.enabled || !profiler.in_step) {
+                return;
+            }
+            profiler.in_step = false;
+            profiler.stats.steps++;
+            profiler.stats.actual_peak_bytes = profiler.step_peak_bytes;
+
+            if (!profiler.stats.learned) {
+                for (auto& it : profiler.step_max) {
+                    profiler.learned[it.first] = std::max(profiler.learned[it.first], it.second);
+                }
+                profiler.stats.predicted_peak_bytes = std::max(profiler.stats.predicted_peak_bytes, profiler.step_peak_bytes);
+                if ((int)profiler.stats.steps >= profiler.warmup_steps) {
+                    profiler.stats.learned = true;
+                    std::cout << "[VmmAllocator::end_step] learned a profile of " << profiler.learned.size() << " sizes, predicted peak " << profiler.stats.predicted_peak_bytes << " bytes." << std::endl;
+                }
+            }
+
+            // the ranges still live open the next step
+            profiler.step_max = profiler.live;
+            profiler.step_peak_bytes = profiler.live_bytes;
+        }
+
+        if (step_profiler.stats.learned) {
+            release_warm(false/*all*/);
+        }
+    }
+
+    HOST_INLINE StepStats VmmAllocator::step_stats() {
+        std::lock_guard<std::mutex> lock(step_mtx);
+        StepStats stats = step_profiler.stats;
+        for (auto& it : step_profiler.warm) {
+            stats.warm_bytes += it.first.second;
+        }
+        return stats;
+    }
+
+    HOST_INLINE void* VmmAllocator::alloc_transient(size_t size, int device) {
+        VT_TRACE_SCOPE("VmmAllocator::alloc_transient", size);
+        // sub-ranges are aligned like the slab slots
+        size_t bumped = ROUND_UP(std::max(size, (size_t)1), SlabAllocator::kMinSlotSize);
+        if (bumped > transient_block_size) {
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(transient_mtx);
+        TransientArena* arena = nullptr;
+        Address base = 0;
+        for (auto& it : transient_arenas) {
+            if (it.second.device == device && it.second.offset + bumped <= it.second.size) {
+                base = it.first;
+                arena = &it.second;
+                break;
+            }
+        }
+
+        if (arena == nullptr) {
+            // a new arena : one block, mapped once over its own reservation
+            CUdeviceptr dptr;
+            size_t reserved_size = 0;
+            if (reserve_virtual_addr((void **)&dptr, transient_block_size, &reserved_size, device, 0/*stream*/) != CUDA_SUCCESS) {
+                return nullptr;
+            }
+            auto block = std::make_shared<PhyBlock>(device, reserved_size, MemoryTier::DEVICE_MEMORY, host_numa_node);
+            if (block->status != CUDA_SUCCESS) {
+                // the caller maps a block sized to the request instead
+                release_reservation((void *)dptr);
+                return nullptr;
+            }
+            block->lifetime = Lifetime::TRANSIENT;
+            if (!map_virtual_address(block.get(), (void *)dptr, reserved_size)) {
+                release_reservation((void *)dptr);
+                return nullptr;
+            }
+            {
+                std::lock_guard<TracedMutex> lock(mtx);
+                bool status = owned_pool.add(block);
+                assert(status);
+            }
+
+            base = dptr;
+            arena = &transient_arenas[base];
+            arena->device = device;
+            arena->size = reserved_size;
+            arena->block = block.get();
+            std::cout << "[VmmAllocator::alloc_transient] map arena " << base << " of " << reserved_size << " bytes in block#" << block->block_id << std::endl;
+        }
+
+        Address addr = base + arena->offset;
+        arena->offset += bumped;
+        arena->live++;
+        transient_allocations[addr] = bumped;
+        return reinterpret_cast<void *>(addr);
+    }
+
+    HOST_INLINE bool VmmAllocator::dealloc_transient(void* ptr) {
+        Address addr = reinterpret_cast<Address>(ptr);
+        std::lock_guard<std::mutex> lock(transient_mtx);
+        auto it = transient_allocations.find(addr);
+        if (it == transient_allocations.end()) {
+            return false;
+        }
+        transient_allocations.erase(it);
+
+        // the arena containing `ptr`, rewound with its last allocation
+        auto arena = transient_arenas.upper_bound(addr);
+        assert(arena != transient_arenas.begin());
+        --arena;
+        if (--arena->second.live == 0) {
+            arena->second.offset = 0;
+        }
+        return true;
+    }
+
+    HOST_INLINE size_t VmmAllocator::transient_size(void* ptr) {
+        std::lock_guard<std::mutex> lock(transient_mtx);
+        auto it = transient_allocations.find(reinterpret_cast<Address>(ptr));
+        return it != transient_allocations.end() ? it->second : 0;
+    }
+
+    HOST_INLINE void VmmAllocator::release_transient_arenas() {
+        std::lock_guard<std::mutex> lock(transient_mtx);
+        for (auto it = transient_arenas.begin(); it != transient_arenas.end(); ) {
+            if (it->second.live > 0) {
+                ++it;
+                continue;
+            }
+            std::cout << "[VmmAllocator::release_transient_arenas] unmap arena " << it->first << " of " << it->second.size << " bytes" << std::endl;
+            // unmapping also frees the virtual address
+            unmap_virtual_address(it->second.block, reinterpret_cast<void *>(it->first), it->second.size);
+            it = transient_arenas.erase(it);
+        }
+    }
+
+    HOST_INLINE void* VmmAllocator::alloc_warm(size_t size, int device, CUstream stream) {
+        {
+            std::lock_guard<std::mutex> lock(step_mtx);
+            if (!step_profiler.enabled || !step_profiler.in_step) {
+                return nullptr;
+            }
+        }
+
+        size_t page = granularity(device);
+        if (page == 0) {
+            return nullptr;
+        }
+        WarmKey key(device, ROUND_UP(size, page));
+
+        void* ptr = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(step_mtx);
+            auto it = step_profiler.warm.find(key);
+            if (it != step_profiler.warm.end()) {
+                ptr = reinterpret_cast<void *>(it->second);
+                step_profiler.warm.erase(it);
+                step_profiler.stats.hits++;
+                shm_add(device, &ShmDeviceStats::cached_bytes, -(int64_t)key.second);
+            }
+        }
+
+        if (ptr == nullptr) {
+            ptr = alloc_mapped(key.second, device, stream);
+            std::lock_guard<std::mutex> lock(step_mtx);
+            step_profiler.stats.misses++;
+        }
+
+        std::lock_guard<std::mutex> lock(step_mtx);
+        StepProfiler& profiler = step_profiler;
+        profiler.allocations[reinterpret_cast<Address>(ptr)] = key;
+        size_t live = ++profiler.live[key];
+        profiler.step_max[key] = std::max(profiler.step_max[key], live);
+        profiler.live_bytes += key.second;
+        profiler.step_peak_bytes = std::max(profiler.step_peak_bytes, profiler.live_bytes);
+        return ptr;
+    }
+
+    HOST_INLINE bool VmmAllocator::dealloc_warm(void* ptr) {
+        std::lock_guard<std::mutex> lock(step_mtx);
+        StepProfiler& profiler = step_profiler;
+        auto it = profiler.allocations.find(reinterpret_cast<Address>(ptr));
+        if (it == profiler.allocations.end()) {
+            return false;
+        }
+
+        WarmKey key = it->second;
+        profiler.allocations.erase(it);
+        profiler.live[key]--;
+        profiler.live_bytes -= key.second;
+        if (!profiler.enabled) {
+            // freed after the profiler was disabled : unmapped by dealloc
+            return false;
+        }
+
+        // stays mapped for the next allocation of the same size
+        profiler.warm.insert({key, reinterpret_cast<Address>(ptr)});
+        shm_add(key.first, &ShmDeviceStats::cached_bytes, key.second);
+        return true;
+    }
+
+    HOST_INLINE size_t VmmAllocator::release_warm(bool all) {
+        VT_TRACE_SCOPE("VmmAllocator::release_warm", 0);
+        std::vector<std::pair<Address, size_t>> ranges;
+        {
+            std::lock_guard<std::mutex> lock(step_mtx);
+            StepProfiler& profiler = step_profiler;
+            auto it = profiler.warm.begin();
+            while (it != profiler.warm.end()) {
+                const WarmKey key = it->first;
+                size_t keep = 0;
+                if (!all) {
+                    auto learned = profiler.learned.find(key);
+                    size_t needed = learned == profiler.learned.end() ? 0 : learned->second;
+                    size_t live = profiler.live[key];
+                    keep = needed > live ? needed - live : 0;
+                }
+                auto range = profiler.warm.equal_range(key);
+                for (size_t n = 0; range.first != range.second; n++) {
+                    if (n < keep) {
+                        ++range.first;
+                        continue;
+                    }
+                    ranges.push_back({range.first->second, key.second});
+                    range.first = profiler.warm.erase(range.first);
+                    shm_add(key.first, &ShmDeviceStats::cached_bytes, -(int64_t)key.second);
+                }
+                it = range.second;
+            }
+        }
+
+        size_t released = 0;
+        for (auto& range : ranges) {
+            PhyBlock* block = get_allocated_block((void *)range.first);
+            if (block != nullptr) {
+                unmap_virtual_address(block, (void *)range.first, range.second);
+                released += range.second;
+            }
+        }
+        if (!ranges.empty()) {
+            std::cout << "[VmmAllocator::release_warm] unmapped " << ranges.size() << " warm ranges, " << released << " bytes." << std::endl;
+        }
+        return released;
+    }
+
+    HOST_INLINE AllocatorStats VmmAllocator::stats() {
+        AllocatorStats stats;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            for (auto& it : reserved_addresses) {
+                stats.reserved_bytes += it.second.first;
+            }
+            stats.num_reservations = reserved_addresses.size();
+            stats.num_mappings = allocated_blocks.size();
+            for (auto& it : owned_pool.blocks) {
+                stats.physical_bytes += it.second->block_size;
+                stats.free_block_bytes += it.second->remaining_size;
+                stats.stranded_bytes += it.second->idle() ? 0 : it.second->remaining_size;
+                stats.num_blocks++;
+            }
+            for (auto& it : allocated_blocks) {
+                auto m = it.second->mapped_addresses.find(it.first);
+                if (m != it.second->mapped_addresses.end()) {
+                    stats.mapped_bytes += m->second;
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(pool_mtx);
+            for (auto& it : private_pools) {
+                for (auto& cached : it.second.cached) {
+                    stats.cached_bytes += cached.first;
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(step_mtx);
+            for (auto& it : step_profiler.warm) {
+                stats.cached_bytes += it.first.second;
+            }
+        }
+        SlabAllocator::Stats slab_stats = slab.stats();
+        stats.slab_mapped_bytes = slab_stats.mapped_bytes;
+        stats.slab_allocated_bytes = slab_stats.allocated_bytes;
+        return stats;
+    }
+
+    HOST_INLINE bool VmmAllocator::publish_stats(const std::string& name) {
+        // the segment is process wide : seeded once, by the allocator publishing it first
+        if (shm_stats_segment() != nullptr) {
+            return open_shm_stats(name);
+        }
+
+        // per device state, as stats(). Allocations running meanwhile are not counted exactly
+        std::map<int, ShmDeviceStats> seed;
+        auto add = [&](int device, std::atomic<uint64_t> ShmDeviceStats::*field, size_t bytes) {
+            (seed[device].*field).fetch_add(bytes, std::memory_order_relaxed);
+        };
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+            for (auto& it : reserved_addresses) {
+                add(it.second.second, &ShmDeviceStats::reserved_bytes, it.second.first);
+            }
+            for (auto& it : owned_pool.blocks) {
+                add(it.second->device_id, &ShmDeviceStats::physical_bytes, it.second->block_size);
+                add(it.second->device_id, &ShmDeviceStats::free_block_bytes, it.second->remaining_size);
+            }
+            for (auto& it : allocated_blocks) {
+                auto m = it.second->mapped_addresses.find(it.first);
+                if (m != it.second->mapped_addresses.end()) {
+                    add(it.second->device_id, &ShmDeviceStats::mapped_bytes, m->second);
+                }
+            }
+        }
+        {
+            // the unique pages are blocks of their own, outside of the owned pool
+            std::lock_guard<std::mutex> lock(dedup_mtx);
+            for (auto& it : unique_pages) {
+                std::shared_ptr<PhyBlock> page = it.second.lock();
+                if (page != nullptr) {
+                    add(page->device_id, &ShmDeviceStats::physical_bytes, page->block_size);
+                    add(page->device_id, &ShmDeviceStats::free_block_bytes, page->remaining_size);
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(pool_mtx);
+            for (auto& it : private_pools) {
+                for (auto& cached : it.second.cached) {
+                    add(it.second.device, &ShmDeviceStats::cached_bytes, cached.first);
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(step_mtx);
+            for (auto& it : step_profiler.warm) {
+                add(it.first.first, &ShmDeviceStats::cached_bytes, it.first.second);
+            }
+        }
+
+        if (!open_shm_stats(name)) {
+            return false;
+        }
+        for (auto& it : seed) {
+            int device = it.first;
+            shm_add(device, &ShmDeviceStats::reserved_bytes, it.second.reserved_bytes.load());
+            shm_add(device, &ShmDeviceStats::mapped_bytes, it.second.mapped_bytes.load());
+            shm_add(device, &ShmDeviceStats::physical_bytes, it.second.physical_bytes.load());
+            shm_add(device, &ShmDeviceStats::free_block_bytes, it.second.free_block_bytes.load());
+            shm_add(device, &ShmDeviceStats::cached_bytes, it.second.cached_bytes.load());
+        }
+        return true;
+    }
+
+    HOST_INLINE void VmmAllocator::set_record_stacks(bool enabled) {
+        std::lock_guard<TracedMutex> lock(mtx);
+        record_stacks = enabled;
+        if (!enabled) {
+            alloc_stacks.clear();
+        }
+    }
+
+    HOST_INLINE AllocatorSnapshot VmmAllocator::snapshot() {
+        AllocatorSnapshot snap;
+        std::map<Address, std::vector<void*>> stacks;
+        {
+            std::lock_guard<TracedMutex> lock(mtx);
+
+            snap.placement_policy = placement_policy_name(owned_pool.policy());
+
+            std::set<PhyBlock*> open;
+            owned_pool.for_each_open([&](PhyBlock* block, size_t) { open.insert(block); });
+
+            std::set<PhyBlock*> visited;
+            auto add_block = [&](PhyBlock* block, const char* pool) {
+                if (block == nullptr || !visited.insert(block).second) {
+                    return;
+                }
+                PhyBlockSnapshot b;
+                b.block_id = block->block_id;
+                b.device_id = block->device_id;
+                b.block_size = block->block_size;
+                b.remaining_size = block->remaining_size;
+                b.pool = pool;
+                b.open = open.count(block) > 0;
+                b.lifetime = lifetime_name(block->lifetime);
+                b.tier = memory_tier_name(block->tier);
+                for (auto& m : block->mapped_addresses) {
+                    MappingSnapshot mapping;
+                    mapping.address = m.first;
+                    mapping.size = m.second;
+                    mapping.block_id = block->block_id;
+                    mapping.device_id = block->device_id;
+                    b.mappings.push_back(mapping);
+                }
+                snap.blocks.push_back(std::move(b));
+            };
+
+            for (auto& it : owned_pool.blocks) {
+                add_block(it.second.get(), "owned");
+            }
+            for (PhyBlock* block : shared_pool.blocks) {
+                add_block(block, "shared");
+            }
+            for (PhyBlock* block : exclusive_pool.blocks) {
+                add_block(block, "exclusive");
+            }
+
+            for (auto& it : allocated_blocks) {
+                PhyBlock* block = it.second;
+                add_block(block, "none");
+
+                MappingSnapshot mapping;
+                mapping.address = it.first;
+                mapping.block_id = block->block_id;
+                mapping.device_id = block->device_id;
+                auto m = block->mapped_addresses.find(it.first);
+                mapping.size = m != block->mapped_addresses.end() ? m->second : 0;
+                snap.mappings.push_back(mapping);
+            }
+
+            for (auto& it : reserved_addresses) {
+                snap.reservations.push_back({it.first, it.second.first, it.second.second});
+            }
+
+            stacks = alloc_stacks;
+        }
+
+        // symbolization is slow, do it outside of the lock
+        for (auto& mapping : snap.mappings) {
+            auto it = stacks.find(mapping.address);
+            if (it != stacks.end()) {
+                mapping.frames = symbolize_stack(it->second);
+            }
+        }
+        return snap;
+    }
+
     HOST_INLINE VmmAllocator::PhyBlock* VmmAllocator::get_allocated_block(void* ptr, bool remove) {
         // TODO (yiakwy) : add mutex shards to enable fine control of concurrent accesses
-        std::lock_guard<std::mutex> lock(mtx);
+        std::lock_guard<TracedMutex> lock(mtx);
         auto it = allocated_blocks.find(reinterpret_cast<uintptr_t>(ptr));
         if (it == allocated_blocks.end()) {
             std::cout << "[VmmAllocator::get_allocated_block] cannot find a block associated  to virtual address " << (uintptr_t)ptr << " " << std::endl;
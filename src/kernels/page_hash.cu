@@ -0,0 +1,110 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cuda_runtime.h>
+
+#include "page_hash.h"
+
+namespace {
+
+constexpr int kThreads = 256;
+constexpr int kWarps = kThreads / 32;
+
+// splitmix64 finalizer
+__device__ __forceinline__ uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// One thread block per page, 16 bytes loads. The position of every word is mixed into its term, so the terms
+// can be combined with xor in any order (warp shuffles, then shared memory).
+__global__ void page_hash_kernel(const uint4* __restrict__ data, size_t words_per_page, uint64_t* __restrict__ out) {
+  const uint4* page = data + blockIdx.x * words_per_page;
+
+  uint64_t h0 = 0, h1 = 0;
+  for (size_t i = threadIdx.x; i < words_per_page; i += kThreads) {
+    uint4 w = __ldg(page + i);
+    uint64_t lo = ((uint64_t)w.y << 32) | w.x;
+    uint64_t hi = ((uint64_t)w.w << 32) | w.z;
+    uint64_t pos = (uint64_t)i * 0x9e3779b97f4a7c15ULL;
+    h0 ^= mix64(lo ^ pos) + mix64(hi ^ (pos + 1));
+    h1 ^= mix64(hi + pos + 0x632be59bd9b4e019ULL) * 3 + mix64(lo + ~pos);
+  }
+
+  for (int offset = 16; offset > 0; offset >>= 1) {
+    h0 ^= __shfl_xor_sync(0xffffffff, h0, offset);
+    h1 ^= __shfl_xor_sync(0xffffffff, h1, offset);
+  }
+
+  __shared__ uint64_t s0[kWarps];
+  __shared__ uint64_t s1[kWarps];
+  int warp = threadIdx.x / 32;
+  if (threadIdx.x % 32 == 0) {
+    s0[warp] = h0;
+    s1[warp] = h1;
+  }
+  __syncthreads();
+
+  if (threadIdx.x == 0) {
+    uint64_t r0 = 0, r1 = 0;
+    for (int w = 0; w < kWarps; w++) {
+      r0 ^= s0[w];
+      r1 ^= s1[w];
+    }
+    out[2 * blockIdx.x] = mix64(r0 ^ words_per_page);
+    out[2 * blockIdx.x + 1] = mix64(r1 + words_per_page);
+  }
+}
+
+// One thread block per page pair, 16 bytes loads, the block votes on any difference.
+__global__ void page_compare_kernel(const uint4* __restrict__ a, const uint4* __restrict__ b, size_t words_per_page,
+                                    int32_t* __restrict__ mismatch) {
+  const uint4* lhs = a + blockIdx.x * words_per_page;
+  const uint4* rhs = b + blockIdx.x * words_per_page;
+
+  int differ = 0;
+  for (size_t i = threadIdx.x; i < words_per_page && !differ; i += kThreads) {
+    uint4 x = __ldg(lhs + i);
+    uint4 y = __ldg(rhs + i);
+    differ = (x.x != y.x) | (x.y != y.y) | (x.z != y.z) | (x.w != y.w);
+  }
+
+  differ = __syncthreads_or(differ);
+  if (threadIdx.x == 0) {
+    mismatch[blockIdx.x] = differ ? 1 : 0;
+  }
+}
+
+} // namespace
+
+void launch_page_hash(const void* data, size_t num_pages, size_t page_size, uint64_t* out, cudaStream_t stream) {
+  if (num_pages == 0) {
+    return;
+  }
+  page_hash_kernel<<<(unsigned int)num_pages, kThreads, 0, stream>>>(
+      reinterpret_cast<const uint4*>(data), page_size / sizeof(uint4), out);
+}
+
+void launch_page_compare(const void* a, const void* b, size_t num_pages, size_t page_size, int32_t* mismatch, cudaStream_t stream) {
+  if (num_pages == 0) {
+    return;
+  }
+  page_compare_kernel<<<(unsigned int)num_pages, kThreads, 0, stream>>>(
+      reinterpret_cast<const uint4*>(a), reinterpret_cast<const uint4*>(b), page_size / sizeof(uint4), mismatch);
+}
@@ -17,14 +17,20 @@ limitations under the License.
 
 #include <iostream>
 
+#include <map>
 #include <mutex>
 #include <numeric>
+#include <sstream>
 
 #include <torch/torch.h>
+#include <ATen/cuda/CUDAContext.h>
 
 #include "vtensor.h"
 
+#include "allocator/checkpoint.h"
+#include "allocator/safetensors.h"
 #include "cu_util.h"
+#include "page_hash.h"
 #include "logging.h"
 
 
@@ -90,12 +96,29 @@ VmmTensor::VmmTensor(std::vector<int64_t> shape, torch::Dtype dtype,
     this->allocator = nvgpu::VmmAllocator::instance();
   }
 
-  this->allocator->reserve_virtual_addr((void **)&v_ptr, actual_size/*requested_size*/, &padded_size/*reserved_size*/, device_id, 0/*stream*/);
+  tag = nvgpu::current_memory_tag();
+  lifetime = nvgpu::current_lifetime();
+  if (!this->allocator->admit(actual_size, device_id)) {
+    throw std::runtime_error("VmmTensor: allocation of " + std::to_string(actual_size) + " bytes rejected by the quota of tag " + tag);
+  }
+
+  // at the same address on every rank while a symmetric heap exists on the device, so that the partitions of the
+  // peers are at known offsets
+  CUresult result = this->allocator->reserve_symmetric((void **)&v_ptr, actual_size/*requested_size*/, &padded_size/*reserved_size*/, device_id);
+  if (result == CUDA_ERROR_NOT_INITIALIZED) {
+    result = this->allocator->reserve_virtual_addr((void **)&v_ptr, actual_size/*requested_size*/, &padded_size/*reserved_size*/, device_id, 0/*stream*/);
+  }
+  if (result != CUDA_SUCCESS) {
+    v_ptr = 0;
+    this->allocator->throw_out_of_memory(actual_size, device_id, result);
+  }
 
   std::cout << "[VmmTensor::VmmTensor] Reserving virtual address " << reinterpret_cast<uint64_t>((void *)v_ptr) << " with requested size " << actual_size << ", reserved_size " << padded_size << std::endl;
 
   AllocMemory(offset_index, world_size, pre_flag);
 
+  this->allocator->tags.charge(tag, (uintptr_t)v_ptr, actual_size, padded_size);
+
   tensor = GetTensor(shape, dtype);
 }
 
@@ -120,11 +143,11 @@ void VmmTensor::AllocMemory(int offset_index, int world_size, int pre_flag) {
         this->u_p_block =
             std::move(unique_phy_blocks[unique_phy_blocks.size() - 1]);
         unique_phy_blocks.pop_back();
+        this->u_p_block->lifetime = lifetime;
         this->allocator->exclusive_pool.add(this->u_p_block.get());
       } else {
         // use does not call init_shared_phy_blocks api, no pre allocated
-        std::cout << "[AllocMemory] Not implmented yet" << std::endl;
-        exit(0);
+        throw std::runtime_error("[AllocMemory] Not implmented yet");
       }
 
       // use the address to find the block which own the address
@@ -204,6 +227,8 @@ torch::Tensor VmmTensor::GetTensor(std::vector<int64_t> &shape,
 }
 
 VmmTensor::~VmmTensor() {
+  this->allocator->tags.release((uintptr_t)v_ptr);
+
   if (v_ptr) {
     this->allocator->dealloc((void *)v_ptr, padded_size, device_id, 0/*stream*/);
   }
@@ -234,10 +259,23 @@ torch::Tensor vmm_realloc_tensor(void* address, std::vector<int64_t> shape, std:
   std::shared_ptr<PhyBlock> _block = nullptr;
   auto find_available = [&](size_t size) {
       // find the nearest memory block
-      PhyBlock* block = _allocator->owned_pool.find_available(size);
+      PhyBlock* block = nullptr;
+      {
+        std::lock_guard<nvgpu::TracedMutex> lock(_allocator->mtx);
+        block = _allocator->owned_pool.find_available(size, nvgpu::current_lifetime());
+      }
 
       if (block == nullptr) {
           _block = std::make_shared<PhyBlock>(device, size);
+          if (_block->status != CUDA_SUCCESS) {
+            // drop the unused blocks and try once more before giving up
+            _allocator->empty_cache();
+            _block = std::make_shared<PhyBlock>(device, size);
+          }
+          if (_block->status != CUDA_SUCCESS) {
+            _allocator->throw_out_of_memory(size, device, _block->status);
+          }
+          _block->lifetime = nvgpu::current_lifetime();
           block = _block.get();
       }
 
@@ -257,7 +295,10 @@ torch::Tensor vmm_realloc_tensor(void* address, std::vector<int64_t> shape, std:
 
       // reserve virtual address
       size_t reserved_size = 0;
-      _allocator->reserve_virtual_addr((void **)&d_ptr, request_size, &reserved_size, device, stream);
+      CUresult result = _allocator->reserve_virtual_addr((void **)&d_ptr, request_size, &reserved_size, device, stream);
+      if (result != CUDA_SUCCESS) {
+        _allocator->throw_out_of_memory(request_size, device, result);
+      }
 
       // Note (yiakwy) : we reuse the remaining memroy in previous the most available block
       const size_t first_chunk_size = block->remaining_size;
@@ -275,6 +316,7 @@ torch::Tensor vmm_realloc_tensor(void* address, std::vector<int64_t> shape, std:
       _allocator->map_virtual_address(one_available_block, v_offset_addr, second_chunk_size);
 
       if (_block != nullptr) {
+        std::lock_guard<nvgpu::TracedMutex> lock(_allocator->mtx);
         bool status = _allocator->owned_pool.add(_block);
         assert(status);
       }
@@ -286,7 +328,10 @@ torch::Tensor vmm_realloc_tensor(void* address, std::vector<int64_t> shape, std:
 
     // reserve virtual address
     size_t reserved_size = 0;
-    _allocator->reserve_virtual_addr((void **)&d_ptr, request_size, &reserved_size, device, stream);
+    CUresult result = _allocator->reserve_virtual_addr((void **)&d_ptr, request_size, &reserved_size, device, stream);
+    if (result != CUDA_SUCCESS) {
+      _allocator->throw_out_of_memory(request_size, device, result);
+    }
 
     PhyBlock* one_available_block = find_available(request_size);
 
@@ -296,6 +341,7 @@ torch::Tensor vmm_realloc_tensor(void* address, std::vector<int64_t> shape, std:
     _allocator->map_virtual_address(one_available_block, v_offset_addr, reserved_size);
 
     if (_block != nullptr) {
+      std::lock_guard<nvgpu::TracedMutex> lock(_allocator->mtx);
       bool status = _allocator->owned_pool.add(_block);
       assert(status);
     }
@@ -303,3 +349,369 @@ torch::Tensor vmm_realloc_tensor(void* address, std::vector<int64_t> shape, std:
     return create_torch_tensor((void *)v_offset_addr);
   }
 }
+
+std::vector<torch::Tensor> vmm_alloc_tensors(std::vector<std::vector<int64_t>> shapes, std::vector<torch::Dtype> dtypes, std::vector<int> devices, size_t alignment, CUstream stream) {
+  const size_t n = shapes.size();
+  if (dtypes.size() != n && dtypes.size() != 1) {
+    throw std::runtime_error("vmm_alloc_tensors: expect one dtype, or one dtype per shape");
+  }
+  if (devices.size() != n && devices.size() != 1) {
+    throw std::runtime_error("vmm_alloc_tensors: expect one device, or one device per shape");
+  }
+
+  auto dtype_of = [&](size_t i) { return dtypes.size() == 1 ? dtypes[0] : dtypes[i]; };
+  auto device_of = [&](size_t i) { return devices.size() == 1 ? devices[0] : devices[i]; };
+
+  nvgpu::VmmAllocator::Ptr _allocator = nvgpu::VmmAllocator::instance();
+
+  // released by the deleter of the last tensor of the group
+  struct Group {
+    nvgpu::VmmAllocator::Ptr allocator;
+    void* ptr;
+    int device;
+    CUstream stream;
+    ~Group() { allocator->dealloc(ptr, 0, device, stream); }
+  };
+
+  std::map<int, std::vector<size_t>> indices_per_device;
+  for (size_t i = 0; i < n; i++) {
+    indices_per_device[device_of(i)].push_back(i);
+  }
+
+  std::vector<torch::Tensor> tensors(n);
+  for (auto& it : indices_per_device) {
+    int device = it.first;
+    const std::vector<size_t>& indices = it.second;
+
+    std::vector<size_t> sizes;
+    for (size_t i : indices) {
+      sizes.push_back(std::accumulate(shapes[i].begin(), shapes[i].end(), (size_t)torch::elementSize(dtype_of(i)),
+                                      std::multiplies<int64_t>()));
+    }
+
+    std::vector<size_t> offsets;
+    void* base = _allocator->alloc_group(sizes, alignment, device, stream, &offsets);
+    if (base == nullptr) {
+      throw std::runtime_error("vmm_alloc_tensors: failed to allocate the tensor group");
+    }
+    std::shared_ptr<Group> group(new Group{_allocator, base, device, stream});
+
+    for (size_t k = 0; k < indices.size(); k++) {
+      size_t i = indices[k];
+      std::vector<int64_t>& shape = shapes[i];
+      std::vector<int64_t> stride(shape.size());
+      if (!shape.empty()) {
+        stride[stride.size() - 1] = 1;
+        for (int d = (int)stride.size() - 2; d >= 0; d--) {
+          stride[d] = shape[d + 1] * stride[d + 1];
+        }
+      }
+
+      torch::TensorOptions options =
+          torch::TensorOptions().dtype(dtype_of(i)).device(torch::kCUDA, device);
+      tensors[i] = torch::from_blob(
+          reinterpret_cast<char *>(base) + offsets[k], shape, stride,
+          [group](void *) {}, options);
+    }
+  }
+
+  return tensors;
+}
+
+// zero-copy views
+
+torch::Tensor vmm_gather_view(std::vector<uintptr_t> addresses, std::vector<size_t> sizes, std::vector<int64_t> shape, torch::Dtype dtype, int device) {
+  if (addresses.size() != sizes.size()) {
+    throw std::runtime_error("vmm_gather_view: expect one size per address");
+  }
+
+  std::vector<std::pair<void*, size_t>> ranges;
+  size_t total_size = 0;
+  for (size_t i = 0; i < addresses.size(); i++) {
+    ranges.push_back({reinterpret_cast<void *>(addresses[i]), sizes[i]});
+    total_size += sizes[i];
+  }
+  size_t nbytes = std::accumulate(shape.begin(), shape.end(), (size_t)torch::elementSize(dtype), std::multiplies<int64_t>());
+  if (nbytes > total_size) {
+    throw std::runtime_error("vmm_gather_view: " + std::to_string(total_size) + " bytes of ranges are too small for the view");
+  }
+
+  nvgpu::VmmAllocator::Ptr _allocator = nvgpu::VmmAllocator::instance();
+  size_t view_size = 0;
+  void* ptr = _allocator->gather(ranges, device, &view_size);
+
+  std::vector<int64_t> stride(shape.size());
+  if (!shape.empty()) {
+    stride[stride.size() - 1] = 1;
+    for (int d = (int)stride.size() - 2; d >= 0; d--) {
+      stride[d] = shape[d + 1] * stride[d + 1];
+    }
+  }
+
+  torch::TensorOptions options =
+      torch::TensorOptions().dtype(dtype).device(torch::kCUDA, device);
+  return torch::from_blob(
+      ptr, shape, stride,
+      [_allocator](void *ptr) { _allocator->release_view(ptr); }, options);
+}
+
+torch::Tensor vmm_ring_view(std::shared_ptr<nvgpu::RingBuffer> ring, uint64_t offset, std::vector<int64_t> shape, torch::Dtype dtype) {
+  size_t nbytes = std::accumulate(shape.begin(), shape.end(), (size_t)torch::elementSize(dtype), std::multiplies<int64_t>());
+  void* ptr = ring->window(offset, nbytes);
+
+  torch::TensorOptions options =
+      torch::TensorOptions().dtype(dtype).device(torch::kCUDA, ring->device());
+  return torch::from_blob(
+      ptr, shape,
+      [ring](void *ptr) {}, options);
+}
+
+torch::Tensor vmm_sparse_view(std::shared_ptr<nvgpu::SparseRange> range, std::vector<int64_t> shape, torch::Dtype dtype) {
+  size_t nbytes = std::accumulate(shape.begin(), shape.end(), (size_t)torch::elementSize(dtype), std::multiplies<int64_t>());
+  if (nbytes > range->size()) {
+    throw std::invalid_argument("vmm_sparse_view: " + std::to_string(nbytes) + " bytes do not fit in a range of " + std::to_string(range->size()) + " bytes");
+  }
+
+  torch::TensorOptions options =
+      torch::TensorOptions().dtype(dtype).device(torch::kCUDA, range->device());
+  return torch::from_blob(
+      range->base(), shape,
+      [range](void *ptr) {}, options);
+}
+
+torch::Tensor vmm_symmetric_tensor(std::vector<int64_t> shape, torch::Dtype dtype, int device) {
+  nvgpu::VmmAllocator::Ptr _allocator = nvgpu::VmmAllocator::instance();
+  size_t nbytes = std::accumulate(shape.begin(), shape.end(), (size_t)torch::elementSize(dtype), std::multiplies<int64_t>());
+  void* ptr = _allocator->alloc_symmetric(nbytes, device);
+
+  torch::TensorOptions options =
+      torch::TensorOptions().dtype(dtype).device(torch::kCUDA, device);
+  return torch::from_blob(
+      ptr, shape,
+      [_allocator, nbytes, device](void *ptr) { _allocator->dealloc(ptr, nbytes, device, 0/*stream*/); }, options);
+}
+
+// page deduplication
+
+size_t vmm_dedup(std::vector<torch::Tensor> tensors) {
+  if (tensors.empty()) {
+    return 0;
+  }
+  int device = tensors[0].device().index();
+
+  nvgpu::VmmAllocator::Ptr _allocator = nvgpu::VmmAllocator::instance();
+  size_t page = _allocator->granularity(device);
+  if (page == 0) {
+    throw std::runtime_error("vmm_dedup: cannot query the granularity of device " + std::to_string(device));
+  }
+
+  std::vector<std::pair<void*, size_t>> ranges;
+  std::vector<size_t> num_pages;
+  size_t total_pages = 0;
+  for (auto& tensor : tensors) {
+    if (!tensor.is_cuda() || tensor.device().index() != device) {
+      throw std::runtime_error("vmm_dedup: tensors must be on CUDA device " + std::to_string(device));
+    }
+    ranges.push_back({tensor.data_ptr(), tensor.nbytes()});
+    num_pages.push_back((tensor.nbytes() + page - 1) / page);
+    total_pages += num_pages.back();
+  }
+
+  // hash the pages on the device, only 16 bytes per page come back to the host
+  torch::Tensor hashes = torch::empty({(int64_t)total_pages, 2}, torch::TensorOptions().dtype(torch::kInt64).device(torch::kCUDA, device));
+  cudaStream_t stream = at::cuda::getCurrentCUDAStream(device).stream();
+  size_t offset = 0;
+  for (size_t i = 0; i < ranges.size(); i++) {
+    launch_page_hash(ranges[i].first, num_pages[i], page, reinterpret_cast<uint64_t *>(hashes.data_ptr<int64_t>()) + 2 * offset, stream);
+    offset += num_pages[i];
+  }
+  torch::Tensor host = hashes.cpu();
+
+  std::vector<nvgpu::VmmAllocator::PageKey> keys(total_pages);
+  const uint64_t* h = reinterpret_cast<const uint64_t *>(host.data_ptr<int64_t>());
+  for (size_t i = 0; i < total_pages; i++) {
+    keys[i] = {h[2 * i], h[2 * i + 1]};
+  }
+
+  // the keys only bucket the pages, the allocator remaps a page once this found it equal to the page of its key
+  auto compare = [device, stream](CUdeviceptr a, CUdeviceptr b, size_t num_pages, size_t page_size, std::vector<char>* equal) {
+    torch::Tensor mismatch = torch::empty({(int64_t)num_pages}, torch::TensorOptions().dtype(torch::kInt32).device(torch::kCUDA, device));
+    launch_page_compare(reinterpret_cast<const void *>(a), reinterpret_cast<const void *>(b), num_pages, page_size, mismatch.data_ptr<int32_t>(), stream);
+    torch::Tensor flags = mismatch.cpu();
+    const int32_t* f = flags.data_ptr<int32_t>();
+    equal->resize(num_pages);
+    for (size_t i = 0; i < num_pages; i++) {
+      (*equal)[i] = f[i] == 0;
+    }
+    return CUDA_SUCCESS;
+  };
+  return _allocator->dedup(ranges, keys, device, compare);
+}
+
+// checkpoint / restore
+
+// "<scalar type>;<sizes>;<strides>", e.g. "15;4,8;8,1"
+static std::string tensor_meta(const torch::Tensor& tensor) {
+  std::ostringstream os;
+  os << (int)tensor.scalar_type() << ";";
+  for (int64_t d = 0; d < tensor.dim(); d++) {
+    os << (d ? "," : "") << tensor.size(d);
+  }
+  os << ";";
+  for (int64_t d = 0; d < tensor.dim(); d++) {
+    os << (d ? "," : "") << tensor.stride(d);
+  }
+  return os.str();
+}
+
+static void parse_meta(const std::string& meta, torch::Dtype* dtype, std::vector<int64_t>* shape, std::vector<int64_t>* stride) {
+  std::istringstream is(meta);
+  std::string field;
+  std::getline(is, field, ';');
+  *dtype = static_cast<torch::Dtype>(std::stoi(field));
+  for (std::vector<int64_t>* dims : {shape, stride}) {
+    std::getline(is, field, ';');
+    std::istringstream fs(field);
+    std::string dim;
+    while (std::getline(fs, dim, ',')) {
+      dims->push_back(std::stoll(dim));
+    }
+  }
+}
+
+size_t vmm_checkpoint(const std::string& path, std::vector<std::string> names, std::vector<torch::Tensor> tensors, size_t chunk_size) {
+  if (names.size() != tensors.size()) {
+    throw std::runtime_error("vmm_checkpoint: expect one name per tensor");
+  }
+
+  bool on_host = !tensors.empty() && tensors[0].device().is_cpu();
+  std::vector<nvgpu::CheckpointRegion> regions;
+  for (size_t i = 0; i < tensors.size(); i++) {
+    const torch::Tensor& tensor = tensors[i];
+    if (tensor.device().is_cpu() != on_host) {
+      throw std::runtime_error("vmm_checkpoint: tensors must be all on the CPU or all on CUDA devices");
+    }
+    if (!tensor.is_contiguous()) {
+      throw std::runtime_error("vmm_checkpoint: tensor " + names[i] + " is not contiguous");
+    }
+    nvgpu::CheckpointRegion region;
+    region.name = names[i];
+    region.meta = tensor_meta(tensor);
+    region.ptr = tensor.data_ptr();
+    region.size = tensor.nbytes();
+    region.device = on_host ? -1 : tensor.device().index();
+    regions.push_back(region);
+  }
+
+  nvgpu::CheckpointOptions options;
+  options.chunk_size = chunk_size;
+  if (on_host) {
+    nvgpu::HostCheckpointBackend backend;
+    return nvgpu::save_checkpoint(path, regions, &backend, "{}", options);
+  }
+  nvgpu::VmmAllocator::Ptr _allocator = nvgpu::VmmAllocator::instance();
+  nvgpu::VmmCheckpointBackend backend(_allocator);
+  return nvgpu::save_checkpoint(path, regions, &backend, _allocator->snapshot().to_json(), options);
+}
+
+std::pair<std::vector<std::pair<std::string, torch::Tensor>>, std::string> vmm_restore(const std::string& path, size_t num_buffers) {
+  // the backend is picked from the devices recorded in the file, so peek at the first segment
+  std::shared_ptr<nvgpu::CheckpointBackend> backend;
+  {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+      throw std::runtime_error("vmm_restore: cannot open " + path);
+    }
+    nvgpu::CheckpointHeader header = {};
+    nvgpu::CheckpointSegmentRecord segment = {};
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 && (header.num_segments == 0 || fread(&segment, sizeof(segment), 1, f) == 1);
+    fclose(f);
+    if (!ok) {
+      throw std::runtime_error("vmm_restore: " + path + " is truncated");
+    }
+    if (header.num_segments > 0 && segment.device < 0) {
+      backend = std::make_shared<nvgpu::HostCheckpointBackend>();
+    } else {
+      backend = std::make_shared<nvgpu::VmmCheckpointBackend>(nvgpu::VmmAllocator::instance());
+    }
+  }
+
+  nvgpu::CheckpointOptions options;
+  options.num_buffers = (int)num_buffers;
+  nvgpu::RestoredCheckpoint restored = nvgpu::restore_checkpoint(path, backend.get(), options);
+
+  // released by the deleter of the last tensor of the segment
+  struct Segment {
+    std::shared_ptr<nvgpu::CheckpointBackend> backend;
+    nvgpu::CheckpointSegment segment;
+    ~Segment() { backend->free(segment.ptr, segment.size, segment.device); }
+  };
+  std::vector<std::shared_ptr<Segment>> segments;
+  for (auto& segment : restored.segments) {
+    segments.push_back(std::shared_ptr<Segment>(new Segment{backend, segment}));
+  }
+
+  std::vector<std::pair<std::string, torch::Tensor>> tensors;
+  for (size_t i = 0; i < restored.regions.size(); i++) {
+    const nvgpu::CheckpointRegion& region = restored.regions[i];
+    torch::Dtype dtype;
+    std::vector<int64_t> shape, stride;
+    parse_meta(region.meta, &dtype, &shape, &stride);
+
+    torch::TensorOptions options = torch::TensorOptions().dtype(dtype);
+    options = region.device < 0 ? options.device(torch::kCPU) : options.device(torch::kCUDA, region.device);
+    std::shared_ptr<Segment> segment = segments[restored.region_segments[i]];
+    tensors.push_back({region.name, torch::from_blob(region.ptr, shape, stride, [segment](void *) {}, options)});
+  }
+  return {tensors, restored.layout_json};
+}
+
+// safetensors loading
+
+static torch::Dtype safetensors_dtype(const std::string& dtype) {
+  static const std::map<std::string, torch::Dtype> dtypes = {
+      {"F64", torch::kFloat64}, {"F32", torch::kFloat32}, {"F16", torch::kFloat16}, {"BF16", torch::kBFloat16},
+      {"I64", torch::kInt64}, {"I32", torch::kInt32}, {"I16", torch::kInt16}, {"I8", torch::kInt8},
+      {"U8", torch::kUInt8}, {"BOOL", torch::kBool}, {"F8_E4M3", torch::kFloat8_e4m3fn}, {"F8_E5M2", torch::kFloat8_e5m2},
+  };
+  auto it = dtypes.find(dtype);
+  if (it == dtypes.end()) {
+    throw std::runtime_error("vmm_load_safetensors: no torch dtype for the safetensors dtype " + dtype);
+  }
+  return it->second;
+}
+
+std::vector<std::pair<std::string, torch::Tensor>> vmm_load_safetensors(const std::string& path, int device, size_t num_buffers, size_t chunk_size) {
+  // fail before reading the file if a dtype has no torch equivalent
+  for (auto& tensor : nvgpu::read_safetensors_header(path).tensors) {
+    safetensors_dtype(tensor.dtype);
+  }
+
+  std::shared_ptr<nvgpu::CheckpointBackend> backend;
+  if (device < 0) {
+    backend = std::make_shared<nvgpu::HostCheckpointBackend>();
+  } else {
+    backend = std::make_shared<nvgpu::VmmCheckpointBackend>(nvgpu::VmmAllocator::instance());
+  }
+
+  nvgpu::SafetensorsOptions options;
+  options.num_buffers = (int)num_buffers;
+  options.chunk_size = chunk_size;
+  nvgpu::LoadedSafetensors loaded = nvgpu::load_safetensors(path, backend.get(), device, options);
+
+  // released by the deleter of the last tensor
+  struct Segment {
+    std::shared_ptr<nvgpu::CheckpointBackend> backend;
+    nvgpu::CheckpointSegment segment;
+    ~Segment() { backend->free(segment.ptr, segment.size, segment.device); }
+  };
+  std::shared_ptr<Segment> segment(new Segment{backend, loaded.segment});
+
+  std::vector<std::pair<std::string, torch::Tensor>> tensors;
+  for (auto& tensor : loaded.tensors) {
+    torch::TensorOptions options = torch::TensorOptions().dtype(safetensors_dtype(tensor.dtype));
+    options = device < 0 ? options.device(torch::kCPU) : options.device(torch::kCUDA, device);
+    tensors.push_back({tensor.name, torch::from_blob(tensor.ptr, tensor.shape, [segment](void *) {}, options)});
+  }
+  return tensors;
+}
@@ -13,33 +13,64 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <numeric>
+
 #include <torch/extension.h>
 #include <torch/torch.h>
 
 #include "vtensor.h"
+#include "vtensor_c.h"
 #include "allocator/vmm_allocator.h"
 
-#ifdef __cplusplus
-extern "C" { // Start C linkage block for C++ compilers
-#endif
-
-void* vmm_alloc(ssize_t size, int device, uintptr_t stream) {
-  nvgpu::VmmAllocator::Ptr _allocator = nvgpu::VmmAllocator::instance();
-  return _allocator->alloc((size_t)size, device, reinterpret_cast<CUstream>(stream));
+static pybind11::dict allocator_state(const nvgpu::OutOfMemoryError& e) {
+  pybind11::dict d;
+  d["device"] = e.device;
+  d["requested_bytes"] = e.requested_size;
+  d["device_free_bytes"] = e.free_bytes;
+  d["device_total_bytes"] = e.total_bytes;
+  d["reserved_bytes"] = e.state.reserved_bytes;
+  d["num_reservations"] = e.state.num_reservations;
+  d["mapped_bytes"] = e.state.mapped_bytes;
+  d["num_mappings"] = e.state.num_mappings;
+  d["physical_bytes"] = e.state.physical_bytes;
+  d["free_block_bytes"] = e.state.free_block_bytes;
+  d["num_blocks"] = e.state.num_blocks;
+  d["stranded_bytes"] = e.state.stranded_bytes;
+  d["cached_bytes"] = e.state.cached_bytes;
+  d["slab_mapped_bytes"] = e.state.slab_mapped_bytes;
+  d["slab_allocated_bytes"] = e.state.slab_allocated_bytes;
+  return d;
 }
 
-void vmm_dealloc(int64_t address, size_t size, int device, uintptr_t stream) {
-  nvgpu::VmmAllocator::Ptr _allocator = nvgpu::VmmAllocator::instance();
-  return _allocator->dealloc(reinterpret_cast<void*>(address), size, device, reinterpret_cast<CUstream>(stream));
+// torch.OutOfMemoryError (torch >= 2.5), torch.cuda.OutOfMemoryError, MemoryError, the first one available
+static pybind11::object out_of_memory_type() {
+  pybind11::module_ torch = pybind11::module_::import("torch");
+  if (pybind11::hasattr(torch, "OutOfMemoryError")) {
+    return torch.attr("OutOfMemoryError");
+  }
+  pybind11::object cuda = torch.attr("cuda");
+  if (pybind11::hasattr(cuda, "OutOfMemoryError")) {
+    return cuda.attr("OutOfMemoryError");
+  }
+  return pybind11::reinterpret_borrow<pybind11::object>(PyExc_MemoryError);
 }
 
-#ifdef __cplusplus
-} // End C linkage block
-#endif
-
 PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
   m.doc() = "vTensor";
 
+  // callers catch the same exception as for the caching allocator, with the allocator state attached
+  pybind11::register_exception_translator([](std::exception_ptr p) {
+      try {
+        if (p) {
+          std::rethrow_exception(p);
+        }
+      } catch (const nvgpu::OutOfMemoryError& e) {
+        pybind11::object error = out_of_memory_type()(e.what());
+        error.attr("allocator_state") = allocator_state(e);
+        PyErr_SetObject(error.get_type().ptr(), error.ptr());
+      }
+  });
+
   pybind11::class_<VmmTensor>(m, "tensor")
       .def(pybind11::init<std::vector<int64_t>, torch::Dtype, int, int, int>())
       .def("realloc_memory", &VmmTensor::AllocMemory)
@@ -62,11 +93,378 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
       })
       .def("dealloc", [](nvgpu::VmmAllocator& self, int64_t address, size_t size, int device, uintptr_t stream){
             return self.dealloc(reinterpret_cast<void*>(address), size, device, reinterpret_cast<CUstream>(stream));
+      })
+      .def("set_placement_policy", &nvgpu::VmmAllocator::set_placement_policy)
+      .def("placement_policy", &nvgpu::VmmAllocator::placement_policy)
+      .def("set_record_stacks", &nvgpu::VmmAllocator::set_record_stacks)
+      .def("snapshot_json", [](nvgpu::VmmAllocator& self) {
+            return self.snapshot().to_json();
+      });
+
+  // placement policy of the allocator behind the torch pluggable allocator
+  m.def("set_placement_policy", [](const std::string& name) {
+      return nvgpu::VmmAllocator::instance()->set_placement_policy(name);
+  });
+  m.def("placement_policy", []() {
+      return nvgpu::VmmAllocator::instance()->placement_policy();
+  });
+
+  // memory snapshot of the allocator behind the torch pluggable allocator
+  m.def("set_record_stacks", [](bool enabled) {
+      nvgpu::VmmAllocator::instance()->set_record_stacks(enabled);
+  });
+  m.def("snapshot_json", []() {
+      return nvgpu::VmmAllocator::instance()->snapshot().to_json();
+  });
+
+  // CUDA graph private pools
+  m.def("graph_pool_handle", []() {
+      return nvgpu::VmmAllocator::instance()->graph_pool_handle();
+  });
+  m.def("begin_allocate_to_pool", [](uint64_t pool_id) {
+      nvgpu::VmmAllocator::instance()->begin_allocate_to_pool(pool_id);
+  });
+  m.def("end_allocate_to_pool", [](uint64_t pool_id) {
+      nvgpu::VmmAllocator::instance()->end_allocate_to_pool(pool_id);
+  });
+  m.def("release_pool", [](uint64_t pool_id) {
+      nvgpu::VmmAllocator::instance()->release_pool(pool_id);
+  });
+  m.def("pool_cached_size", [](uint64_t pool_id) {
+      return nvgpu::VmmAllocator::instance()->pool_cached_size(pool_id);
+  });
+
+  // tagged memory accounting and quotas
+  m.def("set_memory_tag", [](const std::string& tag) {
+      nvgpu::set_current_memory_tag(tag);
+  });
+  m.def("memory_tag", []() {
+      return nvgpu::current_memory_tag();
+  });
+  m.def("set_tag_quota", [](const std::string& tag, size_t hard_limit, size_t soft_limit) {
+      nvgpu::VmmAllocator::instance()->tags.set_quota(tag, hard_limit, soft_limit);
+  }, pybind11::arg("tag"), pybind11::arg("hard_limit"), pybind11::arg("soft_limit") = 0);
+  m.def("set_device_headroom", [](size_t bytes) {
+      nvgpu::VmmAllocator::instance()->device_headroom = bytes;
+  });
+  m.def("set_eviction_callback", [](pybind11::object callback) {
+      if (callback.is_none()) {
+        nvgpu::VmmAllocator::instance()->tags.set_eviction_callback(nullptr);
+        return;
+      }
+      // the allocator may be entered with the GIL released
+      auto fn = std::make_shared<pybind11::object>(callback);
+      nvgpu::VmmAllocator::instance()->tags.set_eviction_callback([fn](const std::string& tag, size_t bytes_needed) {
+          pybind11::gil_scoped_acquire gil;
+          return (*fn)(tag, bytes_needed).cast<size_t>();
       });
+  });
+  m.def("tag_stats", []() {
+      pybind11::dict result;
+      for (auto& it : nvgpu::VmmAllocator::instance()->tags.all_stats()) {
+        pybind11::dict d;
+        d["live_bytes"] = it.second.live_bytes;
+        d["reserved_bytes"] = it.second.reserved_bytes;
+        d["peak_live_bytes"] = it.second.peak_live_bytes;
+        d["num_allocs"] = it.second.num_allocs;
+        d["soft_limit"] = it.second.soft_limit;
+        d["hard_limit"] = it.second.hard_limit;
+        d["num_rejected"] = it.second.num_rejected;
+        d["num_evictions"] = it.second.num_evictions;
+        result[pybind11::str(it.first)] = d;
+      }
+      return result;
+  });
+
+  // lifetime hints, the owned pool keeps the blocks of each lifetime apart
+  m.def("set_lifetime", [](const std::string& name) {
+      nvgpu::Lifetime lifetime;
+      if (!nvgpu::parse_lifetime(name, &lifetime)) {
+        throw std::invalid_argument("unknown lifetime " + name + ", expect default, transient, step or persistent");
+      }
+      nvgpu::set_current_lifetime(lifetime);
+  });
+  m.def("lifetime", []() {
+      return std::string(nvgpu::lifetime_name(nvgpu::current_lifetime()));
+  });
+  m.def("set_transient_block_size", [](size_t bytes) {
+      nvgpu::VmmAllocator::instance()->transient_block_size = bytes;
+  });
+  m.def("lifetime_stats", []() {
+      auto stats = nvgpu::VmmAllocator::instance()->lifetime_stats();
+      pybind11::dict result;
+      for (int i = 0; i < (int)nvgpu::Lifetime::N; i++) {
+        pybind11::dict d;
+        d["blocks"] = stats[i].blocks;
+        d["physical_bytes"] = stats[i].physical_bytes;
+        d["free_block_bytes"] = stats[i].free_block_bytes;
+        d["stranded_bytes"] = stats[i].stranded_bytes;
+        d["idle_blocks"] = stats[i].idle_blocks;
+        d["num_allocs"] = stats[i].num_allocs;
+        result[pybind11::str(nvgpu::lifetime_name((nvgpu::Lifetime)i))] = d;
+      }
+      return result;
+  });
+
+  // small tensors sub-allocator
+  m.def("set_slab_enabled", [](bool enabled) {
+      nvgpu::VmmAllocator::instance()->slab_enabled = enabled;
+  });
+  m.def("slab_stats", []() {
+      auto stats = nvgpu::VmmAllocator::instance()->slab.stats();
+      pybind11::dict d;
+      d["chunks"] = stats.chunks;
+      d["mapped_bytes"] = stats.mapped_bytes;
+      d["allocated_bytes"] = stats.allocated_bytes;
+      d["requested_bytes"] = stats.requested_bytes;
+      d["num_allocs"] = stats.num_allocs;
+      return d;
+  });
+
+  // scatter mapping of the requests no single block can serve
+  m.def("set_scatter_enabled", [](bool enabled) {
+      nvgpu::VmmAllocator::instance()->scatter_enabled = enabled;
+  });
+  m.def("scatter_stats", []() {
+      auto stats = nvgpu::VmmAllocator::instance()->scatter_stats();
+      pybind11::dict d;
+      d["ranges"] = stats.ranges;
+      d["pieces"] = stats.pieces;
+      d["reused_bytes"] = stats.reused_bytes;
+      return d;
+  });
+
+  // counters published to shared memory for tools/vtensor_stats, empty name : /vtensor_stats.<pid>
+  m.def("publish_stats", [](const std::string& name) {
+      return nvgpu::VmmAllocator::instance()->publish_stats(name);
+  }, pybind11::arg("name") = "");
+
+  // allocator timeline, see vTensor.trace
+  m.def("start_trace", [](size_t max_events_per_thread) {
+      nvgpu::start_trace(max_events_per_thread);
+  }, pybind11::arg("max_events_per_thread") = 1 << 20);
+  m.def("stop_trace", []() {
+      nvgpu::stop_trace();
+  });
+  m.def("export_trace", [](const std::string& path) {
+      return nvgpu::export_trace(path);
+  });
+  m.def("trace_stats", []() {
+      auto stats = nvgpu::trace_stats();
+      pybind11::dict d;
+      d["threads"] = stats.threads;
+      d["events"] = stats.events;
+      d["dropped"] = stats.dropped;
+      return d;
+  });
+
+  // iteration aware pre-warming
+  m.def("set_step_prewarm", [](bool enabled, int warmup_steps) {
+      nvgpu::VmmAllocator::instance()->set_step_prewarm(enabled, warmup_steps);
+  }, pybind11::arg("enabled"), pybind11::arg("warmup_steps") = 3);
+  m.def("begin_step", []() {
+      nvgpu::VmmAllocator::instance()->begin_step();
+  });
+  m.def("end_step", []() {
+      nvgpu::VmmAllocator::instance()->end_step();
+  });
+  m.def("step_stats", []() {
+      auto stats = nvgpu::VmmAllocator::instance()->step_stats();
+      pybind11::dict d;
+      d["steps"] = stats.steps;
+      d["learned"] = stats.learned;
+      d["predicted_peak_bytes"] = stats.predicted_peak_bytes;
+      d["actual_peak_bytes"] = stats.actual_peak_bytes;
+      d["warm_bytes"] = stats.warm_bytes;
+      d["hits"] = stats.hits;
+      d["misses"] = stats.misses;
+      d["prewarmed"] = stats.prewarmed;
+      return d;
+  });
+
+  // out of memory handling
+  m.def("empty_cache", []() {
+      return nvgpu::VmmAllocator::instance()->empty_cache();
+  });
+  m.def("register_pressure_callback", [](pybind11::object callback) {
+      auto fn = std::make_shared<pybind11::object>(callback);
+      return nvgpu::VmmAllocator::instance()->add_pressure_callback([fn](int device, size_t bytes_needed) {
+          pybind11::gil_scoped_acquire gil;
+          return (*fn)(device, bytes_needed).cast<size_t>();
+      });
+  });
+  m.def("unregister_pressure_callback", [](int id) {
+      nvgpu::VmmAllocator::instance()->remove_pressure_callback(id);
+  });
+  m.def("last_oom_report", []() {
+      return nvgpu::VmmAllocator::instance()->last_oom_report();
+  });
+
+  // zero-copy views
+  m.def("gather_view", &vmm_gather_view, pybind11::arg("addresses"), pybind11::arg("sizes"), pybind11::arg("shape"),
+        pybind11::arg("dtype"), pybind11::arg("device"));
+  m.def("granularity", [](int device) {
+      return nvgpu::VmmAllocator::instance()->granularity(device);
+  });
+
+  // double mapped ring buffers, the views are contiguous across the wrap around
+  pybind11::class_<nvgpu::RingBuffer, std::shared_ptr<nvgpu::RingBuffer>>(m, "RingBuffer")
+      .def(pybind11::init([](size_t capacity, int device) {
+            return std::make_shared<nvgpu::RingBuffer>(nvgpu::VmmAllocator::instance().get(), capacity, device);
+      }), pybind11::arg("capacity"), pybind11::arg("device"))
+      .def_property_readonly("capacity", &nvgpu::RingBuffer::capacity)
+      .def_property_readonly("device", &nvgpu::RingBuffer::device)
+      .def_property_readonly("head", &nvgpu::RingBuffer::head)
+      .def_property_readonly("tail", &nvgpu::RingBuffer::tail)
+      .def("size", &nvgpu::RingBuffer::size)
+      .def("space", &nvgpu::RingBuffer::space)
+      .def("commit", &nvgpu::RingBuffer::commit)
+      .def("consume", &nvgpu::RingBuffer::consume)
+      .def("reset", &nvgpu::RingBuffer::reset)
+      .def("view", &vmm_ring_view, pybind11::arg("offset"), pybind11::arg("shape"), pybind11::arg("dtype"))
+      .def("write_view", [](std::shared_ptr<nvgpu::RingBuffer> self, std::vector<int64_t> shape, torch::Dtype dtype) {
+            size_t nbytes = std::accumulate(shape.begin(), shape.end(), (size_t)torch::elementSize(dtype), std::multiplies<int64_t>());
+            if (nbytes > self->space()) {
+              throw std::invalid_argument("RingBuffer: " + std::to_string(nbytes) + " bytes to write, " + std::to_string(self->space()) + " bytes of space left");
+            }
+            return vmm_ring_view(self, self->head(), shape, dtype);
+      }, pybind11::arg("shape"), pybind11::arg("dtype"))
+      .def("read_view", [](std::shared_ptr<nvgpu::RingBuffer> self, std::vector<int64_t> shape, torch::Dtype dtype) {
+            size_t nbytes = std::accumulate(shape.begin(), shape.end(), (size_t)torch::elementSize(dtype), std::multiplies<int64_t>());
+            if (nbytes > self->size()) {
+              throw std::invalid_argument("RingBuffer: " + std::to_string(nbytes) + " bytes to read, " + std::to_string(self->size()) + " bytes committed");
+            }
+            return vmm_ring_view(self, self->tail(), shape, dtype);
+      }, pybind11::arg("shape"), pybind11::arg("dtype"));
+
+  // block-sparse tensors, the empty blocks map the zero page of the device
+  pybind11::class_<nvgpu::SparseRange, std::shared_ptr<nvgpu::SparseRange>>(m, "SparseTensor")
+      .def(pybind11::init([](size_t size, size_t block_size, int device) {
+            return std::make_shared<nvgpu::SparseRange>(nvgpu::VmmAllocator::instance().get(), size, block_size, device);
+      }), pybind11::arg("size"), pybind11::arg("block_size"), pybind11::arg("device"))
+      .def_property_readonly("size", &nvgpu::SparseRange::size)
+      .def_property_readonly("block_size", &nvgpu::SparseRange::block_size)
+      .def_property_readonly("num_blocks", &nvgpu::SparseRange::num_blocks)
+      .def_property_readonly("device", &nvgpu::SparseRange::device)
+      .def_property_readonly("num_populated", &nvgpu::SparseRange::num_populated)
+      .def_property_readonly("physical_bytes", &nvgpu::SparseRange::physical_bytes)
+      .def("populated", &nvgpu::SparseRange::populated, pybind11::arg("index"))
+      .def("materialize", &nvgpu::SparseRange::materialize, pybind11::arg("index"), pybind11::arg("zero") = true)
+      .def("release", &nvgpu::SparseRange::release, pybind11::arg("index"))
+      .def("view", &vmm_sparse_view, pybind11::arg("shape"), pybind11::arg("dtype"));
+
+  // symmetric heap, the local ranks get the same addresses
+  m.def("symmetric_init", [](const std::string& path, int rank, int world_size, size_t size, int device, int timeout_ms) {
+      nvgpu::VmmAllocator::instance()->symmetric_init(path, rank, world_size, size, device, timeout_ms);
+  }, pybind11::arg("path"), pybind11::arg("rank"), pybind11::arg("world_size"), pybind11::arg("size"), pybind11::arg("device"),
+     pybind11::arg("timeout_ms") = 60000, pybind11::call_guard<pybind11::gil_scoped_release>());
+  m.def("symmetric_finalize", []() {
+      nvgpu::VmmAllocator::instance()->symmetric_finalize();
+  });
+  m.def("symmetric_empty", &vmm_symmetric_tensor, pybind11::arg("shape"), pybind11::arg("dtype"), pybind11::arg("device"));
+  m.def("symmetric_base", []() {
+      auto heap = nvgpu::VmmAllocator::instance()->symmetric_heap;
+      return heap != nullptr ? reinterpret_cast<uintptr_t>(heap->base()) : (uintptr_t)0;
+  });
+  m.def("symmetric_offset", [](torch::Tensor tensor) {
+      auto heap = nvgpu::VmmAllocator::instance()->symmetric_heap;
+      if (heap == nullptr || !heap->contains(tensor.data_ptr())) {
+        throw std::invalid_argument("symmetric_offset: the tensor is not in the symmetric heap");
+      }
+      return heap->offset_of(tensor.data_ptr());
+  }, pybind11::arg("tensor"));
+
+  // page deduplication
+  m.def("dedup", &vmm_dedup);
+  m.def("dedup_stats", []() {
+      auto stats = nvgpu::VmmAllocator::instance()->dedup_stats();
+      pybind11::dict d;
+      d["unique_pages"] = stats.unique_pages;
+      d["mapped_pages"] = stats.mapped_pages;
+      d["page_size"] = stats.page_size;
+      d["bytes_saved"] = stats.bytes_saved;
+      d["deduped_ranges"] = stats.deduped_ranges;
+      d["collisions"] = stats.collisions;
+      return d;
+  });
+
+  // live migration between devices, the tensors keep their addresses
+  m.def("migrate_begin", [](torch::Tensor tensor, int device) {
+      nvgpu::VmmAllocator::instance()->migrate_begin(tensor.data_ptr(), device);
+  }, pybind11::arg("tensor"), pybind11::arg("device"));
+  m.def("migrate_step", [](torch::Tensor tensor, size_t budget_bytes) {
+      return nvgpu::VmmAllocator::instance()->migrate_step(tensor.data_ptr(), budget_bytes);
+  }, pybind11::arg("tensor"), pybind11::arg("budget_bytes"), pybind11::call_guard<pybind11::gil_scoped_release>());
+  m.def("migrate", [](torch::Tensor tensor, int device) {
+      return nvgpu::VmmAllocator::instance()->migrate(tensor.data_ptr(), device);
+  }, pybind11::arg("tensor"), pybind11::arg("device"), pybind11::call_guard<pybind11::gil_scoped_release>());
+  m.def("migration_stats", []() {
+      auto stats = nvgpu::VmmAllocator::instance()->migration_stats();
+      pybind11::dict d;
+      d["active"] = stats.active;
+      d["completed"] = stats.completed;
+      d["pages"] = stats.pages;
+      d["bytes"] = stats.bytes;
+      return d;
+  });
+
+  // memory tiers, host memory mapped into the device address space
+  auto parse_tier = [](const std::string& name) {
+      nvgpu::MemoryTier tier;
+      if (!nvgpu::parse_memory_tier(name, &tier)) {
+        throw std::invalid_argument("unknown memory tier " + name + ", expect device or host");
+      }
+      return tier;
+  };
+  m.def("set_tag_tier", [parse_tier](const std::string& tag, const std::string& tier) {
+      nvgpu::VmmAllocator::instance()->set_tag_tier(tag, parse_tier(tier));
+  }, pybind11::arg("tag"), pybind11::arg("tier"));
+  m.def("set_host_spill", [](bool enabled, int numa_node) {
+      auto allocator = nvgpu::VmmAllocator::instance();
+      allocator->host_spill = enabled;
+      allocator->host_numa_node = numa_node;
+  }, pybind11::arg("enabled"), pybind11::arg("numa_node") = -1);
+  m.def("tier_of", [](torch::Tensor tensor) {
+      return std::string(nvgpu::memory_tier_name(nvgpu::VmmAllocator::instance()->tier_of(tensor.data_ptr())));
+  });
+  m.def("move_to_tier", [parse_tier](torch::Tensor tensor, const std::string& tier) {
+      nvgpu::MemoryTier target = parse_tier(tier);
+      pybind11::gil_scoped_release release;
+      return nvgpu::VmmAllocator::instance()->move_to_tier(tensor.data_ptr(), target);
+  }, pybind11::arg("tensor"), pybind11::arg("tier"));
+  m.def("tier_stats", []() {
+      auto stats = nvgpu::VmmAllocator::instance()->tier_stats();
+      pybind11::dict result;
+      for (int i = 0; i < (int)nvgpu::MemoryTier::N; i++) {
+        pybind11::dict d;
+        d["blocks"] = stats[i].blocks;
+        d["physical_bytes"] = stats[i].physical_bytes;
+        d["free_block_bytes"] = stats[i].free_block_bytes;
+        d["num_allocs"] = stats[i].num_allocs;
+        d["spilled_allocs"] = stats[i].spilled_allocs;
+        d["moved_in"] = stats[i].moved_in;
+        d["moved_in_bytes"] = stats[i].moved_in_bytes;
+        result[pybind11::str(nvgpu::memory_tier_name((nvgpu::MemoryTier)i))] = d;
+      }
+      return result;
+  });
+
+  // checkpoint / restore
+  m.def("checkpoint", &vmm_checkpoint, pybind11::arg("path"), pybind11::arg("names"), pybind11::arg("tensors"),
+        pybind11::arg("chunk_size") = 8 << 20, pybind11::call_guard<pybind11::gil_scoped_release>());
+  m.def("restore", &vmm_restore, pybind11::arg("path"), pybind11::arg("num_buffers") = 4,
+        pybind11::call_guard<pybind11::gil_scoped_release>());
+  m.def("load_safetensors", &vmm_load_safetensors, pybind11::arg("path"), pybind11::arg("device"),
+        pybind11::arg("num_buffers") = 4, pybind11::arg("chunk_size") = 8 << 20,
+        pybind11::call_guard<pybind11::gil_scoped_release>());
 
   m.def("vmm_alloc", &vmm_alloc);
   m.def("vmm_dealloc", &vmm_dealloc);
 
+  m.def("vmm_tensors", [](std::vector<std::vector<int64_t>> shapes, std::vector<torch::Dtype> dtypes, std::vector<int> devices, size_t alignment, uintptr_t stream) {
+      return vmm_alloc_tensors(shapes, dtypes, devices, alignment, reinterpret_cast<CUstream>(stream));
+  }, pybind11::arg("shapes"), pybind11::arg("dtypes"), pybind11::arg("devices"), pybind11::arg("alignment") = 256, pybind11::arg("stream") = 0);
+
   m.def("vmm_tensor", [](uintptr_t address, std::vector<int64_t> shape, std::vector<int64_t> stride, torch::Dtype dtype, int request_size, int device, uintptr_t stream) {
       return vmm_realloc_tensor(reinterpret_cast<void *>(address), shape, stride, dtype, request_size, device, reinterpret_cast<CUstream>(stream));
   });
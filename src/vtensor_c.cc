@@ -0,0 +1,242 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+#include "vtensor_c.h"
+
+#include "allocator/vmm_allocator.h"
+
+struct vt_allocator {
+  nvgpu::VmmAllocator::Ptr impl;
+};
+
+// no C++ exception may cross the C boundary
+#define VT_TRY(body)                                                           \
+  try {                                                                        \
+    body                                                                       \
+  } catch (const nvgpu::OutOfMemoryError& e) {                                 \
+    return VT_ERROR_OUT_OF_MEMORY;                                             \
+  } catch (const std::exception& e) {                                          \
+    std::cout << "[" << __FUNCTION__ << "] " << e.what() << std::endl;         \
+    return VT_ERROR_UNKNOWN;                                                   \
+  } catch (...) {                                                              \
+    return VT_ERROR_UNKNOWN;                                                   \
+  }
+
+extern "C" {
+
+int vt_abi_version(void) {
+  return VT_ABI_VERSION;
+}
+
+const char* vt_status_string(vt_status_t status) {
+  switch (status) {
+    case VT_SUCCESS: return "success";
+    case VT_ERROR_INVALID_VALUE: return "invalid value";
+    case VT_ERROR_OUT_OF_MEMORY: return "out of memory";
+    case VT_ERROR_NOT_FOUND: return "not found";
+    default: return "unknown error";
+  }
+}
+
+vt_allocator_t* vt_allocator_default(void) {
+  static vt_allocator_t allocator{nvgpu::VmmAllocator::instance()};
+  return &allocator;
+}
+
+vt_status_t vt_allocator_create(vt_allocator_t** allocator) {
+  if (allocator == nullptr) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    *allocator = new vt_allocator_t{std::make_shared<nvgpu::VmmAllocator>()};
+    return VT_SUCCESS;
+  )
+}
+
+void vt_allocator_destroy(vt_allocator_t* allocator) {
+  if (allocator != nullptr && allocator != vt_allocator_default()) {
+    delete allocator;
+  }
+}
+
+vt_status_t vt_alloc(vt_allocator_t* allocator, size_t size, int device, void* stream, void** ptr) {
+  if (allocator == nullptr || ptr == nullptr) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    *ptr = allocator->impl->alloc(size, device, reinterpret_cast<CUstream>(stream));
+    return *ptr == nullptr ? VT_ERROR_OUT_OF_MEMORY : VT_SUCCESS;
+  )
+}
+
+vt_status_t vt_alloc_hinted(vt_allocator_t* allocator, size_t size, int device, void* stream, vt_lifetime_t lifetime, void** ptr) {
+  if (allocator == nullptr || ptr == nullptr || lifetime < VT_LIFETIME_DEFAULT || lifetime > VT_LIFETIME_PERSISTENT) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    *ptr = allocator->impl->alloc(size, device, reinterpret_cast<CUstream>(stream), (nvgpu::Lifetime)lifetime);
+    return *ptr == nullptr ? VT_ERROR_OUT_OF_MEMORY : VT_SUCCESS;
+  )
+}
+
+vt_status_t vt_free(vt_allocator_t* allocator, void* ptr, size_t size, int device, void* stream) {
+  if (allocator == nullptr) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    allocator->impl->dealloc(ptr, size, device, reinterpret_cast<CUstream>(stream));
+    return VT_SUCCESS;
+  )
+}
+
+vt_status_t vt_reserve(vt_allocator_t* allocator, size_t size, int device, void** ptr, size_t* reserved_size) {
+  if (allocator == nullptr || ptr == nullptr || reserved_size == nullptr) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    CUresult result = allocator->impl->reserve_virtual_addr(ptr, size, reserved_size, device, 0/*stream*/);
+    return result == CUDA_SUCCESS ? VT_SUCCESS : VT_ERROR_OUT_OF_MEMORY;
+  )
+}
+
+vt_status_t vt_map(vt_allocator_t* allocator, void* ptr, size_t reserved_size, int device) {
+  if (allocator == nullptr || ptr == nullptr) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    ensure_context(device);
+    CUresult result = allocator->impl->map_reserved(ptr, reserved_size, device);
+    if (result == CUDA_ERROR_OUT_OF_MEMORY) {
+      return VT_ERROR_OUT_OF_MEMORY;
+    }
+    return result == CUDA_SUCCESS ? VT_SUCCESS : VT_ERROR_UNKNOWN;
+  )
+}
+
+vt_status_t vt_unmap(vt_allocator_t* allocator, void* ptr, size_t size, int device) {
+  if (allocator == nullptr) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    ensure_context(device);
+    nvgpu::VmmAllocator::PhyBlock* block = allocator->impl->get_allocated_block(ptr);
+    if (block == nullptr) {
+      return VT_ERROR_NOT_FOUND;
+    }
+    allocator->impl->unmap_virtual_address(block, ptr, size);
+    return VT_SUCCESS;
+  )
+}
+
+vt_status_t vt_get_stats(vt_allocator_t* allocator, vt_stats_t* stats) {
+  if (allocator == nullptr || stats == nullptr || stats->struct_size < sizeof(size_t)) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    nvgpu::AllocatorStats s = allocator->impl->stats();
+    vt_stats_t out = {};
+    out.struct_size = sizeof(vt_stats_t);
+    out.reserved_bytes = s.reserved_bytes;
+    out.num_reservations = s.num_reservations;
+    out.mapped_bytes = s.mapped_bytes;
+    out.num_mappings = s.num_mappings;
+    out.physical_bytes = s.physical_bytes;
+    out.free_block_bytes = s.free_block_bytes;
+    out.num_blocks = s.num_blocks;
+    out.cached_bytes = s.cached_bytes;
+    out.slab_mapped_bytes = s.slab_mapped_bytes;
+    out.slab_allocated_bytes = s.slab_allocated_bytes;
+    // older callers get the prefix they know about
+    size_t n = stats->struct_size < sizeof(vt_stats_t) ? stats->struct_size : sizeof(vt_stats_t);
+    memcpy(stats, &out, n);
+    stats->struct_size = n;
+    return VT_SUCCESS;
+  )
+}
+
+vt_status_t vt_empty_cache(vt_allocator_t* allocator, size_t* released) {
+  if (allocator == nullptr) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    size_t bytes = allocator->impl->empty_cache();
+    if (released != nullptr) {
+      *released = bytes;
+    }
+    return VT_SUCCESS;
+  )
+}
+
+vt_status_t vt_set_placement_policy(vt_allocator_t* allocator, const char* policy) {
+  if (allocator == nullptr || policy == nullptr) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    return allocator->impl->set_placement_policy(policy) ? VT_SUCCESS : VT_ERROR_INVALID_VALUE;
+  )
+}
+
+vt_status_t vt_publish_stats(vt_allocator_t* allocator, const char* name) {
+  if (allocator == nullptr) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    return allocator->impl->publish_stats(name != nullptr ? name : "") ? VT_SUCCESS : VT_ERROR_UNKNOWN;
+  )
+}
+
+vt_status_t vt_set_memory_tag(const char* tag) {
+  if (tag == nullptr) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  VT_TRY(
+    nvgpu::set_current_memory_tag(tag);
+    return VT_SUCCESS;
+  )
+}
+
+vt_status_t vt_set_lifetime(vt_lifetime_t lifetime) {
+  if (lifetime < VT_LIFETIME_DEFAULT || lifetime > VT_LIFETIME_PERSISTENT) {
+    return VT_ERROR_INVALID_VALUE;
+  }
+  nvgpu::set_current_lifetime((nvgpu::Lifetime)lifetime);
+  return VT_SUCCESS;
+}
+
+void* vmm_alloc(ssize_t size, int device, uintptr_t stream) {
+  nvgpu::VmmAllocator::Ptr _allocator = nvgpu::VmmAllocator::instance();
+  // torch raises its own OutOfMemoryError on nullptr, exceptions must not cross the C boundary
+  try {
+    return _allocator->alloc((size_t)size, device, reinterpret_cast<CUstream>(stream));
+  } catch (const std::exception& e) {
+    return nullptr;
+  }
+}
+
+void vmm_dealloc(int64_t address, size_t size, int device, uintptr_t stream) {
+  nvgpu::VmmAllocator::Ptr _allocator = nvgpu::VmmAllocator::instance();
+  // no status to return, report and keep the exception on this side of the C boundary
+  try {
+    _allocator->dealloc(reinterpret_cast<void*>(address), size, device, reinterpret_cast<CUstream>(stream));
+  } catch (const std::exception& e) {
+    std::cout << "[" << __FUNCTION__ << "] " << e.what() << std::endl;
+  }
+}
+
+} // extern "C"
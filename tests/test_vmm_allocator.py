@@ -1,3 +1,4 @@
+import pytest
 import torch
 import vTensor
 from vTensor import get_pluggable_allocator
@@ -106,6 +107,827 @@ def test_vmm_allocator_auto_remapping():
     print(f"✅ Reuse the memory of pre-allocated tensor successuflly")
 
 
+def test_vmm_allocator_placement_policy():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    for policy in ["first_fit", "worst_fit", "segregated_fit", "best_fit"]:
+        assert vTensor.set_placement_policy(policy)
+        assert vTensor.placement_policy() == policy
+
+        shape = (8 * 1024, 1024)
+        x = torch.empty(shape, dtype=torch.float16, device="cuda")
+        x.fill_(1)
+        y = torch.empty(shape, dtype=torch.float16, device="cuda")
+        y.fill_(2)
+        assert torch.all(x + y == 3)
+        del x, y
+
+    assert not vTensor.set_placement_policy("no_such_policy")
+    # transient arenas are bump allocated by address, not through a pool policy
+    assert not vTensor.set_placement_policy("bump")
+    assert vTensor.placement_policy() == "best_fit"
+
+
+def test_vmm_allocator_snapshot():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    vTensor.set_record_stacks(True)
+
+    shape = (8 * 1024, 1024)
+    x = torch.empty(shape, dtype=torch.float16, device="cuda")
+
+    snapshot = vTensor.memory_snapshot()
+    segments = [s for s in snapshot["segments"] if s["address"] == x.data_ptr()]
+    assert len(segments) == 1
+    assert segments[0]["allocated_size"] >= x.numel() * x.element_size()
+    assert segments[0]["blocks"][0]["state"] == "active_allocated"
+    assert len(segments[0]["blocks"][0]["frames"]) > 0
+
+    physical = snapshot["vtensor"]
+    assert any(
+        m["address"] == x.data_ptr() for b in physical["blocks"] for m in b["mappings"]
+    )
+
+    x_ptr = x.data_ptr()
+    del x
+    snapshot = vTensor.memory_snapshot()
+    assert not any(
+        s["address"] == x_ptr and s["allocated_size"] > 0 for s in snapshot["segments"]
+    )
+
+    vTensor.set_record_stacks(False)
+
+
+def test_vmm_allocator_small_tensors():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    # 1000 bias vectors of 4 KB share a handful of 2 MiB chunks
+    biases = [torch.full((1024,), i, dtype=torch.float, device="cuda") for i in range(1000)]
+    stats = vTensor.slab_stats()
+    assert stats["num_allocs"] >= 1000
+    assert stats["mapped_bytes"] <= 4 * 1000 * 1024 + 2 * 1024 * 1024
+
+    for i, b in enumerate(biases):
+        assert torch.all(b == i)
+
+    del biases
+    assert vTensor.slab_stats()["num_allocs"] == 0
+
+
+def test_vmm_allocator_bulk_tensors():
+    torch.tensor([0], device="cuda")  # just to init cuda ctx
+
+    shapes = [(1024, 1024), (3, 5), (4096,), (17, 17, 17)]
+    dtypes = [torch.float16, torch.float32, torch.int64, torch.bfloat16]
+    tensors = vTensor.alloc_tensors(shapes, dtypes, alignment=1024)
+
+    assert [tuple(t.shape) for t in tensors] == shapes
+    assert [t.dtype for t in tensors] == dtypes
+    for t in tensors:
+        assert t.data_ptr() % 1024 == 0
+
+    base = tensors[0].data_ptr()
+    for t in tensors[1:]:
+        assert t.data_ptr() > base
+
+    for i, t in enumerate(tensors):
+        t.fill_(i)
+    for i, t in enumerate(tensors):
+        assert torch.all(t == i)
+
+    del tensors
+
+
+def test_vmm_allocator_graph_pool():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    x = torch.ones((8 * 1024, 1024), dtype=torch.float16, device="cuda")
+
+    # warmup on a side stream, as required by graph capture
+    s = torch.cuda.Stream()
+    s.wait_stream(torch.cuda.current_stream())
+    with torch.cuda.stream(s):
+        y = (x * 2) + 1
+    torch.cuda.current_stream().wait_stream(s)
+
+    g1 = torch.cuda.CUDAGraph()
+    with vTensor.graph_pool() as pool_id:
+        with torch.cuda.graph(g1):
+            tmp = x * 2
+            y1 = tmp + 1
+            del tmp
+
+    # a second graph sharing the pool
+    g2 = torch.cuda.CUDAGraph()
+    with vTensor.graph_pool(pool_id):
+        with torch.cuda.graph(g2):
+            y2 = y1 * 3
+
+    # memory freed outside of the graphs must not alias the graph memory
+    z = torch.full((8 * 1024, 1024), 7, dtype=torch.float16, device="cuda")
+
+    addresses = (y1.data_ptr(), y2.data_ptr())
+    for _ in range(3):
+        x.fill_(2)
+        g1.replay()
+        g2.replay()
+        torch.cuda.synchronize()
+        assert (y1.data_ptr(), y2.data_ptr()) == addresses
+        assert torch.all(y1 == 5)
+        assert torch.all(y2 == 15)
+        assert torch.all(z == 7)
+
+    del g1, g2, y1, y2
+    vTensor.release_graph_pool(pool_id)
+    vTensor.release_graph_pool(pool_id)
+    assert vTensor.pool_cached_size(pool_id) == 0
+
+
+def test_vmm_allocator_tag_quota():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    MB = 1024 * 1024
+    vTensor.set_tag_quota("tenant_a", hard_limit=64 * MB, soft_limit=32 * MB)
+
+    evicted = []
+    kv_cache = []
+
+    def evict(tag, bytes_needed):
+        evicted.append((tag, bytes_needed))
+        freed = 0
+        while kv_cache and freed < bytes_needed:
+            t = kv_cache.pop()
+            freed += t.numel() * t.element_size()
+        return freed
+
+    vTensor.set_eviction_callback(evict)
+
+    with vTensor.memory_tag("tenant_a"):
+        for _ in range(3):
+            kv_cache.append(torch.empty(16 * MB, dtype=torch.uint8, device="cuda"))
+        # over the soft limit : the callback is called
+        assert len(evicted) > 0
+
+        stats = vTensor.tag_stats()["tenant_a"]
+        assert stats["live_bytes"] <= 64 * MB
+
+        vTensor.set_eviction_callback(None)
+        kv_cache.append(torch.empty(32 * MB, dtype=torch.uint8, device="cuda"))
+        try:
+            torch.empty(64 * MB, dtype=torch.uint8, device="cuda")
+            assert False, "the hard limit of tenant_a should reject the allocation"
+        except RuntimeError:
+            pass
+
+    assert vTensor.tag_stats()["tenant_a"]["num_rejected"] >= 1
+    kv_cache.clear()
+    assert vTensor.tag_stats()["tenant_a"]["live_bytes"] == 0
+
+    # a small tensor is charged its slab slot, also at the base of a fresh chunk
+    vTensor.empty_cache()
+    with vTensor.memory_tag("tenant_b"):
+        bias = torch.empty(1000, dtype=torch.uint8, device="cuda")
+    assert vTensor.tag_stats()["tenant_b"]["reserved_bytes"] == 1024
+    del bias
+
+    # a group is charged its whole reservation, and counted with the default lifetime
+    page = vTensor.granularity(torch.cuda.current_device())
+    num_allocs = vTensor.lifetime_stats()["default"]["num_allocs"]
+    with vTensor.memory_tag("tenant_c"):
+        k, v = vTensor.alloc_tensors([[page // 2 + 512], [page // 2 + 512]], torch.uint8)
+    assert vTensor.tag_stats()["tenant_c"]["reserved_bytes"] == 2 * page
+    assert vTensor.lifetime_stats()["default"]["num_allocs"] == num_allocs + 1
+    del k, v
+
+
+def test_vmm_allocator_c_abi():
+    import ctypes
+
+    torch.tensor([0], device="cuda")  # just to init cuda ctx
+
+    # the C ABI is also exported by the extension, libvtensor_core.so exposes the same symbols
+    lib = ctypes.CDLL(vTensor.cpp_ext.__file__)
+    lib.vt_allocator_default.restype = ctypes.c_void_p
+    lib.vt_alloc.argtypes = [
+        ctypes.c_void_p,
+        ctypes.c_size_t,
+        ctypes.c_int,
+        ctypes.c_void_p,
+        ctypes.POINTER(ctypes.c_void_p),
+    ]
+    lib.vt_free.argtypes = [
+        ctypes.c_void_p,
+        ctypes.c_void_p,
+        ctypes.c_size_t,
+        ctypes.c_int,
+        ctypes.c_void_p,
+    ]
+
+    class Stats(ctypes.Structure):
+        _fields_ = [("struct_size", ctypes.c_size_t)] + [
+            (name, ctypes.c_uint64)
+            for name in [
+                "reserved_bytes",
+                "num_reservations",
+                "mapped_bytes",
+                "num_mappings",
+                "physical_bytes",
+                "free_block_bytes",
+                "num_blocks",
+                "cached_bytes",
+                "slab_mapped_bytes",
+                "slab_allocated_bytes",
+            ]
+        ]
+
+    assert lib.vt_abi_version() == 1
+
+    allocator = lib.vt_allocator_default()
+    ptr = ctypes.c_void_p()
+    size = 16 * 1024 * 1024
+    assert lib.vt_alloc(allocator, size, 0, None, ctypes.byref(ptr)) == 0
+    assert ptr.value
+
+    stats = Stats(struct_size=ctypes.sizeof(Stats))
+    assert lib.vt_get_stats(ctypes.c_void_p(allocator), ctypes.byref(stats)) == 0
+    assert stats.mapped_bytes >= size
+
+    assert lib.vt_free(allocator, ptr, size, 0, None) == 0
+
+
+def test_vmm_allocator_out_of_memory():
+    _, total = torch.cuda.mem_get_info()
+
+    pressure = []
+
+    def release(device, bytes_needed):
+        pressure.append((device, bytes_needed))
+        return 0
+
+    callback_id = vTensor.register_pressure_callback(release)
+
+    # more than the device holds : cached blocks are released, the callbacks are asked, then the error is raised
+    oom_type = getattr(torch, "OutOfMemoryError", torch.cuda.OutOfMemoryError)
+    try:
+        vTensor.alloc_tensors([[2 * total]], torch.uint8)
+        assert False, "allocating twice the device memory should fail"
+    except oom_type as e:
+        state = e.allocator_state
+        assert state["requested_bytes"] >= 2 * total
+        assert state["device_total_bytes"] == total
+    finally:
+        vTensor.unregister_pressure_callback(callback_id)
+
+    assert len(pressure) == 1
+    assert "out of memory" in vTensor.last_oom_report()
+
+    # the allocator is still usable
+    x = vTensor.alloc_tensors([[1024 * 1024]], torch.uint8)[0]
+    x.fill_(1)
+    del x
+    vTensor.empty_cache()
+
+
+def test_vmm_allocator_step_prewarm():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    MB = 1024 * 1024
+    vTensor.set_step_prewarm(True, warmup_steps=2)
+
+    def iteration():
+        a = torch.empty(8 * MB, dtype=torch.uint8, device="cuda")
+        b = torch.empty(32 * MB, dtype=torch.uint8, device="cuda")
+        del a
+        c = torch.empty(8 * MB, dtype=torch.uint8, device="cuda")
+        del b, c
+
+    for _ in range(2):
+        with vTensor.step():
+            iteration()
+    stats = vTensor.step_stats()
+    assert stats["learned"]
+    assert stats["predicted_peak_bytes"] >= 40 * MB
+
+    # steady state : every allocation is served by the warm cache
+    misses = stats["misses"]
+    for _ in range(3):
+        with vTensor.step():
+            iteration()
+    stats = vTensor.step_stats()
+    assert stats["misses"] == misses
+    assert stats["hits"] >= 9
+    assert stats["actual_peak_bytes"] <= stats["predicted_peak_bytes"]
+
+    vTensor.set_step_prewarm(False)
+    assert vTensor.step_stats()["warm_bytes"] == 0
+
+
+def test_vmm_allocator_concat():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    page = vTensor.granularity(torch.cuda.current_device())
+    rows = page // (1024 * 4)
+    a = torch.full((rows, 1024), 1.0, device="cuda")
+    b = torch.full((rows, 1024), 2.0, device="cuda")
+    # larger than half a page, smaller tensors live in slab chunks which cannot be aliased
+    c = torch.full((rows // 2 + 8, 1024), 3.0, device="cuda")
+
+    x = vTensor.concat([a, b, c])
+    assert x.shape == (2 * rows + rows // 2 + 8, 1024)
+    assert torch.equal(x, torch.cat([a, b, c]))
+
+    # aliases, not copies
+    x[0, 0] = 42.0
+    torch.cuda.synchronize()
+    assert a[0, 0].item() == 42.0
+
+    # the view keeps the memory alive after the sources are gone
+    del a, b, c
+    assert x[-1, -1].item() == 3.0
+    del x
+
+    # a range must start a mapping
+    y = torch.empty(2 * page, dtype=torch.uint8, device="cuda")
+    try:
+        vTensor.gather_pages([(y.data_ptr() + page, page)], [page], torch.uint8)
+        assert False, "a range inside a mapping cannot be aliased"
+    except ValueError:
+        pass
+
+
+def test_vmm_allocator_scatter():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    page = vTensor.granularity(torch.cuda.current_device())
+    vTensor.empty_cache()
+
+    # four idle blocks of two pages, then one of them partly used by a tensor of one page
+    xs = [torch.empty(2 * page, dtype=torch.uint8, device="cuda") for _ in range(4)]
+    del xs
+    w = torch.full((page // 4,), 7, dtype=torch.float, device="cuda")
+    reused = vTensor.scatter_stats()["reused_bytes"]
+
+    # six pages : only the idle blocks are pieces, the one of w is not mapped twice
+    z = torch.empty(6 * page // 4, dtype=torch.float, device="cuda")
+    stats = vTensor.scatter_stats()
+    assert stats["ranges"] == 1
+    assert stats["pieces"] == 3
+    assert stats["reused_bytes"] == reused + 6 * page
+
+    # one contiguous tensor across the pieces, w keeps its content
+    expected = torch.arange(z.numel(), dtype=torch.float, device="cuda")
+    z.copy_(expected)
+    assert torch.equal(z, expected)
+    assert torch.all(w == 7)
+
+    del w, z
+    assert vTensor.scatter_stats()["ranges"] == 0
+    vTensor.empty_cache()
+
+
+def test_vmm_allocator_bounded_reuse():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    page = vTensor.granularity(torch.cuda.current_device())
+    vTensor.empty_cache()
+
+    # an idle block is mapped whole : a tensor of a page does not pin an idle block of 16 pages
+    x = torch.empty(16 * page, dtype=torch.uint8, device="cuda")
+    del x
+    y = torch.empty(page, dtype=torch.uint8, device="cuda")
+    stats = vTensor.lifetime_stats()["default"]
+    assert stats["blocks"] == 2 and stats["idle_blocks"] == 1 and stats["stranded_bytes"] == 0
+
+    # at least half of it does, the rest of the block shows as stranded
+    z = torch.empty(10 * page, dtype=torch.uint8, device="cuda")
+    stats = vTensor.lifetime_stats()["default"]
+    assert stats["blocks"] == 2 and stats["idle_blocks"] == 0 and stats["stranded_bytes"] == 6 * page
+    del y, z
+    vTensor.empty_cache()
+
+
+def test_vmm_allocator_lifetime():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    page = vTensor.granularity(torch.cuda.current_device())
+    vTensor.empty_cache()
+    vTensor.set_transient_block_size(8 * page)
+
+    # a weight allocated in the middle of the activations of a step
+    with vTensor.lifetime("transient"):
+        acts = [torch.full((page,), i, dtype=torch.uint8, device="cuda") for i in range(3)]
+        with vTensor.lifetime("persistent"):
+            w = torch.ones(page, dtype=torch.uint8, device="cuda")
+        acts += [torch.full((page,), i, dtype=torch.uint8, device="cuda") for i in range(3, 6)]
+    assert vTensor.cpp_ext.lifetime() == "default"
+
+    # the activations are sub-ranges of one arena, each with bytes of its own
+    assert len({a.data_ptr() for a in acts}) == 6
+    for i, a in enumerate(acts):
+        assert torch.all(a == i)
+
+    stats = vTensor.lifetime_stats()
+    assert stats["transient"]["blocks"] == 1
+    assert stats["transient"]["physical_bytes"] == 8 * page
+    assert stats["persistent"]["blocks"] == 1
+
+    # the arena is released once the step is over, the weight does not pin it
+    del acts
+    vTensor.empty_cache()
+    stats = vTensor.lifetime_stats()
+    assert stats["transient"]["blocks"] == 0
+    assert stats["persistent"]["blocks"] == 1
+    assert torch.all(w == 1)
+
+    physical = vTensor.memory_snapshot()["vtensor"]
+    assert any(b["lifetime"] == "persistent" and b["mappings"] for b in physical["blocks"])
+
+    try:
+        vTensor.set_lifetime("forever")
+        assert False
+    except ValueError:
+        pass
+    del w
+    vTensor.empty_cache()
+    vTensor.set_transient_block_size(64 << 20)
+
+
+def test_vmm_allocator_shm_stats():
+    import os
+    import struct
+
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    assert vTensor.publish_stats()
+    device = torch.cuda.current_device()
+
+    # fixed layout of allocator/shm_stats.h : 72 bytes of header, then 128 bytes per device
+    def read():
+        with open(f"/dev/shm/vtensor_stats.{os.getpid()}", "rb") as f:
+            data = f.read()
+        magic, version, size, max_devices, num_driver_calls, pid = struct.unpack_from("8sIIIIq", data, 0)
+        assert magic == b"VTSTATS\0" and version == 1 and pid == os.getpid()
+        reserved, mapped, physical, free_block, cached, allocs, frees = struct.unpack_from("7Q", data, 72 + 128 * device)
+        return mapped, physical, allocs, frees
+
+    mapped, physical, allocs, frees = read()
+    x = torch.empty(64 << 20, dtype=torch.uint8, device="cuda")
+    mapped_after, physical_after, allocs_after, _ = read()
+    assert allocs_after == allocs + 1
+    assert mapped_after >= mapped + (64 << 20)
+    assert physical_after >= mapped_after
+
+    del x
+    _, _, _, frees_after = read()
+    assert frees_after == frees + 1
+
+
+def test_vmm_allocator_trace(tmp_path):
+    import json
+    import os
+
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    path = str(tmp_path / "vtensor_trace.json")
+    with vTensor.trace(path):
+        x = torch.empty(64 << 20, dtype=torch.uint8, device="cuda")
+        del x
+
+    events = json.load(open(path))["traceEvents"]
+    names = {event["name"] for event in events}
+    assert "VmmAllocator::alloc" in names and "VmmAllocator::dealloc" in names
+    assert "cuMemMap" in names and "cuMemSetAccess" in names
+    alloc = next(event for event in events if event["name"] == "VmmAllocator::alloc")
+    assert alloc["ph"] == "X" and alloc["pid"] == os.getpid() and alloc["args"]["bytes"] == 64 << 20
+
+    # nothing is recorded once the trace is stopped
+    count = vTensor.trace_stats()["events"]
+    y = torch.empty(1 << 20, dtype=torch.uint8, device="cuda")
+    del y
+    assert vTensor.trace_stats()["events"] == count
+
+
+def test_vmm_allocator_ring_buffer():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    device = torch.cuda.current_device()
+    page = vTensor.granularity(device)
+    ring = vTensor.RingBuffer(page + 1, device)
+    # rounded up to the granularity
+    capacity = ring.capacity
+    assert capacity == 2 * page and ring.space() == capacity
+
+    # move the cursors close to the end, the next write wraps around
+    n = capacity // 4
+    ring.commit(capacity - n // 2)
+    ring.consume(capacity - n // 2)
+    assert ring.size() == 0 and ring.head == capacity - n // 2
+
+    values = torch.arange(n // 4, dtype=torch.int32, device="cuda")
+    ring.write_view([n // 4], torch.int32).copy_(values)
+    ring.commit(n)
+    assert torch.equal(ring.read_view([n // 4], torch.int32), values)
+
+    # the second half of the window is at the start of the first mapping
+    wrapped = ring.view(0, [n // 8], torch.int32)
+    assert torch.equal(wrapped, values[n // 8:])
+
+    try:
+        ring.write_view([capacity], torch.uint8)
+        assert False, "only the consumed bytes can be written"
+    except ValueError:
+        pass
+    ring.consume(n)
+    assert ring.size() == 0
+
+
+def test_vmm_allocator_sparse():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    page = vTensor.granularity(torch.cuda.current_device())
+    # 8 blocks of one page, nothing populated
+    rows = page // 4
+    handle, tensor = vTensor.sparse_tensor([8, rows], torch.float32, page)
+    assert handle.num_blocks == 8 and handle.num_populated == 0 and handle.physical_bytes == 0
+    assert torch.count_nonzero(tensor).item() == 0
+
+    handle.materialize(2)
+    handle.materialize(5)
+    assert handle.populated(2) and not handle.populated(3)
+    assert handle.physical_bytes == 2 * page
+    tensor[2].fill_(1.0)
+    tensor[5].fill_(2.0)
+    assert tensor.sum().item() == 3 * rows
+    # the empty blocks still read zeros
+    assert torch.count_nonzero(tensor[3]).item() == 0
+
+    torch.cuda.synchronize()
+    handle.release(2)
+    assert handle.num_populated == 1 and handle.physical_bytes == page
+    assert torch.count_nonzero(tensor[2]).item() == 0
+    assert torch.equal(tensor[5], torch.full([rows], 2.0, device="cuda"))
+
+    try:
+        handle.materialize(8)
+        assert False, "block 8 is out of range"
+    except IndexError:
+        pass
+
+
+def symmetric_rank(path, rank, world_size, queue):
+    base = vTensor.init_symmetric_heap(path, rank, world_size, 64 << 20)
+    # private allocations differ per rank, the symmetric ones do not
+    private = [torch.empty(rank + 1, 1 << 20, device="cuda") for _ in range(rank + 1)]
+    a = vTensor.symmetric_tensor([1 << 20], torch.float32)
+    b = vTensor.symmetric_tensor([3, 1000], torch.int64)
+    a.fill_(rank)
+    assert torch.all(a == rank).item()
+    queue.put((rank, base, a.data_ptr(), b.data_ptr(), vTensor.symmetric_offset(b)))
+    del a, b, private
+    vTensor.symmetric_finalize()
+
+
+def test_vmm_allocator_symmetric(tmp_path):
+    import os
+
+    world_size = 2
+    path = os.path.join(str(tmp_path), "vtensor_symmetric")
+    ctx = torch.multiprocessing.get_context("spawn")
+    queue = ctx.Queue()
+    ranks = [ctx.Process(target=symmetric_rank, args=(path, rank, world_size, queue)) for rank in range(world_size)]
+    for p in ranks:
+        p.start()
+    results = sorted(queue.get(timeout=120) for _ in range(world_size))
+    for p in ranks:
+        p.join()
+        assert p.exitcode == 0
+
+    # same base and same addresses on every rank, peers are at the same offsets
+    assert len(set(r[1:] for r in results)) == 1
+    base, a, b, offset = results[0][1:]
+    assert a == base and b == base + offset
+    assert not os.path.exists(path)
+
+
+def test_vmm_allocator_dedup():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    page = vTensor.granularity(torch.cuda.current_device())
+    # two replicas of the same weights, the LoRA variant differs on its last page only
+    base = torch.randn(4 * page // 4, device="cuda")
+    replica = base.clone()
+    variant = base.clone()
+    variant[-1] += 1.0
+    torch.cuda.synchronize()
+
+    saved = vTensor.dedup([base, replica, variant])
+    stats = vTensor.dedup_stats()
+    assert saved == 7 * page
+    assert stats["unique_pages"] == 5
+    assert stats["mapped_pages"] == 12
+    assert stats["collisions"] == 0
+
+    assert torch.equal(base, replica)
+    assert not torch.equal(base, variant)
+    assert torch.equal(base[:-1], variant[:-1])
+
+    # pages are released with their last mapping
+    del base, replica
+    assert vTensor.dedup_stats()["unique_pages"] == 4
+    del variant
+    assert vTensor.dedup_stats()["unique_pages"] == 0
+
+
+@pytest.mark.skipif(torch.cuda.device_count() < 2, reason="needs two GPUs")
+def test_vmm_allocator_migrate():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    page = vTensor.granularity(0)
+    x = torch.randn(4 * page // 4, device="cuda:0")
+    expected = x.cpu()
+    address = x.data_ptr()
+
+    # one block of four pages moves by pages, each one mapped from a block of its own
+    steps = 0
+    for left in vTensor.migrate_incrementally(x, 1, page):
+        steps += 1
+        # the tensor keeps working between the steps, writes included
+        assert torch.equal(x.cpu(), expected)
+        x[-1] = steps
+        expected[-1] = steps
+    assert steps == 4 and left == 0
+
+    assert x.data_ptr() == address
+    assert torch.equal(x.cpu(), expected)
+    x += 1.0
+    assert torch.equal(x.cpu(), expected + 1.0)
+
+    stats = vTensor.migration_stats()
+    assert stats["active"] == 0 and stats["completed"] >= 1 and stats["pages"] >= 4
+    del x
+
+
+def test_vmm_allocator_host_tier():
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    page = vTensor.granularity(torch.cuda.current_device())
+    vTensor.empty_cache()
+
+    # the allocations of a tag placed in host memory, read by kernels in place
+    vTensor.set_tag_tier("cold", "host")
+    with vTensor.memory_tag("cold"):
+        kv = torch.full((4 * page // 4,), 2.0, device="cuda")
+    assert vTensor.tier_of(kv) == "host"
+    assert kv.sum().item() == 2.0 * kv.numel()
+    stats = vTensor.tier_stats()
+    assert stats["host"]["blocks"] >= 1 and stats["host"]["num_allocs"] >= 1
+
+    # back to the device and out again, the tensor keeps its address and content. The range moves by pieces and
+    # keeps them, every piece follows it
+    before = vTensor.tier_stats()
+    address = kv.data_ptr()
+    kv.copy_(torch.arange(kv.numel(), dtype=kv.dtype, device="cuda"))
+    expected = kv.clone()
+    assert vTensor.move_to_tier(kv, "device") == 4 * page
+    assert vTensor.tier_of(kv) == "device" and vTensor.tier_of(kv[-1:]) == "device" and kv.data_ptr() == address
+    assert torch.equal(kv, expected)
+    kv += 1.0
+    assert vTensor.move_to_tier(kv, "host") == 4 * page
+    assert vTensor.tier_of(kv) == "host" and vTensor.tier_of(kv[-1:]) == "host"
+    assert vTensor.move_to_tier(kv, "host") == 0
+    assert torch.equal(kv, expected + 1.0)
+    stats = vTensor.tier_stats()
+    assert stats["host"]["moved_in"] == before["host"]["moved_in"] + 1
+    assert stats["device"]["moved_in"] == before["device"]["moved_in"] + 1
+    assert stats["host"]["moved_in_bytes"] == before["host"]["moved_in_bytes"] + 4 * page
+
+    # only whole allocations move
+    try:
+        vTensor.move_to_tier(kv[page // 4:], "device")
+        assert False
+    except ValueError:
+        pass
+    assert vTensor.tier_of(kv) == "host"
+
+    physical = vTensor.memory_snapshot()["vtensor"]
+    assert any(b["tier"] == "host" and b["mappings"] for b in physical["blocks"])
+
+    try:
+        vTensor.set_tag_tier("cold", "disk")
+        assert False
+    except ValueError:
+        pass
+    vTensor.set_tag_tier("cold", "device")
+    del kv
+    vTensor.empty_cache()
+    assert vTensor.tier_stats()["host"]["blocks"] == 0
+
+
+def test_vmm_allocator_checkpoint_host(tmp_path):
+    # host stand-in for the device : runs without a GPU
+    tensors = {
+        "weight": torch.randn(1024, 1024),
+        "bias": torch.arange(1000, dtype=torch.int32),
+        "scalar": torch.tensor(3.5, dtype=torch.float64),
+    }
+    path = str(tmp_path / "vtensor_host.ckpt")
+    written = vTensor.save_checkpoint(path, tensors, chunk_size=1 << 20)
+    assert written > sum(t.numel() * t.element_size() for t in tensors.values())
+
+    restored = vTensor.load_checkpoint(path, num_buffers=2)
+    assert list(restored.keys()) == list(tensors.keys())
+    for name, t in tensors.items():
+        assert restored[name].dtype == t.dtype
+        assert torch.equal(restored[name], t)
+
+    # a corrupt segment count is rejected before anything is allocated
+    import struct
+    with open(path, "r+b") as f:
+        f.seek(12)
+        f.write(struct.pack("<I", 0xffffffff))
+    try:
+        vTensor.load_checkpoint(path)
+        assert False
+    except RuntimeError as e:
+        assert "truncated" in str(e)
+
+
+def test_vmm_allocator_checkpoint(tmp_path):
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    # k and v share one reservation, restore keeps them in one allocation at the same offsets
+    k, v = vTensor.alloc_tensors([[64, 1024], [64, 1024]], torch.float16)
+    k.normal_()
+    v.normal_()
+    w = torch.randn(4096, 256, device="cuda")
+    path = str(tmp_path / "vtensor.ckpt")
+    vTensor.save_checkpoint(path, {"k": k, "v": v, "w": w})
+
+    restored, layout = vTensor.load_checkpoint(path, return_layout=True)
+    assert "segments" in layout
+    for name, t in {"k": k, "v": v, "w": w}.items():
+        assert torch.equal(restored[name], t)
+    offset = v.data_ptr() - k.data_ptr()
+    assert restored["v"].data_ptr() - restored["k"].data_ptr() == offset
+
+
+def write_safetensors(path, tensors):
+    import json
+    import struct
+
+    dtypes = {torch.float32: "F32", torch.bfloat16: "BF16", torch.int64: "I64", torch.uint8: "U8"}
+    header, chunks, offset = {"__metadata__": {"format": "pt"}}, [], 0
+    for name, t in tensors.items():
+        data = t.contiguous().view(torch.uint8).numpy().tobytes() if t.numel() else b""
+        header[name] = {"dtype": dtypes[t.dtype], "shape": list(t.shape), "data_offsets": [offset, offset + len(data)]}
+        chunks.append(data)
+        offset += len(data)
+    encoded = json.dumps(header).encode()
+    with open(path, "wb") as f:
+        f.write(struct.pack("<Q", len(encoded)) + encoded + b"".join(chunks))
+
+
+def test_vmm_allocator_safetensors(tmp_path):
+    vmm_allocator_torch_api = get_pluggable_allocator()
+    torch.cuda.change_current_allocator(vmm_allocator_torch_api)
+
+    tensors = {
+        "embed": torch.randn(3000, 257).to(torch.bfloat16),
+        "norm": torch.randn(257),
+        "positions": torch.arange(17, dtype=torch.int64),
+        "mask": torch.randint(0, 255, (1001,), dtype=torch.uint8),
+    }
+    path = str(tmp_path / "vtensor_weights.safetensors")
+    write_safetensors(path, tensors)
+
+    # chunks smaller than the tensors : several staging buffers in flight
+    for device in (torch.cuda.current_device(), -1):
+        loaded = vTensor.load_safetensors(path, device, num_buffers=2, chunk_size=64 << 10)
+        assert list(loaded.keys()) == list(tensors.keys())
+        for name, t in tensors.items():
+            assert loaded[name].dtype == t.dtype and loaded[name].shape == t.shape
+            assert torch.equal(loaded[name].cpu(), t)
+            assert loaded[name].data_ptr() % 256 == 0
+
+
 def test_vmm_allocator_resume():
     pass
 
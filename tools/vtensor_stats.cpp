@@ -0,0 +1,341 @@
+/* Copyright 2025 vTensor authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Reader of the allocator counters published to shared memory (VTENSOR_SHM_STATS=1 or VmmAllocator::publish_stats).
+//
+// The segment is mapped read only : reading never blocks nor slows down the serving process. Without --interval
+// the counters are printed once, with it the allocation rates and driver latencies of every interval are printed
+// until interrupted. --prometheus prints the text exposition format instead, e.g. for the node exporter textfile
+// collector or a scrape endpoint wrapping this tool.
+//
+// Build & run :
+//
+//   g++ -O2 -std=c++17 -I include/vtensor -o vtensor_stats tools/vtensor_stats.cpp -lrt
+//   VTENSOR_SHM_STATS=1 python serve.py &
+//   ./vtensor_stats $!
+//   ./vtensor_stats --prometheus /vtensor_stats.1234
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "allocator/shm_stats.h"
+
+using namespace nvgpu;
+
+struct DeviceCounters {
+    uint64_t reserved_bytes = 0;
+    uint64_t mapped_bytes = 0;
+    uint64_t physical_bytes = 0;
+    uint64_t free_block_bytes = 0;
+    uint64_t cached_bytes = 0;
+    uint64_t num_allocs = 0;
+    uint64_t num_frees = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t freed_bytes = 0;
+    uint64_t num_ooms = 0;
+
+    bool used() const {
+        return physical_bytes > 0 || reserved_bytes > 0 || num_allocs > 0 || num_ooms > 0;
+    }
+};
+
+struct DriverCounters {
+    uint64_t calls = 0;
+    uint64_t errors = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+// one read of every counter, each one consistent on its own
+struct Sample {
+    int64_t pid = 0;
+    std::vector<DeviceCounters> devices;
+    std::vector<DriverCounters> driver;
+};
+
+static void usage(const char* argv0) {
+    std::fprintf(stderr,
+        "usage : %s [--prometheus] [--interval SECONDS] [PID | SEGMENT]\n"
+        "  reads the counters published by a process running with VTENSOR_SHM_STATS, by default the only\n"
+        "  /vtensor_stats.<pid> segment of the host.\n", argv0);
+}
+
+static std::vector<std::string> list_segments() {
+    std::vector<std::string> names;
+    DIR* dir = opendir("/dev/shm");
+    if (dir == nullptr) {
+        return names;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (std::strncmp(entry->d_name, "vtensor_stats.", 14) == 0) {
+            names.push_back(std::string("/") + entry->d_name);
+        }
+    }
+    closedir(dir);
+    return names;
+}
+
+static const ShmStatsSegment* open_segment(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        std::fprintf(stderr, "cannot open %s : %s\n", name.c_str(), std::strerror(errno));
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmStatsSegment)) {
+        std::fprintf(stderr, "%s is not a vTensor stats segment\n", name.c_str());
+        close(fd);
+        return nullptr;
+    }
+    void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        std::fprintf(stderr, "cannot map %s : %s\n", name.c_str(), std::strerror(errno));
+        return nullptr;
+    }
+
+    const ShmStatsSegment* segment = static_cast<const ShmStatsSegment*>(ptr);
+    if (std::memcmp(segment->magic, kShmStatsMagic, sizeof(kShmStatsMagic)) != 0) {
+        std::fprintf(stderr, "%s is not a vTensor stats segment, or is being initialized\n", name.c_str());
+        return nullptr;
+    }
+    // newer writers only append fields
+    if (segment->version < kShmStatsVersion || segment->size < sizeof(ShmStatsSegment)) {
+        std::fprintf(stderr, "%s has layout version %u, this reader needs %u\n", name.c_str(), segment->version, kShmStatsVersion);
+        return nullptr;
+    }
+    return segment;
+}
+
+static Sample read_sample(const ShmStatsSegment* segment) {
+    Sample sample;
+    sample.pid = segment->pid;
+    int num_devices = std::min<int>(segment->max_devices, kShmStatsMaxDevices);
+    for (int i = 0; i < num_devices; i++) {
+        const ShmDeviceStats& d = segment->devices[i];
+        DeviceCounters c;
+        c.reserved_bytes = d.reserved_bytes.load(std::memory_order_relaxed);
+        c.mapped_bytes = d.mapped_bytes.load(std::memory_order_relaxed);
+        c.physical_bytes = d.physical_bytes.load(std::memory_order_relaxed);
+        c.free_block_bytes = d.free_block_bytes.load(std::memory_order_relaxed);
+        c.cached_bytes = d.cached_bytes.load(std::memory_order_relaxed);
+        c.num_allocs = d.num_allocs.load(std::memory_order_relaxed);
+        c.num_frees = d.num_frees.load(std::memory_order_relaxed);
+        c.allocated_bytes = d.allocated_bytes.load(std::memory_order_relaxed);
+        c.freed_bytes = d.freed_bytes.load(std::memory_order_relaxed);
+        c.num_ooms = d.num_ooms.load(std::memory_order_relaxed);
+        sample.devices.push_back(c);
+    }
+    int num_calls = std::min<int>(segment->num_driver_calls, (int)DriverCall::N);
+    for (int i = 0; i < num_calls; i++) {
+        const ShmDriverStats& d = segment->driver[i];
+        DriverCounters c;
+        c.calls = d.calls.load(std::memory_order_relaxed);
+        c.errors = d.errors.load(std::memory_order_relaxed);
+        c.total_ns = d.total_ns.load(std::memory_order_relaxed);
+        c.max_ns = d.max_ns.load(std::memory_order_relaxed);
+        sample.driver.push_back(c);
+    }
+    return sample;
+}
+
+static double mib(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+static void print_text(const Sample& sample) {
+    std::printf("vTensor allocator of pid %lld\n\n", (long long)sample.pid);
+    std::printf("%-6s %12s %12s %12s %12s %12s %12s %12s %6s\n", "device", "reserved MiB", "mapped MiB",
+                "physical MiB", "free blk MiB", "cached MiB", "allocs", "frees", "ooms");
+    for (size_t i = 0; i < sample.devices.size(); i++) {
+        const DeviceCounters& c = sample.devices[i];
+        if (!c.used()) {
+            continue;
+        }
+        std::printf("%-6zu %12.1f %12.1f %12.1f %12.1f %12.1f %12llu %12llu %6llu\n", i, mib(c.reserved_bytes),
+                    mib(c.mapped_bytes), mib(c.physical_bytes), mib(c.free_block_bytes), mib(c.cached_bytes),
+                    (unsigned long long)c.num_allocs, (unsigned long long)c.num_frees, (unsigned long long)c.num_ooms);
+    }
+
+    std::printf("\n%-20s %10s %8s %10s %10s\n", "driver call", "calls", "errors", "avg us", "max us");
+    for (size_t i = 0; i < sample.driver.size(); i++) {
+        const DriverCounters& c = sample.driver[i];
+        double avg_us = c.calls > 0 ? c.total_ns / 1e3 / c.calls : 0;
+        std::printf("%-20s %10llu %8llu %10.1f %10.1f\n", driver_call_name((DriverCall)i), (unsigned long long)c.calls,
+                    (unsigned long long)c.errors, avg_us, c.max_ns / 1e3);
+    }
+}
+
+// rates between two samples
+static void print_interval(const Sample& prev, const Sample& cur, double seconds) {
+    std::printf("%-6s %12s %12s %12s %12s %10s %10s\n", "device", "mapped MiB", "physical MiB", "allocs/s", "frees/s",
+                "alloc MB/s", "ooms");
+    for (size_t i = 0; i < cur.devices.size(); i++) {
+        const DeviceCounters& c = cur.devices[i];
+        const DeviceCounters& p = prev.devices[i];
+        if (!c.used()) {
+            continue;
+        }
+        std::printf("%-6zu %12.1f %12.1f %12.0f %12.0f %10.1f %10llu\n", i, mib(c.mapped_bytes), mib(c.physical_bytes),
+                    (c.num_allocs - p.num_allocs) / seconds, (c.num_frees - p.num_frees) / seconds,
+                    (c.allocated_bytes - p.allocated_bytes) / 1e6 / seconds, (unsigned long long)(c.num_ooms - p.num_ooms));
+    }
+    for (size_t i = 0; i < cur.driver.size(); i++) {
+        uint64_t calls = cur.driver[i].calls - prev.driver[i].calls;
+        if (calls == 0) {
+            continue;
+        }
+        double avg_us = (cur.driver[i].total_ns - prev.driver[i].total_ns) / 1e3 / calls;
+        std::printf("  %-20s %8.0f calls/s %8.1f us avg\n", driver_call_name((DriverCall)i), calls / seconds, avg_us);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+static void print_metric(const char* name, const char* type, const char* help) {
+    std::printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void print_prometheus(const Sample& sample) {
+    struct Field {
+        const char* name;
+        const char* type;
+        const char* help;
+        uint64_t DeviceCounters::*value;
+    };
+    static const Field fields[] = {
+        {"vtensor_reserved_bytes", "gauge", "Virtual address space reserved by the allocator.", &DeviceCounters::reserved_bytes},
+        {"vtensor_mapped_bytes", "gauge", "Virtual addresses mapped to physical memory.", &DeviceCounters::mapped_bytes},
+        {"vtensor_physical_bytes", "gauge", "Physical memory held by the allocator.", &DeviceCounters::physical_bytes},
+        {"vtensor_free_block_bytes", "gauge", "Physical memory held by the allocator without mapping.", &DeviceCounters::free_block_bytes},
+        {"vtensor_cached_bytes", "gauge", "Freed ranges kept mapped by the graph pools and the step warm cache.", &DeviceCounters::cached_bytes},
+        {"vtensor_allocs_total", "counter", "Allocations served.", &DeviceCounters::num_allocs},
+        {"vtensor_frees_total", "counter", "Deallocations.", &DeviceCounters::num_frees},
+        {"vtensor_allocated_bytes_total", "counter", "Bytes requested by the allocations.", &DeviceCounters::allocated_bytes},
+        {"vtensor_freed_bytes_total", "counter", "Bytes released by the deallocations.", &DeviceCounters::freed_bytes},
+        {"vtensor_ooms_total", "counter", "Out of memory errors raised.", &DeviceCounters::num_ooms},
+    };
+    for (const Field& field : fields) {
+        print_metric(field.name, field.type, field.help);
+        for (size_t i = 0; i < sample.devices.size(); i++) {
+            if (sample.devices[i].used()) {
+                std::printf("%s{pid=\"%lld\",device=\"%zu\"} %llu\n", field.name, (long long)sample.pid, i,
+                            (unsigned long long)(sample.devices[i].*field.value));
+            }
+        }
+    }
+
+    print_metric("vtensor_driver_calls_total", "counter", "Driver calls of the allocator.");
+    for (size_t i = 0; i < sample.driver.size(); i++) {
+        std::printf("vtensor_driver_calls_total{pid=\"%lld\",call=\"%s\"} %llu\n", (long long)sample.pid,
+                    driver_call_name((DriverCall)i), (unsigned long long)sample.driver[i].calls);
+    }
+    print_metric("vtensor_driver_errors_total", "counter", "Driver calls which failed.");
+    for (size_t i = 0; i < sample.driver.size(); i++) {
+        std::printf("vtensor_driver_errors_total{pid=\"%lld\",call=\"%s\"} %llu\n", (long long)sample.pid,
+                    driver_call_name((DriverCall)i), (unsigned long long)sample.driver[i].errors);
+    }
+    print_metric("vtensor_driver_call_seconds_total", "counter", "Time spent in the driver calls.");
+    for (size_t i = 0; i < sample.driver.size(); i++) {
+        std::printf("vtensor_driver_call_seconds_total{pid=\"%lld\",call=\"%s\"} %.9f\n", (long long)sample.pid,
+                    driver_call_name((DriverCall)i), sample.driver[i].total_ns / 1e9);
+    }
+    print_metric("vtensor_driver_call_max_seconds", "gauge", "Slowest driver call since the process started.");
+    for (size_t i = 0; i < sample.driver.size(); i++) {
+        std::printf("vtensor_driver_call_max_seconds{pid=\"%lld\",call=\"%s\"} %.9f\n", (long long)sample.pid,
+                    driver_call_name((DriverCall)i), sample.driver[i].max_ns / 1e9);
+    }
+}
+
+int main(int argc, char** argv) {
+    bool prometheus = false;
+    double interval = 0;
+    std::string target;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--prometheus") {
+            prometheus = true;
+        } else if (arg == "--interval" && i + 1 < argc) {
+            interval = std::atof(argv[++i]);
+        } else if (!arg.empty() && arg[0] != '-' && target.empty()) {
+            target = arg;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::string name;
+    if (target.empty()) {
+        std::vector<std::string> segments = list_segments();
+        if (segments.size() != 1) {
+            std::fprintf(stderr, segments.empty() ? "no vTensor stats segment found\n" : "several segments, pick one :\n");
+            for (auto& segment : segments) {
+                std::fprintf(stderr, "  %s\n", segment.c_str());
+            }
+            return 1;
+        }
+        name = segments[0];
+    } else if (target.find_first_not_of("0123456789") == std::string::npos) {
+        name = default_shm_stats_name(std::atoll(target.c_str()));
+    } else {
+        name = target[0] == '/' ? target : "/" + target;
+    }
+
+    const ShmStatsSegment* segment = open_segment(name);
+    if (segment == nullptr) {
+        return 1;
+    }
+
+    Sample prev = read_sample(segment);
+    if (interval <= 0) {
+        if (prometheus) {
+            print_prometheus(prev);
+        } else {
+            print_text(prev);
+        }
+        return 0;
+    }
+
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+        Sample cur = read_sample(segment);
+        if (prometheus) {
+            print_prometheus(cur);
+            std::printf("\n");
+            std::fflush(stdout);
+        } else {
+            print_interval(prev, cur, interval);
+        }
+        prev = cur;
+        // the writer unlinks the segment at exit, the mapping keeps the last values
+        if (kill((pid_t)cur.pid, 0) != 0 && errno == ESRCH) {
+            return 0;
+        }
+    }
+}